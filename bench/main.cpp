@@ -0,0 +1,1578 @@
+//------------------------------------------------------------------------------
+//
+// Contributors:
+//             1) Tommy Hinks
+//
+//------------------------------------------------------------------------------
+
+#include <thx.hpp>
+#include <thx_expr.hpp>
+#include <thx_quat_algo.hpp>
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+//! Random value in the range [-1..1].
+template<typename S> inline
+S
+makeRandUnit()
+{
+  return static_cast<S>(2*(static_cast<double>(rand())/RAND_MAX) - 1);
+}
+
+//! Matrix with random elements in the range [-1..1].
+template<class M>
+M
+makeRandMat()
+{
+  typedef typename M::value_type value_type;
+  M a;
+  for (int i = 0; i < M::linear_size; ++i) {
+    a[i] = makeRandUnit<value_type>();
+  }
+  return a;
+}
+
+//! Vector with random elements in the range [-1..1].
+template<class V>
+V
+makeRandVec()
+{
+  typedef typename V::value_type value_type;
+  V v;
+  for (std::size_t i = 0; i < V::linear_size; ++i) {
+    v[i] = makeRandUnit<value_type>();
+  }
+  return v;
+}
+
+//------------------------------------------------------------------------------
+
+// Single-element kernels.
+// -----------------------
+//
+// One benchmark per public vec_algo, mat_algo and quat_algo function, for the
+// specialized sizes N = 2, 3, 4 and one generic size. Operands are passed 
+// through DoNotOptimize so that the results are not computed at compile-time.
+
+//! vec_add.
+template<std::size_t N, typename S>
+void
+BM_vec_add(benchmark::State& state)
+{
+  srand(1981);
+  thx::vec<N,S> u = makeRandVec<thx::vec<N,S>>();
+  thx::vec<N,S> v = makeRandVec<thx::vec<N,S>>();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(u);
+    benchmark::DoNotOptimize(v);
+    thx::vec<N,S> w = thx::vec_add(u, v);
+    benchmark::DoNotOptimize(w);
+  }
+}
+
+//! dot.
+template<std::size_t N, typename S>
+void
+BM_dot(benchmark::State& state)
+{
+  srand(1981);
+  thx::vec<N,S> u = makeRandVec<thx::vec<N,S>>();
+  thx::vec<N,S> v = makeRandVec<thx::vec<N,S>>();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(u);
+    benchmark::DoNotOptimize(v);
+    S d = thx::dot(u, v);
+    benchmark::DoNotOptimize(d);
+  }
+}
+
+//! cross, only defined for N = 2 (scalar result) and N = 3.
+template<std::size_t N, typename S>
+void
+BM_cross(benchmark::State& state)
+{
+  srand(1981);
+  thx::vec<N,S> u = makeRandVec<thx::vec<N,S>>();
+  thx::vec<N,S> v = makeRandVec<thx::vec<N,S>>();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(u);
+    benchmark::DoNotOptimize(v);
+    auto w = thx::cross(u, v);
+    benchmark::DoNotOptimize(w);
+  }
+}
+
+//! normalize.
+template<std::size_t N, typename S>
+void
+BM_normalize(benchmark::State& state)
+{
+  srand(1981);
+  thx::vec<N,S> v = makeRandVec<thx::vec<N,S>>();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(v);
+    thx::vec<N,S> w = v;
+    thx::normalize(w);
+    benchmark::DoNotOptimize(w);
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_vec_add, 2, thx::float32);
+BENCHMARK_TEMPLATE(BM_vec_add, 3, thx::float32);
+BENCHMARK_TEMPLATE(BM_vec_add, 4, thx::float32);
+BENCHMARK_TEMPLATE(BM_vec_add, 8, thx::float32);
+BENCHMARK_TEMPLATE(BM_vec_add, 2, thx::float64);
+BENCHMARK_TEMPLATE(BM_vec_add, 3, thx::float64);
+BENCHMARK_TEMPLATE(BM_vec_add, 4, thx::float64);
+BENCHMARK_TEMPLATE(BM_vec_add, 8, thx::float64);
+BENCHMARK_TEMPLATE(BM_dot, 2, thx::float32);
+BENCHMARK_TEMPLATE(BM_dot, 3, thx::float32);
+BENCHMARK_TEMPLATE(BM_dot, 4, thx::float32);
+BENCHMARK_TEMPLATE(BM_dot, 8, thx::float32);
+BENCHMARK_TEMPLATE(BM_dot, 2, thx::float64);
+BENCHMARK_TEMPLATE(BM_dot, 3, thx::float64);
+BENCHMARK_TEMPLATE(BM_dot, 4, thx::float64);
+BENCHMARK_TEMPLATE(BM_dot, 8, thx::float64);
+BENCHMARK_TEMPLATE(BM_cross, 2, thx::float32);
+BENCHMARK_TEMPLATE(BM_cross, 3, thx::float32);
+BENCHMARK_TEMPLATE(BM_cross, 2, thx::float64);
+BENCHMARK_TEMPLATE(BM_cross, 3, thx::float64);
+BENCHMARK_TEMPLATE(BM_normalize, 2, thx::float32);
+BENCHMARK_TEMPLATE(BM_normalize, 3, thx::float32);
+BENCHMARK_TEMPLATE(BM_normalize, 4, thx::float32);
+BENCHMARK_TEMPLATE(BM_normalize, 8, thx::float32);
+BENCHMARK_TEMPLATE(BM_normalize, 2, thx::float64);
+BENCHMARK_TEMPLATE(BM_normalize, 3, thx::float64);
+BENCHMARK_TEMPLATE(BM_normalize, 4, thx::float64);
+BENCHMARK_TEMPLATE(BM_normalize, 8, thx::float64);
+
+//! mat<N,S> multiplication.
+template<std::size_t N, typename S>
+void
+BM_mat_mult(benchmark::State& state)
+{
+  srand(1981);
+  thx::mat<N,S> a = makeRandMat<thx::mat<N,S>>();
+  thx::mat<N,S> b = makeRandMat<thx::mat<N,S>>();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(a);
+    benchmark::DoNotOptimize(b);
+    thx::mat<N,S> c = thx::mult(a, b);
+    benchmark::DoNotOptimize(c);
+  }
+}
+
+//! determinant, only specialized for N = 2, 3, 4.
+template<std::size_t N, typename S>
+void
+BM_determinant(benchmark::State& state)
+{
+  srand(1981);
+  thx::mat<N,S> a = makeRandMat<thx::mat<N,S>>();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(a);
+    S d = thx::determinant(a);
+    benchmark::DoNotOptimize(d);
+  }
+}
+
+//! transposed.
+template<std::size_t N, typename S>
+void
+BM_transposed(benchmark::State& state)
+{
+  srand(1981);
+  thx::mat<N,S> a = makeRandMat<thx::mat<N,S>>();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(a);
+    thx::mat<N,S> b = thx::transposed(a);
+    benchmark::DoNotOptimize(b);
+  }
+}
+
+//! inverted, closed form for N = 2, 3, Gram-Schmidt for N = 4 and 
+//! gauss_jacobi otherwise.
+template<std::size_t N, typename S>
+void
+BM_inverted(benchmark::State& state)
+{
+  srand(1981);
+  thx::mat<N,S> a = makeRandMat<thx::mat<N,S>>();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(a);
+    thx::mat<N,S> b = thx::inverted(a);
+    benchmark::DoNotOptimize(b);
+  }
+}
+
+//! gauss_jacobi, solving for the inverse.
+template<std::size_t N, typename S>
+void
+BM_gauss_jacobi(benchmark::State& state)
+{
+  srand(1981);
+  thx::mat<N,S> const a = makeRandMat<thx::mat<N,S>>();
+  for (auto _ : state) {
+    thx::mat<N,S> c = a; // Copy.
+    thx::mat<N,S> b(1);  // Identity.
+    benchmark::DoNotOptimize(c);
+    bool ok = thx::gauss_jacobi(c, b);
+    benchmark::DoNotOptimize(ok);
+    benchmark::DoNotOptimize(b);
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_mat_mult, 2, thx::float32);
+BENCHMARK_TEMPLATE(BM_mat_mult, 3, thx::float32);
+BENCHMARK_TEMPLATE(BM_mat_mult, 4, thx::float32);
+BENCHMARK_TEMPLATE(BM_mat_mult, 6, thx::float32);
+BENCHMARK_TEMPLATE(BM_mat_mult, 2, thx::float64);
+BENCHMARK_TEMPLATE(BM_mat_mult, 3, thx::float64);
+BENCHMARK_TEMPLATE(BM_mat_mult, 4, thx::float64);
+BENCHMARK_TEMPLATE(BM_mat_mult, 6, thx::float64);
+BENCHMARK_TEMPLATE(BM_determinant, 2, thx::float32);
+BENCHMARK_TEMPLATE(BM_determinant, 3, thx::float32);
+BENCHMARK_TEMPLATE(BM_determinant, 4, thx::float32);
+BENCHMARK_TEMPLATE(BM_determinant, 2, thx::float64);
+BENCHMARK_TEMPLATE(BM_determinant, 3, thx::float64);
+BENCHMARK_TEMPLATE(BM_determinant, 4, thx::float64);
+BENCHMARK_TEMPLATE(BM_transposed, 2, thx::float32);
+BENCHMARK_TEMPLATE(BM_transposed, 3, thx::float32);
+BENCHMARK_TEMPLATE(BM_transposed, 4, thx::float32);
+BENCHMARK_TEMPLATE(BM_transposed, 6, thx::float32);
+BENCHMARK_TEMPLATE(BM_transposed, 2, thx::float64);
+BENCHMARK_TEMPLATE(BM_transposed, 3, thx::float64);
+BENCHMARK_TEMPLATE(BM_transposed, 4, thx::float64);
+BENCHMARK_TEMPLATE(BM_transposed, 6, thx::float64);
+BENCHMARK_TEMPLATE(BM_inverted, 2, thx::float32);
+BENCHMARK_TEMPLATE(BM_inverted, 3, thx::float32);
+BENCHMARK_TEMPLATE(BM_inverted, 4, thx::float32);
+BENCHMARK_TEMPLATE(BM_inverted, 6, thx::float32);
+BENCHMARK_TEMPLATE(BM_inverted, 2, thx::float64);
+BENCHMARK_TEMPLATE(BM_inverted, 3, thx::float64);
+BENCHMARK_TEMPLATE(BM_inverted, 4, thx::float64);
+BENCHMARK_TEMPLATE(BM_inverted, 6, thx::float64);
+BENCHMARK_TEMPLATE(BM_gauss_jacobi, 2, thx::float32);
+BENCHMARK_TEMPLATE(BM_gauss_jacobi, 3, thx::float32);
+BENCHMARK_TEMPLATE(BM_gauss_jacobi, 4, thx::float32);
+BENCHMARK_TEMPLATE(BM_gauss_jacobi, 6, thx::float32);
+BENCHMARK_TEMPLATE(BM_gauss_jacobi, 2, thx::float64);
+BENCHMARK_TEMPLATE(BM_gauss_jacobi, 3, thx::float64);
+BENCHMARK_TEMPLATE(BM_gauss_jacobi, 4, thx::float64);
+BENCHMARK_TEMPLATE(BM_gauss_jacobi, 6, thx::float64);
+
+//! affine<S> composition, compare with BM_mat_mult<4,S>.
+template<typename S>
+void
+BM_affine_mult(benchmark::State& state)
+{
+  srand(1981);
+  thx::affine<S> a(makeRandMat<thx::mat<4,S>>());
+  thx::affine<S> b(makeRandMat<thx::mat<4,S>>());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(a);
+    benchmark::DoNotOptimize(b);
+    thx::affine<S> c = thx::mult(a, b);
+    benchmark::DoNotOptimize(c);
+  }
+}
+
+//! affine<S> rigid inverse, compare with BM_inverted<4,S>.
+template<typename S>
+void
+BM_affine_inverted_rigid(benchmark::State& state)
+{
+  srand(1981);
+  thx::affine<S> a(makeRandMat<thx::mat<4,S>>());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(a);
+    thx::affine<S> b = thx::inverted_rigid(a);
+    benchmark::DoNotOptimize(b);
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_affine_mult, thx::float32);
+BENCHMARK_TEMPLATE(BM_affine_mult, thx::float64);
+BENCHMARK_TEMPLATE(BM_affine_inverted_rigid, thx::float32);
+BENCHMARK_TEMPLATE(BM_affine_inverted_rigid, thx::float64);
+
+//! dual_quat<S> composition.
+template<typename S>
+void
+BM_dual_quat_mult(benchmark::State& state)
+{
+  srand(1981);
+  thx::dual_quat<S> a(
+    thx::quat<S>(makeRandUnit<S>(), makeRandUnit<S>(), 
+                 makeRandUnit<S>(), makeRandUnit<S>()),
+    thx::quat<S>(makeRandUnit<S>(), makeRandUnit<S>(), 
+                 makeRandUnit<S>(), makeRandUnit<S>()));
+  thx::dual_quat<S> b = a*a;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(a);
+    benchmark::DoNotOptimize(b);
+    thx::dual_quat<S> c = a*b;
+    benchmark::DoNotOptimize(c);
+  }
+}
+
+//! Batched dual quaternion skinning of points and normals, 64 bones and 
+//! 4 influences per point.
+template<typename S>
+void
+BM_skin(benchmark::State& state)
+{
+  srand(1981);
+  const std::size_t n = static_cast<std::size_t>(state.range(0));
+  const std::size_t k = 4;
+  std::vector<thx::dual_quat<S>> bones(64);
+  for (std::size_t i = 0; i < bones.size(); ++i) {
+    thx::vec<3,S> axis = makeRandVec<thx::vec<3,S>>();
+    thx::normalize(axis);
+    thx::quat<S> r;
+    thx::set_axis_angle(r, axis, makeRandUnit<S>());
+    bones[i] = thx::dual_quat<S>(r, makeRandVec<thx::vec<3,S>>());
+  }
+  std::vector<thx::vec<3,S>> p(n);
+  std::vector<thx::vec<3,S>> nrm(n);
+  std::vector<thx::uint32> index(n*k);
+  std::vector<S> weight(n*k);
+  for (std::size_t i = 0; i < n; ++i) {
+    p[i] = makeRandVec<thx::vec<3,S>>();
+    nrm[i] = makeRandVec<thx::vec<3,S>>();
+    for (std::size_t j = 0; j < k; ++j) {
+      index[i*k + j] = static_cast<thx::uint32>(rand()%bones.size());
+      weight[i*k + j] = S(0.25);
+    }
+  }
+  std::vector<thx::vec<3,S>> q(n);
+  std::vector<thx::vec<3,S>> m(n);
+  for (auto _ : state) {
+    thx::skin(&bones[0], &index[0], &weight[0], k, 
+              &p[0], &q[0], &nrm[0], &m[0], n);
+    benchmark::DoNotOptimize(q.data());
+    benchmark::DoNotOptimize(m.data());
+  }
+  state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_dual_quat_mult, thx::float32);
+BENCHMARK_TEMPLATE(BM_dual_quat_mult, thx::float64);
+BENCHMARK_TEMPLATE(BM_skin, thx::float32)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_skin, thx::float64)->Arg(1 << 16);
+
+//! Random unit quaternion.
+template<typename S>
+thx::quat<S>
+makeRandRotation()
+{
+  thx::vec<3,S> axis = makeRandVec<thx::vec<3,S>>();
+  thx::normalize(axis);
+  thx::quat<S> q;
+  thx::set_axis_angle(q, axis, 3*makeRandUnit<S>());
+  return q;
+}
+
+//! Quaternion interpolation, F is slerp, nlerp or slerp_fast.
+template<typename S, thx::quat<S> (*F)(thx::quat<S> const&, 
+                                       thx::quat<S> const&, S)>
+void
+BM_quat_interp(benchmark::State& state)
+{
+  srand(1981);
+  thx::quat<S> q = makeRandRotation<S>();
+  thx::quat<S> r = makeRandRotation<S>();
+  S t = S(0.3);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(q);
+    benchmark::DoNotOptimize(r);
+    benchmark::DoNotOptimize(t);
+    thx::quat<S> p = F(q, r, t);
+    benchmark::DoNotOptimize(p);
+  }
+}
+
+//! Batched sampling of tracks with 8 keys each.
+template<typename S>
+void
+BM_sample(benchmark::State& state)
+{
+  srand(1981);
+  const std::size_t n = static_cast<std::size_t>(state.range(0));
+  const std::size_t size = 8;
+  std::vector<S> times(size);
+  for (std::size_t j = 0; j < size; ++j) {
+    times[j] = S(j);
+  }
+  std::vector<thx::quat<S>> keys(n*size);
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    keys[i] = makeRandRotation<S>();
+  }
+  std::vector<thx::quat_track<S>> tracks(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    thx::quat_track<S> const tr = { &times[0], &keys[i*size], size };
+    tracks[i] = tr;
+  }
+  std::vector<thx::quat<S>> out(n);
+  S t = S(0);
+  for (auto _ : state) {
+    thx::sample(&tracks[0], n, t, &out[0]);
+    benchmark::DoNotOptimize(out.data());
+    t = (t < S(size) ? t + S(0.01) : S(0));
+  }
+  state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_quat_interp, thx::float32, thx::slerp<thx::float32>);
+BENCHMARK_TEMPLATE(BM_quat_interp, thx::float64, thx::slerp<thx::float64>);
+BENCHMARK_TEMPLATE(BM_quat_interp, thx::float32, thx::nlerp<thx::float32>);
+BENCHMARK_TEMPLATE(BM_quat_interp, thx::float64, thx::nlerp<thx::float64>);
+BENCHMARK_TEMPLATE(BM_quat_interp, thx::float32, 
+                   thx::slerp_fast<thx::float32>);
+BENCHMARK_TEMPLATE(BM_quat_interp, thx::float64, 
+                   thx::slerp_fast<thx::float64>);
+BENCHMARK_TEMPLATE(BM_sample, thx::float32)->Arg(1 << 14);
+BENCHMARK_TEMPLATE(BM_sample, thx::float64)->Arg(1 << 14);
+
+//! Batched quaternion to NxN rotation matrix conversion.
+template<std::size_t N, typename S>
+void
+BM_to_mat(benchmark::State& state)
+{
+  srand(1981);
+  const std::size_t n = static_cast<std::size_t>(state.range(0));
+  std::vector<thx::quat<S>> q(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    q[i] = makeRandRotation<S>();
+  }
+  std::vector<thx::mat<N,S>> m(n);
+  for (auto _ : state) {
+    thx::to_mat(&q[0], &m[0], n);
+    benchmark::DoNotOptimize(m.data());
+  }
+  state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+//! Batched NxN rotation matrix to quaternion conversion.
+template<std::size_t N, typename S>
+void
+BM_to_quat(benchmark::State& state)
+{
+  srand(1981);
+  const std::size_t n = static_cast<std::size_t>(state.range(0));
+  std::vector<thx::mat<N,S>> m(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    m[i] = thx::mat<N,S>(thx::to_mat3(makeRandRotation<S>()));
+  }
+  std::vector<thx::quat<S>> q(n);
+  for (auto _ : state) {
+    thx::to_quat(&m[0], &q[0], n);
+    benchmark::DoNotOptimize(q.data());
+  }
+  state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+//! Batched quaternion to rotation matrix conversion, structure-of-arrays.
+template<typename S>
+void
+BM_to_mat_soa(benchmark::State& state)
+{
+  srand(1981);
+  const std::size_t n = static_cast<std::size_t>(state.range(0));
+  thx::vec_soa<4,S> q(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    const thx::quat<S> r = makeRandRotation<S>();
+    q.set(i, thx::vec<4,S>(r[0], r[1], r[2], r[3]));
+  }
+  thx::vec_soa<9,S> m(n);
+  for (auto _ : state) {
+    thx::to_mat(q, m);
+    benchmark::DoNotOptimize(m.component(0));
+  }
+  state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_to_mat, 3, thx::float32)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_to_mat, 3, thx::float64)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_to_mat, 4, thx::float32)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_to_mat, 4, thx::float64)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_to_quat, 3, thx::float32)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_to_quat, 3, thx::float64)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_to_mat_soa, thx::float32)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_to_mat_soa, thx::float64)->Arg(1 << 16);
+
+//! Batched smallest three encoding.
+template<std::size_t B, typename S>
+void
+BM_pack(benchmark::State& state)
+{
+  srand(1981);
+  const std::size_t n = static_cast<std::size_t>(state.range(0));
+  std::vector<thx::quat<S>> q(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    q[i] = makeRandRotation<S>();
+  }
+  std::vector<thx::packed_quat<B>> p(n);
+  for (auto _ : state) {
+    thx::pack(&q[0], &p[0], n);
+    benchmark::DoNotOptimize(p.data());
+  }
+  state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+//! Batched smallest three decoding.
+template<std::size_t B, typename S>
+void
+BM_unpack(benchmark::State& state)
+{
+  srand(1981);
+  const std::size_t n = static_cast<std::size_t>(state.range(0));
+  std::vector<thx::packed_quat<B>> p(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    p[i] = thx::pack<B>(makeRandRotation<S>());
+  }
+  std::vector<thx::quat<S>> q(n);
+  for (auto _ : state) {
+    thx::unpack(&p[0], &q[0], n);
+    benchmark::DoNotOptimize(q.data());
+  }
+  state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_pack, 32, thx::float32)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_pack, 48, thx::float32)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_pack, 64, thx::float32)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_pack, 32, thx::float64)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_unpack, 32, thx::float32)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_unpack, 48, thx::float32)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_unpack, 64, thx::float32)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_unpack, 32, thx::float64)->Arg(1 << 16);
+
+//! Quaternion multiplication.
+template<typename S>
+void
+BM_quat_mult(benchmark::State& state)
+{
+  srand(1981);
+  thx::quat<S> q(makeRandUnit<S>(), makeRandUnit<S>(), 
+                 makeRandUnit<S>(), makeRandUnit<S>());
+  thx::quat<S> r(makeRandUnit<S>(), makeRandUnit<S>(), 
+                 makeRandUnit<S>(), makeRandUnit<S>());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(q);
+    benchmark::DoNotOptimize(r);
+    thx::quat<S> p = q*r;
+    benchmark::DoNotOptimize(p);
+  }
+}
+
+//! set_axis_angle.
+template<typename S>
+void
+BM_set_axis_angle(benchmark::State& state)
+{
+  srand(1981);
+  thx::vec<3,S> axis = makeRandVec<thx::vec<3,S>>();
+  thx::normalize(axis);
+  S theta = makeRandUnit<S>();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(axis);
+    benchmark::DoNotOptimize(theta);
+    thx::quat<S> q;
+    thx::set_axis_angle(q, axis, theta);
+    benchmark::DoNotOptimize(q);
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_quat_mult, thx::float32);
+BENCHMARK_TEMPLATE(BM_quat_mult, thx::float64);
+BENCHMARK_TEMPLATE(BM_set_axis_angle, thx::float32);
+BENCHMARK_TEMPLATE(BM_set_axis_angle, thx::float64);
+
+//------------------------------------------------------------------------------
+
+//! mat<4,S> multiplication, scalar path.
+template<typename S>
+void
+BM_mat4_mult_scalar(benchmark::State& state)
+{
+  srand(1981);
+  thx::mat<4,S> a = makeRandMat<thx::mat<4,S>>();
+  thx::mat<4,S> b = makeRandMat<thx::mat<4,S>>();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(a);
+    benchmark::DoNotOptimize(b);
+    thx::mat<4,S> c = thx::mult<S>(a, b); // Explicit template argument.
+    benchmark::DoNotOptimize(c);
+  }
+}
+
+//! mat<4,S> multiplication, SIMD specialization (if enabled).
+template<typename S>
+void
+BM_mat4_mult(benchmark::State& state)
+{
+  srand(1981);
+  thx::mat<4,S> a = makeRandMat<thx::mat<4,S>>();
+  thx::mat<4,S> b = makeRandMat<thx::mat<4,S>>();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(a);
+    benchmark::DoNotOptimize(b);
+    thx::mat<4,S> c = thx::mult(a, b);
+    benchmark::DoNotOptimize(c);
+  }
+}
+
+//! mat<4,S> multiplication, aligned loads and stores.
+template<typename S>
+void
+BM_mat4_mult_aligned(benchmark::State& state)
+{
+  srand(1981);
+  thx::aligned<thx::mat<4,S>> a = makeRandMat<thx::mat<4,S>>();
+  thx::aligned<thx::mat<4,S>> b = makeRandMat<thx::mat<4,S>>();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(a);
+    benchmark::DoNotOptimize(b);
+    thx::aligned<thx::mat<4,S>> c = thx::mult(a, b);
+    benchmark::DoNotOptimize(c);
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_mat4_mult_scalar, thx::float32);
+BENCHMARK_TEMPLATE(BM_mat4_mult, thx::float32);
+BENCHMARK_TEMPLATE(BM_mat4_mult_aligned, thx::float32);
+BENCHMARK_TEMPLATE(BM_mat4_mult_scalar, thx::float64);
+BENCHMARK_TEMPLATE(BM_mat4_mult, thx::float64);
+BENCHMARK_TEMPLATE(BM_mat4_mult_aligned, thx::float64);
+
+//------------------------------------------------------------------------------
+
+//! Point cloud with random coordinates in the range [-1..1].
+template<typename S>
+std::vector<thx::vec<3,S>>
+makeRandPoints(std::size_t const n)
+{
+  std::vector<thx::vec<3,S>> p(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    p[i] = thx::vec<3,S>(
+      makeRandUnit<S>(), makeRandUnit<S>(), makeRandUnit<S>());
+  }
+  return p;
+}
+
+//! Point transforms, one element at a time through operator*.
+template<typename S>
+void
+BM_transform_points_loop(benchmark::State& state)
+{
+  srand(1981);
+  thx::mat<4,S> const a = makeRandMat<thx::mat<4,S>>();
+  std::vector<thx::vec<3,S>> const p = makeRandPoints<S>(state.range(0));
+  std::vector<thx::vec<3,S>> q(p.size());
+  for (auto _ : state) {
+    for (std::size_t i = 0; i < p.size(); ++i) {
+      q[i] = a*p[i];
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+//! Batched point transforms.
+template<typename S>
+void
+BM_transform_points(benchmark::State& state)
+{
+  srand(1981);
+  thx::mat<4,S> const a = makeRandMat<thx::mat<4,S>>();
+  std::vector<thx::vec<3,S>> const p = makeRandPoints<S>(state.range(0));
+  std::vector<thx::vec<3,S>> q(p.size());
+  for (auto _ : state) {
+    thx::transform_points(a, &p[0], &q[0], p.size());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_transform_points_loop, thx::float32)->Range(64, 1 << 20);
+BENCHMARK_TEMPLATE(BM_transform_points, thx::float32)->Range(64, 1 << 20);
+BENCHMARK_TEMPLATE(BM_transform_points_loop, thx::float64)->Range(64, 1 << 20);
+BENCHMARK_TEMPLATE(BM_transform_points, thx::float64)->Range(64, 1 << 20);
+
+//------------------------------------------------------------------------------
+
+//! Matrix inversion, one element at a time.
+template<std::size_t N, typename S>
+void
+BM_inverted_loop(benchmark::State& state)
+{
+  srand(1981);
+  std::vector<thx::mat<N,S>> a(state.range(0));
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    a[i] = makeRandMat<thx::mat<N,S>>();
+  }
+  std::vector<thx::mat<N,S>> b(a.size());
+  for (auto _ : state) {
+    for (std::size_t i = 0; i < a.size(); ++i) {
+      b[i] = thx::inverted(a[i]);
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+//! Batched, parallel matrix inversion.
+template<std::size_t N, typename S>
+void
+BM_inverted_batch(benchmark::State& state)
+{
+  srand(1981);
+  std::vector<thx::mat<N,S>> a(state.range(0));
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    a[i] = makeRandMat<thx::mat<N,S>>();
+  }
+  std::vector<thx::mat<N,S>> b(a.size());
+  std::vector<thx::uint8> status(a.size());
+  for (auto _ : state) {
+    thx::inverted(&a[0], &b[0], &status[0], a.size());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_inverted_loop, 3, thx::float32)->Range(64, 1 << 18);
+BENCHMARK_TEMPLATE(BM_inverted_batch, 3, thx::float32)->Range(64, 1 << 18);
+BENCHMARK_TEMPLATE(BM_inverted_loop, 4, thx::float32)->Range(64, 1 << 18);
+BENCHMARK_TEMPLATE(BM_inverted_batch, 4, thx::float32)->Range(64, 1 << 18);
+BENCHMARK_TEMPLATE(BM_inverted_loop, 4, thx::float64)->Range(64, 1 << 18);
+BENCHMARK_TEMPLATE(BM_inverted_batch, 4, thx::float64)->Range(64, 1 << 18);
+
+//! Batched 4x4 matrix inversion with the instruction set tier given as the
+//! second argument, clamped to what the CPU supports (see the label).
+template<typename S>
+void
+BM_inverted_isa(benchmark::State& state)
+{
+  srand(1981);
+  const thx::isa t = 
+    thx::set_active_isa(static_cast<thx::isa>(state.range(1)));
+  state.SetLabel(thx::isa_name(t));
+  std::vector<thx::mat<4,S>> a(state.range(0));
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    a[i] = makeRandMat<thx::mat<4,S>>();
+  }
+  std::vector<thx::mat<4,S>> b(a.size());
+  std::vector<thx::uint8> status(a.size());
+  for (auto _ : state) {
+    thx::inverted(&a[0], &b[0], &status[0], a.size());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations()*state.range(0));
+  thx::set_active_isa(thx::max_isa());
+}
+
+BENCHMARK_TEMPLATE(BM_inverted_isa, thx::float32)
+  ->Args({1 << 12, thx::isa_sse2})
+  ->Args({1 << 12, thx::isa_avx})
+  ->Args({1 << 12, thx::isa_avx512});
+BENCHMARK_TEMPLATE(BM_inverted_isa, thx::float64)
+  ->Args({1 << 12, thx::isa_sse2})
+  ->Args({1 << 12, thx::isa_avx})
+  ->Args({1 << 12, thx::isa_avx512});
+
+//------------------------------------------------------------------------------
+
+//! Dot products, one element at a time on array-of-structures.
+template<typename S>
+void
+BM_dot_loop(benchmark::State& state)
+{
+  srand(1981);
+  std::vector<thx::vec<3,S>> const u = makeRandPoints<S>(state.range(0));
+  std::vector<thx::vec<3,S>> const v = makeRandPoints<S>(state.range(0));
+  std::vector<S> d(u.size());
+  for (auto _ : state) {
+    for (std::size_t i = 0; i < u.size(); ++i) {
+      d[i] = thx::dot(u[i], v[i]);
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+//! Bulk dot products on structure-of-arrays.
+template<typename S>
+void
+BM_dot_soa(benchmark::State& state)
+{
+  srand(1981);
+  thx::vec_soa<3,S> const u(makeRandPoints<S>(state.range(0)));
+  thx::vec_soa<3,S> const v(makeRandPoints<S>(state.range(0)));
+  std::vector<S> d(u.size());
+  for (auto _ : state) {
+    thx::dot(u, v, &d[0]);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+//! Normalization, one element at a time on array-of-structures.
+template<typename S>
+void
+BM_normalize_loop(benchmark::State& state)
+{
+  srand(1981);
+  std::vector<thx::vec<3,S>> v = makeRandPoints<S>(state.range(0));
+  for (auto _ : state) {
+    for (std::size_t i = 0; i < v.size(); ++i) {
+      thx::normalize(v[i]);
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+//! Bulk normalization on structure-of-arrays.
+template<typename S>
+void
+BM_normalize_soa(benchmark::State& state)
+{
+  srand(1981);
+  thx::vec_soa<3,S> v(makeRandPoints<S>(state.range(0)));
+  for (auto _ : state) {
+    thx::normalize(v);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_dot_loop, thx::float32)->Range(64, 1 << 20);
+BENCHMARK_TEMPLATE(BM_dot_soa, thx::float32)->Range(64, 1 << 20);
+BENCHMARK_TEMPLATE(BM_dot_loop, thx::float64)->Range(64, 1 << 20);
+BENCHMARK_TEMPLATE(BM_dot_soa, thx::float64)->Range(64, 1 << 20);
+BENCHMARK_TEMPLATE(BM_normalize_loop, thx::float32)->Range(64, 1 << 20);
+BENCHMARK_TEMPLATE(BM_normalize_soa, thx::float32)->Range(64, 1 << 20);
+BENCHMARK_TEMPLATE(BM_normalize_loop, thx::float64)->Range(64, 1 << 20);
+BENCHMARK_TEMPLATE(BM_normalize_soa, thx::float64)->Range(64, 1 << 20);
+
+//------------------------------------------------------------------------------
+
+//! r = a*x + b*y - z, one temporary per operator.
+template<std::size_t N>
+void
+BM_axpby_eager(benchmark::State& state)
+{
+  typedef thx::vec<N,thx::float32> vec_type;
+  srand(1981);
+  thx::float32 a = makeRandUnit<thx::float32>();
+  thx::float32 b = makeRandUnit<thx::float32>();
+  vec_type x = makeRandVec<vec_type>();
+  vec_type y = makeRandVec<vec_type>();
+  vec_type z = makeRandVec<vec_type>();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(x);
+    benchmark::DoNotOptimize(y);
+    benchmark::DoNotOptimize(z);
+    vec_type r = a*x + b*y - z;
+    benchmark::DoNotOptimize(r);
+  }
+}
+
+//! r = a*x + b*y - z, single fused loop through expression templates.
+template<std::size_t N>
+void
+BM_axpby_expr(benchmark::State& state)
+{
+  typedef thx::vec<N,thx::float32> vec_type;
+  srand(1981);
+  thx::float32 a = makeRandUnit<thx::float32>();
+  thx::float32 b = makeRandUnit<thx::float32>();
+  vec_type x = makeRandVec<vec_type>();
+  vec_type y = makeRandVec<vec_type>();
+  vec_type z = makeRandVec<vec_type>();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(x);
+    benchmark::DoNotOptimize(y);
+    benchmark::DoNotOptimize(z);
+    vec_type r = a*thx::lazy(x) + b*thx::lazy(y) - z;
+    benchmark::DoNotOptimize(r);
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_axpby_eager, 3);
+BENCHMARK_TEMPLATE(BM_axpby_expr, 3);
+BENCHMARK_TEMPLATE(BM_axpby_eager, 4);
+BENCHMARK_TEMPLATE(BM_axpby_expr, 4);
+BENCHMARK_TEMPLATE(BM_axpby_eager, 16);
+BENCHMARK_TEMPLATE(BM_axpby_expr, 16);
+BENCHMARK_TEMPLATE(BM_axpby_eager, 64);
+BENCHMARK_TEMPLATE(BM_axpby_expr, 64);
+
+} // Namespace: anonymous.
+
+//! Hash throughput, bytes_per_second in the output.
+template<typename U, U (*F)(void const*, std::size_t, U)>
+void
+BM_hash(benchmark::State& state)
+{
+  srand(1981);
+  const std::size_t n = static_cast<std::size_t>(state.range(0));
+  std::vector<thx::uint8> b(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    b[i] = static_cast<thx::uint8>(rand());
+  }
+  U seed = 0;
+  for (auto _ : state) {
+    seed = F(b.data(), n, seed);
+    benchmark::DoNotOptimize(seed);
+  }
+  state.SetBytesProcessed(state.iterations()*state.range(0));
+}
+
+//! Streaming hash throughput, the data arrives in 1500-byte chunks.
+template<typename U>
+void
+BM_murmur3_hasher(benchmark::State& state)
+{
+  srand(1981);
+  const std::size_t n = static_cast<std::size_t>(state.range(0));
+  const std::size_t chunk = 1500;
+  std::vector<thx::uint8> b(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    b[i] = static_cast<thx::uint8>(rand());
+  }
+  for (auto _ : state) {
+    thx::murmur3_hasher<U> hasher;
+    for (std::size_t i = 0; i < n; i += chunk) {
+      hasher.update(&b[i], (std::min)(chunk, n - i));
+    }
+    U h = hasher.digest();
+    benchmark::DoNotOptimize(h);
+  }
+  state.SetBytesProcessed(state.iterations()*state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_hash, thx::uint32, thx::murmur<thx::uint32>)
+  ->Arg(16)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_hash, thx::uint64, thx::murmur<thx::uint64>)
+  ->Arg(16)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_hash, thx::uint32, thx::murmur3<thx::uint32>)
+  ->Arg(16)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_hash, thx::uint64, thx::murmur3<thx::uint64>)
+  ->Arg(16)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_murmur3_hasher, thx::uint32)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_murmur3_hasher, thx::uint64)->Arg(1 << 20);
+
+//! Hand-rolled hasher that combines std::hash of each component, for 
+//! comparison with std::hash<vec<N,S>>.
+template<std::size_t N, typename S>
+struct component_hash {
+  std::size_t
+  operator()(thx::vec<N,S> const& v) const {
+    std::size_t h = 0;
+    for (std::size_t i = 0; i < N; ++i) {
+      h ^= std::hash<S>()(v[i]) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    }
+    return h;
+  }
+};
+
+//! Vertex deduplication: inserts n positions on a grid, half of them 
+//! duplicates, then looks all of them up.
+template<typename S, class H>
+void
+BM_vec_map(benchmark::State& state)
+{
+  srand(1981);
+  const std::size_t n = static_cast<std::size_t>(state.range(0));
+  std::vector<thx::vec<3,S>> v(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    v[i] = thx::vec<3,S>(S(rand() % 64), S(rand() % 64), S(rand() % 16)*S(0.25));
+  }
+  for (auto _ : state) {
+    std::unordered_map<thx::vec<3,S>, int, H> index;
+    for (std::size_t i = 0; i < n; ++i) {
+      index.insert(std::make_pair(v[i], static_cast<int>(i)));
+    }
+    int sum = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+      sum += index.find(v[i])->second;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(2*state.iterations()*state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_vec_map, thx::float32, 
+                   std::hash<thx::vec<3,thx::float32>>)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_vec_map, thx::float32, 
+                   component_hash<3,thx::float32>)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_vec_map, thx::float64, 
+                   std::hash<thx::vec<3,thx::float64>>)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_vec_map, thx::float64, 
+                   component_hash<3,thx::float64>)->Arg(1 << 16);
+
+//! n random particles in a cube with about one particle per unit cell.
+template<typename S>
+std::vector<thx::vec<3,S>>
+makeParticles(const std::size_t n)
+{
+  srand(1981);
+  const S side = std::cbrt(S(n));
+  std::vector<thx::vec<3,S>> p(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    p[i] = thx::vec<3,S>(side*(S(rand())/RAND_MAX), 
+                         side*(S(rand())/RAND_MAX), 
+                         side*(S(rand())/RAND_MAX));
+  }
+  return p;
+}
+
+template<typename S>
+void
+BM_grid_build(benchmark::State& state)
+{
+  const std::size_t n = static_cast<std::size_t>(state.range(0));
+  const std::vector<thx::vec<3,S>> p = makeParticles<S>(n);
+  thx::spatial_hash_grid<S> grid(S(1));
+  for (auto _ : state) {
+    grid.build(&p[0], n);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+//! Radius queries around the first 4096 particles, radius 1.
+template<typename S>
+void
+BM_grid_radius(benchmark::State& state)
+{
+  const std::size_t n = static_cast<std::size_t>(state.range(0));
+  const std::vector<thx::vec<3,S>> p = makeParticles<S>(n);
+  thx::spatial_hash_grid<S> grid(S(1));
+  grid.build(&p[0], n);
+  std::vector<thx::uint32> ids;
+  for (auto _ : state) {
+    std::size_t found = 0;
+    for (std::size_t i = 0; i < 4096; ++i) {
+      grid.radius_query(p[i], S(1), ids);
+      found += ids.size();
+    }
+    benchmark::DoNotOptimize(found);
+  }
+  state.SetItemsProcessed(state.iterations()*4096);
+}
+
+//! Same queries as BM_grid_radius, by testing every particle.
+template<typename S>
+void
+BM_brute_radius(benchmark::State& state)
+{
+  const std::size_t n = static_cast<std::size_t>(state.range(0));
+  const std::vector<thx::vec<3,S>> p = makeParticles<S>(n);
+  std::vector<thx::uint32> ids;
+  for (auto _ : state) {
+    std::size_t found = 0;
+    for (std::size_t i = 0; i < 4096; ++i) {
+      ids.clear();
+      for (std::size_t j = 0; j < n; ++j) {
+        if (thx::dist_squared(p[j], p[i]) <= 1) {
+          ids.push_back(static_cast<thx::uint32>(j));
+        }
+      }
+      found += ids.size();
+    }
+    benchmark::DoNotOptimize(found);
+  }
+  state.SetItemsProcessed(state.iterations()*4096);
+}
+
+//! 8 nearest neighbors of the first 4096 particles.
+template<typename S>
+void
+BM_grid_knn(benchmark::State& state)
+{
+  const std::size_t n = static_cast<std::size_t>(state.range(0));
+  const std::vector<thx::vec<3,S>> p = makeParticles<S>(n);
+  thx::spatial_hash_grid<S> grid(S(1));
+  grid.build(&p[0], n);
+  std::vector<thx::uint32> ids;
+  for (auto _ : state) {
+    std::size_t sum = 0;
+    for (std::size_t i = 0; i < 4096; ++i) {
+      grid.knn_query(p[i], 8, ids);
+      sum += ids.back();
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations()*4096);
+}
+
+BENCHMARK_TEMPLATE(BM_grid_build, thx::float32)->Arg(1 << 20)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_grid_build, thx::float64)->Arg(1 << 20)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_grid_radius, thx::float32)->Arg(1 << 16)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_brute_radius, thx::float32)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_grid_knn, thx::float32)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_grid_knn, thx::float64)->Arg(1 << 20);
+
+//! Morton codes of quantized particles with the instruction set tier given as
+//! the second argument, sse2 uses shifts and masks, avx2 uses pdep if the CPU
+//! has a fast one (see the label).
+template<typename S>
+void
+BM_morton_encode_isa(benchmark::State& state)
+{
+  const thx::isa t = 
+    thx::set_active_isa(static_cast<thx::isa>(state.range(1)));
+  const bool pdep = thx::cpu().fast_pdep && t >= thx::isa_avx2;
+  state.SetLabel(pdep ? "pdep" : "magic bits");
+  const std::size_t n = static_cast<std::size_t>(state.range(0));
+  const std::vector<thx::vec<3,S>> p = makeParticles<S>(n);
+  const thx::morton_quantizer<3,S> q(thx::vec<3,S>(S(0)), 
+                                     thx::vec<3,S>(std::cbrt(S(n))));
+  std::vector<thx::uint64> codes(n);
+  for (auto _ : state) {
+    thx::morton_encode(q, &p[0], n, &codes[0]);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations()*state.range(0));
+  thx::set_active_isa(thx::max_isa());
+}
+
+//! Random 64-bit keys sorted with radix_sort or std::sort.
+template<bool Radix>
+void
+BM_sort_keys(benchmark::State& state)
+{
+  srand(1981);
+  const std::size_t n = static_cast<std::size_t>(state.range(0));
+  std::vector<thx::uint64> keys(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    keys[i] = (thx::uint64(rand()) << 32) ^ thx::uint64(rand());
+  }
+  std::vector<thx::uint64> sorted(n);
+  for (auto _ : state) {
+    sorted = keys;
+    if (Radix) {
+      thx::radix_sort(&sorted[0], n);
+    }
+    else {
+      std::sort(sorted.begin(), sorted.end());
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+//! Particles reordered by Morton code, or sorted lexicographically with 
+//! std::sort for comparison.
+template<typename S, bool Morton>
+void
+BM_sort_particles(benchmark::State& state)
+{
+  const std::size_t n = static_cast<std::size_t>(state.range(0));
+  const std::vector<thx::vec<3,S>> p = makeParticles<S>(n);
+  std::vector<thx::vec<3,S>> sorted(n);
+  for (auto _ : state) {
+    sorted = p;
+    if (Morton) {
+      thx::morton_sort(&sorted[0], n);
+    }
+    else {
+      std::sort(sorted.begin(), sorted.end(), 
+        [](const thx::vec<3,S> &u, const thx::vec<3,S> &v) {
+          return u[2] < v[2] || (u[2] == v[2] && (u[1] < v[1] || 
+                 (u[1] == v[1] && u[0] < v[0])));
+        });
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_morton_encode_isa, thx::float32)
+  ->Args({1 << 20, thx::isa_sse2})
+  ->Args({1 << 20, thx::isa_avx2});
+BENCHMARK_TEMPLATE(BM_sort_keys, true)->Arg(1 << 22)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_sort_keys, false)->Arg(1 << 22)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_sort_particles, thx::float32, true)
+  ->Arg(1 << 22)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_sort_particles, thx::float32, false)
+  ->Arg(1 << 22)->UseRealTime();
+
+//------------------------------------------------------------------------------
+
+//! Frame of random colors in [0, 1].
+template<typename S>
+std::vector<thx::vec<3,S>>
+makeFrame(std::size_t const width, std::size_t const height)
+{
+  std::vector<thx::vec<3,S>> f(width*height);
+  for (std::size_t i = 0; i < f.size(); ++i) {
+    f[i] = thx::vec<3,S>(static_cast<S>(rand())/RAND_MAX, 
+                         static_cast<S>(rand())/RAND_MAX, 
+                         static_cast<S>(rand())/RAND_MAX);
+  }
+  return f;
+}
+
+//! Color conversion of a 4K frame. range(0) selects the stages, see below,
+//! and range(1) is 1 for convert_colors and 0 for a loop over convert_color.
+//! Throughput is reported in megapixels per second.
+template<typename S>
+void
+BM_color_frame(benchmark::State& state)
+{
+  const std::size_t width = 3840;
+  const std::size_t height = 2160;
+  const thx::color_stages stages[] = {
+    thx::color_XYZ_to_RGB, 
+    thx::color_RGB_to_HSV, 
+    thx::color_HSV_to_RGB, 
+    { thx::color_xyY_to_XYZ, thx::color_XYZ_to_RGB, thx::color_RGB_to_sRGB }
+  };
+  char const* const labels[] = { 
+    "XYZ to RGB", "RGB to HSV", "HSV to RGB", "xyY to sRGB" 
+  };
+  const thx::color_stages &s = stages[state.range(0)];
+  const bool batched = state.range(1) != 0;
+  const std::vector<thx::vec<3,S>> in = makeFrame<S>(width, height);
+  std::vector<thx::vec<3,S>> out(in.size());
+  for (auto _ : state) {
+    if (batched) {
+      thx::convert_colors(s, &in[0], width, &out[0], width, width, height);
+    }
+    else {
+      for (std::size_t i = 0; i < in.size(); ++i) {
+        out[i] = thx::convert_color(s, in[i]);
+      }
+    }
+    benchmark::ClobberMemory();
+  }
+  state.counters["MP"] = benchmark::Counter(
+    1e-6*static_cast<double>(width*height), 
+    benchmark::Counter::kIsIterationInvariantRate);
+  state.SetLabel(std::string(labels[state.range(0)]) + 
+                 (batched ? ", batched" : ", per pixel"));
+}
+
+BENCHMARK_TEMPLATE(BM_color_frame, thx::float32)
+  ->ArgsProduct({{0, 1, 2, 3}, {0, 1}})->UseRealTime();
+BENCHMARK_TEMPLATE(BM_color_frame, thx::float64)
+  ->Args({1, 1})->Args({3, 1})->UseRealTime();
+
+//! Copy of a 4K frame with three float32 channels. range(0) and range(1) are
+//! the source and destination layouts.
+static void
+BM_image_copy(benchmark::State& state)
+{
+  const thx::image_layout src_layout = 
+    static_cast<thx::image_layout>(state.range(0));
+  const thx::image_layout dst_layout = 
+    static_cast<thx::image_layout>(state.range(1));
+  thx::image3f32 src(3840, 2160, src_layout);
+  thx::image3f32 dst(3840, 2160, dst_layout);
+  for (auto _ : state) {
+    thx::copy_image(src, dst);
+    benchmark::ClobberMemory();
+  }
+  state.counters["MP"] = benchmark::Counter(
+    1e-6*static_cast<double>(src.width()*src.height()), 
+    benchmark::Counter::kIsIterationInvariantRate);
+  char const* const labels[] = { "interleaved", "planar" };
+  state.SetLabel(std::string(labels[src_layout]) + " to " + 
+                 labels[dst_layout]);
+}
+
+BENCHMARK(BM_image_copy)->ArgsProduct({{0, 1}, {0, 1}})->UseRealTime();
+
+//! Gaussian blur of a 4K frame with three float32 channels. range(0) is the
+//! layout and range(1) is sigma in tenths of a pixel.
+static void
+BM_image_blur(benchmark::State& state)
+{
+  const thx::image_layout layout = 
+    static_cast<thx::image_layout>(state.range(0));
+  const thx::float32 sigma = 0.1f*state.range(1);
+  thx::image3f32 in(3840, 2160, layout);
+  thx::image3f32 out(3840, 2160, layout);
+  for (auto _ : state) {
+    thx::gaussian_blur(in, out, sigma);
+    benchmark::ClobberMemory();
+  }
+  state.counters["MP"] = benchmark::Counter(
+    1e-6*static_cast<double>(in.width()*in.height()), 
+    benchmark::Counter::kIsIterationInvariantRate);
+  state.SetLabel(layout == thx::image_planar ? "planar" : "interleaved");
+}
+
+BENCHMARK(BM_image_blur)->ArgsProduct({{0, 1}, {10, 30}})->UseRealTime();
+
+//! Resampling of a planar 4K frame with three float32 channels to
+//! range(0) x range(1) pixels. Throughput is in input megapixels per second.
+static void
+BM_image_resample(benchmark::State& state)
+{
+  thx::image3f32 in(3840, 2160, thx::image_planar);
+  thx::image3f32 out(state.range(0), state.range(1), thx::image_planar);
+  for (auto _ : state) {
+    thx::resample(in, out);
+    benchmark::ClobberMemory();
+  }
+  state.counters["MP"] = benchmark::Counter(
+    1e-6*static_cast<double>(in.width()*in.height()), 
+    benchmark::Counter::kIsIterationInvariantRate);
+}
+
+BENCHMARK(BM_image_resample)
+  ->Args({1920, 1080})->Args({960, 540})->Args({5760, 3240})->UseRealTime();
+
+//! sRGB encoding of the channels of a 4K frame to C, range(0) selects the
+//! color_transfer. Throughput is reported in megachannels per second.
+template<typename S, typename C>
+void
+BM_srgb_encode(benchmark::State& state)
+{
+  const std::vector<thx::vec<3,S>> in = makeFrame<S>(3840, 2160);
+  const std::size_t n = 3*in.size();
+  const thx::color_transfer t = 
+    static_cast<thx::color_transfer>(state.range(0));
+  std::vector<C> out(n);
+  for (auto _ : state) {
+    thx::sRGB_encode(&in[0][0], &out[0], n, t);
+    benchmark::ClobberMemory();
+  }
+  state.counters["MC"] = benchmark::Counter(
+    1e-6*static_cast<double>(n), 
+    benchmark::Counter::kIsIterationInvariantRate);
+  state.SetLabel(t == thx::color_transfer_table ? "table" : "exact");
+}
+
+//! sRGB decoding of the channels of a 4K frame from C, see above.
+template<typename S, typename C>
+void
+BM_srgb_decode(benchmark::State& state)
+{
+  const std::size_t n = 3*3840*2160;
+  const thx::color_transfer t = 
+    static_cast<thx::color_transfer>(state.range(0));
+  std::vector<C> in(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    in[i] = static_cast<C>(rand());
+  }
+  std::vector<S> out(n);
+  for (auto _ : state) {
+    thx::sRGB_decode(&in[0], &out[0], n, t);
+    benchmark::ClobberMemory();
+  }
+  state.counters["MC"] = benchmark::Counter(
+    1e-6*static_cast<double>(n), 
+    benchmark::Counter::kIsIterationInvariantRate);
+  state.SetLabel(t == thx::color_transfer_table ? "table" : "exact");
+}
+
+BENCHMARK_TEMPLATE(BM_srgb_encode, thx::float32, thx::uint8)
+  ->Arg(thx::color_transfer_exact)->Arg(thx::color_transfer_table)
+  ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_srgb_encode, thx::float32, thx::uint16)
+  ->Arg(thx::color_transfer_exact)->Arg(thx::color_transfer_table)
+  ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_srgb_decode, thx::float32, thx::uint8)
+  ->Arg(thx::color_transfer_exact)->Arg(thx::color_transfer_table)
+  ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_srgb_decode, thx::float32, thx::uint16)
+  ->Arg(thx::color_transfer_exact)->Arg(thx::color_transfer_table)
+  ->UseRealTime();
+
+//! Normalization of an array of vectors with precision policy Tag.
+template<typename S, class Tag>
+void
+BM_normalize_policy(benchmark::State& state)
+{
+  srand(1981);
+  std::vector<thx::vec<3,S>> v(4096);
+  for (std::size_t i = 0; i < v.size(); ++i) {
+    v[i] = makeRandVec<thx::vec<3,S>>();
+  }
+  for (auto _ : state) {
+    for (std::size_t i = 0; i < v.size(); ++i) {
+      thx::normalize(v[i], Tag());
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations()*v.size());
+}
+
+//! sin, exp and atan2 of an array with Traits, scalar_traits or 
+//! fast_scalar_traits.
+template<typename S, class Traits>
+void
+BM_math_traits(benchmark::State& state)
+{
+  srand(1981);
+  std::vector<S> x(4096);
+  for (std::size_t i = 0; i < x.size(); ++i) {
+    x[i] = S(20)*(static_cast<S>(rand())/RAND_MAX) - S(10);
+  }
+  std::vector<S> y(x.size());
+  for (auto _ : state) {
+    for (std::size_t i = 0; i < x.size(); ++i) {
+      y[i] = Traits::sin(x[i]) + Traits::exp(x[i]) + 
+             Traits::atan2(x[i], S(1) + y[i]);
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations()*x.size());
+}
+
+BENCHMARK_TEMPLATE(BM_normalize_policy, thx::float32, thx::precise_math_tag);
+BENCHMARK_TEMPLATE(BM_normalize_policy, thx::float32, thx::fast_math_tag);
+BENCHMARK_TEMPLATE(BM_normalize_policy, thx::float64, thx::precise_math_tag);
+BENCHMARK_TEMPLATE(BM_normalize_policy, thx::float64, thx::fast_math_tag);
+BENCHMARK_TEMPLATE(BM_math_traits, thx::float32, 
+                   thx::scalar_traits<thx::float32>);
+BENCHMARK_TEMPLATE(BM_math_traits, thx::float32, 
+                   thx::fast_scalar_traits<thx::float32>);
+BENCHMARK_TEMPLATE(BM_math_traits, thx::float64, 
+                   thx::scalar_traits<thx::float64>);
+BENCHMARK_TEMPLATE(BM_math_traits, thx::float64, 
+                   thx::fast_scalar_traits<thx::float64>);
+
+//! Sine and cosine of an array, range(0) selects the batched sincos (1) or
+//! scalar_traits<S>::sincos one angle at a time (0).
+template<typename S>
+void
+BM_sincos(benchmark::State& state)
+{
+  srand(1981);
+  std::vector<S> x(4096);
+  for (std::size_t i = 0; i < x.size(); ++i) {
+    x[i] = S(20)*(static_cast<S>(rand())/RAND_MAX) - S(10);
+  }
+  std::vector<S> s(x.size());
+  std::vector<S> c(x.size());
+  const bool batched = state.range(0) != 0;
+  for (auto _ : state) {
+    if (batched) {
+      thx::sincos(&x[0], &s[0], &c[0], x.size());
+    }
+    else {
+      for (std::size_t i = 0; i < x.size(); ++i) {
+        thx::scalar_traits<S>::sincos(x[i], s[i], c[i]);
+      }
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations()*x.size());
+  state.SetLabel(batched ? "batched" : "scalar");
+}
+
+//! Rotation matrices from angles, range(0) selects rotation_from_angles (1) 
+//! or products of rotation_x/y/z (0).
+template<typename S>
+void
+BM_rotation_from_angles(benchmark::State& state)
+{
+  srand(1981);
+  std::vector<thx::vec<3,S>> a(16384);
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    a[i] = S(10)*makeRandVec<thx::vec<3,S>>();
+  }
+  std::vector<thx::mat<3,S>> m(a.size());
+  const bool batched = state.range(0) != 0;
+  for (auto _ : state) {
+    if (batched) {
+      thx::rotation_from_angles(&a[0], &m[0], a.size());
+    }
+    else {
+      for (std::size_t i = 0; i < a.size(); ++i) {
+        m[i] = thx::rotation_z(a[i][2])*thx::rotation_y(a[i][1])*
+               thx::rotation_x(a[i][0]);
+      }
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations()*a.size());
+  state.SetLabel(batched ? "batched" : "scalar");
+}
+
+//! Batched conversion of float16 vectors to float32 and back, range(0) 
+//! selects convert (1) or element-wise casts (0).
+void
+BM_float16_convert(benchmark::State& state)
+{
+  srand(1981);
+  std::vector<thx::vec<3,thx::float32>> f(4096);
+  for (std::size_t i = 0; i < f.size(); ++i) {
+    for (std::size_t j = 0; j < 3; ++j) {
+      f[i][j] = 2*(static_cast<thx::float32>(rand())/RAND_MAX) - 1;
+    }
+  }
+  std::vector<thx::vec<3,thx::float16>> h(f.size());
+  const bool batched = state.range(0) != 0;
+  for (auto _ : state) {
+    if (batched) {
+      thx::convert(&f[0], &h[0], f.size());
+      thx::convert(&h[0], &f[0], f.size());
+    }
+    else {
+      for (std::size_t i = 0; i < f.size(); ++i) {
+        for (std::size_t j = 0; j < 3; ++j) {
+          h[i][j] = f[i][j];
+          f[i][j] = h[i][j];
+        }
+      }
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations()*f.size());
+  state.SetLabel(batched ? "batched" : "scalar");
+}
+
+BENCHMARK_TEMPLATE(BM_sincos, thx::float32)->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_sincos, thx::float64)->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_rotation_from_angles, thx::float32)->Arg(0)->Arg(1)
+  ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_rotation_from_angles, thx::float64)->Arg(0)->Arg(1)
+  ->UseRealTime();
+BENCHMARK(BM_float16_convert)->Arg(0)->Arg(1);
+
+//! Same as BENCHMARK_MAIN(), but results are also written as JSON to 
+//! thx_bench.json unless --benchmark_out is given, so that they can be 
+//! tracked over time. The active instruction set tier (see thx_cpu.hpp) is
+//! recorded in the context section.
+int
+main(int argc, char* argv[])
+{
+  std::vector<char*> args(argv, argv + argc);
+  bool out = false;
+  for (int i = 1; i < argc; ++i) {
+    out = out || std::strncmp(argv[i], "--benchmark_out=", 16) == 0;
+  }
+  std::string out_file("--benchmark_out=thx_bench.json");
+  std::string out_format("--benchmark_out_format=json");
+  if (!out) {
+    args.push_back(&out_file[0]);
+    args.push_back(&out_format[0]);
+  }
+  int n = static_cast<int>(args.size());
+  args.push_back(0);
+  benchmark::Initialize(&n, &args[0]);
+  if (benchmark::ReportUnrecognizedArguments(n, &args[0])) {
+    return 1;
+  }
+  benchmark::AddCustomContext("thx_isa", thx::isa_name(thx::active_isa()));
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -1,6 +1,8 @@
 #!/bin/bash
 
-build_path="../build/vc10"
+# Visual Studio 2017 (15) is the oldest supported MSVC, see ../CMakeLists.txt.
+
+build_path="../build/vc15"
 rm -rf $build_path
 echo "Removed $build_path"
 mkdir $build_path
@@ -11,4 +13,4 @@ cd $build_path
 cmake \
   -DCMAKE_INSTALL_PREFIX=.. \
   ../../cmake \
-  -G "Visual Studio 10 Win64"
+  -G "Visual Studio 15 2017 Win64"
@@ -10,11 +10,31 @@
 
 // Convenient header that exposes all functionality in thx namespace.
 
+#include "thx_affine.hpp"
+#include "thx_aligned.hpp"
+#include "thx_color_space.hpp"
+#include "thx_cpu.hpp"
+#include "thx_dual_quat.hpp"
+#include "thx_fast_scalar_traits.hpp"
+#include "thx_float16.hpp"
+#include "thx_hashing.hpp"
+#include "thx_image.hpp"
+#include "thx_image_filter.hpp"
 #include "thx_mat.hpp"			// Matrices
 #include "thx_mat_algo.hpp"
+#include "thx_mat_batch.hpp"
+#include "thx_morton.hpp"
 #include "thx_operators.hpp"
+#include "thx_packed_quat.hpp"
+#include "thx_pixel.hpp"
+#include "thx_quat_batch.hpp"
+#include "thx_quat_utils.hpp"
+#include "thx_radix_sort.hpp"
+#include "thx_scalar_batch.hpp"
+#include "thx_std_hash.hpp"
 #include "thx_vec.hpp"			// Vectors
 #include "thx_vec_algo.hpp"
+#include "thx_vec_soa.hpp"
 #include "thx_types.hpp"
 
 
@@ -24,13 +44,12 @@
 //#include "thx_bbox2.hpp"
 //#include "thx_bbox3.hpp"
 
-//#include "thx_color_space.hpp"
-
 //#include "thx_mat_transform.hpp"
 //#include "thx_plane_fit.hpp"
 //#include "thx_quaternion.hpp"
 //#include "thx_sym_eigen2.hpp"
 //#include "thx_sym_eigen3.hpp"
+#include "thx_spatial_hash_grid.hpp"
 #include "thx_scalar_traits.hpp"
 #include "thx_scalar_algo.hpp"
 #include "thx_operators.hpp"
@@ -0,0 +1,435 @@
+//------------------------------------------------------------------------------
+//
+// Contributors:
+//             1) Tommy Hinks
+//
+//------------------------------------------------------------------------------
+
+#ifndef THX_AFFINE_HPP_INCLUDED
+#define THX_AFFINE_HPP_INCLUDED
+
+#include "thx_namespace.hpp"
+#include "thx_define.hpp"
+#include "thx_types.hpp"
+#include "thx_vec.hpp"
+#include "thx_mat.hpp"
+#include "thx_mat_algo.hpp"
+#include "thx_mat_batch.hpp"
+#include "thx_operators.hpp"
+#include "thx_simd.hpp"
+#include <cstddef>
+#include <type_traits>
+
+//------------------------------------------------------------------------------
+
+BEGIN_THX_NAMESPACE
+
+// affine<S> anatomy:
+// ------------------
+//
+// Define value_type
+// Define rows (3), cols (4), linear size (12)
+//
+// constexpr affine<S> identity()
+//
+// Default constexpr CTOR (set to identity by default)
+// Linear part and translation constexpr CTOR
+// mat<4,S> constexpr CTOR (bottom row is dropped)
+// Value constexpr CTOR (row-major argument order, like mat<N,S>)
+// (Compiler-generated DTOR, copy CTOR and operator=)
+//
+// operator*=(affine)
+//
+// S  operator()(row, col) const
+// S& operator()(row, col)
+// S  operator[](i) const
+// S& operator[](i)
+//
+// mat<3,S> linear() const
+// vec<3,S> translation() const
+// mat<4,S> to_mat() const
+//
+// const S* const_data() const
+// S* data()
+//
+// The upper 3x4 part of a mat<4,S> whose bottom row is 0 0 0 1, i.e. a linear
+// map followed by a translation. The bottom row is implicit, which saves 25%
+// of the storage and skips the multiplications with it when composing.
+// Values are stored in column-major order, column 3 is the translation.
+
+//! DOCS
+template<typename S>
+class affine {
+public:
+  static_assert(std::is_arithmetic<S>::value,
+                "Scalar type must be arithmetic");
+
+  typedef S value_type;
+  typedef std::size_t size_type;
+
+  static const size_type rows = 3;
+  static const size_type cols = 4;
+  static const size_type linear_size = rows*cols;
+
+  //! Return identity transform.
+  static THX_CONST_EXPR affine<S>
+  identity() {
+    return affine<S>(1);
+  }
+
+public: // CTOR's.
+  //! Default CTOR, x on the diagonal of the linear part, no translation.
+  explicit THX_CONST_EXPR
+  affine(S const x = 1)
+    : _v{x, 0, 0,   // Col 0.
+         0, x, 0,   // Col 1.
+         0, 0, x,   // Col 2.
+         0, 0, 0} { // Col 3.
+  }
+
+  //! Linear part and translation CTOR.
+  explicit THX_CONST_EXPR
+  affine(mat<3,S> const& a, vec<3,S> const& t = vec<3,S>(S(0)))
+    : _v{a(0,0), a(1,0), a(2,0),   // Col 0.
+         a(0,1), a(1,1), a(2,1),   // Col 1.
+         a(0,2), a(1,2), a(2,2),   // Col 2.
+         t[0],   t[1],   t[2]} {   // Col 3.
+  }
+
+  //! mat<4,S> CTOR. The bottom row of a is assumed to be 0 0 0 1.
+  explicit THX_CONST_EXPR
+  affine(mat<4,S> const& a)
+    : _v{a(0,0), a(1,0), a(2,0),   // Col 0.
+         a(0,1), a(1,1), a(2,1),   // Col 1.
+         a(0,2), a(1,2), a(2,2),   // Col 2.
+         a(0,3), a(1,3), a(2,3)} { // Col 3.
+  }
+
+  //! Value CTOR, arguments in row-major order.
+  explicit THX_CONST_EXPR
+  affine(S const v0, S const v3, S const v6, S const v9,
+         S const v1, S const v4, S const v7, S const v10,
+         S const v2, S const v5, S const v8, S const v11)
+    : _v{v0, v1, v2,      // Col 0.
+         v3, v4, v5,      // Col 1.
+         v6, v7, v8,      // Col 2.
+         v9, v10, v11} {  // Col 3.
+  }
+
+public: // Operators.
+  //! Compose, *this = *this*b, i.e. b is applied first.
+  THX_CONST_EXPR affine<S>&
+  operator*=(affine<S> const& b) {
+    return *this = mult(*this, b);
+  }
+
+public: // Access operators.
+  //! Return element at row i and column j. No bounds checking!
+  THX_CONST_EXPR S
+  operator()(int64 const i, int64 const j) const {
+    return _v[i + 3*j];
+  }
+
+  //! Return element at row i and column j. No bounds checking!
+  THX_CONST_EXPR S&
+  operator()(int64 const i, int64 const j) {
+    return _v[i + 3*j];
+  }
+
+  //! Return i'th element. No bounds checking!
+  THX_CONST_EXPR S
+  operator[](int64 const i) const {
+    return _v[i];
+  }
+
+  //! Return i'th element. No bounds checking!
+  THX_CONST_EXPR S&
+  operator[](int64 const i) {
+    return _v[i];
+  }
+
+public: // Conversions.
+  //! Upper left 3x3 part.
+  THX_CONST_EXPR mat<3,S>
+  linear() const {
+    return mat<3,S>(_v[0], _v[3], _v[6],
+                    _v[1], _v[4], _v[7],
+                    _v[2], _v[5], _v[8]);
+  }
+
+  //! Column 3.
+  THX_CONST_EXPR vec<3,S>
+  translation() const {
+    return vec<3,S>(_v[9], _v[10], _v[11]);
+  }
+
+  //! Full matrix, with bottom row 0 0 0 1.
+  THX_CONST_EXPR mat<4,S>
+  to_mat() const {
+    return mat<4,S>(_v[0], _v[3], _v[6], _v[9],
+                    _v[1], _v[4], _v[7], _v[10],
+                    _v[2], _v[5], _v[8], _v[11],
+                    0,     0,     0,     1);
+  }
+
+public: // Data.
+  //! Const data.
+  THX_CONST_EXPR const S*
+  const_data() const {
+    return &_v[0];
+  }
+
+  //! Mutable data.
+  THX_CONST_EXPR S*
+  data() {
+    return &_v[0];
+  }
+
+private: // Member variables.
+  S _v[linear_size];
+};
+
+//------------------------------------------------------------------------------
+
+//! Compose, a*b, i.e. b is applied first. Products are summed in the same
+//! order as mult(mat<4,S>, mat<4,S>) with the implicit bottom rows.
+template<typename S> inline THX_CONST_EXPR
+affine<S>
+mult(affine<S> const& a, affine<S> const& b) {
+  return affine<S>(
+    a[0]*b[0] + a[3]*b[1] + a[6]*b[2],
+    a[0]*b[3] + a[3]*b[4] + a[6]*b[5],
+    a[0]*b[6] + a[3]*b[7] + a[6]*b[8],
+    a[0]*b[9] + a[3]*b[10] + a[6]*b[11] + a[9],
+    a[1]*b[0] + a[4]*b[1] + a[7]*b[2],
+    a[1]*b[3] + a[4]*b[4] + a[7]*b[5],
+    a[1]*b[6] + a[4]*b[7] + a[7]*b[8],
+    a[1]*b[9] + a[4]*b[10] + a[7]*b[11] + a[10],
+    a[2]*b[0] + a[5]*b[1] + a[8]*b[2],
+    a[2]*b[3] + a[5]*b[4] + a[8]*b[5],
+    a[2]*b[6] + a[5]*b[7] + a[8]*b[8],
+    a[2]*b[9] + a[5]*b[10] + a[8]*b[11] + a[11]);
+}
+
+#if defined(THX_SSE2)
+
+namespace detail {
+
+//! Linear part of a times column bj of b, where a0..a2 are the columns of a.
+inline
+__m128
+affine_col_sse(__m128 const a0, 
+               __m128 const a1, 
+               __m128 const a2, 
+               float32 const* const bj) {
+  __m128 c = _mm_mul_ps(a0, _mm_set1_ps(bj[0]));
+  c = _mm_add_ps(c, _mm_mul_ps(a1, _mm_set1_ps(bj[1])));
+  c = _mm_add_ps(c, _mm_mul_ps(a2, _mm_set1_ps(bj[2])));
+  return c;
+}
+
+//! Linear part of a times column bj of b, SSE2 version for float64. Only rows
+//! 0-1 are computed, a0..a2 are the upper halves of the columns of a.
+inline
+__m128d
+affine_col_sse(__m128d const a0, 
+               __m128d const a1, 
+               __m128d const a2, 
+               float64 const* const bj) {
+  __m128d c = _mm_mul_pd(a0, _mm_set1_pd(bj[0]));
+  c = _mm_add_pd(c, _mm_mul_pd(a1, _mm_set1_pd(bj[1])));
+  c = _mm_add_pd(c, _mm_mul_pd(a2, _mm_set1_pd(bj[2])));
+  return c;
+}
+
+//! c = a*b, SSE version for float32. Columns are loaded as overlapping 
+//! 4-wide packets, the fourth lane is ignored. The result columns are packed 
+//! into three full packets before storing. c must not alias a or b.
+inline
+void
+affine_mult_simd(float32 const* const pa, 
+                 float32 const* const pb, 
+                 float32* const pc) {
+  __m128 const a0 = _mm_loadu_ps(pa);
+  __m128 const a1 = _mm_loadu_ps(pa + 3);
+  __m128 const a2 = _mm_loadu_ps(pa + 6);
+  __m128 const a3 = _mm_loadu_ps(pa + 8); // Lanes 1-3 hold column 3.
+  __m128 const c0 = affine_col_sse(a0, a1, a2, pb);
+  __m128 const c1 = affine_col_sse(a0, a1, a2, pb + 3);
+  __m128 const c2 = affine_col_sse(a0, a1, a2, pb + 6);
+  __m128 const c3 = _mm_add_ps(affine_col_sse(a0, a1, a2, pb + 9), 
+                               _mm_shuffle_ps(a3, a3, _MM_SHUFFLE(3, 3, 2, 1)));
+
+  // [c00 c10 c20 c01], [c11 c21 c02 c12], [c22 c03 c13 c23].
+  __m128 const t0 = _mm_shuffle_ps(c0, c1, _MM_SHUFFLE(0, 0, 2, 2));
+  __m128 const t2 = _mm_shuffle_ps(c2, c3, _MM_SHUFFLE(0, 0, 2, 2));
+  _mm_storeu_ps(pc,     _mm_shuffle_ps(c0, t0, _MM_SHUFFLE(2, 0, 1, 0)));
+  _mm_storeu_ps(pc + 4, _mm_shuffle_ps(c1, c2, _MM_SHUFFLE(1, 0, 2, 1)));
+  _mm_storeu_ps(pc + 8, _mm_shuffle_ps(t2, c3, _MM_SHUFFLE(2, 1, 2, 0)));
+}
+
+//! c = a*b, SSE2 version for float64. Rows 0-1 are packed, row 2 is scalar.
+//! c must not alias a or b.
+inline
+void
+affine_mult_simd(float64 const* const pa, 
+                 float64 const* const pb, 
+                 float64* const pc) {
+  __m128d const a0 = _mm_loadu_pd(pa);
+  __m128d const a1 = _mm_loadu_pd(pa + 3);
+  __m128d const a2 = _mm_loadu_pd(pa + 6);
+  __m128d const a3 = _mm_loadu_pd(pa + 9);
+  _mm_storeu_pd(pc,     affine_col_sse(a0, a1, a2, pb));
+  _mm_storeu_pd(pc + 3, affine_col_sse(a0, a1, a2, pb + 3));
+  _mm_storeu_pd(pc + 6, affine_col_sse(a0, a1, a2, pb + 6));
+  _mm_storeu_pd(pc + 9, _mm_add_pd(affine_col_sse(a0, a1, a2, pb + 9), a3));
+  pc[2]  = pa[2]*pb[0] + pa[5]*pb[1]  + pa[8]*pb[2];
+  pc[5]  = pa[2]*pb[3] + pa[5]*pb[4]  + pa[8]*pb[5];
+  pc[8]  = pa[2]*pb[6] + pa[5]*pb[7]  + pa[8]*pb[8];
+  pc[11] = pa[2]*pb[9] + pa[5]*pb[10] + pa[8]*pb[11] + pa[11];
+}
+
+} // Namespace: detail.
+
+//! Compose, SSE specialization for float32.
+inline THX_CONST_EXPR_DISPATCH
+affine<float32>
+mult(affine<float32> const& a, affine<float32> const& b) {
+  if (THX_CONSTANT_EVALUATED()) {
+    return mult<float32>(a, b);
+  }
+  affine<float32> c;
+  detail::affine_mult_simd(a.const_data(), b.const_data(), c.data());
+  return c;
+}
+
+//! Compose, SSE2 specialization for float64.
+inline THX_CONST_EXPR_DISPATCH
+affine<float64>
+mult(affine<float64> const& a, affine<float64> const& b) {
+  if (THX_CONSTANT_EVALUATED()) {
+    return mult<float64>(a, b);
+  }
+  affine<float64> c;
+  detail::affine_mult_simd(a.const_data(), b.const_data(), c.data());
+  return c;
+}
+
+#endif // THX_SSE2
+
+//! Transform point p, i.e. w = 1.
+template<typename S> inline THX_CONST_EXPR
+vec<3,S>
+transform_point(affine<S> const& a, vec<3,S> const& p) {
+  return vec<3,S>(
+    a(0,0)*p[0] + a(0,1)*p[1] + a(0,2)*p[2] + a(0,3),
+    a(1,0)*p[0] + a(1,1)*p[1] + a(1,2)*p[2] + a(1,3),
+    a(2,0)*p[0] + a(2,1)*p[1] + a(2,2)*p[2] + a(2,3));
+}
+
+//! Transform direction v, i.e. w = 0, the translation is ignored.
+template<typename S> inline THX_CONST_EXPR
+vec<3,S>
+transform_vector(affine<S> const& a, vec<3,S> const& v) {
+  return vec<3,S>(
+    a(0,0)*v[0] + a(0,1)*v[1] + a(0,2)*v[2],
+    a(1,0)*v[0] + a(1,1)*v[1] + a(1,2)*v[2],
+    a(2,0)*v[0] + a(2,1)*v[1] + a(2,2)*v[2]);
+}
+
+//! Determinant of the linear part, which is also the determinant of the full
+//! 4x4 matrix.
+template<typename S> inline THX_CONST_EXPR
+S
+determinant(affine<S> const& a) {
+  return determinant(a.linear());
+}
+
+//! Inverse of a general affine transform, the linear part is inverted by
+//! cofactor expansion. No singularity checking!
+template<typename S> inline
+affine<S>
+inverted(affine<S> const& a) {
+  const mat<3,S> li = inverted(a.linear());
+  return affine<S>(li, -(li*a.translation()));
+}
+
+//! Inverse of a rigid transform (rotation and translation), i.e. the linear
+//! part must be orthonormal. The linear part is transposed, so this is both
+//! cheaper and more accurate than inverted.
+template<typename S> inline THX_CONST_EXPR
+affine<S>
+inverted_rigid(affine<S> const& a) {
+  return affine<S>(
+    a(0,0), a(1,0), a(2,0), -(a(0,0)*a(0,3) + a(1,0)*a(1,3) + a(2,0)*a(2,3)),
+    a(0,1), a(1,1), a(2,1), -(a(0,1)*a(0,3) + a(1,1)*a(1,3) + a(2,1)*a(2,3)),
+    a(0,2), a(1,2), a(2,2), -(a(0,2)*a(0,3) + a(1,2)*a(1,3) + a(2,2)*a(2,3)));
+}
+
+//------------------------------------------------------------------------------
+
+//! Transform n points, see transform_points(mat<4,S>, ...).
+template<typename S> inline
+void
+transform_points(affine<S> const& a,
+                 vec<3,S> const* const in,
+                 vec<3,S>* const out,
+                 std::size_t const n) {
+  transform_points(a.to_mat(), in, out, n);
+}
+
+//! Transform n direction vectors, see transform_vectors(mat<4,S>, ...).
+template<typename S> inline
+void
+transform_vectors(affine<S> const& a,
+                  vec<3,S> const* const in,
+                  vec<3,S>* const out,
+                  std::size_t const n) {
+  transform_vectors(a.to_mat(), in, out, n);
+}
+
+//------------------------------------------------------------------------------
+
+//! Binary operator: affine<S> == affine<S>
+template<typename S> inline THX_CONST_EXPR
+bool
+operator==(affine<S> const& a, affine<S> const& b) {
+  for (std::size_t i = 0; i < affine<S>::linear_size; ++i) {
+    if (a[i] != b[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+//! Binary operator: affine<S> != affine<S>
+template<typename S> inline THX_CONST_EXPR
+bool
+operator!=(affine<S> const& a, affine<S> const& b) {
+  return !(a == b);
+}
+
+//! Binary operator: affine<S> * affine<S>
+template<typename S> inline THX_CONST_EXPR
+affine<S>
+operator*(affine<S> const& a, affine<S> const& b) {
+  return mult(a, b);
+}
+
+//! Binary operator: affine<S> * vec<3,S> (point, assume w = 1)
+template<typename S> inline THX_CONST_EXPR
+vec<3,S>
+operator*(affine<S> const& a, vec<3,S> const& p) {
+  return transform_point(a, p);
+}
+
+//------------------------------------------------------------------------------
+
+// Convenient types, add more if appropriate.
+
+typedef affine<float32>  affinef32;
+typedef affine<float64>  affinef64;
+
+END_THX_NAMESPACE
+
+#endif // THX_AFFINE_HPP_INCLUDED
@@ -0,0 +1,225 @@
+//------------------------------------------------------------------------------
+//
+// Contributors:
+//             1) Tommy Hinks
+//
+//------------------------------------------------------------------------------
+
+#ifndef THX_ALIGNED_HPP_INCLUDED
+#define THX_ALIGNED_HPP_INCLUDED
+
+#include "thx_namespace.hpp"
+#include "thx_define.hpp"
+#include "thx_types.hpp"
+#include "thx_vec.hpp"
+#include "thx_mat.hpp"
+#include "thx_quat.hpp"
+#include "thx_mat_algo.hpp"
+#include "thx_simd.hpp"
+#include <cstddef>
+#include <limits>
+#include <new>
+
+//------------------------------------------------------------------------------
+
+BEGIN_THX_NAMESPACE
+
+// aligned<T,A> anatomy:
+// ---------------------
+//
+// define alignment = A
+//
+// (All CTOR's of T)
+// Default constexpr CTOR (as T)
+// T constexpr CTOR
+// (Compiler-generated DTOR, copy CTOR and operator=)
+//
+// aligned<T,A> is a T whose address is always a multiple of A bytes. The
+// default A is the largest power of two that divides sizeof(T), but no more
+// than simd_alignment. For vec<4,S>, mat<4,S> and quat<S> this means:
+//
+//   vec4f32_aligned, quatf32_aligned - 16 bytes
+//   vec4f64_aligned, quatf64_aligned - 32 bytes
+//   mat4f32_aligned, mat4f64_aligned - 64 bytes (a cache line)
+//
+// Since sizeof(T) is a multiple of A, arrays of aligned<T,A> have the same
+// layout as arrays of T, every element is aligned and no element straddles a
+// cache line.
+//
+// aligned<T,A> derives from T, so all functions and operators taking T work
+// unchanged, returning T. Results convert back implicitly.
+//
+// Memory from operator new is only guaranteed to be aligned to
+// alignof(std::max_align_t) before C++17. Use aligned_allocator<T> with
+// std containers, e.g.
+//
+//   std::vector<mat4f32_aligned, aligned_allocator<mat4f32_aligned>> m;
+
+namespace detail {
+
+//! Largest power of two that divides Size, no more than simd_alignment.
+template<std::size_t Size, std::size_t A = simd_alignment>
+struct aligned_default {
+  static const std::size_t value =
+    (Size % A == 0) ? A : aligned_default<Size, A/2>::value;
+};
+
+template<std::size_t Size>
+struct aligned_default<Size, 1> {
+  static const std::size_t value = 1;
+};
+
+} // Namespace: detail.
+
+//! DOCS
+template<class T, std::size_t A = detail::aligned_default<sizeof(T)>::value>
+class alignas(A) aligned : public T {
+public:
+  static_assert(A > 0 && (A & (A - 1)) == 0,
+                "Alignment must be a power of two");
+  static_assert(sizeof(T) % A == 0,
+                "Size must be a multiple of the alignment");
+
+  static const std::size_t alignment = A;
+
+public: // CTOR's.
+  using T::T;
+
+  //! Default CTOR.
+  THX_CONST_EXPR
+  aligned()
+    : T() {
+  }
+
+  //! T CTOR. Not explicit, results of functions taking T convert back.
+  THX_CONST_EXPR
+  aligned(T const& t)
+    : T(t) {
+  }
+};
+
+//------------------------------------------------------------------------------
+
+// aligned_allocator<T> anatomy:
+// -----------------------------
+//
+// Standard allocator (C++11 minimal requirements) handing out memory aligned
+// to simd_alignment bytes, which is enough for any aligned<T,A> with the
+// default alignment.
+
+//! DOCS
+template<class T>
+class aligned_allocator {
+public:
+  typedef T value_type;
+
+  static_assert(alignof(T) <= simd_alignment,
+                "Alignment must not exceed simd_alignment");
+
+public: // CTOR's.
+  aligned_allocator() {
+  }
+
+  template<class U>
+  aligned_allocator(aligned_allocator<U> const&) {
+  }
+
+public:
+  //! Allocate storage for n elements. Throws std::bad_alloc on failure.
+  T*
+  allocate(std::size_t const n) {
+    if (n > (std::numeric_limits<std::size_t>::max)()/sizeof(T)) {
+      throw std::bad_alloc();
+    }
+    return static_cast<T*>(detail::aligned_malloc(n*sizeof(T)));
+  }
+
+  //! Free storage from allocate.
+  void
+  deallocate(T* const p, std::size_t) {
+    detail::aligned_free(p);
+  }
+};
+
+//! All aligned_allocators are interchangeable.
+template<class T, class U> inline
+bool
+operator==(aligned_allocator<T> const&, aligned_allocator<U> const&) {
+  return true;
+}
+
+template<class T, class U> inline
+bool
+operator!=(aligned_allocator<T> const&, aligned_allocator<U> const&) {
+  return false;
+}
+
+//------------------------------------------------------------------------------
+
+// Aligned mat<4,S> multiplication.
+// --------------------------------
+//
+// With aligned operands the SIMD specializations of mult use aligned loads and
+// stores. Results are identical to the unaligned versions.
+
+//! Matrix multiplication.
+template<typename S> inline THX_CONST_EXPR
+aligned<mat<4,S>>
+mult(aligned<mat<4,S>> const& a, aligned<mat<4,S>> const& b) {
+  return aligned<mat<4,S>>(
+    mult(static_cast<mat<4,S> const&>(a), static_cast<mat<4,S> const&>(b)));
+}
+
+#if defined(THX_SSE2)
+
+//! Matrix multiplication, SSE specialization for float32.
+inline THX_CONST_EXPR_DISPATCH
+aligned<mat<4,float32>>
+mult(aligned<mat<4,float32>> const& a, aligned<mat<4,float32>> const& b) {
+  if (THX_CONSTANT_EVALUATED()) {
+    return aligned<mat<4,float32>>(mult<float32>(
+      static_cast<mat<4,float32> const&>(a), 
+      static_cast<mat<4,float32> const&>(b)));
+  }
+  aligned<mat<4,float32>> c;
+  detail::mult4_simd<true>(a.const_data(), b.const_data(), c.data());
+  return c;
+}
+
+//! Matrix multiplication, SSE2/AVX specialization for float64.
+inline THX_CONST_EXPR_DISPATCH
+aligned<mat<4,float64>>
+mult(aligned<mat<4,float64>> const& a, aligned<mat<4,float64>> const& b) {
+  if (THX_CONSTANT_EVALUATED()) {
+    return aligned<mat<4,float64>>(mult<float64>(
+      static_cast<mat<4,float64> const&>(a), 
+      static_cast<mat<4,float64> const&>(b)));
+  }
+  aligned<mat<4,float64>> c;
+  detail::mult4_simd<true>(a.const_data(), b.const_data(), c.data());
+  return c;
+}
+
+#endif // THX_SSE2
+
+//! Binary operator: aligned<mat<4,S>> * aligned<mat<4,S>>
+template<typename S> inline THX_CONST_EXPR
+aligned<mat<4,S>>
+operator*(aligned<mat<4,S>> const& a, aligned<mat<4,S>> const& b) {
+  return mult(a, b);
+}
+
+//------------------------------------------------------------------------------
+
+// Convenient types, add more if appropriate.
+
+typedef aligned<vec<4,float32>>  vec4f32_aligned;
+typedef aligned<vec<4,float64>>  vec4f64_aligned;
+typedef aligned<mat<4,float32>>  mat4f32_aligned;
+typedef aligned<mat<4,float64>>  mat4f64_aligned;
+typedef aligned<quat<float32>>   quatf32_aligned;
+typedef aligned<quat<float64>>   quatf64_aligned;
+
+END_THX_NAMESPACE
+
+#endif // THX_ALIGNED_HPP_INCLUDED
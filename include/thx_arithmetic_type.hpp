@@ -15,15 +15,26 @@
 
 BEGIN_THX_NAMESPACE
 
+//! value is the type stored for S, compute the type arithmetic on S is
+//! evaluated in. Both are S for the built-in types, storage types such as
+//! float16 (see thx_float16.hpp) specialize compute.
 template<typename S>
 struct arithmetic_type {
 public:
   typedef S value;
+  typedef S compute;
 
 private:
   static_assert(std::is_arithmetic<S>::value, "type is not arithmetic");
 };
 
+//! True if arithmetic on S is evaluated in a floating point type, e.g. for
+//! float32, float64 and float16.
+template<typename S>
+struct is_real_scalar 
+  : std::is_floating_point<typename arithmetic_type<S>::compute> {
+};
+
 END_THX_NAMESPACE
 
 #endif  // THX_ARITHMETIC_TYPE_HPP_INCLUDED
\ No newline at end of file
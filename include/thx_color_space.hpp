@@ -0,0 +1,1231 @@
+//------------------------------------------------------------------------------
+//
+// Contributors:
+//             1) Tommy Hinks
+//
+//------------------------------------------------------------------------------
+
+#ifndef THX_COLOR_SPACE_HPP_INCLUDED
+#define THX_COLOR_SPACE_HPP_INCLUDED
+
+#include "thx_namespace.hpp"
+#include "thx_types.hpp"
+#include "thx_vec.hpp"
+#include "thx_simd.hpp"
+#include "thx_cpu.hpp"
+#include "thx_mat_batch.hpp"
+#include "thx_parallel.hpp"
+#include "thx_image.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+#include <type_traits>
+
+//------------------------------------------------------------------------------
+
+BEGIN_THX_NAMESPACE
+
+// Color space conversion.
+// -----------------------
+//
+// vec<3,S> xyY_to_XYZ(vec<3,S>)
+// vec<3,S> XYZ_to_xyY(vec<3,S>)
+// vec<3,S> RGB_to_XYZ(vec<3,S>)
+// vec<3,S> XYZ_to_RGB(vec<3,S>)
+// vec<3,S> RGB_to_sRGB(vec<3,S>)
+// vec<3,S> sRGB_to_RGB(vec<3,S>)
+// vec<3,S> RGB_to_HSV(vec<3,S>)
+// vec<3,S> HSV_to_RGB(vec<3,S>)
+// vec<3,S> convert_color(color_stages, vec<3,S>)
+//
+// RGB is linear with Rec. 709 (sRGB) primaries and a D65 white point. XYZ is
+// scaled so that Y = 1 for white. XYZ_to_RGB does not clamp, colors outside
+// the gamut get components outside [0, 1].
+//
+// sRGB is the IEC 61966-2-1 encoding of RGB, see sRGB_encode. Linear values
+// are clamped to [0, 1] before encoding.
+//
+// HSV components are in [0, 1], with hue measured in turns from red. Grays
+// have hue and saturation zero. HSV_to_RGB clamps the hue to [0, 1].
+//
+// xyY_to_XYZ maps y <= 0 to black, XYZ_to_xyY maps black to the chromaticity
+// of the D65 white point.
+//
+// Batched conversion.
+// -------------------
+//
+// void convert_colors(stages, vec<3,S> const* in, vec<3,S>* out, n[, pool])
+// void convert_colors(stages,
+//                     vec<3,S> const* in, in_stride,
+//                     vec<3,S>* out, out_stride,
+//                     width, height[, pool])
+// void convert_colors(stages,
+//                     color_planes<S const> in,
+//                     color_planes<S> out,
+//                     width, height[, pool])
+// void convert_colors(stages,
+//                     image_view<3,S const> in,
+//                     image_view<3,S> out[, pool])
+//
+// Applies a sequence of conversions, e.g.
+// {color_xyY_to_XYZ, color_XYZ_to_RGB, color_RGB_to_sRGB}, to interleaved
+// pixels or to an image with three separate planes. Strides are the distance
+// between the starts of consecutive rows, in pixels for interleaved images and
+// in elements for planes. Input and output may be the same, but must not
+// partially overlap. Images may have different layouts, e.g. to convert
+// interleaved pixels into planes.
+//
+// Rows are split into groups of about color_grain pixels that are converted in
+// parallel. Each group is converted one block of color_block pixels at a time:
+// the block is copied into structure-of-arrays form and all stages are applied
+// while it is in cache, so memory is only traversed once. The 3x3 matrix, xyY
+// and HSV stages are branch free and process simd_traits<S>::packet_size
+// pixels at a time, or as many as active_isa() allows with run-time dispatch
+// (see thx_cpu.hpp). The sRGB stages call std::pow for each component.
+//
+// Every lane performs the same operations as the single-pixel functions, so
+// the results are identical as long as multiplies and adds are not contracted
+// into fused multiply-add instructions, see thx_cpu.hpp. Otherwise they agree
+// to within a few ulp.
+
+//! Conversion stages.
+enum color_conversion {
+  color_xyY_to_XYZ = 0,
+  color_XYZ_to_xyY,
+  color_RGB_to_XYZ,
+  color_XYZ_to_RGB,
+  color_RGB_to_sRGB,
+  color_sRGB_to_RGB,
+  color_RGB_to_HSV,
+  color_HSV_to_RGB
+};
+
+//------------------------------------------------------------------------------
+
+// color_stages anatomy:
+// ---------------------
+//
+// define max_size
+//
+// Stage CTOR (implicit, single stage)
+// List CTOR (implicit, throws std::length_error if longer than max_size)
+//
+// std::size_t size() const
+// color_conversion operator[](std::size_t) const
+
+//! DOCS
+class color_stages {
+public:
+  static const std::size_t max_size = 8;
+
+  //! Stage CTOR.
+  color_stages(color_conversion const c)
+    : _size(1) {
+    _stages[0] = c;
+  }
+
+  //! List CTOR, stages are applied in order.
+  color_stages(std::initializer_list<color_conversion> const stages)
+    : _size(stages.size()) {
+    if (_size > max_size) {
+      throw std::length_error("too many color conversion stages");
+    }
+    std::copy(stages.begin(), stages.end(), _stages);
+  }
+
+  std::size_t
+  size() const {
+    return _size;
+  }
+
+  color_conversion
+  operator[](std::size_t const i) const {
+    return _stages[i];
+  }
+
+private: // Member variables.
+  color_conversion _stages[max_size];
+  std::size_t _size;
+};
+
+//------------------------------------------------------------------------------
+
+//! Three planes of an image, e.g. R, G and B, with stride elements between
+//! the starts of consecutive rows.
+template<typename S>
+struct color_planes {
+  S* plane[3];
+  std::size_t stride;
+};
+
+//! Planes from three pointers.
+template<typename S> inline
+color_planes<S>
+make_color_planes(S* const p0,
+                  S* const p1,
+                  S* const p2,
+                  std::size_t const stride) {
+  color_planes<S> r;
+  r.plane[0] = p0;
+  r.plane[1] = p1;
+  r.plane[2] = p2;
+  r.stride = stride;
+  return r;
+}
+
+//------------------------------------------------------------------------------
+
+//! sRGB encoding of a linear value, clamped to [0, 1].
+template<typename S> inline
+S
+sRGB_encode(S x) {
+  x = (x > S(0) ? (x < S(1) ? x : S(1)) : S(0)); // NaN to zero.
+  return x <= S(0.0031308) ?
+    S(12.92)*x : S(1.055)*std::pow(x, S(1)/S(2.4)) - S(0.055);
+}
+
+//! Linear value of an sRGB encoded value, clamped to [0, 1].
+template<typename S> inline
+S
+sRGB_decode(S x) {
+  x = (x > S(0) ? (x < S(1) ? x : S(1)) : S(0)); // NaN to zero.
+  return x <= S(0.04045) ?
+    x/S(12.92) : std::pow((x + S(0.055))/S(1.055), S(2.4));
+}
+
+namespace detail {
+
+//! Pixels per parallel task.
+static const std::size_t color_grain = 16384;
+
+//! Pixels per structure-of-arrays block, a multiple of any packet_size.
+static const std::size_t color_block = 256;
+
+//! Row-major 3x3 matrix of a matrix stage.
+template<typename S> inline
+S const*
+color_matrix(color_conversion const c) {
+  static const S rgb_to_xyz[9] = {
+    S(0.4124564), S(0.3575761), S(0.1804375),
+    S(0.2126729), S(0.7151522), S(0.0721750),
+    S(0.0193339), S(0.1191920), S(0.9503041)
+  };
+  static const S xyz_to_rgb[9] = {
+    S( 3.2404542), S(-1.5371385), S(-0.4985314),
+    S(-0.9692660), S( 1.8760108), S( 0.0415560),
+    S( 0.0556434), S(-0.2040259), S( 1.0572252)
+  };
+  return c == color_RGB_to_XYZ ? rgb_to_xyz : xyz_to_rgb;
+}
+
+THX_GENERIC_KERNELS_BEGIN
+
+//! (a, b, c) = m*(a, b, c).
+template<class Simd, typename S> inline
+void
+color_matrix_packet(S const* const m,
+                    typename Simd::packet_type& a,
+                    typename Simd::packet_type& b,
+                    typename Simd::packet_type& c) {
+  typedef Simd simd;
+  typedef typename simd::packet_type packet_type;
+  packet_type r[3];
+  for (int i = 0; i < 3; ++i) {
+    r[i] = simd::mul(simd::set1(m[3*i]), a);
+    r[i] = simd::add(r[i], simd::mul(simd::set1(m[3*i + 1]), b));
+    r[i] = simd::add(r[i], simd::mul(simd::set1(m[3*i + 2]), c));
+  }
+  a = r[0];
+  b = r[1];
+  c = r[2];
+}
+
+//! (x, y, Y) to (X, Y, Z).
+template<class Simd, typename S> inline
+void
+xyY_to_XYZ_packet(typename Simd::packet_type& x,
+                  typename Simd::packet_type& y,
+                  typename Simd::packet_type& Y) {
+  typedef Simd simd;
+  typedef typename simd::packet_type packet_type;
+  const packet_type zero = simd::set1(S(0));
+  const typename simd::mask_type valid = simd::cmplt(zero, y);
+  const packet_type k = simd::div(Y, y);
+  const packet_type X = simd::mul(x, k);
+  const packet_type z = simd::sub(simd::sub(simd::set1(S(1)), x), y);
+  const packet_type Z = simd::mul(z, k);
+  x = simd::select(valid, X, zero);
+  y = simd::select(valid, Y, zero);
+  Y = simd::select(valid, Z, zero);
+}
+
+//! (X, Y, Z) to (x, y, Y).
+template<class Simd, typename S> inline
+void
+XYZ_to_xyY_packet(typename Simd::packet_type& X,
+                  typename Simd::packet_type& Y,
+                  typename Simd::packet_type& Z) {
+  typedef Simd simd;
+  typedef typename simd::packet_type packet_type;
+  const packet_type w = simd::add(simd::add(X, Y), Z);
+  const typename simd::mask_type valid = simd::cmplt(simd::set1(S(0)), w);
+  const packet_type x = simd::select(
+    valid, simd::div(X, w), simd::set1(S(0.3127)));
+  const packet_type y = simd::select(
+    valid, simd::div(Y, w), simd::set1(S(0.3290)));
+  Z = Y;
+  X = x;
+  Y = y;
+}
+
+//! (r, g, b) to (h, s, v).
+template<class Simd, typename S> inline
+void
+RGB_to_HSV_packet(typename Simd::packet_type& r,
+                  typename Simd::packet_type& g,
+                  typename Simd::packet_type& b) {
+  typedef Simd simd;
+  typedef typename simd::packet_type packet_type;
+  const packet_type zero = simd::set1(S(0));
+  const packet_type v = simd::max(r, simd::max(g, b));
+  const packet_type d = simd::sub(v, simd::min(r, simd::min(g, b)));
+  const packet_type s = simd::select(
+    simd::cmplt(zero, v), simd::div(d, v), zero);
+
+  // Distances to the maximum in units of d, zero for grays.
+  const packet_type inv_d = simd::select(
+    simd::cmplt(zero, d), simd::div(simd::set1(S(1)), d), zero);
+  const packet_type rc = simd::mul(simd::sub(v, r), inv_d);
+  const packet_type gc = simd::mul(simd::sub(v, g), inv_d);
+  const packet_type bc = simd::mul(simd::sub(v, b), inv_d);
+
+  // Sextant of the largest component, red first, then green.
+  packet_type h = simd::add(simd::set1(S(4)), simd::sub(gc, rc));
+  h = simd::select(simd::cmpeq(g, v),
+                   simd::add(simd::set1(S(2)), simd::sub(rc, bc)), h);
+  h = simd::select(simd::cmpeq(r, v), simd::sub(bc, gc), h);
+  h = simd::div(h, simd::set1(S(6)));
+  h = simd::select(simd::cmplt(h, zero), simd::add(h, simd::set1(S(1))), h);
+  r = h;
+  g = s;
+  b = v;
+}
+
+//! f = a + |t|, or a - |t| if negate is true, clamped to [0, 1].
+template<class Simd> inline
+void
+hue_ramp(typename Simd::packet_type const& a,
+         typename Simd::packet_type const& t,
+         typename Simd::packet_type const& zero,
+         typename Simd::packet_type const& one,
+         bool const negate,
+         typename Simd::packet_type& f) {
+  typedef Simd simd;
+  const typename simd::packet_type abs_t = simd::max(t, simd::sub(zero, t));
+  f = simd::min(one, simd::max(zero,
+    negate ? simd::sub(a, abs_t) : simd::add(a, abs_t)));
+}
+
+//! (h, s, v) to (r, g, b).
+template<class Simd, typename S> inline
+void
+HSV_to_RGB_packet(typename Simd::packet_type& h,
+                  typename Simd::packet_type& s,
+                  typename Simd::packet_type& v) {
+  typedef Simd simd;
+  typedef typename simd::packet_type packet_type;
+  const packet_type zero = simd::set1(S(0));
+  const packet_type one = simd::set1(S(1));
+  const packet_type h6 = simd::mul(simd::min(one, simd::max(zero, h)),
+                                   simd::set1(S(6)));
+
+  // Piecewise linear hue ramps, one at the maximum and zero at the minimum
+  // of each component.
+  packet_type fr, fg, fb;
+  hue_ramp<Simd>(simd::set1(S(-1)), simd::sub(h6, simd::set1(S(3))),
+                 zero, one, false, fr);
+  hue_ramp<Simd>(simd::set1(S(2)), simd::sub(h6, simd::set1(S(2))),
+                 zero, one, true, fg);
+  hue_ramp<Simd>(simd::set1(S(2)), simd::sub(h6, simd::set1(S(4))),
+                 zero, one, true, fb);
+
+  // v - c*(1 - f) is exactly v at the maximum.
+  const packet_type c = simd::mul(v, s);
+  h = simd::sub(v, simd::mul(c, simd::sub(one, fr)));
+  s = simd::sub(v, simd::mul(c, simd::sub(one, fg)));
+  v = simd::sub(v, simd::mul(c, simd::sub(one, fb)));
+}
+
+//! Apply the stages to the first n pixels of a structure-of-arrays block,
+//! component k of pixel l is buf[k*B + l]. Pixels up to the next multiple of
+//! Simd::packet_size are also converted and must be initialized.
+template<std::size_t B, typename S, class Simd = simd_traits<S>>
+void
+color_block_packets(color_stages const& stages,
+                    S* const buf,
+                    std::size_t const n) {
+  typedef Simd simd;
+  typedef typename simd::packet_type packet_type;
+  static const std::size_t P = simd::packet_size;
+
+  for (std::size_t k = 0; k < stages.size(); ++k) {
+    const color_conversion stage = stages[k];
+    if (stage == color_RGB_to_sRGB || stage == color_sRGB_to_RGB) {
+      for (std::size_t c = 0; c < 3; ++c) {
+        S* const p = buf + c*B;
+        for (std::size_t l = 0; l < n; ++l) {
+          p[l] = (stage == color_RGB_to_sRGB ?
+                  sRGB_encode(p[l]) : sRGB_decode(p[l]));
+        }
+      }
+      continue;
+    }
+
+    S const* const m = color_matrix<S>(stage);
+    for (std::size_t l = 0; l < n; l += P) {
+      packet_type a = simd::loadu(buf + l);
+      packet_type b = simd::loadu(buf + B + l);
+      packet_type c = simd::loadu(buf + 2*B + l);
+      switch (stage) {
+      case color_xyY_to_XYZ:
+        xyY_to_XYZ_packet<simd,S>(a, b, c);
+        break;
+      case color_XYZ_to_xyY:
+        XYZ_to_xyY_packet<simd,S>(a, b, c);
+        break;
+      case color_RGB_to_HSV:
+        RGB_to_HSV_packet<simd,S>(a, b, c);
+        break;
+      case color_HSV_to_RGB:
+        HSV_to_RGB_packet<simd,S>(a, b, c);
+        break;
+      default:
+        color_matrix_packet<simd>(m, a, b, c);
+        break;
+      }
+      simd::storeu(buf + l, a);
+      simd::storeu(buf + B + l, b);
+      simd::storeu(buf + 2*B + l, c);
+    }
+  }
+}
+
+THX_GENERIC_KERNELS_END
+
+//! Kernel converting a structure-of-arrays block, see color_block_packets.
+template<typename S>
+struct color_kernel {
+  typedef void (*type)(color_stages const&, S*, std::size_t);
+};
+
+//! Kernel for the instruction sets enabled at compile time.
+template<typename S> inline
+typename color_kernel<S>::type
+color_select_kernel(S) {
+  return &color_block_packets<color_block,S>;
+}
+
+#if defined(THX_DISPATCH)
+
+template<std::size_t B, typename S> THX_TARGET_AVX THX_FLATTEN
+void
+color_block_avx(color_stages const& stages, S* const buf, std::size_t const n) {
+  color_block_packets<B, S, avx_traits<S>>(stages, buf, n);
+}
+
+template<std::size_t B, typename S> THX_TARGET_AVX512 THX_FLATTEN
+void
+color_block_avx512(color_stages const& stages,
+                   S* const buf,
+                   std::size_t const n) {
+  color_block_packets<B, S, avx512_traits<S>>(stages, buf, n);
+}
+
+//! Kernel dispatched on active_isa().
+template<typename S> inline
+typename color_kernel<S>::type
+color_select_dispatch() {
+  const isa t = active_isa();
+  if (t >= isa_avx512) {
+    return &color_block_avx512<color_block,S>;
+  }
+  if (t >= isa_avx) {
+    return &color_block_avx<color_block,S>;
+  }
+  return &color_block_packets<color_block,S>;
+}
+
+inline
+color_kernel<float32>::type
+color_select_kernel(float32) {
+  return color_select_dispatch<float32>();
+}
+
+inline
+color_kernel<float64>::type
+color_select_kernel(float64) {
+  return color_select_dispatch<float64>();
+}
+
+#endif // THX_DISPATCH
+
+//! Copy n <= B interleaved pixels into structure-of-arrays form.
+template<std::size_t B, typename S> inline
+void
+color_gather(vec<3,S> const* const in, std::size_t const n, S* const buf) {
+  for (std::size_t l = 0; l < n; ++l) {
+    buf[l] = in[l][0];
+    buf[B + l] = in[l][1];
+    buf[2*B + l] = in[l][2];
+  }
+}
+
+//! Inverse of color_gather.
+template<std::size_t B, typename S> inline
+void
+color_scatter(S const* const buf, std::size_t const n, vec<3,S>* const out) {
+  for (std::size_t l = 0; l < n; ++l) {
+    out[l][0] = buf[l];
+    out[l][1] = buf[B + l];
+    out[l][2] = buf[2*B + l];
+  }
+}
+
+#if defined(THX_SSE2)
+
+//! Copy n <= B interleaved pixels into structure-of-arrays form, 4 at a
+//! time.
+template<std::size_t B> inline
+void
+color_gather(vec<3,float32> const* const in,
+             std::size_t const n,
+             float32* const buf) {
+  std::size_t l = 0;
+  for (; l + 4 <= n; l += 4) {
+    __m128 x, y, z;
+    load_soa4(in[l].const_data(), x, y, z);
+    _mm_storeu_ps(buf + l, x);
+    _mm_storeu_ps(buf + B + l, y);
+    _mm_storeu_ps(buf + 2*B + l, z);
+  }
+  for (; l < n; ++l) {
+    buf[l] = in[l][0];
+    buf[B + l] = in[l][1];
+    buf[2*B + l] = in[l][2];
+  }
+}
+
+//! Inverse of color_gather, 4 at a time.
+template<std::size_t B> inline
+void
+color_scatter(float32 const* const buf,
+              std::size_t const n,
+              vec<3,float32>* const out) {
+  std::size_t l = 0;
+  for (; l + 4 <= n; l += 4) {
+    store_soa4(out[l].data(),
+               _mm_loadu_ps(buf + l),
+               _mm_loadu_ps(buf + B + l),
+               _mm_loadu_ps(buf + 2*B + l));
+  }
+  for (; l < n; ++l) {
+    out[l][0] = buf[l];
+    out[l][1] = buf[B + l];
+    out[l][2] = buf[2*B + l];
+  }
+}
+
+#endif // THX_SSE2
+
+//! Convert n interleaved pixels on the calling thread, one block at a time.
+template<typename S>
+void
+color_range(color_stages const& stages,
+            typename color_kernel<S>::type const kernel,
+            vec<3,S> const* const in,
+            vec<3,S>* const out,
+            std::size_t const n,
+            S* const buf) {
+  static const std::size_t B = color_block;
+  for (std::size_t i = 0; i < n; i += B) {
+    const std::size_t m = (std::min)(B, n - i);
+    color_gather<B>(in + i, m, buf);
+    kernel(stages, buf, m);
+    color_scatter<B>(buf, m, out + i);
+  }
+}
+
+//! Convert n pixels of a row of planes on the calling thread, one block at a
+//! time.
+template<typename S>
+void
+color_range(color_stages const& stages,
+            typename color_kernel<S>::type const kernel,
+            S const* const* const in,
+            S* const* const out,
+            std::size_t const n,
+            S* const buf) {
+  static const std::size_t B = color_block;
+  for (std::size_t i = 0; i < n; i += B) {
+    const std::size_t m = (std::min)(B, n - i);
+    for (std::size_t c = 0; c < 3; ++c) {
+      std::copy(in[c] + i, in[c] + i + m, buf + c*B);
+    }
+    kernel(stages, buf, m);
+    for (std::size_t c = 0; c < 3; ++c) {
+      std::copy(buf + c*B, buf + c*B + m, out[c] + i);
+    }
+  }
+}
+
+//! Convert row y of an image on the calling thread, one block at a time.
+//! Either image may be interleaved or planar.
+template<typename S>
+void
+color_image_row(color_stages const& stages,
+                typename color_kernel<S>::type const kernel,
+                image_view<3,S const> const& in,
+                image_view<3,S> const& out,
+                std::size_t const y,
+                S* const buf) {
+  static const std::size_t B = color_block;
+  const std::size_t n = in.width();
+  for (std::size_t i = 0; i < n; i += B) {
+    const std::size_t m = (std::min)(B, n - i);
+    if (in.layout() == image_interleaved) {
+      color_gather<B>(reinterpret_cast<vec<3,S> const*>(in.at(i, y)), m, buf);
+    }
+    else {
+      for (std::size_t c = 0; c < 3; ++c) {
+        std::copy(in.at(i, y, c), in.at(i, y, c) + m, buf + c*B);
+      }
+    }
+    kernel(stages, buf, m);
+    if (out.layout() == image_interleaved) {
+      color_scatter<B>(buf, m, reinterpret_cast<vec<3,S>*>(out.at(i, y)));
+    }
+    else {
+      for (std::size_t c = 0; c < 3; ++c) {
+        std::copy(buf + c*B, buf + c*B + m, out.at(i, y, c));
+      }
+    }
+  }
+}
+
+//! Call f(y0, y1) for groups of consecutive rows of an image width pixels
+//! wide, in parallel on pool. Each group has at least color_grain pixels,
+//! unless the image is smaller.
+template<class F>
+void
+color_rows(std::size_t const width,
+           std::size_t const height,
+           thread_pool& pool,
+           F const& f) {
+  const std::size_t rows = color_grain/(std::max)(width, std::size_t(1));
+  parallel_for(0, height, (std::max)(rows, std::size_t(1)), f, pool);
+}
+
+} // Namespace: detail.
+
+//------------------------------------------------------------------------------
+
+//! Apply the stages to a single pixel.
+template<typename S> inline
+vec<3,S>
+convert_color(color_stages const& stages, vec<3,S> const& v) {
+  static_assert(std::is_floating_point<S>::value,
+                "Colors must have floating point components");
+  S buf[3] = { v[0], v[1], v[2] };
+  detail::color_block_packets<1, S, detail::single_lane_traits<S>>(
+    stages, buf, 1);
+  return vec<3,S>(buf[0], buf[1], buf[2]);
+}
+
+//! Convert (x, y, Y) to (X, Y, Z).
+template<typename S> inline
+vec<3,S>
+xyY_to_XYZ(vec<3,S> const& xyY) {
+  return convert_color(color_xyY_to_XYZ, xyY);
+}
+
+//! Convert (X, Y, Z) to (x, y, Y).
+template<typename S> inline
+vec<3,S>
+XYZ_to_xyY(vec<3,S> const& XYZ) {
+  return convert_color(color_XYZ_to_xyY, XYZ);
+}
+
+//! Convert linear RGB to XYZ.
+template<typename S> inline
+vec<3,S>
+RGB_to_XYZ(vec<3,S> const& rgb) {
+  return convert_color(color_RGB_to_XYZ, rgb);
+}
+
+//! Convert XYZ to linear RGB.
+template<typename S> inline
+vec<3,S>
+XYZ_to_RGB(vec<3,S> const& XYZ) {
+  return convert_color(color_XYZ_to_RGB, XYZ);
+}
+
+//! Encode linear RGB as sRGB.
+template<typename S> inline
+vec<3,S>
+RGB_to_sRGB(vec<3,S> const& rgb) {
+  return convert_color(color_RGB_to_sRGB, rgb);
+}
+
+//! Decode sRGB to linear RGB.
+template<typename S> inline
+vec<3,S>
+sRGB_to_RGB(vec<3,S> const& srgb) {
+  return convert_color(color_sRGB_to_RGB, srgb);
+}
+
+//! Convert RGB to (h, s, v).
+template<typename S> inline
+vec<3,S>
+RGB_to_HSV(vec<3,S> const& rgb) {
+  return convert_color(color_RGB_to_HSV, rgb);
+}
+
+//! Convert (h, s, v) to RGB.
+template<typename S> inline
+vec<3,S>
+HSV_to_RGB(vec<3,S> const& hsv) {
+  return convert_color(color_HSV_to_RGB, hsv);
+}
+
+//------------------------------------------------------------------------------
+
+//! Batched conversion of n interleaved pixels. See above.
+template<typename S>
+void
+convert_colors(color_stages const& stages,
+               vec<3,S> const* const in,
+               vec<3,S>* const out,
+               std::size_t const n,
+               thread_pool& pool = default_thread_pool()) {
+  static_assert(std::is_floating_point<S>::value,
+                "Colors must have floating point components");
+  const typename detail::color_kernel<S>::type kernel =
+    detail::color_select_kernel(S(0));
+  parallel_for(0, n, detail::color_grain,
+    [&](std::size_t const i0, std::size_t const i1) {
+      S buf[3*detail::color_block] = {};
+      detail::color_range(stages, kernel, in + i0, out + i0, i1 - i0, buf);
+    }, pool);
+}
+
+//! Batched conversion of an interleaved image. See above.
+template<typename S>
+void
+convert_colors(color_stages const& stages,
+               vec<3,S> const* const in,
+               std::size_t const in_stride,
+               vec<3,S>* const out,
+               std::size_t const out_stride,
+               std::size_t const width,
+               std::size_t const height,
+               thread_pool& pool = default_thread_pool()) {
+  static_assert(std::is_floating_point<S>::value,
+                "Colors must have floating point components");
+  const typename detail::color_kernel<S>::type kernel =
+    detail::color_select_kernel(S(0));
+  detail::color_rows(width, height, pool,
+    [&](std::size_t const y0, std::size_t const y1) {
+      S buf[3*detail::color_block] = {};
+      for (std::size_t y = y0; y < y1; ++y) {
+        detail::color_range(stages, kernel,
+                            in + y*in_stride, out + y*out_stride,
+                            width, buf);
+      }
+    });
+}
+
+//! Batched conversion of a planar image. See above.
+template<typename S>
+void
+convert_colors(color_stages const& stages,
+               color_planes<S const> const& in,
+               color_planes<S> const& out,
+               std::size_t const width,
+               std::size_t const height,
+               thread_pool& pool = default_thread_pool()) {
+  static_assert(std::is_floating_point<S>::value,
+                "Colors must have floating point components");
+  const typename detail::color_kernel<S>::type kernel =
+    detail::color_select_kernel(S(0));
+  detail::color_rows(width, height, pool,
+    [&](std::size_t const y0, std::size_t const y1) {
+      S buf[3*detail::color_block] = {};
+      for (std::size_t y = y0; y < y1; ++y) {
+        S const* const src[3] = {
+          in.plane[0] + y*in.stride,
+          in.plane[1] + y*in.stride,
+          in.plane[2] + y*in.stride
+        };
+        S* const dst[3] = {
+          out.plane[0] + y*out.stride,
+          out.plane[1] + y*out.stride,
+          out.plane[2] + y*out.stride
+        };
+        detail::color_range(stages, kernel, src, dst, width, buf);
+      }
+    });
+}
+
+//! Batched conversion of an image to another of the same size. See above.
+template<typename S>
+void
+convert_colors(color_stages const& stages,
+               image_view<3,S const> const& in,
+               image_view<3,S> const& out,
+               thread_pool& pool = default_thread_pool()) {
+  static_assert(std::is_floating_point<S>::value,
+                "Colors must have floating point components");
+  static_assert(sizeof(vec<3,S>) == 3*sizeof(S),
+                "Interleaved pixels must have the layout of vec<3,S>");
+  const typename detail::color_kernel<S>::type kernel =
+    detail::color_select_kernel(S(0));
+  parallel_for_rows(in, [&](std::size_t const y0, std::size_t const y1) {
+    S buf[3*detail::color_block] = {};
+    for (std::size_t y = y0; y < y1; ++y) {
+      detail::color_image_row(stages, kernel, in, out, y, buf);
+    }
+  }, pool);
+}
+
+//! Mutable input, e.g. an image<3,S>.
+template<typename S>
+void
+convert_colors(color_stages const& stages,
+               image_view<3,S> const& in,
+               image_view<3,S> const& out,
+               thread_pool& pool = default_thread_pool()) {
+  convert_colors(stages, image_view<3,S const>(in), out, pool);
+}
+
+//------------------------------------------------------------------------------
+
+// sRGB transfer of 8- and 16-bit channels.
+// ----------------------------------------
+//
+// uint8 sRGB_encode8(S x[, transfer])
+// uint16 sRGB_encode16(S x[, transfer])
+// S sRGB_decode8<S>(uint8 c[, transfer])
+// S sRGB_decode16<S>(uint16 c[, transfer])
+//
+// void sRGB_encode(S const* in, uint8* out, n[, transfer[, pool]])
+// void sRGB_encode(S const* in, uint16* out, n[, transfer[, pool]])
+// void sRGB_decode(uint8 const* in, S* out, n[, transfer[, pool]])
+// void sRGB_decode(uint16 const* in, S* out, n[, transfer[, pool]])
+//
+// Convert between linear values and sRGB encoded integer channels, e.g. the
+// components of interleaved or planar images. Encoding clamps to [0, 1] and
+// rounds to the nearest code. With color_transfer_exact every value goes
+// through sRGB_encode or sRGB_decode, i.e. std::pow. With color_transfer_table,
+// the default:
+//
+// - Decoding looks up a table of all 256 or 65536 codes, built on first use
+//   from the exact path, so the results are identical.
+// - Encoding evaluates a piecewise quadratic fit of the curve. Segments are
+//   indexed by the float32 exponent and the top 4 (8-bit) or 6 (16-bit)
+//   mantissa bits, so that they are short where the curve bends the most. The
+//   tables have 145 and 577 segments of 16 bytes. The linear part near zero is
+//   evaluated directly. Codes differ from the exact path by at most one, for
+//   about 1 in 50000 (8-bit) and 1 in 10000 (16-bit) values, all close to the
+//   midpoint between two codes.
+//
+// The batched versions split the range into chunks of srgb_grain values that
+// are converted in parallel.
+
+//! Evaluation of the sRGB transfer function for integer channels.
+enum color_transfer {
+  color_transfer_exact = 0, //!< std::pow for every value.
+  color_transfer_table      //!< Lookup tables, see above.
+};
+
+namespace detail {
+
+//! Values per parallel task.
+static const std::size_t srgb_grain = 65536;
+
+inline
+uint32
+srgb_float_bits(float32 const x) {
+  uint32 u;
+  std::memcpy(&u, &x, sizeof(u));
+  return u;
+}
+
+inline
+float32
+srgb_bits_float(uint32 const u) {
+  float32 x;
+  std::memcpy(&x, &u, sizeof(x));
+  return x;
+}
+
+//! Piecewise quadratic fit of sRGB_encode scaled to [0, 2^Bits - 1], see
+//! above.
+template<int Bits>
+class srgb_encode_table {
+public:
+  static const uint32 top = (1u << Bits) - 1;
+
+  //! Mantissa bits of the segment index.
+  static const int mantissa_bits = (Bits <= 8 ? 4 : 6);
+  static const int shift = 23 - mantissa_bits;
+
+  //! Bits of 2^-9, the first segment starts below the linear part.
+  static const uint32 first = 0x3b000000u;
+
+  //! Exponents -9 to -1, and a last segment for 1.
+  static const std::size_t size = (std::size_t(9) << mantissa_bits) + 1;
+
+  srgb_encode_table() {
+    for (std::size_t i = 0; i < size; ++i) {
+      const float64 x0 = srgb_bits_float(first + uint32(i << shift));
+      const float64 h = srgb_bits_float(first + uint32((i + 1) << shift)) - x0;
+
+      // Interpolate at the Chebyshev nodes of the segment, in powers of
+      // t = x - x0.
+      float64 t[3];
+      float64 y[3];
+      for (int k = 0; k < 3; ++k) {
+        t[k] = 0.5*h*(1 - std::cos((2*k + 1)*3.14159265358979323846/6));
+        y[k] = top*sRGB_encode(x0 + t[k]);
+      }
+      const float64 d01 = (y[1] - y[0])/(t[1] - t[0]);
+      const float64 d12 = (y[2] - y[1])/(t[2] - t[1]);
+      const float64 c2 = (d12 - d01)/(t[2] - t[0]);
+      const float64 c1 = d01 - c2*(t[0] + t[1]);
+      float64 c0 = y[0] - d01*t[0] + c2*t[0]*t[1];
+
+      // Center the error, and add 0.5 so that truncation rounds.
+      float64 lo = 0;
+      float64 hi = 0;
+      for (int j = 0; j <= 64; ++j) {
+        const float64 u = h*j/64;
+        const float64 e = top*sRGB_encode(x0 + u) - (c0 + u*(c1 + u*c2));
+        lo = (std::min)(lo, e);
+        hi = (std::max)(hi, e);
+      }
+      c0 += 0.5*(lo + hi) + 0.5;
+
+      // The integer part is kept exact, float32 only holds the fraction.
+      const float64 base = std::floor(c0);
+      _segment[i].base = static_cast<uint32>(base);
+      _segment[i].c0 = static_cast<float32>(c0 - base);
+      _segment[i].c1 = static_cast<float32>(c1);
+      _segment[i].c2 = static_cast<float32>(c2);
+    }
+  }
+
+  //! Code of x in (0.0031308, 1].
+  uint32
+  operator()(float32 const x) const {
+    const uint32 u = srgb_float_bits(x);
+    segment const& s = _segment[(u - first) >> shift];
+    const float32 t = x - srgb_bits_float(u & ~((1u << shift) - 1));
+    const uint32 c = s.base + static_cast<uint32>(s.c0 + t*(s.c1 + t*s.c2));
+    return c < top ? c : top;
+  }
+
+  //! Segment i as 4 consecutive 32-bit values: base (integer), c0, c1, c2.
+  //! Only for SIMD loads, which may alias any type.
+  float32 const*
+  segment_data(std::size_t const i) const {
+    return reinterpret_cast<float32 const*>(&_segment[i]);
+  }
+
+private:
+  struct segment {
+    uint32 base;
+    float32 c0;
+    float32 c1;
+    float32 c2;
+  };
+
+private: // Member variables.
+  segment _segment[size];
+};
+
+//! Table of the encoding fit, built on first use.
+template<int Bits> inline
+srgb_encode_table<Bits> const&
+srgb_encode_lut() {
+  static const srgb_encode_table<Bits> table;
+  return table;
+}
+
+//! Encode x to a code in [0, 2^Bits - 1].
+template<int Bits, typename S> inline
+uint32
+srgb_encode_code(S const x, srgb_encode_table<Bits> const* const table) {
+  static const uint32 top = srgb_encode_table<Bits>::top;
+  if (table == 0) {
+    return static_cast<uint32>(S(top)*sRGB_encode(x) + S(0.5));
+  }
+  float32 f = static_cast<float32>(x);
+  f = (f > 0.f ? (f < 1.f ? f : 1.f) : 0.f); // NaN to zero.
+  if (f <= 0.0031308f) {
+    return static_cast<uint32>(f*(12.92f*top) + 0.5f);
+  }
+  return (*table)(f);
+}
+
+#if defined(THX_SSE2)
+
+//! Codes of 4 values, the same as srgb_encode_code with a table.
+template<int Bits> inline
+__m128i
+srgb_encode4_sse(srgb_encode_table<Bits> const& table, __m128 x) {
+  typedef srgb_encode_table<Bits> table_type;
+  const __m128i top = _mm_set1_epi32(static_cast<int32>(table_type::top));
+
+  // Clamp to [0, 1], NaN to zero.
+  x = _mm_min_ps(_mm_max_ps(x, _mm_setzero_ps()), _mm_set1_ps(1.f));
+
+  // Segment indices, zero in the linear part, and offsets into the segments.
+  const __m128i u = _mm_castps_si128(x);
+  __m128i i = _mm_srai_epi32(
+    _mm_sub_epi32(u, _mm_set1_epi32(static_cast<int32>(table_type::first))),
+    table_type::shift);
+  i = _mm_andnot_si128(_mm_srai_epi32(i, 31), i);
+  const __m128 t = _mm_sub_ps(x, _mm_castsi128_ps(_mm_and_si128(
+    u, _mm_set1_epi32(~static_cast<int32>((1u << table_type::shift) - 1)))));
+
+  // Gather the segments and transpose to base, c0, c1 and c2.
+  __m128 s0 = _mm_loadu_ps(table.segment_data(
+    static_cast<uint32>(_mm_cvtsi128_si32(i))));
+  __m128 s1 = _mm_loadu_ps(table.segment_data(
+    static_cast<uint32>(_mm_cvtsi128_si32(_mm_shuffle_epi32(i, 1)))));
+  __m128 s2 = _mm_loadu_ps(table.segment_data(
+    static_cast<uint32>(_mm_cvtsi128_si32(_mm_shuffle_epi32(i, 2)))));
+  __m128 s3 = _mm_loadu_ps(table.segment_data(
+    static_cast<uint32>(_mm_cvtsi128_si32(_mm_shuffle_epi32(i, 3)))));
+  _MM_TRANSPOSE4_PS(s0, s1, s2, s3);
+
+  const __m128 poly = _mm_add_ps(s1, _mm_mul_ps(t,
+    _mm_add_ps(s2, _mm_mul_ps(t, s3))));
+  __m128i c = _mm_add_epi32(_mm_castps_si128(s0), _mm_cvttps_epi32(poly));
+  const __m128i over = _mm_cmpgt_epi32(c, top);
+  c = _mm_or_si128(_mm_and_si128(over, top), _mm_andnot_si128(over, c));
+
+  // Linear part.
+  const __m128i lin = _mm_cvttps_epi32(_mm_add_ps(
+    _mm_mul_ps(x, _mm_set1_ps(12.92f*table_type::top)), _mm_set1_ps(0.5f)));
+  const __m128i near_zero = _mm_castps_si128(
+    _mm_cmple_ps(x, _mm_set1_ps(0.0031308f)));
+  return _mm_or_si128(_mm_and_si128(near_zero, lin),
+                      _mm_andnot_si128(near_zero, c));
+}
+
+#endif // THX_SSE2
+
+//! Linear values of all 2^Bits codes.
+template<int Bits, typename S>
+class srgb_decode_table {
+public:
+  srgb_decode_table() {
+    const S top = S((1u << Bits) - 1);
+    for (uint32 c = 0; c < (1u << Bits); ++c) {
+      _value[c] = sRGB_decode(S(c)/top);
+    }
+  }
+
+  S
+  operator[](uint32 const c) const {
+    return _value[c];
+  }
+
+private: // Member variables.
+  S _value[1u << Bits];
+};
+
+//! Decoding table, built on first use.
+template<int Bits, typename S> inline
+srgb_decode_table<Bits,S> const&
+srgb_decode_lut() {
+  static const srgb_decode_table<Bits,S> table;
+  return table;
+}
+
+//! Decode the code c in [0, 2^Bits - 1].
+template<int Bits, typename S> inline
+S
+srgb_decode_code(uint32 const c, srgb_decode_table<Bits,S> const* const table) {
+  if (table == 0) {
+    return sRGB_decode(S(c)/S((1u << Bits) - 1));
+  }
+  return (*table)[c];
+}
+
+//! Encode n values on the calling thread, C is the channel type. Arguments
+//! are passed by value, since stores to uint8 channels may alias anything
+//! reachable through a reference.
+template<int Bits, typename S, typename C>
+void
+srgb_encode_chunk(S const* const in,
+                  C* const out,
+                  std::size_t const n,
+                  srgb_encode_table<Bits> const* const table) {
+  std::size_t i = 0;
+#if defined(THX_SSE2)
+  if (table != 0) {
+    for (; i + 4 <= n; i += 4) {
+      const __m128 x = _mm_set_ps(static_cast<float32>(in[i + 3]),
+                                  static_cast<float32>(in[i + 2]),
+                                  static_cast<float32>(in[i + 1]),
+                                  static_cast<float32>(in[i]));
+      uint32 c[4];
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(c),
+                       srgb_encode4_sse(*table, x));
+      out[i] = static_cast<C>(c[0]);
+      out[i + 1] = static_cast<C>(c[1]);
+      out[i + 2] = static_cast<C>(c[2]);
+      out[i + 3] = static_cast<C>(c[3]);
+    }
+  }
+#endif // THX_SSE2
+  for (; i < n; ++i) {
+    out[i] = static_cast<C>(srgb_encode_code<Bits>(in[i], table));
+  }
+}
+
+//! Batched encoding, C is the channel type.
+template<int Bits, typename S, typename C>
+void
+srgb_encode_range(S const* const in,
+                  C* const out,
+                  std::size_t const n,
+                  color_transfer const transfer,
+                  thread_pool& pool) {
+  srgb_encode_table<Bits> const* const table =
+    (transfer == color_transfer_table ? &srgb_encode_lut<Bits>() : 0);
+  parallel_for(0, n, srgb_grain,
+    [&](std::size_t const i0, std::size_t const i1) {
+      srgb_encode_chunk<Bits>(in + i0, out + i0, i1 - i0, table);
+    }, pool);
+}
+
+//! Decode n values on the calling thread, C is the channel type. See
+//! srgb_encode_chunk.
+template<int Bits, typename S, typename C>
+void
+srgb_decode_chunk(C const* const in,
+                  S* const out,
+                  std::size_t const n,
+                  srgb_decode_table<Bits,S> const* const table) {
+  for (std::size_t i = 0; i < n; ++i) {
+    out[i] = srgb_decode_code<Bits>(in[i], table);
+  }
+}
+
+//! Batched decoding, C is the channel type.
+template<int Bits, typename S, typename C>
+void
+srgb_decode_range(C const* const in,
+                  S* const out,
+                  std::size_t const n,
+                  color_transfer const transfer,
+                  thread_pool& pool) {
+  srgb_decode_table<Bits,S> const* const table =
+    (transfer == color_transfer_table ? &srgb_decode_lut<Bits,S>() : 0);
+  parallel_for(0, n, srgb_grain,
+    [&](std::size_t const i0, std::size_t const i1) {
+      srgb_decode_chunk<Bits>(in + i0, out + i0, i1 - i0, table);
+    }, pool);
+}
+
+} // Namespace: detail.
+
+//------------------------------------------------------------------------------
+
+//! 8-bit sRGB code of the linear value x. See above.
+template<typename S> inline
+uint8
+sRGB_encode8(S const x, color_transfer const transfer = color_transfer_table) {
+  return static_cast<uint8>(detail::srgb_encode_code<8>(
+    x, transfer == color_transfer_table ? &detail::srgb_encode_lut<8>() : 0));
+}
+
+//! 16-bit sRGB code of the linear value x. See above.
+template<typename S> inline
+uint16
+sRGB_encode16(S const x, color_transfer const transfer = color_transfer_table) {
+  return static_cast<uint16>(detail::srgb_encode_code<16>(
+    x, transfer == color_transfer_table ? &detail::srgb_encode_lut<16>() : 0));
+}
+
+//! Linear value of the 8-bit sRGB code c. See above.
+template<typename S> inline
+S
+sRGB_decode8(uint8 const c,
+             color_transfer const transfer = color_transfer_table) {
+  return detail::srgb_decode_code<8>(c,
+    transfer == color_transfer_table ? &detail::srgb_decode_lut<8,S>() : 0);
+}
+
+//! Linear value of the 16-bit sRGB code c. See above.
+template<typename S> inline
+S
+sRGB_decode16(uint16 const c,
+              color_transfer const transfer = color_transfer_table) {
+  return detail::srgb_decode_code<16>(c,
+    transfer == color_transfer_table ? &detail::srgb_decode_lut<16,S>() : 0);
+}
+
+//! Batched 8-bit encoding. See above.
+template<typename S>
+void
+sRGB_encode(S const* const in,
+            uint8* const out,
+            std::size_t const n,
+            color_transfer const transfer = color_transfer_table,
+            thread_pool& pool = default_thread_pool()) {
+  detail::srgb_encode_range<8>(in, out, n, transfer, pool);
+}
+
+//! Batched 16-bit encoding. See above.
+template<typename S>
+void
+sRGB_encode(S const* const in,
+            uint16* const out,
+            std::size_t const n,
+            color_transfer const transfer = color_transfer_table,
+            thread_pool& pool = default_thread_pool()) {
+  detail::srgb_encode_range<16>(in, out, n, transfer, pool);
+}
+
+//! Batched 8-bit decoding. See above.
+template<typename S>
+void
+sRGB_decode(uint8 const* const in,
+            S* const out,
+            std::size_t const n,
+            color_transfer const transfer = color_transfer_table,
+            thread_pool& pool = default_thread_pool()) {
+  detail::srgb_decode_range<8>(in, out, n, transfer, pool);
+}
+
+//! Batched 16-bit decoding. See above.
+template<typename S>
+void
+sRGB_decode(uint16 const* const in,
+            S* const out,
+            std::size_t const n,
+            color_transfer const transfer = color_transfer_table,
+            thread_pool& pool = default_thread_pool()) {
+  detail::srgb_decode_range<16>(in, out, n, transfer, pool);
+}
+
+END_THX_NAMESPACE
+
+#endif // THX_COLOR_SPACE_HPP_INCLUDED
@@ -0,0 +1,633 @@
+//------------------------------------------------------------------------------
+//
+// Contributors:
+//             1) Tommy Hinks
+//
+//------------------------------------------------------------------------------
+
+#ifndef THX_CPU_HPP_INCLUDED
+#define THX_CPU_HPP_INCLUDED
+
+#include "thx_namespace.hpp"
+#include "thx_types.hpp"
+#include "thx_simd.hpp"
+#include <atomic>
+#include <cstddef>
+
+// Run-time instruction set dispatch.
+// ----------------------------------
+//
+// thx_simd.hpp selects kernels from the instruction sets enabled at compile
+// time. A binary built for the lowest common denominator (SSE2 on x64) can
+// still use wider instructions on CPUs that have them: the batched kernels
+// (transform_points/transform_vectors, batched mult and inverted, vec_soa
+// normalize) detect CPU features once, on first use, and call the widest
+// implementation the CPU and OS support.
+//
+// THX_DISPATCH - defined if run-time dispatch is available, i.e. x86/x64 with
+//                SSE2 enabled and MSVC, or gcc/clang with optimization
+//                enabled. Unoptimized gcc/clang builds do not honour
+//                THX_FLATTEN (below), so packets would be passed between
+//                functions compiled for different instruction sets.
+//
+// Kernels for wider instruction sets are marked with THX_TARGET_AVX,
+// THX_TARGET_AVX2, THX_TARGET_AVX512, THX_TARGET_BMI2 or THX_TARGET_F16C,
+// which lets gcc/clang emit those instructions in a single function regardless
+// of the compiler flags. MSVC emits any intrinsic without flags. THX_FLATTEN
+// inlines all calls of the marked function into it, so generic kernels
+// written against a traits class are compiled for the instruction set of the
+// caller.
+//
+// Generic kernels instantiated with the traits classes below pass packets
+// between functions that are not marked with a target, which gcc warns about
+// (-Wpsabi). Since the kernels are always inlined into a THX_FLATTEN function
+// the calling convention never applies. Wrap their definitions with
+// THX_GENERIC_KERNELS_BEGIN and THX_GENERIC_KERNELS_END to silence the warning.
+//
+// The AVX2 tier uses the AVX kernels. FMA is deliberately not used, so results
+// are bit-identical between tiers and between nodes of different generations.
+// AVX-512F implies FMA for gcc, which then contracts multiplies and adds
+// unless -ffp-contract=off is given, so THX_TARGET_AVX512 turns contraction
+// off for the kernels it marks. This only covers the dispatched kernels: if
+// FMA is enabled for the whole translation unit (e.g. -mfma or -march=native
+// with gcc's default -ffp-contract=fast) the baseline kernels and the scalar
+// functions they are compared against may be contracted as well, and results
+// of different tiers then agree to within a few ulp rather than exactly.
+// Build with -ffp-contract=off where bit-identical results are required.
+// Marking the scalar functions with optimize("fp-contract=off") instead would
+// keep gcc from inlining them.
+
+#if defined(THX_SSE2) && \
+    (defined(__x86_64__) || defined(__i386__) || \
+     defined(_M_X64) || defined(_M_IX86)) && \
+    ((defined(_MSC_VER) && !defined(__clang__)) || \
+     ((defined(__GNUC__) || defined(__clang__)) && defined(__OPTIMIZE__)))
+#  define THX_DISPATCH
+#endif
+
+#if defined(THX_DISPATCH)
+#  include <immintrin.h>
+#  if defined(_MSC_VER) && !defined(__clang__)
+#    include <intrin.h>
+#    define THX_TARGET_AVX
+#    define THX_TARGET_AVX2
+#    define THX_TARGET_AVX512
+#    define THX_TARGET_BMI2
+#    define THX_TARGET_F16C
+#    define THX_FLATTEN
+#  else
+#    include <cpuid.h>
+#    define THX_TARGET_AVX    __attribute__((target("avx")))
+#    define THX_TARGET_AVX2   __attribute__((target("avx2")))
+#    define THX_TARGET_AVX512 __attribute__((target("avx512f"), \
+                                               optimize("fp-contract=off")))
+#    define THX_TARGET_BMI2   __attribute__((target("bmi2")))
+#    define THX_TARGET_F16C   __attribute__((target("avx,f16c")))
+#    define THX_FLATTEN       __attribute__((flatten))
+#  endif
+#else
+#  define THX_TARGET_AVX
+#  define THX_TARGET_AVX2
+#  define THX_TARGET_AVX512
+#  define THX_TARGET_BMI2
+#  define THX_TARGET_F16C
+#  define THX_FLATTEN
+#endif // THX_DISPATCH
+
+#if defined(THX_DISPATCH) && defined(__GNUC__) && !defined(__clang__)
+#  define THX_GENERIC_KERNELS_BEGIN \
+     _Pragma("GCC diagnostic push") \
+     _Pragma("GCC diagnostic ignored \"-Wpsabi\"")
+#  define THX_GENERIC_KERNELS_END _Pragma("GCC diagnostic pop")
+#else
+#  define THX_GENERIC_KERNELS_BEGIN
+#  define THX_GENERIC_KERNELS_END
+#endif
+
+//------------------------------------------------------------------------------
+
+BEGIN_THX_NAMESPACE
+
+//! Instruction set tiers, ordered. Each tier includes the ones below it.
+enum isa {
+  isa_scalar = 0, //!< No SIMD.
+  isa_sse2,       //!< SSE2, 128-bit.
+  isa_avx,        //!< AVX, 256-bit float.
+  isa_avx2,       //!< AVX2 and FMA, 256-bit integer.
+  isa_avx512      //!< AVX-512F, 512-bit.
+};
+
+//! Name of tier t, e.g. "avx2", for logging and telemetry.
+inline
+char const*
+isa_name(isa const t) {
+  switch (t) {
+  case isa_sse2:   return "sse2";
+  case isa_avx:    return "avx";
+  case isa_avx2:   return "avx2";
+  case isa_avx512: return "avx512";
+  default:         return "scalar";
+  }
+}
+
+//! CPU features relevant to the kernels. A feature is only reported if the OS
+//! also saves the corresponding registers on context switches.
+struct cpu_features {
+  cpu_features()
+    : sse2(false)
+    , avx(false)
+    , avx2(false)
+    , fma(false)
+    , avx512f(false)
+    , bmi2(false)
+    , fast_pdep(false)
+    , f16c(false) {
+  }
+
+  bool sse2;
+  bool avx;
+  bool avx2;
+  bool fma;
+  bool avx512f;
+  bool bmi2;      //!< Bit deposit/extract, independent of the tiers.
+  bool fast_pdep; //!< BMI2, and pdep/pext are not microcoded. AMD CPUs
+                  //!< before Zen 3 (family 19h) take hundreds of cycles.
+  bool f16c;      //!< Half precision conversion, VEX encoded.
+};
+
+namespace detail {
+
+#if defined(THX_DISPATCH)
+
+//! Registers eax, ebx, ecx, edx of cpuid leaf/sub-leaf. Zero if the leaf is
+//! not supported.
+inline
+void
+cpuid(uint32 const leaf, uint32 const sub, uint32 r[4]) {
+  r[0] = r[1] = r[2] = r[3] = 0;
+#if defined(_MSC_VER) && !defined(__clang__)
+  int max[4];
+  __cpuid(max, static_cast<int>(leaf & 0x80000000u));
+  if (static_cast<uint32>(max[0]) >= leaf) {
+    int x[4];
+    __cpuidex(x, static_cast<int>(leaf), static_cast<int>(sub));
+    for (int i = 0; i < 4; ++i) {
+      r[i] = static_cast<uint32>(x[i]);
+    }
+  }
+#else
+  unsigned int a, b, c, d;
+  if (__get_cpuid_max(leaf & 0x80000000u, 0) >= leaf) {
+    __cpuid_count(leaf, sub, a, b, c, d);
+    r[0] = a;
+    r[1] = b;
+    r[2] = c;
+    r[3] = d;
+  }
+#endif
+}
+
+//! Extended control register 0, the register state enabled by the OS.
+//! Must only be called if cpuid reports OSXSAVE.
+inline
+uint64
+xgetbv0() {
+#if defined(_MSC_VER) && !defined(__clang__)
+  return static_cast<uint64>(_xgetbv(0));
+#else
+  uint32 lo, hi;
+  __asm__ __volatile__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+  return (static_cast<uint64>(hi) << 32) | lo;
+#endif
+}
+
+#endif // THX_DISPATCH
+
+//! Query the CPU.
+inline
+cpu_features
+detect_cpu_features() {
+  cpu_features f;
+#if defined(THX_DISPATCH)
+  uint32 r0[4];
+  uint32 r1[4];
+  uint32 r7[4];
+  cpuid(0, 0, r0);
+  cpuid(1, 0, r1);
+  cpuid(7, 0, r7);
+  f.sse2 = (r1[3] & (1u << 26)) != 0;
+
+  const bool osxsave = (r1[2] & (1u << 27)) != 0;
+  const uint64 xcr0 = osxsave ? xgetbv0() : 0;
+  const bool ymm = (xcr0 & 0x06) == 0x06;   // XMM and YMM state.
+  const bool zmm = (xcr0 & 0xe6) == 0xe6;   // ... and opmask, ZMM state.
+  f.avx = ymm && (r1[2] & (1u << 28)) != 0;
+  f.fma = f.avx && (r1[2] & (1u << 12)) != 0;
+  f.avx2 = f.avx && (r7[1] & (1u << 5)) != 0;
+  f.avx512f = zmm && f.avx && (r7[1] & (1u << 16)) != 0;
+  f.bmi2 = (r7[1] & (1u << 8)) != 0;
+
+  // Vendor "AuthenticAMD" or "HygonGenuine" in ebx, edx, ecx of leaf 0, and
+  // the family including the extended family of leaf 1.
+  const bool amd = (r0[1] == 0x68747541u && r0[3] == 0x69746e65u &&
+                    r0[2] == 0x444d4163u) ||
+                   (r0[1] == 0x6f677948u && r0[3] == 0x6e65476eu &&
+                    r0[2] == 0x656e6975u);
+  const uint32 base_family = (r1[0] >> 8) & 0xf;
+  const uint32 family = base_family == 0xf ?
+    base_family + ((r1[0] >> 20) & 0xff) : base_family;
+  f.fast_pdep = f.bmi2 && !(amd && family < 0x19);
+  f.f16c = f.avx && (r1[2] & (1u << 29)) != 0;
+#elif defined(THX_SSE2)
+  f.sse2 = true;
+#endif
+  return f;
+}
+
+//! Lowest tier, the instruction sets enabled at compile time.
+inline
+isa
+isa_baseline() {
+#if defined(THX_AVX)
+  return isa_avx;
+#elif defined(THX_SSE2)
+  return isa_sse2;
+#else
+  return isa_scalar;
+#endif
+}
+
+//! Active tier, -1 until first use.
+inline
+std::atomic<int>&
+isa_state() {
+  static std::atomic<int> state(-1);
+  return state;
+}
+
+} // Namespace: detail.
+
+//! Features of the CPU the program runs on, detected once.
+inline
+cpu_features const&
+cpu() {
+  static const cpu_features f = detail::detect_cpu_features();
+  return f;
+}
+
+//! Highest tier the kernels can use on this CPU. Without THX_DISPATCH this is
+//! the compile-time tier.
+inline
+isa
+max_isa() {
+#if defined(THX_DISPATCH)
+  cpu_features const& f = cpu();
+  isa t = detail::isa_baseline();
+  if (f.avx && t < isa_avx) {
+    t = isa_avx;
+  }
+  if (f.avx2 && f.fma && t < isa_avx2) {
+    t = isa_avx2;
+  }
+  if (f.avx512f && f.avx2 && f.fma) {
+    t = isa_avx512;
+  }
+  return t;
+#else
+  return detail::isa_baseline();
+#endif
+}
+
+//! Tier used by the dispatched kernels, max_isa() unless lowered with
+//! set_active_isa. Report this in logs and telemetry.
+inline
+isa
+active_isa() {
+  const int t = detail::isa_state().load(std::memory_order_relaxed);
+  if (t >= 0) {
+    return static_cast<isa>(t);
+  }
+  const isa m = max_isa();
+  detail::isa_state().store(m, std::memory_order_relaxed);
+  return m;
+}
+
+//! Use tier t, clamped to [compile-time tier, max_isa()], for subsequent calls
+//! of dispatched kernels. Returns the tier in use. Meant for start-up
+//! configuration and testing, calls running concurrently may use either tier.
+inline
+isa
+set_active_isa(isa const t) {
+  const isa lo = detail::isa_baseline();
+  const isa hi = max_isa();
+  const isa r = (t < lo ? lo : (t > hi ? hi : t));
+  detail::isa_state().store(r, std::memory_order_relaxed);
+  return r;
+}
+
+//------------------------------------------------------------------------------
+
+#if defined(THX_DISPATCH)
+
+namespace detail {
+
+// avx_traits<S>, avx512_traits<S> anatomy:
+// ----------------------------------------
+//
+// Same interface as simd_traits<S>, see thx_simd.hpp, with every function
+// compiled for AVX or AVX-512F. Only use from functions marked with the same
+// (or a wider) target.
+
+template<typename S>
+class avx_traits;
+
+//! AVX, 8 x float32.
+template<>
+class avx_traits<float32> : private nonconstructible
+{
+public:
+  typedef __m256 packet_type;
+  typedef __m256 mask_type;
+  static const std::size_t packet_size = 8;
+
+  static THX_TARGET_AVX packet_type
+  load(float32 const* const p)
+  { return _mm256_load_ps(p); }
+
+  static THX_TARGET_AVX packet_type
+  loadu(float32 const* const p)
+  { return _mm256_loadu_ps(p); }
+
+  static THX_TARGET_AVX void
+  store(float32* const p, packet_type const a)
+  { _mm256_store_ps(p, a); }
+
+  static THX_TARGET_AVX void
+  storeu(float32* const p, packet_type const a)
+  { _mm256_storeu_ps(p, a); }
+
+  static THX_TARGET_AVX packet_type
+  set1(float32 const x)
+  { return _mm256_set1_ps(x); }
+
+  static THX_TARGET_AVX packet_type
+  add(packet_type const a, packet_type const b)
+  { return _mm256_add_ps(a, b); }
+
+  static THX_TARGET_AVX packet_type
+  sub(packet_type const a, packet_type const b)
+  { return _mm256_sub_ps(a, b); }
+
+  static THX_TARGET_AVX packet_type
+  mul(packet_type const a, packet_type const b)
+  { return _mm256_mul_ps(a, b); }
+
+  static THX_TARGET_AVX packet_type
+  div(packet_type const a, packet_type const b)
+  { return _mm256_div_ps(a, b); }
+
+  static THX_TARGET_AVX packet_type
+  sqrt(packet_type const a)
+  { return _mm256_sqrt_ps(a); }
+
+  static THX_TARGET_AVX packet_type
+  min(packet_type const a, packet_type const b)
+  { return _mm256_min_ps(a, b); }
+
+  static THX_TARGET_AVX packet_type
+  max(packet_type const a, packet_type const b)
+  { return _mm256_max_ps(a, b); }
+
+  static THX_TARGET_AVX mask_type
+  cmplt(packet_type const a, packet_type const b)
+  { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+
+  static THX_TARGET_AVX mask_type
+  cmpeq(packet_type const a, packet_type const b)
+  { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+
+  static THX_TARGET_AVX packet_type
+  select(mask_type const m, packet_type const a, packet_type const b)
+  { return _mm256_blendv_ps(b, a, m); }
+};
+
+//! AVX, 4 x float64.
+template<>
+class avx_traits<float64> : private nonconstructible
+{
+public:
+  typedef __m256d packet_type;
+  typedef __m256d mask_type;
+  static const std::size_t packet_size = 4;
+
+  static THX_TARGET_AVX packet_type
+  load(float64 const* const p)
+  { return _mm256_load_pd(p); }
+
+  static THX_TARGET_AVX packet_type
+  loadu(float64 const* const p)
+  { return _mm256_loadu_pd(p); }
+
+  static THX_TARGET_AVX void
+  store(float64* const p, packet_type const a)
+  { _mm256_store_pd(p, a); }
+
+  static THX_TARGET_AVX void
+  storeu(float64* const p, packet_type const a)
+  { _mm256_storeu_pd(p, a); }
+
+  static THX_TARGET_AVX packet_type
+  set1(float64 const x)
+  { return _mm256_set1_pd(x); }
+
+  static THX_TARGET_AVX packet_type
+  add(packet_type const a, packet_type const b)
+  { return _mm256_add_pd(a, b); }
+
+  static THX_TARGET_AVX packet_type
+  sub(packet_type const a, packet_type const b)
+  { return _mm256_sub_pd(a, b); }
+
+  static THX_TARGET_AVX packet_type
+  mul(packet_type const a, packet_type const b)
+  { return _mm256_mul_pd(a, b); }
+
+  static THX_TARGET_AVX packet_type
+  div(packet_type const a, packet_type const b)
+  { return _mm256_div_pd(a, b); }
+
+  static THX_TARGET_AVX packet_type
+  sqrt(packet_type const a)
+  { return _mm256_sqrt_pd(a); }
+
+  static THX_TARGET_AVX packet_type
+  min(packet_type const a, packet_type const b)
+  { return _mm256_min_pd(a, b); }
+
+  static THX_TARGET_AVX packet_type
+  max(packet_type const a, packet_type const b)
+  { return _mm256_max_pd(a, b); }
+
+  static THX_TARGET_AVX mask_type
+  cmplt(packet_type const a, packet_type const b)
+  { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+
+  static THX_TARGET_AVX mask_type
+  cmpeq(packet_type const a, packet_type const b)
+  { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+
+  static THX_TARGET_AVX packet_type
+  select(mask_type const m, packet_type const a, packet_type const b)
+  { return _mm256_blendv_pd(b, a, m); }
+};
+
+template<typename S>
+class avx512_traits;
+
+//! AVX-512F, 16 x float32.
+template<>
+class avx512_traits<float32> : private nonconstructible
+{
+public:
+  typedef __m512 packet_type;
+  typedef __mmask16 mask_type;
+  static const std::size_t packet_size = 16;
+
+  static THX_TARGET_AVX512 packet_type
+  load(float32 const* const p)
+  { return _mm512_load_ps(p); }
+
+  static THX_TARGET_AVX512 packet_type
+  loadu(float32 const* const p)
+  { return _mm512_loadu_ps(p); }
+
+  static THX_TARGET_AVX512 void
+  store(float32* const p, packet_type const a)
+  { _mm512_store_ps(p, a); }
+
+  static THX_TARGET_AVX512 void
+  storeu(float32* const p, packet_type const a)
+  { _mm512_storeu_ps(p, a); }
+
+  static THX_TARGET_AVX512 packet_type
+  set1(float32 const x)
+  { return _mm512_set1_ps(x); }
+
+  static THX_TARGET_AVX512 packet_type
+  add(packet_type const a, packet_type const b)
+  { return _mm512_add_ps(a, b); }
+
+  static THX_TARGET_AVX512 packet_type
+  sub(packet_type const a, packet_type const b)
+  { return _mm512_sub_ps(a, b); }
+
+  static THX_TARGET_AVX512 packet_type
+  mul(packet_type const a, packet_type const b)
+  { return _mm512_mul_ps(a, b); }
+
+  static THX_TARGET_AVX512 packet_type
+  div(packet_type const a, packet_type const b)
+  { return _mm512_div_ps(a, b); }
+
+  static THX_TARGET_AVX512 packet_type
+  sqrt(packet_type const a)
+  { return _mm512_sqrt_ps(a); }
+
+  static THX_TARGET_AVX512 packet_type
+  min(packet_type const a, packet_type const b)
+  { return _mm512_min_ps(a, b); }
+
+  static THX_TARGET_AVX512 packet_type
+  max(packet_type const a, packet_type const b)
+  { return _mm512_max_ps(a, b); }
+
+  static THX_TARGET_AVX512 mask_type
+  cmplt(packet_type const a, packet_type const b)
+  { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+
+  static THX_TARGET_AVX512 mask_type
+  cmpeq(packet_type const a, packet_type const b)
+  { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+
+  static THX_TARGET_AVX512 packet_type
+  select(mask_type const m, packet_type const a, packet_type const b)
+  { return _mm512_mask_blend_ps(m, b, a); }
+};
+
+//! AVX-512F, 8 x float64.
+template<>
+class avx512_traits<float64> : private nonconstructible
+{
+public:
+  typedef __m512d packet_type;
+  typedef __mmask8 mask_type;
+  static const std::size_t packet_size = 8;
+
+  static THX_TARGET_AVX512 packet_type
+  load(float64 const* const p)
+  { return _mm512_load_pd(p); }
+
+  static THX_TARGET_AVX512 packet_type
+  loadu(float64 const* const p)
+  { return _mm512_loadu_pd(p); }
+
+  static THX_TARGET_AVX512 void
+  store(float64* const p, packet_type const a)
+  { _mm512_store_pd(p, a); }
+
+  static THX_TARGET_AVX512 void
+  storeu(float64* const p, packet_type const a)
+  { _mm512_storeu_pd(p, a); }
+
+  static THX_TARGET_AVX512 packet_type
+  set1(float64 const x)
+  { return _mm512_set1_pd(x); }
+
+  static THX_TARGET_AVX512 packet_type
+  add(packet_type const a, packet_type const b)
+  { return _mm512_add_pd(a, b); }
+
+  static THX_TARGET_AVX512 packet_type
+  sub(packet_type const a, packet_type const b)
+  { return _mm512_sub_pd(a, b); }
+
+  static THX_TARGET_AVX512 packet_type
+  mul(packet_type const a, packet_type const b)
+  { return _mm512_mul_pd(a, b); }
+
+  static THX_TARGET_AVX512 packet_type
+  div(packet_type const a, packet_type const b)
+  { return _mm512_div_pd(a, b); }
+
+  static THX_TARGET_AVX512 packet_type
+  sqrt(packet_type const a)
+  { return _mm512_sqrt_pd(a); }
+
+  static THX_TARGET_AVX512 packet_type
+  min(packet_type const a, packet_type const b)
+  { return _mm512_min_pd(a, b); }
+
+  static THX_TARGET_AVX512 packet_type
+  max(packet_type const a, packet_type const b)
+  { return _mm512_max_pd(a, b); }
+
+  static THX_TARGET_AVX512 mask_type
+  cmplt(packet_type const a, packet_type const b)
+  { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+
+  static THX_TARGET_AVX512 mask_type
+  cmpeq(packet_type const a, packet_type const b)
+  { return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ); }
+
+  static THX_TARGET_AVX512 packet_type
+  select(mask_type const m, packet_type const a, packet_type const b)
+  { return _mm512_mask_blend_pd(m, b, a); }
+};
+
+} // Namespace: detail.
+
+#endif // THX_DISPATCH
+
+END_THX_NAMESPACE
+
+#endif // THX_CPU_HPP_INCLUDED
@@ -1,6 +1,6 @@
 //------------------------------------------------------------------------------
 //
-// Contributors: 
+// Contributors:
 //             1) Tommy Hinks
 //
 //------------------------------------------------------------------------------
@@ -8,6 +8,64 @@
 #ifndef THX_DEFINE_HPP_INCLUDED
 #define THX_DEFINE_HPP_INCLUDED
 
-#define THX_CONST_EXPR /*constexpr*/
+// Compile-time constexpr support.
+// -------------------------------
+//
+// THX_CONST_EXPR - constexpr if the compiler supports relaxed (C++14)
+//                  constexpr functions, i.e. loops, local variables and
+//                  member modification. Otherwise empty and all functions
+//                  marked THX_CONST_EXPR are regular inline functions.
+// THX_HAS_CONST_EXPR - defined if THX_CONST_EXPR is constexpr.
+//
+// THX_CONSTANT_EVALUATED() - true during constant evaluation, false at
+//                  run-time. Lets a function use SIMD intrinsics or the C
+//                  library at run-time and still be usable in constant
+//                  expressions.
+// THX_HAS_CONSTANT_EVALUATED - defined if THX_CONSTANT_EVALUATED() is
+//                  available.
+// THX_CONST_EXPR_DISPATCH - constexpr for non-template functions that need
+//                  THX_CONSTANT_EVALUATED() to have a constant path, empty if
+//                  it is not available.
+
+// Byte order.
+// -----------
+//
+// THX_BIG_ENDIAN - defined on big-endian targets. Code that reads or writes
+//                  multi-byte values in a fixed byte order, e.g. hashing,
+//                  takes a byte-wise path there.
+
+#if (defined(__cplusplus) && __cplusplus >= 201402L && !defined(_MSC_VER)) || \
+    (defined(_MSC_VER) && _MSC_VER >= 1910 && _MSVC_LANG >= 201402L)
+#  define THX_HAS_CONST_EXPR
+#endif
+
+#if defined(THX_HAS_CONST_EXPR)
+#  define THX_CONST_EXPR constexpr
+#  if defined(__has_builtin)
+#    if __has_builtin(__builtin_is_constant_evaluated)
+#      define THX_HAS_CONSTANT_EVALUATED
+#    endif
+#  elif (defined(__GNUC__) && __GNUC__ >= 9) || \
+        (defined(_MSC_VER) && _MSC_VER >= 1925)
+#    define THX_HAS_CONSTANT_EVALUATED
+#  endif
+#else
+#  define THX_CONST_EXPR
+#endif
+
+#if defined(THX_HAS_CONSTANT_EVALUATED)
+#  define THX_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#  define THX_CONST_EXPR_DISPATCH constexpr
+#else
+#  define THX_CONSTANT_EVALUATED() false
+#  define THX_CONST_EXPR_DISPATCH
+#endif
+
+#if !defined(THX_BIG_ENDIAN) && \
+    defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__)
+#  if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#    define THX_BIG_ENDIAN
+#  endif
+#endif
 
 #endif // THX_DEFINE_HPP_INCLUDED
@@ -0,0 +1,603 @@
+//------------------------------------------------------------------------------
+//
+// Contributors:
+//             1) Tommy Hinks
+//
+//------------------------------------------------------------------------------
+
+#ifndef THX_DUAL_QUAT_HPP_INCLUDED
+#define THX_DUAL_QUAT_HPP_INCLUDED
+
+#include "thx_namespace.hpp"
+#include "thx_define.hpp"
+#include "thx_types.hpp"
+#include "thx_vec.hpp"
+#include "thx_vec_algo.hpp"
+#include "thx_quat.hpp"
+#include "thx_quat_algo.hpp"
+#include "thx_operators.hpp"
+#include "thx_scalar_traits.hpp"
+#include "thx_simd.hpp"
+#include "thx_cpu.hpp"
+#include "thx_parallel.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
+//------------------------------------------------------------------------------
+
+BEGIN_THX_NAMESPACE
+
+// dual_quat<S> anatomy:
+// ---------------------
+//
+// Define value_type
+//
+// constexpr dual_quat<S> identity()
+//
+// Default constexpr CTOR (identity)
+// Real and dual part constexpr CTOR
+// Rotation and translation constexpr CTOR
+// (Compiler-generated DTOR, copy CTOR and operator=)
+//
+// operator+=(dual_quat)
+// operator*=(S)
+// operator*=(dual_quat)
+//
+// quat<S> real() const
+// quat<S>& real()
+// quat<S> dual() const
+// quat<S>& dual()
+//
+// A rigid transform q = r + e*d, where the unit quaternion r is the rotation
+// and d = 0.5*t*r holds the translation t, applied after the rotation. Eight
+// scalars instead of the twelve of affine<S> or the sixteen of mat<4,S>, and
+// weighted sums of unit dual quaternions renormalize to rigid transforms,
+// which makes them the representation of choice for skinning.
+
+//! DOCS
+template<typename S>
+class dual_quat {
+public:
+  static_assert(std::is_floating_point<S>::value,
+                "Scalar type must be floating point");
+
+  typedef S value_type;
+
+  //! Return identity transform.
+  static THX_CONST_EXPR dual_quat<S>
+  identity() {
+    return dual_quat<S>();
+  }
+
+public: // CTOR's.
+  //! Default CTOR, identity.
+  THX_CONST_EXPR
+  dual_quat()
+    : _real(S(1))
+    , _dual(S(0)) {
+  }
+
+  //! Real and dual part CTOR.
+  explicit THX_CONST_EXPR
+  dual_quat(quat<S> const& real, quat<S> const& dual)
+    : _real(real)
+    , _dual(dual) {
+  }
+
+  //! Rotation and translation CTOR, rotation must have unit length. The
+  //! rotation is applied first.
+  explicit THX_CONST_EXPR
+  dual_quat(quat<S> const& rotation, vec<3,S> const& translation)
+    : _real(rotation)
+    , _dual(S(0.5)*(quat<S>(S(0), translation)*rotation)) {
+  }
+
+public: // Operators.
+  //! Component-wise addition, used for blending.
+  THX_CONST_EXPR dual_quat<S>&
+  operator+=(dual_quat<S> const& rhs) {
+    _real += rhs._real;
+    _dual += rhs._dual;
+    return *this;
+  }
+
+  //! Scale both parts.
+  THX_CONST_EXPR dual_quat<S>&
+  operator*=(S const s) {
+    _real *= s;
+    _dual *= s;
+    return *this;
+  }
+
+  //! Compose, *this = *this*b, i.e. b is applied first.
+  THX_CONST_EXPR dual_quat<S>&
+  operator*=(dual_quat<S> const& b) {
+    const dual_quat<S> a(*this); // Copy.
+    _real = a._real*b._real;
+    _dual = a._real*b._dual + a._dual*b._real;
+    return *this;
+  }
+
+public: // Access.
+  //! Rotation part.
+  THX_CONST_EXPR quat<S> const&
+  real() const {
+    return _real;
+  }
+
+  //! Rotation part.
+  THX_CONST_EXPR quat<S>&
+  real() {
+    return _real;
+  }
+
+  //! Translation part.
+  THX_CONST_EXPR quat<S> const&
+  dual() const {
+    return _dual;
+  }
+
+  //! Translation part.
+  THX_CONST_EXPR quat<S>&
+  dual() {
+    return _dual;
+  }
+
+private: // Member variables.
+  quat<S> _real;
+  quat<S> _dual;
+};
+
+//------------------------------------------------------------------------------
+
+//! Compose, a*b, i.e. b is applied first.
+template<typename S> inline THX_CONST_EXPR
+dual_quat<S>
+mult(dual_quat<S> const& a, dual_quat<S> const& b) {
+  dual_quat<S> c(a);
+  c *= b;
+  return c;
+}
+
+//! Conjugate both parts, which is the inverse of a unit dual quaternion.
+template<typename S> inline THX_CONST_EXPR
+dual_quat<S>
+conjugated(dual_quat<S> const& q) {
+  return dual_quat<S>(conjugated(q.real()), conjugated(q.dual()));
+}
+
+//! Return a unit dual quaternion, i.e. the real part has unit length and is
+//! orthogonal to the dual part. No divide-by-zero checking!
+template<typename S> inline
+dual_quat<S>
+normalized(dual_quat<S> const& q) {
+  const S inv_mag = 1/scalar_traits<S>::sqrt(dot(q.real(), q.real()));
+  const quat<S> r = inv_mag*q.real();
+  const quat<S> d = inv_mag*q.dual();
+  return dual_quat<S>(r, d - dot(r, d)*r);
+}
+
+//! Normalize q, see normalized.
+template<typename S> inline
+void
+normalize(dual_quat<S>& q) {
+  q = normalized(q);
+}
+
+//! Translation of a unit dual quaternion, t = 2*d*conj(r).
+template<typename S> inline THX_CONST_EXPR
+vec<3,S>
+translation(dual_quat<S> const& q) {
+  const quat<S> t = S(2)*(q.dual()*conjugated(q.real()));
+  return vec<3,S>(t[1], t[2], t[3]);
+}
+
+//! Rotate v by a unit dual quaternion, the translation is ignored.
+template<typename S> inline THX_CONST_EXPR
+vec<3,S>
+transform_vector(dual_quat<S> const& q, vec<3,S> const& v) {
+  // v + w*t + u x t, where t = 2*(u x v) and r = (w, u).
+  const vec<3,S> u(q.real()[1], q.real()[2], q.real()[3]);
+  const vec<3,S> t = S(2)*cross(u, v);
+  return v + q.real()[0]*t + cross(u, t);
+}
+
+//! Transform point p by a unit dual quaternion.
+template<typename S> inline THX_CONST_EXPR
+vec<3,S>
+transform_point(dual_quat<S> const& q, vec<3,S> const& p) {
+  return transform_vector(q, p) + translation(q);
+}
+
+//! Binary operator: dual_quat<S> == dual_quat<S>
+template<typename S> inline THX_CONST_EXPR
+bool
+operator==(dual_quat<S> const& a, dual_quat<S> const& b) {
+  return a.real() == b.real() && a.dual() == b.dual();
+}
+
+//! Binary operator: dual_quat<S> != dual_quat<S>
+template<typename S> inline THX_CONST_EXPR
+bool
+operator!=(dual_quat<S> const& a, dual_quat<S> const& b) {
+  return !(a == b);
+}
+
+//! Binary operator: dual_quat<S> + dual_quat<S>
+template<typename S> inline THX_CONST_EXPR
+dual_quat<S>
+operator+(dual_quat<S> const& a, dual_quat<S> const& b) {
+  return dual_quat<S>(a.real() + b.real(), a.dual() + b.dual());
+}
+
+//! Binary operator: S * dual_quat<S>
+template<typename S> inline THX_CONST_EXPR
+dual_quat<S>
+operator*(S const s, dual_quat<S> const& q) {
+  return dual_quat<S>(s*q.real(), s*q.dual());
+}
+
+//! Binary operator: dual_quat<S> * dual_quat<S>
+template<typename S> inline THX_CONST_EXPR
+dual_quat<S>
+operator*(dual_quat<S> const& a, dual_quat<S> const& b) {
+  return mult(a, b);
+}
+
+//! Binary operator: dual_quat<S> * vec<3,S> (point)
+template<typename S> inline THX_CONST_EXPR
+vec<3,S>
+operator*(dual_quat<S> const& q, vec<3,S> const& p) {
+  return transform_point(q, p);
+}
+
+//------------------------------------------------------------------------------
+
+// Batched skinning.
+// -----------------
+//
+// skin(bones, index, weight, k, p, pout, n) deforms n points by dual
+// quaternion linear blending. Point i is influenced by the k bones
+// index[i*k .. i*k + k) with weights weight[i*k .. i*k + k). The weighted
+// bone transforms are summed, with the sign of each flipped if needed so
+// that all lie in the hemisphere of the first influence, then normalized and
+// applied. Weights need not sum to one, but must not all be zero. An overload
+// also rotates normals. Outputs may be the same ranges as the inputs.
+//
+// The range is split into chunks that are skinned on default_thread_pool().
+// Within a chunk, the blended transforms and the points are gathered into
+// structure-of-arrays blocks so that simd_traits<S>::packet_size points are
+// normalized and transformed at once, or as many as active_isa() allows with
+// run-time dispatch (see thx_cpu.hpp).
+
+namespace detail {
+
+//! Number of points per parallel task.
+static const std::size_t skin_grain = 4096;
+
+//! Number of points per structure-of-arrays block, a multiple of any
+//! packet_size.
+static const std::size_t skin_block = 64;
+
+//! Components per point in a block: blended real (4) and dual (4) parts,
+//! point (3) and normal (3).
+static const std::size_t skin_components = 14;
+
+//! Blend the transforms of n <= B points and gather them together with the
+//! points and normals (if any) into structure-of-arrays form, t[c*B + l] is
+//! component c of point l. Lanes past n are set to identity and zero.
+template<std::size_t B, typename S> inline
+void
+skin_gather(dual_quat<S> const* const bones,
+            uint32 const* const index,
+            S const* const weight,
+            std::size_t const k,
+            vec<3,S> const* const p,
+            vec<3,S> const* const nrm,
+            std::size_t const n,
+            S* const t) {
+  for (std::size_t l = 0; l < n; ++l) {
+    uint32 const* const il = index + l*k;
+    S const* const wl = weight + l*k;
+    quat<S> const& r0 = bones[il[0]].real();
+    dual_quat<S> b = wl[0]*bones[il[0]];
+    for (std::size_t j = 1; j < k; ++j) {
+      dual_quat<S> const& bj = bones[il[j]];
+      b += (dot(r0, bj.real()) < 0 ? -wl[j] : wl[j])*bj;
+    }
+    for (std::size_t c = 0; c < 4; ++c) {
+      t[c*B + l] = b.real()[c];
+      t[(c + 4)*B + l] = b.dual()[c];
+    }
+    for (std::size_t c = 0; c < 3; ++c) {
+      t[(c + 8)*B + l] = p[l][c];
+      t[(c + 11)*B + l] = (nrm != 0 ? nrm[l][c] : S(0));
+    }
+  }
+  for (std::size_t l = n; l < B; ++l) {
+    for (std::size_t c = 0; c < skin_components; ++c) {
+      t[c*B + l] = (c == 0 ? S(1) : S(0));
+    }
+  }
+}
+
+//! Scatter the first n points (and normals if nrm is not null) of t.
+template<std::size_t B, typename S> inline
+void
+skin_scatter(S const* const t,
+             std::size_t const n,
+             vec<3,S>* const p,
+             vec<3,S>* const nrm) {
+  for (std::size_t l = 0; l < n; ++l) {
+    for (std::size_t c = 0; c < 3; ++c) {
+      p[l][c] = t[(c + 8)*B + l];
+    }
+  }
+  if (nrm != 0) {
+    for (std::size_t l = 0; l < n; ++l) {
+      for (std::size_t c = 0; c < 3; ++c) {
+        nrm[l][c] = t[(c + 11)*B + l];
+      }
+    }
+  }
+}
+
+THX_GENERIC_KERNELS_BEGIN
+
+//! Store v + w*t + u x t to p, where t = 2*(u x v), i.e. v rotated by the
+//! unit quaternion (w, u), see transform_vector. Packets are passed by
+//! reference, see inverted_cofactor.
+template<std::size_t B, class Simd, typename S> inline
+void
+skin_rotate(S* const p,
+            typename Simd::packet_type const& w,
+            typename Simd::packet_type const& ux,
+            typename Simd::packet_type const& uy,
+            typename Simd::packet_type const& uz) {
+  typedef Simd simd;
+  typedef typename simd::packet_type packet_type;
+
+  const packet_type two = simd::set1(S(2));
+  const packet_type vx = simd::loadu(p + 0*B);
+  const packet_type vy = simd::loadu(p + 1*B);
+  const packet_type vz = simd::loadu(p + 2*B);
+  const packet_type tx =
+    simd::mul(two, simd::sub(simd::mul(uy, vz), simd::mul(uz, vy)));
+  const packet_type ty =
+    simd::mul(two, simd::sub(simd::mul(uz, vx), simd::mul(ux, vz)));
+  const packet_type tz =
+    simd::mul(two, simd::sub(simd::mul(ux, vy), simd::mul(uy, vx)));
+  simd::storeu(p + 0*B, simd::add(simd::add(vx, simd::mul(w, tx)),
+    simd::sub(simd::mul(uy, tz), simd::mul(uz, ty))));
+  simd::storeu(p + 1*B, simd::add(simd::add(vy, simd::mul(w, ty)),
+    simd::sub(simd::mul(uz, tx), simd::mul(ux, tz))));
+  simd::storeu(p + 2*B, simd::add(simd::add(vz, simd::mul(w, tz)),
+    simd::sub(simd::mul(ux, ty), simd::mul(uy, tx))));
+}
+
+//! Normalize Simd::packet_size blended transforms in structure-of-arrays
+//! form and apply them to the points and normals in place. Both parts are
+//! divided by the magnitude of the real part. Unlike normalized, the
+//! component of the dual part along the real part is not removed, since it
+//! does not contribute to the translation.
+template<std::size_t B, typename S, class Simd = simd_traits<S>>
+void
+skin_packet(S* const t) {
+  typedef Simd simd;
+  typedef typename simd::packet_type packet_type;
+
+  const packet_type rw0 = simd::loadu(t + 0*B);
+  const packet_type rx0 = simd::loadu(t + 1*B);
+  const packet_type ry0 = simd::loadu(t + 2*B);
+  const packet_type rz0 = simd::loadu(t + 3*B);
+  const packet_type inv_mag = simd::div(simd::set1(S(1)), simd::sqrt(
+    simd::add(simd::add(simd::mul(rw0, rw0), simd::mul(rx0, rx0)),
+              simd::add(simd::mul(ry0, ry0), simd::mul(rz0, rz0)))));
+  const packet_type rw = simd::mul(rw0, inv_mag);
+  const packet_type rx = simd::mul(rx0, inv_mag);
+  const packet_type ry = simd::mul(ry0, inv_mag);
+  const packet_type rz = simd::mul(rz0, inv_mag);
+  const packet_type dw = simd::mul(simd::loadu(t + 4*B), inv_mag);
+  const packet_type dx = simd::mul(simd::loadu(t + 5*B), inv_mag);
+  const packet_type dy = simd::mul(simd::loadu(t + 6*B), inv_mag);
+  const packet_type dz = simd::mul(simd::loadu(t + 7*B), inv_mag);
+
+  skin_rotate<B,simd>(t + 8*B, rw, rx, ry, rz);
+  skin_rotate<B,simd>(t + 11*B, rw, rx, ry, rz);
+
+  // Translation 2*(w*d - dw*u + u x d), where r = (w, u) and d = (dw, d).
+  const packet_type two = simd::set1(S(2));
+  const packet_type tx = simd::mul(two, simd::add(
+    simd::sub(simd::mul(rw, dx), simd::mul(dw, rx)),
+    simd::sub(simd::mul(ry, dz), simd::mul(rz, dy))));
+  const packet_type ty = simd::mul(two, simd::add(
+    simd::sub(simd::mul(rw, dy), simd::mul(dw, ry)),
+    simd::sub(simd::mul(rz, dx), simd::mul(rx, dz))));
+  const packet_type tz = simd::mul(two, simd::add(
+    simd::sub(simd::mul(rw, dz), simd::mul(dw, rz)),
+    simd::sub(simd::mul(rx, dy), simd::mul(ry, dx))));
+  simd::storeu(t + 8*B, simd::add(simd::loadu(t + 8*B), tx));
+  simd::storeu(t + 9*B, simd::add(simd::loadu(t + 9*B), ty));
+  simd::storeu(t + 10*B, simd::add(simd::loadu(t + 10*B), tz));
+}
+
+THX_GENERIC_KERNELS_END
+
+//! Skin n points on the calling thread, one block at a time. kernel
+//! transforms P points of a block in place.
+template<std::size_t P, typename S>
+void
+skin_blocks(dual_quat<S> const* const bones,
+            uint32 const* const index,
+            S const* const weight,
+            std::size_t const k,
+            vec<3,S> const* const p,
+            vec<3,S>* const pout,
+            vec<3,S> const* const nrm,
+            vec<3,S>* const nout,
+            std::size_t const n,
+            void (*kernel)(S*)) {
+  static const std::size_t B = skin_block;
+
+  S t[skin_components*B];
+  for (std::size_t i = 0; i < n; i += B) {
+    const std::size_t m = (std::min)(B, n - i);
+    skin_gather<B>(bones, index + i*k, weight + i*k, k,
+                   p + i, (nrm != 0 ? nrm + i : 0), m, t);
+    for (std::size_t j = 0; j < m; j += P) {
+      kernel(t + j);
+    }
+    skin_scatter<B>(t, m, pout + i, (nout != 0 ? nout + i : 0));
+  }
+}
+
+//! Skin n points on the calling thread.
+template<typename S>
+void
+skin_range(dual_quat<S> const* const bones,
+           uint32 const* const index,
+           S const* const weight,
+           std::size_t const k,
+           vec<3,S> const* const p,
+           vec<3,S>* const pout,
+           vec<3,S> const* const nrm,
+           vec<3,S>* const nout,
+           std::size_t const n) {
+  skin_blocks<simd_traits<S>::packet_size>(
+    bones, index, weight, k, p, pout, nrm, nout, n, &skin_packet<skin_block,S>);
+}
+
+#if defined(THX_DISPATCH)
+
+template<std::size_t B, typename S> THX_TARGET_AVX THX_FLATTEN
+void
+skin_avx(S* const t) {
+  skin_packet<B, S, avx_traits<S>>(t);
+}
+
+template<std::size_t B, typename S> THX_TARGET_AVX512 THX_FLATTEN
+void
+skin_avx512(S* const t) {
+  skin_packet<B, S, avx512_traits<S>>(t);
+}
+
+//! Skin n points on the calling thread, dispatched on active_isa().
+template<typename S>
+void
+skin_dispatch(dual_quat<S> const* const bones,
+              uint32 const* const index,
+              S const* const weight,
+              std::size_t const k,
+              vec<3,S> const* const p,
+              vec<3,S>* const pout,
+              vec<3,S> const* const nrm,
+              vec<3,S>* const nout,
+              std::size_t const n) {
+  const isa t = active_isa();
+  if (t >= isa_avx512) {
+    skin_blocks<avx512_traits<S>::packet_size>(
+      bones, index, weight, k, p, pout, nrm, nout, n,
+      &skin_avx512<skin_block,S>);
+  }
+  else if (t >= isa_avx) {
+    skin_blocks<avx_traits<S>::packet_size>(
+      bones, index, weight, k, p, pout, nrm, nout, n,
+      &skin_avx<skin_block,S>);
+  }
+  else {
+    skin_range<S>(bones, index, weight, k, p, pout, nrm, nout, n);
+  }
+}
+
+inline
+void
+skin_range(dual_quat<float32> const* const bones,
+           uint32 const* const index,
+           float32 const* const weight,
+           std::size_t const k,
+           vec<3,float32> const* const p,
+           vec<3,float32>* const pout,
+           vec<3,float32> const* const nrm,
+           vec<3,float32>* const nout,
+           std::size_t const n) {
+  skin_dispatch(bones, index, weight, k, p, pout, nrm, nout, n);
+}
+
+inline
+void
+skin_range(dual_quat<float64> const* const bones,
+           uint32 const* const index,
+           float64 const* const weight,
+           std::size_t const k,
+           vec<3,float64> const* const p,
+           vec<3,float64>* const pout,
+           vec<3,float64> const* const nrm,
+           vec<3,float64>* const nout,
+           std::size_t const n) {
+  skin_dispatch(bones, index, weight, k, p, pout, nrm, nout, n);
+}
+
+#endif // THX_DISPATCH
+
+//! Run skin_range on sub-ranges in parallel.
+template<typename S>
+void
+skin_parallel(dual_quat<S> const* const bones,
+              uint32 const* const index,
+              S const* const weight,
+              std::size_t const k,
+              vec<3,S> const* const p,
+              vec<3,S>* const pout,
+              vec<3,S> const* const nrm,
+              vec<3,S>* const nout,
+              std::size_t const n) {
+  parallel_for(0, n, skin_grain,
+    [&](std::size_t const i0, std::size_t const i1) {
+      skin_range(bones, index + i0*k, weight + i0*k, k,
+                 p + i0, pout + i0,
+                 (nrm != 0 ? nrm + i0 : 0), (nout != 0 ? nout + i0 : 0),
+                 i1 - i0);
+    });
+}
+
+} // Namespace: detail.
+
+//! Batched skinning of points. See above.
+template<typename S>
+void
+skin(dual_quat<S> const* const bones,
+     uint32 const* const index,
+     S const* const weight,
+     std::size_t const k,
+     vec<3,S> const* const p,
+     vec<3,S>* const pout,
+     std::size_t const n) {
+  detail::skin_parallel<S>(bones, index, weight, k, p, pout, 0, 0, n);
+}
+
+//! Batched skinning of points and normals. See above.
+template<typename S>
+void
+skin(dual_quat<S> const* const bones,
+     uint32 const* const index,
+     S const* const weight,
+     std::size_t const k,
+     vec<3,S> const* const p,
+     vec<3,S>* const pout,
+     vec<3,S> const* const nrm,
+     vec<3,S>* const nout,
+     std::size_t const n) {
+  detail::skin_parallel<S>(bones, index, weight, k, p, pout, nrm, nout, n);
+}
+
+//------------------------------------------------------------------------------
+
+// Convenient types, add more if appropriate.
+
+typedef dual_quat<float32>  dual_quatf32;
+typedef dual_quat<float64>  dual_quatf64;
+
+END_THX_NAMESPACE
+
+#endif // THX_DUAL_QUAT_HPP_INCLUDED
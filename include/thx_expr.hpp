@@ -0,0 +1,319 @@
+//------------------------------------------------------------------------------
+//
+// Contributors:
+//             1) Tommy Hinks
+//
+//------------------------------------------------------------------------------
+
+#ifndef THX_EXPR_HPP_INCLUDED
+#define THX_EXPR_HPP_INCLUDED
+
+#include "thx_namespace.hpp"
+#include "thx_vec.hpp"
+#include "thx_mat.hpp"
+#include <cstddef>
+#include <type_traits>
+
+//------------------------------------------------------------------------------
+
+// Opt-in expression templates for element-wise vec/mat arithmetic.
+// ----------------------------------------------------------------
+//
+// The operators in thx_operators.hpp return vec/mat by value, so an
+// expression such as a*x + b*y - c creates a temporary per operator. Wrapping
+// operands with lazy() instead builds an expression tree that is evaluated in
+// a single fused loop when it is converted to its value type:
+//
+//   vec<16,float32> r = a*lazy(x) + b*lazy(y) - lazy(c);
+//   assign(r, lazy(r) + lazy(d)); // Writes into r directly, no temporary.
+//
+// Supported operators are unary -, +, - and scalar multiplication. Expressions
+// can be mixed with plain value types as long as at least one operand of each
+// operator is an expression. Only element-wise operations are lazy, mat<N,S>
+// products are not.
+//
+// For small vectors (N <= 4) the optimizer usually removes the temporaries of
+// the eager operators already, see bench/ before using lazy() there.
+//
+// Leaves hold references to their operands. Do not store expressions beyond
+// the full-expression they were created in (e.g. with auto).
+//
+// Evaluation of element i only reads element i of the operands, so the
+// destination of assign() may also appear in the expression.
+
+BEGIN_THX_NAMESPACE
+
+//! CRTP base for all expressions. E must define result_type, value_type and
+//! value_type operator[](std::size_t) const.
+template<class E>
+class expr {
+public:
+  //! The derived expression.
+  E const&
+  self() const {
+    return static_cast<E const&>(*this);
+  }
+};
+
+//------------------------------------------------------------------------------
+
+//! Leaf, references a vec or mat.
+template<class T>
+class expr_leaf : public expr<expr_leaf<T>> {
+public:
+  typedef T result_type;
+  typedef typename T::value_type value_type;
+
+  explicit
+  expr_leaf(T const& t)
+    : _t(t) {
+  }
+
+  value_type
+  operator[](std::size_t const i) const {
+    return _t[i];
+  }
+
+  //! Evaluate.
+  operator result_type() const {
+    return _t;
+  }
+
+private:
+  T const& _t;
+};
+
+//------------------------------------------------------------------------------
+
+namespace detail {
+
+//! Evaluate expression e into r, a single fused loop.
+template<class E> inline
+void
+expr_eval(typename E::result_type& r, E const& e) {
+  for (std::size_t i = 0; i < E::result_type::linear_size; ++i) {
+    r[i] = e[i];
+  }
+}
+
+struct expr_plus {
+  template<typename S> static
+  S
+  apply(S const a, S const b) {
+    return a + b;
+  }
+};
+
+struct expr_minus {
+  template<typename S> static
+  S
+  apply(S const a, S const b) {
+    return a - b;
+  }
+};
+
+} // Namespace: detail.
+
+//------------------------------------------------------------------------------
+
+//! Element-wise binary operation.
+template<class A, class B, class Op>
+class expr_binary : public expr<expr_binary<A,B,Op>> {
+public:
+  typedef typename A::result_type result_type;
+  typedef typename A::value_type value_type;
+
+  static_assert(std::is_same<result_type, typename B::result_type>::value,
+                "Operands must have the same type");
+
+  expr_binary(A const& a, B const& b)
+    : _a(a)
+    , _b(b) {
+  }
+
+  value_type
+  operator[](std::size_t const i) const {
+    return Op::apply(_a[i], _b[i]);
+  }
+
+  //! Evaluate.
+  operator result_type() const {
+    result_type r;
+    detail::expr_eval(r, *this);
+    return r;
+  }
+
+private:
+  A const _a;
+  B const _b;
+};
+
+//------------------------------------------------------------------------------
+
+//! Scalar multiplication.
+template<class A>
+class expr_scale : public expr<expr_scale<A>> {
+public:
+  typedef typename A::result_type result_type;
+  typedef typename A::value_type value_type;
+
+  expr_scale(value_type const s, A const& a)
+    : _s(s)
+    , _a(a) {
+  }
+
+  value_type
+  operator[](std::size_t const i) const {
+    return _s*_a[i];
+  }
+
+  //! Evaluate.
+  operator result_type() const {
+    result_type r;
+    detail::expr_eval(r, *this);
+    return r;
+  }
+
+private:
+  value_type const _s;
+  A const _a;
+};
+
+//------------------------------------------------------------------------------
+
+//! Negation.
+template<class A>
+class expr_negate : public expr<expr_negate<A>> {
+public:
+  typedef typename A::result_type result_type;
+  typedef typename A::value_type value_type;
+
+  explicit
+  expr_negate(A const& a)
+    : _a(a) {
+  }
+
+  value_type
+  operator[](std::size_t const i) const {
+    return -_a[i];
+  }
+
+  //! Evaluate.
+  operator result_type() const {
+    result_type r;
+    detail::expr_eval(r, *this);
+    return r;
+  }
+
+private:
+  A const _a;
+};
+
+//------------------------------------------------------------------------------
+
+//! Start a lazy expression from a vector.
+template<std::size_t N, typename S> inline
+expr_leaf<vec<N,S>>
+lazy(vec<N,S> const& v) {
+  return expr_leaf<vec<N,S>>(v);
+}
+
+//! Start a lazy expression from a matrix.
+template<std::size_t N, typename S> inline
+expr_leaf<mat<N,S>>
+lazy(mat<N,S> const& a) {
+  return expr_leaf<mat<N,S>>(a);
+}
+
+//! Evaluate expression e into r without creating a temporary.
+template<class E> inline
+void
+assign(typename E::result_type& r, expr<E> const& e) {
+  detail::expr_eval(r, e.self());
+}
+
+//! Evaluate expression e.
+template<class E> inline
+typename E::result_type
+eval(expr<E> const& e) {
+  return e.self();
+}
+
+//------------------------------------------------------------------------------
+
+//! Unary operator: -expr
+template<class A> inline
+expr_negate<A>
+operator-(expr<A> const& a) {
+  return expr_negate<A>(a.self());
+}
+
+//------------------------------------------------------------------------------
+
+//! Binary operator: expr + expr
+template<class A, class B> inline
+expr_binary<A, B, detail::expr_plus>
+operator+(expr<A> const& a, expr<B> const& b) {
+  return expr_binary<A, B, detail::expr_plus>(a.self(), b.self());
+}
+
+//! Binary operator: expr + value
+template<class A> inline
+expr_binary<A, expr_leaf<typename A::result_type>, detail::expr_plus>
+operator+(expr<A> const& a, typename A::result_type const& b) {
+  typedef expr_leaf<typename A::result_type> leaf;
+  return expr_binary<A, leaf, detail::expr_plus>(a.self(), leaf(b));
+}
+
+//! Binary operator: value + expr
+template<class B> inline
+expr_binary<expr_leaf<typename B::result_type>, B, detail::expr_plus>
+operator+(typename B::result_type const& a, expr<B> const& b) {
+  typedef expr_leaf<typename B::result_type> leaf;
+  return expr_binary<leaf, B, detail::expr_plus>(leaf(a), b.self());
+}
+
+//------------------------------------------------------------------------------
+
+//! Binary operator: expr - expr
+template<class A, class B> inline
+expr_binary<A, B, detail::expr_minus>
+operator-(expr<A> const& a, expr<B> const& b) {
+  return expr_binary<A, B, detail::expr_minus>(a.self(), b.self());
+}
+
+//! Binary operator: expr - value
+template<class A> inline
+expr_binary<A, expr_leaf<typename A::result_type>, detail::expr_minus>
+operator-(expr<A> const& a, typename A::result_type const& b) {
+  typedef expr_leaf<typename A::result_type> leaf;
+  return expr_binary<A, leaf, detail::expr_minus>(a.self(), leaf(b));
+}
+
+//! Binary operator: value - expr
+template<class B> inline
+expr_binary<expr_leaf<typename B::result_type>, B, detail::expr_minus>
+operator-(typename B::result_type const& a, expr<B> const& b) {
+  typedef expr_leaf<typename B::result_type> leaf;
+  return expr_binary<leaf, B, detail::expr_minus>(leaf(a), b.self());
+}
+
+//------------------------------------------------------------------------------
+
+//! Binary operator: scalar * expr
+template<class A> inline
+expr_scale<A>
+operator*(typename A::value_type const s, expr<A> const& a) {
+  return expr_scale<A>(s, a.self());
+}
+
+//! Binary operator: expr * scalar
+template<class A> inline
+expr_scale<A>
+operator*(expr<A> const& a, typename A::value_type const s) {
+  return expr_scale<A>(s, a.self());
+}
+
+END_THX_NAMESPACE
+
+#endif // THX_EXPR_HPP_INCLUDED
@@ -0,0 +1,459 @@
+//------------------------------------------------------------------------------
+//
+// Contributors:
+//             1) Tommy Hinks
+//
+//------------------------------------------------------------------------------
+
+#ifndef THX_FLOAT16_HPP_INCLUDED
+#define THX_FLOAT16_HPP_INCLUDED
+
+#include "thx_namespace.hpp"
+#include "thx_types.hpp"
+#include "thx_arithmetic_type.hpp"
+#include "thx_scalar_traits.hpp"
+#include "thx_vec.hpp"
+#include "thx_cpu.hpp"
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#if defined(__F16C__)
+#  include <immintrin.h>
+#endif
+
+//------------------------------------------------------------------------------
+
+BEGIN_THX_NAMESPACE
+
+// float16 anatomy:
+// ----------------
+//
+// float16()                  (zero)
+// float16(T)                 (any arithmetic T, nearest float16)
+// operator float32() const
+//
+// operator+=(float16)
+// operator-=(float16)
+// operator*=(float16)
+// operator/=(float16)
+//
+// uint16 bits() const
+// static float16 from_bits(uint16)
+//
+// IEEE 754 binary16 storage type, 1 sign, 5 exponent and 10 mantissa bits,
+// for data that is stored or uploaded in half precision. There is no half
+// precision arithmetic: a float16 converts implicitly to float32, every
+// operation is evaluated in float32 and the result is rounded to nearest
+// even when stored back to a float16. float64 values are rounded to float32
+// first. arithmetic_type<float16>::compute is float32 and
+// scalar_traits<float16> evaluates in float32, so float16 can be used as S in
+// vec, mat and quat.
+//
+// Batched conversion.
+// -------------------
+//
+// convert(in, out, n) converts n float16 to float32 or n float32 to float16,
+// or n vec<N,float16> to vec<N,float32> and vice versa. Uses F16C if the CPU
+// supports it and active_isa() is at least isa_avx (see thx_cpu.hpp), 8
+// values at a time, with identical results.
+
+namespace detail {
+
+//! Nearest float16 bits to x, ties to even. Overflow gives infinity, NaN
+//! keeps the upper payload bits and is made quiet, like F16C.
+inline
+uint16
+float16_encode_soft(float32 const x) {
+  uint32 u;
+  std::memcpy(&u, &x, sizeof(u));
+  const uint32 sign = u & 0x80000000u;
+  u ^= sign;
+  uint32 h;
+  if (u >= 0x47800000u) {
+    // 2^16 and above, infinity or NaN.
+    h = u > 0x7f800000u ? 0x7e00u | ((u >> 13) & 0x3ffu) : 0x7c00u;
+  }
+  else if (u < 0x38800000u) {
+    // Below 2^-14, subnormal or zero. Adding 0.5 lines the float16 mantissa
+    // up with the low float32 mantissa bits and rounds it.
+    float32 f;
+    std::memcpy(&f, &u, sizeof(f));
+    f += 0.5f;
+    std::memcpy(&h, &f, sizeof(h));
+    h -= 0x3f000000u;
+  }
+  else {
+    // Rebias the exponent and round the 13 dropped bits to even.
+    h = (u + 0xc8000fffu + ((u >> 13) & 1u)) >> 13;
+  }
+  return static_cast<uint16>(h | (sign >> 16));
+}
+
+//! float32 value of float16 bits h, exact. NaN is made quiet, like F16C.
+inline
+float32
+float16_decode_soft(uint16 const h) {
+  uint32 u = static_cast<uint32>(h & 0x7fffu) << 13;
+  const uint32 e = u & 0x0f800000u;
+  u += 0x38000000u;                 // Rebias the exponent.
+  float32 f;
+  if (e == 0x0f800000u) {
+    u += 0x38000000u;               // Infinity or NaN.
+    u |= (u & 0x007fffffu) != 0 ? 0x00400000u : 0u;
+    std::memcpy(&f, &u, sizeof(f));
+  }
+  else if (e == 0) {
+    // Zero or subnormal, renormalized by subtracting 2^-14.
+    u += 0x00800000u;
+    std::memcpy(&f, &u, sizeof(f));
+    f -= 6.103515625e-05f;
+  }
+  else {
+    std::memcpy(&f, &u, sizeof(f));
+  }
+  return (h & 0x8000u) != 0 ? -f : f;
+}
+
+inline
+uint16
+float16_encode(float32 const x) {
+#if defined(__F16C__)
+  return static_cast<uint16>(_cvtss_sh(x, _MM_FROUND_TO_NEAREST_INT));
+#else
+  return float16_encode_soft(x);
+#endif
+}
+
+inline
+float32
+float16_decode(uint16 const h) {
+#if defined(__F16C__)
+  return _cvtsh_ss(h);
+#else
+  return float16_decode_soft(h);
+#endif
+}
+
+} // Namespace: detail.
+
+//------------------------------------------------------------------------------
+
+//! DOCS
+class float16 {
+public: // CTOR's.
+  //! Zero.
+  THX_CONST_EXPR
+  float16()
+    : _bits(0) {
+  }
+
+  //! Nearest float16 to x. Implicit, like conversions between the built-in
+  //! floating point types.
+  template<typename T>
+  float16(T const x,
+          typename std::enable_if<std::is_arithmetic<T>::value>::type* = 0)
+    : _bits(detail::float16_encode(static_cast<float32>(x))) {
+  }
+
+public: // Operators.
+  //! Exact.
+  operator float32() const {
+    return detail::float16_decode(_bits);
+  }
+
+  float16&
+  operator+=(float16 const x) {
+    return *this = float16(float32(*this) + float32(x));
+  }
+
+  float16&
+  operator-=(float16 const x) {
+    return *this = float16(float32(*this) - float32(x));
+  }
+
+  float16&
+  operator*=(float16 const x) {
+    return *this = float16(float32(*this)*float32(x));
+  }
+
+  float16&
+  operator/=(float16 const x) {
+    return *this = float16(float32(*this)/float32(x));
+  }
+
+public: // Bits.
+  THX_CONST_EXPR uint16
+  bits() const {
+    return _bits;
+  }
+
+  static THX_CONST_EXPR float16
+  from_bits(uint16 const h) {
+    return float16(h, 0);
+  }
+
+private:
+  THX_CONST_EXPR
+  float16(uint16 const h, int)
+    : _bits(h) {
+  }
+
+private: // Member variables.
+  uint16 _bits; //!< IEEE 754 binary16.
+};
+
+//------------------------------------------------------------------------------
+
+//! Stored as float16, evaluated in float32.
+template<>
+struct arithmetic_type<float16> {
+public:
+  typedef float16 value;
+  typedef float32 compute;
+};
+
+//------------------------------------------------------------------------------
+
+//! Traits for float16 scalar type, evaluated in float32 and rounded.
+template<>
+class scalar_traits<float16> : private detail::nonconstructible
+{
+public:
+  typedef real_scalar_tag scalar_category;
+  typedef scalar_traits<float32> traits;
+
+  static float16
+  pi()
+  { return float16(traits::pi()); }
+
+  //! Square root of the largest float16 over 8, see float32 version.
+  static float16
+  big_value()
+  { return float16(traits::sqrt(65504.f)/8); }
+
+  static float16
+  abs(const float16 x)
+  { return float16::from_bits(static_cast<uint16>(x.bits() & 0x7fffu)); }
+
+  static float16
+  exp(const float16 x)
+  { return float16(traits::exp(x)); }
+
+  static float16
+  log(const float16 x)
+  { return float16(traits::log(x)); }
+
+  static float16
+  sin(const float16 x)
+  { return float16(traits::sin(x)); }
+
+  static float16
+  cos(const float16 x)
+  { return float16(traits::cos(x)); }
+
+  static void
+  sincos(const float16 x, float16& s, float16& c)
+  {
+    float32 s32, c32;
+    traits::sincos(x, s32, c32);
+    s = float16(s32);
+    c = float16(c32);
+  }
+
+  static float16
+  tan(const float16 x)
+  { return float16(traits::tan(x)); }
+
+  static float16
+  asin(const float16 x)
+  { return float16(traits::asin(x)); }
+
+  static float16
+  acos(const float16 x)
+  { return float16(traits::acos(x)); }
+
+  static float16
+  atan(const float16 x)
+  { return float16(traits::atan(x)); }
+
+  static float16
+  atan2(const float16 y, const float16 x)
+  { return float16(traits::atan2(y, x)); }
+
+  static float16
+  sqrt(const float16 x)
+  { return float16(traits::sqrt(x)); }
+};
+
+//------------------------------------------------------------------------------
+
+namespace detail {
+
+inline
+void
+float16_decode_range(uint16 const* const in,
+                     float32* const out,
+                     std::size_t const n) {
+  for (std::size_t i = 0; i < n; ++i) {
+    out[i] = float16_decode(in[i]);
+  }
+}
+
+inline
+void
+float16_encode_range(float32 const* const in,
+                     uint16* const out,
+                     std::size_t const n) {
+  for (std::size_t i = 0; i < n; ++i) {
+    out[i] = float16_encode(in[i]);
+  }
+}
+
+#if defined(THX_DISPATCH) || defined(__F16C__)
+
+inline THX_TARGET_F16C
+void
+float16_decode_f16c(uint16 const* const in,
+                    float32* const out,
+                    std::size_t const n) {
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m128i h = _mm_loadu_si128(reinterpret_cast<__m128i const*>(in + i));
+    _mm256_storeu_ps(out + i, _mm256_cvtph_ps(h));
+  }
+  for (; i < n; ++i) {
+    out[i] = _cvtsh_ss(in[i]);
+  }
+}
+
+inline THX_TARGET_F16C
+void
+float16_encode_f16c(float32 const* const in,
+                    uint16* const out,
+                    std::size_t const n) {
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m128i h =
+      _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), h);
+  }
+  for (; i < n; ++i) {
+    out[i] = static_cast<uint16>(
+      _cvtss_sh(in[i], _MM_FROUND_TO_NEAREST_INT));
+  }
+}
+
+#endif
+
+//! True if the F16C kernels are used.
+inline
+bool
+float16_use_f16c() {
+#if defined(THX_DISPATCH)
+  return cpu().f16c && active_isa() >= isa_avx;
+#elif defined(__F16C__)
+  return true;
+#else
+  return false;
+#endif
+}
+
+} // Namespace: detail.
+
+//! Convert n float16 to float32. See above.
+inline
+void
+convert(float16 const* const in, float32* const out, std::size_t const n) {
+  uint16 const* const h = reinterpret_cast<uint16 const*>(in);
+#if defined(THX_DISPATCH) || defined(__F16C__)
+  if (detail::float16_use_f16c()) {
+    detail::float16_decode_f16c(h, out, n);
+    return;
+  }
+#endif
+  detail::float16_decode_range(h, out, n);
+}
+
+//! Convert n float32 to float16, rounding to nearest even. See above.
+inline
+void
+convert(float32 const* const in, float16* const out, std::size_t const n) {
+  uint16* const h = reinterpret_cast<uint16*>(out);
+#if defined(THX_DISPATCH) || defined(__F16C__)
+  if (detail::float16_use_f16c()) {
+    detail::float16_encode_f16c(in, h, n);
+    return;
+  }
+#endif
+  detail::float16_encode_range(in, h, n);
+}
+
+//! Convert n vec<N,float16> to vec<N,float32>. Relies on vec<N,S> arrays
+//! being tightly packed.
+template<std::size_t N>
+void
+convert(vec<N,float16> const* const in,
+        vec<N,float32>* const out,
+        std::size_t const n) {
+  convert(reinterpret_cast<float16 const*>(in),
+          reinterpret_cast<float32*>(out), N*n);
+}
+
+//! Convert n vec<N,float32> to vec<N,float16>, see above.
+template<std::size_t N>
+void
+convert(vec<N,float32> const* const in,
+        vec<N,float16>* const out,
+        std::size_t const n) {
+  convert(reinterpret_cast<float32 const*>(in),
+          reinterpret_cast<float16*>(out), N*n);
+}
+
+END_THX_NAMESPACE
+
+//------------------------------------------------------------------------------
+
+namespace std {
+
+//! Limits of float16, as for the built-in floating point types.
+template<>
+class numeric_limits<thx::float16> {
+public:
+  static const bool is_specialized = true;
+  static const bool is_signed = true;
+  static const bool is_integer = false;
+  static const bool is_exact = false;
+  static const bool has_infinity = true;
+  static const bool has_quiet_NaN = true;
+  static const bool has_signaling_NaN = true;
+  static const float_denorm_style has_denorm = denorm_present;
+  static const bool has_denorm_loss = false;
+  static const float_round_style round_style = round_to_nearest;
+  static const bool is_iec559 = true;
+  static const bool is_bounded = true;
+  static const bool is_modulo = false;
+  static const int digits = 11;
+  static const int digits10 = 3;
+  static const int max_digits10 = 5;
+  static const int radix = 2;
+  static const int min_exponent = -13;
+  static const int min_exponent10 = -4;
+  static const int max_exponent = 16;
+  static const int max_exponent10 = 4;
+
+  static thx::float16 min() { return thx::float16::from_bits(0x0400); }
+  static thx::float16 max() { return thx::float16::from_bits(0x7bff); }
+  static thx::float16 lowest() { return thx::float16::from_bits(0xfbff); }
+  static thx::float16 epsilon() { return thx::float16::from_bits(0x1400); }
+  static thx::float16 round_error() { return thx::float16::from_bits(0x3800); }
+  static thx::float16 infinity() { return thx::float16::from_bits(0x7c00); }
+  static thx::float16 quiet_NaN() { return thx::float16::from_bits(0x7e00); }
+  static thx::float16 signaling_NaN() { return thx::float16::from_bits(0x7d00); }
+  static thx::float16 denorm_min() { return thx::float16::from_bits(0x0001); }
+};
+
+} // Namespace: std.
+
+#endif // THX_FLOAT16_HPP_INCLUDED
@@ -0,0 +1,516 @@
+//------------------------------------------------------------------------------
+//
+// Contributors:
+//             1) Tommy Hinks
+//
+//------------------------------------------------------------------------------
+
+#ifndef THX_HASHING_HPP_INCLUDED
+#define THX_HASHING_HPP_INCLUDED
+
+#include "thx_namespace.hpp"
+#include "thx_define.hpp"
+#include "thx_types.hpp"
+#include <cstddef>
+#include <cstring>
+
+//------------------------------------------------------------------------------
+
+BEGIN_THX_NAMESPACE
+
+// Hashing.
+// --------
+//
+// S murmur<S>(key, len, seed)
+// S murmur_inverse<S>(h, seed)
+// S murmur3<S>(key, len, seed)
+// murmur3_hasher<S>
+//
+// Austin Appleby's MurmurHash functions for S = uint32 and uint64.
+//
+// murmur is MurmurHash2 for uint32 and MurmurHash64A for uint64.
+// murmur_inverse returns the 4 or 8-byte key whose murmur hash is h. That
+// makes murmur a bijection on keys of that size, which is useful for
+// scrambling integer ids without collisions.
+//
+// murmur3 is MurmurHash3_x86_32 for uint32 and the first half of
+// MurmurHash3_x64_128 for uint64. The reference x64 version takes a 32-bit
+// seed and matches for seeds below 2^32. murmur3_hasher computes the same
+// hash incrementally, for data that arrives in chunks.
+//
+// Keys are read as little-endian words on all targets. Hashes therefore do
+// not depend on the byte order of the host and may be stored. On little-endian
+// targets they match the reference implementations. Words are read with
+// memcpy, so keys need no particular alignment.
+
+namespace detail {
+
+inline
+uint32
+rotl32(uint32 const x, int const r) {
+  return (x << r) | (x >> (32 - r));
+}
+
+inline
+uint64
+rotl64(uint64 const x, int const r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+inline
+uint32
+byte_swap32(uint32 const x) {
+  return (x >> 24) | ((x >> 8) & 0xff00) | ((x << 8) & 0xff0000) | (x << 24);
+}
+
+inline
+uint64
+byte_swap64(uint64 const x) {
+  return (uint64(byte_swap32(static_cast<uint32>(x))) << 32) |
+         byte_swap32(static_cast<uint32>(x >> 32));
+}
+
+//! Little-endian loads assembled byte by byte, for any host byte order.
+struct le_bytes_load {
+  static
+  uint32
+  load32(uint8 const* const p) {
+    return uint32(p[0]) | (uint32(p[1]) << 8) |
+           (uint32(p[2]) << 16) | (uint32(p[3]) << 24);
+  }
+
+  static
+  uint64
+  load64(uint8 const* const p) {
+    return uint64(load32(p)) | (uint64(load32(p + 4)) << 32);
+  }
+};
+
+//! Little-endian loads on a little-endian host.
+struct le_native_load {
+  static
+  uint32
+  load32(uint8 const* const p) {
+    uint32 k;
+    std::memcpy(&k, p, sizeof(k));
+    return k;
+  }
+
+  static
+  uint64
+  load64(uint8 const* const p) {
+    uint64 k;
+    std::memcpy(&k, p, sizeof(k));
+    return k;
+  }
+};
+
+#if defined(THX_BIG_ENDIAN)
+typedef le_bytes_load host_load;
+#else
+typedef le_native_load host_load;
+#endif
+
+//! Little-endian value of the n < 8 bytes at p.
+inline
+uint64
+load_tail(uint8 const* const p, std::size_t const n) {
+  uint64 k = 0;
+  for (std::size_t i = n; i > 0; --i) {
+    k = (k << 8) | p[i - 1];
+  }
+  return k;
+}
+
+//! Invert x ^= x >> s, s > 0.
+template<typename U> inline
+U
+invert_shift_xor(U const x, int const s) {
+  U y = x;
+  for (int t = s; t < static_cast<int>(8*sizeof(U)); t += s) {
+    y ^= x >> t;
+  }
+  return y;
+}
+
+//! MurmurHash2, reading words with Load.
+template<class Load>
+uint32
+murmur2_32(void const* const key, std::size_t len, uint32 const seed) {
+  const uint32 m = 0x5bd1e995;
+  const int r = 24;
+
+  uint32 h = seed ^ static_cast<uint32>(len);
+  uint8 const* data = static_cast<uint8 const*>(key);
+  for (; len >= 4; data += 4, len -= 4) {
+    uint32 k = Load::load32(data);
+    k *= m;
+    k ^= k >> r;
+    k *= m;
+    h *= m;
+    h ^= k;
+  }
+  if (len > 0) {
+    h ^= static_cast<uint32>(load_tail(data, len));
+    h *= m;
+  }
+
+  h ^= h >> 13;
+  h *= m;
+  h ^= h >> 15;
+  return h;
+}
+
+//! MurmurHash64A, reading words with Load.
+template<class Load>
+uint64
+murmur2_64(void const* const key, std::size_t len, uint64 const seed) {
+  const uint64 m = 0xc6a4a7935bd1e995ULL;
+  const int r = 47;
+
+  uint64 h = seed ^ (uint64(len)*m);
+  uint8 const* data = static_cast<uint8 const*>(key);
+  for (; len >= 8; data += 8, len -= 8) {
+    uint64 k = Load::load64(data);
+    k *= m;
+    k ^= k >> r;
+    k *= m;
+    h ^= k;
+    h *= m;
+  }
+  if (len > 0) {
+    h ^= load_tail(data, len);
+    h *= m;
+  }
+
+  h ^= h >> r;
+  h *= m;
+  h ^= h >> r;
+  return h;
+}
+
+inline
+uint32
+fmix32(uint32 h) {
+  h ^= h >> 16;
+  h *= 0x85ebca6b;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35;
+  h ^= h >> 16;
+  return h;
+}
+
+inline
+uint64
+fmix64(uint64 k) {
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ULL;
+  k ^= k >> 33;
+  return k;
+}
+
+//! MurmurHash3 state between blocks, specialized for uint32 and uint64.
+template<typename S, class Load>
+struct murmur3_state;
+
+//! MurmurHash3_x86_32 state.
+template<class Load>
+struct murmur3_state<uint32, Load> {
+  static const std::size_t block_size = 4;
+
+  void
+  reset(uint32 const seed) {
+    h = seed;
+  }
+
+  //! Mix in n blocks at p.
+  void
+  blocks(uint8 const* p, std::size_t n) {
+    const uint32 c1 = 0xcc9e2d51;
+    const uint32 c2 = 0x1b873593;
+    uint32 h1 = h;
+    for (; n > 0; --n, p += block_size) {
+      uint32 k1 = Load::load32(p);
+      k1 *= c1;
+      k1 = rotl32(k1, 15);
+      k1 *= c2;
+      h1 ^= k1;
+      h1 = rotl32(h1, 13);
+      h1 = h1*5 + 0xe6546b64;
+    }
+    h = h1;
+  }
+
+  //! Hash of all blocks so far followed by n < block_size tail bytes at p,
+  //! len bytes in total.
+  uint32
+  finish(uint8 const* const p, std::size_t const n, uint64 const len) const {
+    uint32 h1 = h;
+    if (n > 0) {
+      uint32 k1 = static_cast<uint32>(load_tail(p, n));
+      k1 *= 0xcc9e2d51;
+      k1 = rotl32(k1, 15);
+      k1 *= 0x1b873593;
+      h1 ^= k1;
+    }
+    h1 ^= static_cast<uint32>(len);
+    return fmix32(h1);
+  }
+
+  uint32 h;
+};
+
+//! MurmurHash3_x64_128 state, the hash is the first half.
+template<class Load>
+struct murmur3_state<uint64, Load> {
+  static const std::size_t block_size = 16;
+
+  void
+  reset(uint64 const seed) {
+    h1 = seed;
+    h2 = seed;
+  }
+
+  //! Mix in n blocks at p.
+  void
+  blocks(uint8 const* p, std::size_t n) {
+    const uint64 c1 = 0x87c37b91114253d5ULL;
+    const uint64 c2 = 0x4cf5ad432745937fULL;
+    uint64 a = h1;
+    uint64 b = h2;
+    for (; n > 0; --n, p += block_size) {
+      uint64 k1 = Load::load64(p);
+      uint64 k2 = Load::load64(p + 8);
+      k1 *= c1;
+      k1 = rotl64(k1, 31);
+      k1 *= c2;
+      a ^= k1;
+      a = rotl64(a, 27);
+      a += b;
+      a = a*5 + 0x52dce729;
+      k2 *= c2;
+      k2 = rotl64(k2, 33);
+      k2 *= c1;
+      b ^= k2;
+      b = rotl64(b, 31);
+      b += a;
+      b = b*5 + 0x38495ab5;
+    }
+    h1 = a;
+    h2 = b;
+  }
+
+  //! Hash of all blocks so far followed by n < block_size tail bytes at p,
+  //! len bytes in total.
+  uint64
+  finish(uint8 const* const p, std::size_t const n, uint64 const len) const {
+    const uint64 c1 = 0x87c37b91114253d5ULL;
+    const uint64 c2 = 0x4cf5ad432745937fULL;
+    uint64 a = h1;
+    uint64 b = h2;
+    if (n > 8) {
+      uint64 k2 = load_tail(p + 8, n - 8);
+      k2 *= c2;
+      k2 = rotl64(k2, 33);
+      k2 *= c1;
+      b ^= k2;
+    }
+    if (n > 0) {
+      uint64 k1 = load_tail(p, n < 8 ? n : 8);
+      k1 *= c1;
+      k1 = rotl64(k1, 31);
+      k1 *= c2;
+      a ^= k1;
+    }
+    a ^= len;
+    b ^= len;
+    a += b;
+    b += a;
+    a = fmix64(a);
+    b = fmix64(b);
+    return a + b;
+  }
+
+  uint64 h1;
+  uint64 h2;
+};
+
+} // Namespace: detail.
+
+//------------------------------------------------------------------------------
+
+//! MurmurHash2 (uint32) or MurmurHash64A (uint64) of the len bytes at key.
+template<typename S>
+S
+murmur(void const* key, std::size_t len, S seed);
+
+template<> inline
+uint32
+murmur<uint32>(void const* const key, std::size_t const len, uint32 const seed) {
+  return detail::murmur2_32<detail::host_load>(key, len, seed);
+}
+
+template<> inline
+uint64
+murmur<uint64>(void const* const key, std::size_t const len, uint64 const seed) {
+  return detail::murmur2_64<detail::host_load>(key, len, seed);
+}
+
+//! Return the key k such that murmur<S>(&k, sizeof(S), seed) == h.
+template<typename S>
+S
+murmur_inverse(S h, S seed);
+
+template<> inline
+uint32
+murmur_inverse<uint32>(uint32 h, uint32 const seed) {
+  const uint32 m = 0x5bd1e995;
+  const uint32 minv = 0xe59b19bd; // m*minv == 1 modulo 2^32.
+  const int r = 24;
+
+  h = detail::invert_shift_xor(h, 15);
+  h *= minv;
+  h = detail::invert_shift_xor(h, 13);
+
+  uint32 k = h ^ ((seed ^ 4)*m);
+  k *= minv;
+  k = detail::invert_shift_xor(k, r);
+  k *= minv;
+#if defined(THX_BIG_ENDIAN)
+  k = detail::byte_swap32(k);
+#endif
+  return k;
+}
+
+template<> inline
+uint64
+murmur_inverse<uint64>(uint64 h, uint64 const seed) {
+  const uint64 m = 0xc6a4a7935bd1e995ULL;
+  const uint64 minv = 0x5f7a0ea7e59b19bdULL; // m*minv == 1 modulo 2^64.
+  const int r = 47;
+
+  h = detail::invert_shift_xor(h, r);
+  h *= minv;
+  h = detail::invert_shift_xor(h, r);
+  h *= minv;
+
+  uint64 k = h ^ (seed ^ (8*m));
+  k *= minv;
+  k = detail::invert_shift_xor(k, r);
+  k *= minv;
+#if defined(THX_BIG_ENDIAN)
+  k = detail::byte_swap64(k);
+#endif
+  return k;
+}
+
+//------------------------------------------------------------------------------
+
+// murmur3_hasher<S> anatomy:
+// --------------------------
+//
+// Seed CTOR
+// (Compiler-generated DTOR, copy CTOR and operator=)
+//
+// void reset(seed)
+// murmur3_hasher& update(data, len)
+// S digest() const
+// uint64 size() const
+//
+// Incremental murmur3<S>. The digest of the data passed to update so far,
+// in any number of chunks, equals murmur3<S> of all of it. digest does not
+// end the stream, more data may follow. Whole blocks are hashed straight from
+// the input, only a partial block is buffered between calls.
+
+//! DOCS
+template<typename S, class Load = detail::host_load>
+class murmur3_hasher {
+public:
+  typedef S value_type;
+
+public: // CTOR's.
+  //! Seed CTOR.
+  explicit
+  murmur3_hasher(S const seed = 0) {
+    reset(seed);
+  }
+
+public:
+  //! Start a new stream.
+  void
+  reset(S const seed = 0) {
+    _state.reset(seed);
+    _buf_size = 0;
+    _size = 0;
+  }
+
+  //! Append the len bytes at data.
+  murmur3_hasher&
+  update(void const* const data, std::size_t len) {
+    static const std::size_t B = state_type::block_size;
+
+    uint8 const* p = static_cast<uint8 const*>(data);
+    _size += len;
+    if (_buf_size > 0) {
+      const std::size_t n = (len < B - _buf_size ? len : B - _buf_size);
+      std::memcpy(_buf + _buf_size, p, n);
+      _buf_size += n;
+      p += n;
+      len -= n;
+      if (_buf_size < B) {
+        return *this;
+      }
+      _state.blocks(_buf, 1);
+      _buf_size = 0;
+    }
+    _state.blocks(p, len/B);
+    p += (len/B)*B;
+    _buf_size = len%B;
+    if (_buf_size > 0) {
+      std::memcpy(_buf, p, _buf_size);
+    }
+    return *this;
+  }
+
+  //! Hash of all data so far.
+  S
+  digest() const {
+    return _state.finish(_buf, _buf_size, _size);
+  }
+
+  //! Number of bytes so far.
+  uint64
+  size() const {
+    return _size;
+  }
+
+private:
+  typedef detail::murmur3_state<S, Load> state_type;
+
+private: // Member variables.
+  state_type _state;
+  uint8 _buf[state_type::block_size]; //!< Partial block.
+  std::size_t _buf_size;
+  uint64 _size;
+};
+
+//------------------------------------------------------------------------------
+
+//! MurmurHash3_x86_32 (uint32) or the first half of MurmurHash3_x64_128
+//! (uint64) of the len bytes at key.
+template<typename S> inline
+S
+murmur3(void const* const key, std::size_t const len, S const seed) {
+  detail::murmur3_state<S, detail::host_load> state;
+  state.reset(seed);
+  const std::size_t B = detail::murmur3_state<S, detail::host_load>::block_size;
+  uint8 const* const p = static_cast<uint8 const*>(key);
+  state.blocks(p, len/B);
+  return state.finish(p + (len/B)*B, len%B, len);
+}
+
+END_THX_NAMESPACE
+
+#endif // THX_HASHING_HPP_INCLUDED
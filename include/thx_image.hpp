@@ -0,0 +1,565 @@
+//------------------------------------------------------------------------------
+//
+// Contributors:
+//             1) Tommy Hinks
+//
+//------------------------------------------------------------------------------
+
+#ifndef THX_IMAGE_HPP_INCLUDED
+#define THX_IMAGE_HPP_INCLUDED
+
+#include "thx_namespace.hpp"
+#include "thx_types.hpp"
+#include "thx_pixel.hpp"
+#include "thx_simd.hpp"
+#include "thx_parallel.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+
+//------------------------------------------------------------------------------
+
+BEGIN_THX_NAMESPACE
+
+// Images.
+// -------
+//
+// image_view<N,S>  - Non-owning window into pixels with N channels of type S.
+//                    S may be const. Views are cheap to copy.
+// image<N,S>       - Owning image, derives from image_view<N,S>.
+//
+// Pixels are stored either interleaved, all channels of a pixel next to each
+// other, or planar, one plane per channel. Channel c of pixel (x, y) is at
+//
+//   data() + y*row_stride() + x*pixel_stride() + c*channel_stride()
+//
+// where strides are in elements, i.e. in units of S:
+//
+//                    pixel_stride    channel_stride
+//   image_interleaved   N               1
+//   image_planar        1               plane size
+//
+// image<N,S> allocates one zeroed block. Every row, and for planar images
+// every plane, starts on a simd_alignment (cache line) boundary. Rows are
+// padded with zeros up to the next boundary, so row kernels may load and store
+// whole packets up to row_stride() elements from the start of a row. Using the
+// padding is not allowed for sub-images, since it overlaps their neighbours.
+// A custom row stride may be given, at least width()*pixel_stride() elements.
+//
+// Sub-images and single channels are views into the same pixels, no copies
+// are made. image_view<N,S> converts implicitly to image_view<N,S const>.
+//
+// Iteration.
+// ----------
+//
+// void parallel_for_rows(image_view<N,S>, f[, pool])
+// void parallel_for_tiles(image_view<N,S>, tile_width, tile_height, f[, pool])
+// void copy_image(image_view<N,S const> src, image_view<N,S> dst[, pool])
+//
+// parallel_for_rows calls f(y0, y1) for groups of consecutive rows of at least
+// image_grain pixels. parallel_for_tiles calls f(tile, x, y) where tile is the
+// sub-image of at most tile_width x tile_height pixels at (x, y). Tiles keep
+// the working set of filters in cache. Both run on the calling thread and the
+// threads of pool, see parallel_for. copy_image copies pixels between images
+// of the same size, possibly converting between layouts.
+
+//! Pixel storage order.
+enum image_layout {
+  image_interleaved = 0,
+  image_planar
+};
+
+namespace detail {
+
+//! Pixels per task of parallel_for_rows.
+static const std::size_t image_grain = 16384;
+
+//! Default tile size, in pixels.
+static const std::size_t image_tile = 64;
+
+} // Namespace: detail.
+
+//------------------------------------------------------------------------------
+
+// image_view<N,S> anatomy:
+// ------------------------
+//
+// typedef std::remove_const<S>::type value_type;
+// typedef pixel<N,value_type> pixel_type;
+// typedef std::size_t size_type;
+// typedef S* pointer;
+//
+// define channel_count = N
+//
+// Default CTOR (empty)
+// Data CTOR (data, width, height, layout, row_stride[, plane_stride])
+// image_view<N,U> CTOR (adds const)
+// (Compiler-generated copy CTOR, operator= and DTOR)
+//
+// size_type width() const
+// size_type height() const
+// bool empty() const
+// image_layout layout() const
+// size_type row_stride() const
+// size_type pixel_stride() const
+// size_type channel_stride() const
+// bool rows_aligned() const
+//
+// pointer data() const
+// pointer row(y[, c]) const
+// pointer at(x, y[, c]) const
+// pixel_type get(x, y) const
+// void set(x, y, pixel_type) const
+//
+// image_view<N,S> sub_image(x, y, width, height) const
+// image_view<1,S> channel(c) const
+
+//! DOCS
+template<std::size_t N, typename S>
+class image_view {
+public:
+  typedef typename std::remove_const<S>::type value_type;
+  typedef pixel<N,value_type> pixel_type;
+  typedef std::size_t size_type;
+  typedef S* pointer;
+
+  static const size_type channel_count = N;
+
+  static_assert(N > 0, "Images must have at least one channel");
+
+public: // CTOR's.
+  //! Default CTOR, an empty view.
+  image_view()
+    : _data(0)
+    , _width(0)
+    , _height(0)
+    , _row_stride(0)
+    , _pixel_stride(N)
+    , _channel_stride(1)
+    , _layout(image_interleaved) {
+  }
+
+  //! Data CTOR. Strides are in elements. For planar images plane_stride is
+  //! the distance between the planes, by default height*row_stride. Ignored
+  //! for interleaved images.
+  image_view(pointer const data,
+             size_type const width,
+             size_type const height,
+             image_layout const layout,
+             size_type const row_stride,
+             size_type const plane_stride = 0)
+    : _data(data)
+    , _width(width)
+    , _height(height)
+    , _row_stride(row_stride)
+    , _pixel_stride(layout == image_interleaved ? N : 1)
+    , _channel_stride(layout == image_interleaved ? 1 :
+                      (plane_stride > 0 ? plane_stride : height*row_stride))
+    , _layout(layout) {
+  }
+
+  //! image_view<N,U> CTOR, e.g. from a mutable to a const view.
+  template<typename U>
+  image_view(image_view<N,U> const& rhs,
+             typename std::enable_if<
+               std::is_convertible<U*, S*>::value>::type* = 0)
+    : _data(rhs.data())
+    , _width(rhs.width())
+    , _height(rhs.height())
+    , _row_stride(rhs.row_stride())
+    , _pixel_stride(rhs.pixel_stride())
+    , _channel_stride(rhs.channel_stride())
+    , _layout(rhs.layout()) {
+  }
+
+public: // Size and layout.
+  size_type
+  width() const {
+    return _width;
+  }
+
+  size_type
+  height() const {
+    return _height;
+  }
+
+  //! True if there are no pixels.
+  bool
+  empty() const {
+    return _width == 0 || _height == 0;
+  }
+
+  image_layout
+  layout() const {
+    return _layout;
+  }
+
+  //! Elements between the starts of consecutive rows.
+  size_type
+  row_stride() const {
+    return _row_stride;
+  }
+
+  //! Elements between horizontally adjacent pixels.
+  size_type
+  pixel_stride() const {
+    return _pixel_stride;
+  }
+
+  //! Elements between the channels of a pixel.
+  size_type
+  channel_stride() const {
+    return _channel_stride;
+  }
+
+  //! True if every row of every channel starts on a simd_alignment boundary.
+  bool
+  rows_aligned() const {
+    const std::size_t a = simd_alignment;
+    bool r = reinterpret_cast<std::size_t>(_data) % a == 0 &&
+             (_height < 2 || (_row_stride*sizeof(S)) % a == 0);
+    if (_layout == image_planar && N > 1) {
+      r = r && (_channel_stride*sizeof(S)) % a == 0;
+    }
+    return r;
+  }
+
+public: // Pixel access.
+  //! Channel 0 of pixel (0, 0).
+  pointer
+  data() const {
+    return _data;
+  }
+
+  //! Channel c of the first pixel of row y. No bounds checking!
+  pointer
+  row(size_type const y, size_type const c = 0) const {
+    return _data + y*_row_stride + c*_channel_stride;
+  }
+
+  //! Channel c of pixel (x, y). No bounds checking!
+  pointer
+  at(size_type const x, size_type const y, size_type const c = 0) const {
+    return row(y, c) + x*_pixel_stride;
+  }
+
+  //! Pixel (x, y). No bounds checking!
+  pixel_type
+  get(size_type const x, size_type const y) const {
+    S* const p = at(x, y);
+    pixel_type r;
+    for (size_type c = 0; c < N; ++c) {
+      r[c] = p[c*_channel_stride];
+    }
+    return r;
+  }
+
+  //! Set pixel (x, y). No bounds checking!
+  void
+  set(size_type const x, size_type const y, pixel_type const& v) const {
+    S* const p = at(x, y);
+    for (size_type c = 0; c < N; ++c) {
+      p[c*_channel_stride] = v[c];
+    }
+  }
+
+public: // Views.
+  //! The width x height pixels starting at (x, y). No bounds checking!
+  image_view<N,S>
+  sub_image(size_type const x,
+            size_type const y,
+            size_type const width,
+            size_type const height) const {
+    image_view<N,S> r(*this);
+    r._data = at(x, y);
+    r._width = width;
+    r._height = height;
+    return r;
+  }
+
+  //! Channel c as a single-channel image. For interleaved images the pixels
+  //! of the view are pixel_stride() apart. No bounds checking!
+  image_view<1,S>
+  channel(size_type const c) const {
+    image_view<1,S> r(_data + c*_channel_stride, _width, _height,
+                      image_planar, _row_stride);
+    r._pixel_stride = _pixel_stride;
+    r._layout = _layout;
+    return r;
+  }
+
+private:
+  template<std::size_t M, typename U> friend class image_view;
+  template<std::size_t M, typename U> friend class image;
+
+private: // Member variables.
+  pointer _data;              //!< Channel 0 of pixel (0, 0).
+  size_type _width;           //!< Pixels per row.
+  size_type _height;          //!< Rows.
+  size_type _row_stride;      //!< Elements between rows.
+  size_type _pixel_stride;    //!< Elements between pixels of a row.
+  size_type _channel_stride;  //!< Elements between channels.
+  image_layout _layout;
+};
+
+//------------------------------------------------------------------------------
+
+// image<N,S> anatomy:
+// -------------------
+//
+// Default CTOR (empty)
+// Size CTOR (width, height[, layout]), all zeros
+// Stride CTOR (width, height, layout, row_stride), all zeros
+// Copy CTOR, Move CTOR, operator=, DTOR
+//
+// void swap(image<N,S>&)
+// (All image_view<N,S> members)
+//
+// Storage is described at the top of this file. The view members refer to
+// the image itself, so a const image still hands out mutable pointers. Pass
+// image_view<N,S const> to code that should only read.
+
+//! DOCS
+template<std::size_t N, typename S>
+class image : public image_view<N,S> {
+public:
+  typedef image_view<N,S> view_type;
+  typedef typename view_type::size_type size_type;
+  typedef typename view_type::pointer pointer;
+
+  static_assert(!std::is_const<S>::value, "Images own mutable pixels");
+  static_assert(simd_alignment % sizeof(S) == 0,
+                "Elements must evenly divide simd_alignment");
+
+public: // CTOR's.
+  //! Default CTOR, an empty image.
+  image()
+    : _size(0) {
+  }
+
+  //! Size CTOR. Rows are padded to simd_alignment bytes.
+  image(size_type const width,
+        size_type const height,
+        image_layout const layout = image_interleaved)
+    : _size(0) {
+    _alloc(width, height, layout, _aligned_stride(width, layout));
+  }
+
+  //! Stride CTOR, row_stride elements between rows. Throws
+  //! std::invalid_argument if row_stride is too small for width pixels.
+  image(size_type const width,
+        size_type const height,
+        image_layout const layout,
+        size_type const row_stride)
+    : _size(0) {
+    if (row_stride < width*(layout == image_interleaved ? N : 1)) {
+      throw std::invalid_argument("image row stride smaller than a row");
+    }
+    _alloc(width, height, layout, row_stride);
+  }
+
+  //! Copy CTOR.
+  image(image<N,S> const& rhs)
+    : view_type()
+    , _size(0) {
+    _alloc(rhs.width(), rhs.height(), rhs.layout(), rhs.row_stride());
+    if (_size > 0) {
+      std::memcpy(this->_data, rhs._data, _size*sizeof(S));
+    }
+  }
+
+  //! Move CTOR, rhs is left empty.
+  image(image<N,S>&& rhs)
+    : view_type()
+    , _size(0) {
+    swap(rhs);
+  }
+
+  //! DTOR.
+  ~image() {
+    detail::aligned_free(this->_data);
+  }
+
+  //! Assignment operator.
+  image<N,S>&
+  operator=(image<N,S> rhs) {
+    swap(rhs);
+    return *this;
+  }
+
+  //! Swap contents with rhs. Never throws.
+  void
+  swap(image<N,S>& rhs) {
+    std::swap(static_cast<view_type&>(*this), static_cast<view_type&>(rhs));
+    std::swap(_size, rhs._size);
+  }
+
+private:
+  //! Smallest stride that keeps rows aligned.
+  static
+  size_type
+  _aligned_stride(size_type const width, image_layout const layout) {
+    const size_type lane = simd_alignment/sizeof(S);
+    const size_type n = width*(layout == image_interleaved ? N : 1);
+    return ((n + lane - 1)/lane)*lane;
+  }
+
+  //! Allocate zeroed storage. Assumes that no storage is currently held.
+  void
+  _alloc(size_type const width,
+         size_type const height,
+         image_layout const layout,
+         size_type const row_stride) {
+    const size_type lane = simd_alignment/sizeof(S);
+    const size_type plane = ((height*row_stride + lane - 1)/lane)*lane;
+    const size_type planes = (layout == image_interleaved ? 1 : N);
+    if (height > 0 &&
+        row_stride > (std::numeric_limits<size_type>::max)()/sizeof(S)/
+                     planes/height) {
+      throw std::bad_alloc();
+    }
+    const size_type size = planes*plane;
+    pointer data = 0;
+    if (size > 0) {
+      data = static_cast<pointer>(detail::aligned_malloc(size*sizeof(S)));
+      std::memset(data, 0, size*sizeof(S));
+    }
+    static_cast<view_type&>(*this) =
+      view_type(data, width, height, layout, row_stride, plane);
+    _size = size;
+  }
+
+private: // Member variables.
+  size_type _size; //!< Allocated elements.
+};
+
+//------------------------------------------------------------------------------
+
+//! Call f(y0, y1) for groups of consecutive rows of v, in parallel on pool.
+//! Each group has at least image_grain pixels, unless the image is smaller.
+template<std::size_t N, typename S, class F>
+void
+parallel_for_rows(image_view<N,S> const& v,
+                  F const& f,
+                  thread_pool& pool = default_thread_pool()) {
+  const std::size_t rows =
+    detail::image_grain/(std::max)(v.width(), std::size_t(1));
+  parallel_for(0, v.height(), (std::max)(rows, std::size_t(1)), f, pool);
+}
+
+//! Call f(tile, x, y) for the tiles of v, in parallel on pool. tile is the
+//! sub-image at (x, y) of tile_width x tile_height pixels, smaller at the
+//! right and bottom edges. Tiles are numbered row by row, every pixel is in
+//! exactly one tile.
+template<std::size_t N, typename S, class F>
+void
+parallel_for_tiles(image_view<N,S> const& v,
+                   std::size_t tile_width,
+                   std::size_t tile_height,
+                   F const& f,
+                   thread_pool& pool = default_thread_pool()) {
+  if (v.empty()) {
+    return;
+  }
+  tile_width = (std::max)(tile_width, std::size_t(1));
+  tile_height = (std::max)(tile_height, std::size_t(1));
+  const std::size_t nx = (v.width() + tile_width - 1)/tile_width;
+  const std::size_t ny = (v.height() + tile_height - 1)/tile_height;
+  parallel_for(0, nx*ny, 1, [&](std::size_t const t0, std::size_t const t1) {
+    for (std::size_t t = t0; t < t1; ++t) {
+      const std::size_t x = (t % nx)*tile_width;
+      const std::size_t y = (t/nx)*tile_height;
+      f(v.sub_image(x, y,
+                    (std::min)(tile_width, v.width() - x),
+                    (std::min)(tile_height, v.height() - y)), x, y);
+    }
+  }, pool);
+}
+
+//! Tiles of image_tile x image_tile pixels.
+template<std::size_t N, typename S, class F>
+void
+parallel_for_tiles(image_view<N,S> const& v,
+                   F const& f,
+                   thread_pool& pool = default_thread_pool()) {
+  parallel_for_tiles(v, detail::image_tile, detail::image_tile, f, pool);
+}
+
+namespace detail {
+
+//! Copy a row of n pixels, channel by channel unless both are contiguous.
+template<std::size_t N, typename S>
+void
+copy_image_row(image_view<N,S const> const& src,
+               image_view<N,S> const& dst,
+               std::size_t const y) {
+  const std::size_t n = src.width();
+  if (src.pixel_stride() == dst.pixel_stride() &&
+      src.channel_stride() == 1 && dst.channel_stride() == 1) {
+    std::memcpy(dst.row(y), src.row(y), n*src.pixel_stride()*sizeof(S));
+    return;
+  }
+  if (src.pixel_stride() == 1 && dst.pixel_stride() == 1) {
+    for (std::size_t c = 0; c < N; ++c) {
+      std::memcpy(dst.row(y, c), src.row(y, c), n*sizeof(S));
+    }
+    return;
+  }
+  // Layout conversion, all channels in one pass over the row.
+  S const* s[N];
+  S* d[N];
+  for (std::size_t c = 0; c < N; ++c) {
+    s[c] = src.row(y, c);
+    d[c] = dst.row(y, c);
+  }
+  const std::size_t ss = src.pixel_stride();
+  const std::size_t ds = dst.pixel_stride();
+  for (std::size_t x = 0; x < n; ++x) {
+    for (std::size_t c = 0; c < N; ++c) {
+      d[c][x*ds] = s[c][x*ss];
+    }
+  }
+}
+
+} // Namespace: detail.
+
+//! Copy the pixels of src to dst, which must have the same size and must not
+//! overlap src. Layouts may differ.
+template<std::size_t N, typename S>
+void
+copy_image(image_view<N,S const> const& src,
+           image_view<N,S> const& dst,
+           thread_pool& pool = default_thread_pool()) {
+  parallel_for_rows(src, [&](std::size_t const y0, std::size_t const y1) {
+    for (std::size_t y = y0; y < y1; ++y) {
+      detail::copy_image_row(src, dst, y);
+    }
+  }, pool);
+}
+
+//! Mutable source.
+template<std::size_t N, typename S>
+void
+copy_image(image_view<N,S> const& src,
+           image_view<N,S> const& dst,
+           thread_pool& pool = default_thread_pool()) {
+  copy_image(image_view<N,S const>(src), dst, pool);
+}
+
+//------------------------------------------------------------------------------
+
+// Convenient types, add more if appropriate.
+
+typedef image<1,uint8>    luminance_image;
+typedef image<3,uint8>    rgb_image;
+typedef image<4,uint8>    rgba_image;
+typedef image<3,float32>  image3f32;
+typedef image<4,float32>  image4f32;
+
+END_THX_NAMESPACE
+
+#endif // THX_IMAGE_HPP_INCLUDED
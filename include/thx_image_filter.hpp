@@ -0,0 +1,684 @@
+//------------------------------------------------------------------------------
+//
+// Contributors:
+//             1) Tommy Hinks
+//
+//------------------------------------------------------------------------------
+
+#ifndef THX_IMAGE_FILTER_HPP_INCLUDED
+#define THX_IMAGE_FILTER_HPP_INCLUDED
+
+#include "thx_namespace.hpp"
+#include "thx_types.hpp"
+#include "thx_scalar_algo.hpp"
+#include "thx_simd.hpp"
+#include "thx_cpu.hpp"
+#include "thx_aligned.hpp"
+#include "thx_parallel.hpp"
+#include "thx_image.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+BEGIN_THX_NAMESPACE
+
+// Separable image filters.
+// ------------------------
+//
+// filter_taps<S> compact_gaussian_taps(in_size, out_size, sigma)
+//
+// void convolve_separable(image_view<N,S const> in,
+//                         image_view<N,S> out,
+//                         filter_taps<S> x_taps,
+//                         filter_taps<S> y_taps[, pool])
+// void gaussian_blur(image_view<N,S const> in,
+//                    image_view<N,S> out,
+//                    S sigma[, pool])
+// void resample(image_view<N,S const> in,
+//                image_view<N,S> out[, sigma[, pool]])
+//
+// Output pixel o along an axis is a weighted sum of the input pixels
+// start(o), ..., start(o) + size() - 1 of filter_taps. Pixels outside the
+// input repeat the edge pixel. compact_gaussian_taps samples compact_gaussian
+// (see thx_scalar_algo.hpp) around the output pixel center mapped to the
+// input, with sigma in output pixels, widened by the scale factor when
+// downsampling. Weights are normalized to sum to one. gaussian_blur and
+// resample build taps for both axes and call convolve_separable. Images may
+// have any layout, but in and out must not overlap. S is float32 or float64.
+//
+// The output is split into tiles of about filter_tile_width pixels wide,
+// sized so that the horizontally filtered input rows of a tile fit in
+// filter_cache bytes, i.e. stay in L2. For each tile the input rows are
+// filtered horizontally into that buffer, one plane per channel, then the
+// vertical pass combines whole buffer rows into output rows. Interleaved
+// pixels are split into channels, and merged again, in one pass per row.
+// The vertical pass, and the horizontal pass when all outputs share their
+// weights as for blurs, weigh rows of consecutive pixels and run on
+// simd_traits<S> packets, or as many as active_isa() allows with run-time
+// dispatch (see thx_cpu.hpp). Tiles are processed in parallel on the pool.
+
+namespace detail {
+
+//! Output pixels per tile row.
+static const std::size_t filter_tile_width = 256;
+
+//! Bytes of horizontally filtered rows per tile.
+static const std::size_t filter_cache = 256*1024;
+
+} // Namespace: detail.
+
+//------------------------------------------------------------------------------
+
+// filter_taps<S> anatomy:
+// -----------------------
+//
+// typedef std::size_t size_type;
+//
+// Default CTOR (empty)
+// Size CTOR (in_size, out_size, taps), all weights zero
+// (Compiler-generated copy CTOR, operator= and DTOR)
+//
+// size_type in_size() const
+// size_type out_size() const
+// size_type size() const
+// bool uniform() const
+// void set_uniform()
+//
+// std::ptrdiff_t start(o) const
+// void set_start(o, std::ptrdiff_t)
+// S const* weights(o) const
+// S* weights(o)
+//
+// size() weights per output pixel. uniform() is true when every output has
+// the weights of output 0 and start(o) = start(0) + o, e.g. for blurs, and
+// must be updated with set_uniform() after changing weights.
+
+//! DOCS
+template<typename S>
+class filter_taps {
+public:
+  typedef std::size_t size_type;
+
+  static_assert(std::is_floating_point<S>::value,
+                "Filter weights must be floating point");
+
+public: // CTOR's.
+  //! Default CTOR, no taps.
+  filter_taps()
+    : _in_size(0)
+    , _out_size(0)
+    , _size(0)
+    , _uniform(false) {
+  }
+
+  //! Size CTOR, taps weights per output, all zero.
+  filter_taps(size_type const in_size,
+              size_type const out_size,
+              size_type const taps)
+    : _in_size(in_size)
+    , _out_size(out_size)
+    , _size(taps)
+    , _uniform(false)
+    , _start(out_size, 0)
+    , _weights(out_size*taps, S(0)) {
+  }
+
+public: // Size.
+  //! Input pixels.
+  size_type
+  in_size() const {
+    return _in_size;
+  }
+
+  //! Output pixels.
+  size_type
+  out_size() const {
+    return _out_size;
+  }
+
+  //! Taps per output pixel.
+  size_type
+  size() const {
+    return _size;
+  }
+
+  //! True if all outputs share the weights of output 0, see above.
+  bool
+  uniform() const {
+    return _uniform;
+  }
+
+  //! Check whether all outputs share the weights of output 0.
+  void
+  set_uniform() {
+    _uniform = _out_size > 0;
+    for (size_type o = 1; _uniform && o < _out_size; ++o) {
+      _uniform = _start[o] == _start[0] + static_cast<std::ptrdiff_t>(o) &&
+                 std::equal(weights(o), weights(o) + _size, weights(0));
+    }
+  }
+
+public: // Taps.
+  //! First input pixel of output o, may be outside the input.
+  std::ptrdiff_t
+  start(size_type const o) const {
+    return _start[o];
+  }
+
+  void
+  set_start(size_type const o, std::ptrdiff_t const s) {
+    _start[o] = s;
+  }
+
+  //! Weights of output o. No bounds checking!
+  S const*
+  weights(size_type const o) const {
+    return _weights.data() + o*_size;
+  }
+
+  //! Weights of output o. No bounds checking!
+  S*
+  weights(size_type const o) {
+    return _weights.data() + o*_size;
+  }
+
+private: // Member variables.
+  size_type _in_size;
+  size_type _out_size;
+  size_type _size;                   //!< Taps per output.
+  bool _uniform;
+  std::vector<std::ptrdiff_t> _start;
+  std::vector<S> _weights;           //!< size() per output.
+};
+
+//------------------------------------------------------------------------------
+
+//! Taps sampling compact_gaussian with sigma in output pixels, see above.
+//! Throws std::invalid_argument unless sigma > 0.
+template<typename S>
+filter_taps<S>
+compact_gaussian_taps(std::size_t const in_size,
+                      std::size_t const out_size,
+                      S const sigma) {
+  if (!(sigma > S(0))) {
+    throw std::invalid_argument("filter sigma must be positive");
+  }
+  if (in_size == 0 || out_size == 0) {
+    return filter_taps<S>(in_size, out_size, 0);
+  }
+
+  // Input pixels per output pixel, and the filter radius in input pixels.
+  const S scale = static_cast<S>(in_size)/static_cast<S>(out_size);
+  const S sigma_in = sigma*(std::max)(scale, S(1));
+  const S radius = S(2.5)*sigma_in;
+  const std::size_t taps =
+    2*static_cast<std::size_t>(std::ceil(radius)) + 1;
+
+  // Input pixels within the radius of the output pixel center c.
+  filter_taps<S> r(in_size, out_size, taps);
+  for (std::size_t o = 0; o < out_size; ++o) {
+    const S c = (static_cast<S>(o) + S(0.5))*scale - S(0.5);
+    const std::ptrdiff_t s =
+      static_cast<std::ptrdiff_t>(std::floor(c - radius)) + 1;
+    S* const w = r.weights(o);
+    S sum = S(0);
+    for (std::size_t k = 0; k < taps; ++k) {
+      const S x = static_cast<S>(s + static_cast<std::ptrdiff_t>(k));
+      w[k] = compact_gaussian(x - c, sigma_in);
+      sum += w[k];
+    }
+    if (sum > S(0)) {
+      for (std::size_t k = 0; k < taps; ++k) {
+        w[k] /= sum;
+      }
+    }
+    else {
+      // Narrower than a pixel, take the nearest.
+      const std::ptrdiff_t n =
+        static_cast<std::ptrdiff_t>(std::floor(c + S(0.5))) - s;
+      w[(std::min)(static_cast<std::size_t>((std::max)(n, std::ptrdiff_t(0))),
+                   taps - 1)] = S(1);
+    }
+    r.set_start(o, s);
+  }
+
+  // Drop taps that are zero for every output.
+  std::size_t lead = taps;
+  std::size_t trail = taps;
+  for (std::size_t o = 0; o < out_size; ++o) {
+    S const* const w = r.weights(o);
+    std::size_t l = 0;
+    while (l < taps && w[l] == S(0)) {
+      ++l;
+    }
+    std::size_t t = 0;
+    while (t < taps - l && w[taps - 1 - t] == S(0)) {
+      ++t;
+    }
+    lead = (std::min)(lead, l);
+    trail = (std::min)(trail, t);
+  }
+  if (lead + trail > 0) {
+    filter_taps<S> trimmed(in_size, out_size, taps - lead - trail);
+    for (std::size_t o = 0; o < out_size; ++o) {
+      std::copy(r.weights(o) + lead, r.weights(o) + taps - trail,
+                trimmed.weights(o));
+      trimmed.set_start(o, r.start(o) + static_cast<std::ptrdiff_t>(lead));
+    }
+    r = trimmed;
+  }
+  r.set_uniform();
+  return r;
+}
+
+//------------------------------------------------------------------------------
+
+namespace detail {
+
+THX_GENERIC_KERNELS_BEGIN
+
+//! dst[j] = sum of w[k]*src[k][j] over k < taps, for j < n. Terms are added
+//! in order of k, packets of Simd::packet_size pixels at a time. Four packets
+//! are summed side by side to hide the latency of the additions.
+template<typename S, class Simd = simd_traits<S>>
+void
+filter_combine_packets(S const* const* const src,
+                       S const* const w,
+                       std::size_t const taps,
+                       S* const dst,
+                       std::size_t const n) {
+  typedef Simd simd;
+  typedef typename simd::packet_type packet_type;
+  static const std::size_t P = simd::packet_size;
+
+  std::size_t j = 0;
+  for (; j + 4*P <= n; j += 4*P) {
+    packet_type wk = simd::set1(w[0]);
+    packet_type a0 = simd::mul(wk, simd::loadu(src[0] + j));
+    packet_type a1 = simd::mul(wk, simd::loadu(src[0] + j + P));
+    packet_type a2 = simd::mul(wk, simd::loadu(src[0] + j + 2*P));
+    packet_type a3 = simd::mul(wk, simd::loadu(src[0] + j + 3*P));
+    for (std::size_t k = 1; k < taps; ++k) {
+      S const* const s = src[k] + j;
+      wk = simd::set1(w[k]);
+      a0 = simd::add(a0, simd::mul(wk, simd::loadu(s)));
+      a1 = simd::add(a1, simd::mul(wk, simd::loadu(s + P)));
+      a2 = simd::add(a2, simd::mul(wk, simd::loadu(s + 2*P)));
+      a3 = simd::add(a3, simd::mul(wk, simd::loadu(s + 3*P)));
+    }
+    simd::storeu(dst + j, a0);
+    simd::storeu(dst + j + P, a1);
+    simd::storeu(dst + j + 2*P, a2);
+    simd::storeu(dst + j + 3*P, a3);
+  }
+  for (; j + P <= n; j += P) {
+    packet_type a = simd::mul(simd::set1(w[0]), simd::loadu(src[0] + j));
+    for (std::size_t k = 1; k < taps; ++k) {
+      a = simd::add(a, simd::mul(simd::set1(w[k]), simd::loadu(src[k] + j)));
+    }
+    simd::storeu(dst + j, a);
+  }
+  for (; j < n; ++j) {
+    S a = w[0]*src[0][j];
+    for (std::size_t k = 1; k < taps; ++k) {
+      a = a + w[k]*src[k][j];
+    }
+    dst[j] = a;
+  }
+}
+
+THX_GENERIC_KERNELS_END
+
+//! Kernel combining rows, see filter_combine_packets.
+template<typename S>
+struct filter_kernel {
+  typedef void (*type)(S const* const*, S const*, std::size_t, S*,
+                       std::size_t);
+};
+
+//! Kernel for the instruction sets enabled at compile time.
+template<typename S> inline
+typename filter_kernel<S>::type
+filter_select_kernel(S) {
+  return &filter_combine_packets<S>;
+}
+
+#if defined(THX_DISPATCH)
+
+template<typename S> THX_TARGET_AVX THX_FLATTEN
+void
+filter_combine_avx(S const* const* const src,
+                   S const* const w,
+                   std::size_t const taps,
+                   S* const dst,
+                   std::size_t const n) {
+  filter_combine_packets<S, avx_traits<S>>(src, w, taps, dst, n);
+}
+
+template<typename S> THX_TARGET_AVX512 THX_FLATTEN
+void
+filter_combine_avx512(S const* const* const src,
+                      S const* const w,
+                      std::size_t const taps,
+                      S* const dst,
+                      std::size_t const n) {
+  filter_combine_packets<S, avx512_traits<S>>(src, w, taps, dst, n);
+}
+
+//! Kernel dispatched on active_isa().
+template<typename S> inline
+typename filter_kernel<S>::type
+filter_select_dispatch() {
+  const isa t = active_isa();
+  if (t >= isa_avx512) {
+    return &filter_combine_avx512<S>;
+  }
+  if (t >= isa_avx) {
+    return &filter_combine_avx<S>;
+  }
+  return &filter_combine_packets<S>;
+}
+
+inline
+filter_kernel<float32>::type
+filter_select_kernel(float32) {
+  return filter_select_dispatch<float32>();
+}
+
+inline
+filter_kernel<float64>::type
+filter_select_kernel(float64) {
+  return filter_select_dispatch<float64>();
+}
+
+#endif // THX_DISPATCH
+
+//! Clamp i to [0, n).
+inline
+std::size_t
+filter_clamp(std::ptrdiff_t const i, std::size_t const n) {
+  return i < 0 ? 0 :
+    (static_cast<std::size_t>(i) < n ? static_cast<std::size_t>(i) : n - 1);
+}
+
+//! dst[x - x0] = sum of w[k]*src[start(x) - xs0 + k] with the weights w of
+//! output x, for x0 <= x < x1, i.e. src holds input columns from xs0 on.
+//! Four outputs are summed side by side to hide the latency of the
+//! additions.
+template<typename S>
+void
+filter_row_taps(filter_taps<S> const& t,
+                std::size_t const x0,
+                std::size_t const x1,
+                S const* const src,
+                std::ptrdiff_t const xs0,
+                S* const dst) {
+  const std::size_t n = t.size();
+  std::size_t x = x0;
+  for (; x + 4 <= x1; x += 4) {
+    S const* const w0 = t.weights(x);
+    S const* const w1 = w0 + n;
+    S const* const w2 = w1 + n;
+    S const* const w3 = w2 + n;
+    S const* const s0 = src + (t.start(x) - xs0);
+    S const* const s1 = src + (t.start(x + 1) - xs0);
+    S const* const s2 = src + (t.start(x + 2) - xs0);
+    S const* const s3 = src + (t.start(x + 3) - xs0);
+    S a0 = w0[0]*s0[0];
+    S a1 = w1[0]*s1[0];
+    S a2 = w2[0]*s2[0];
+    S a3 = w3[0]*s3[0];
+    for (std::size_t k = 1; k < n; ++k) {
+      a0 = a0 + w0[k]*s0[k];
+      a1 = a1 + w1[k]*s1[k];
+      a2 = a2 + w2[k]*s2[k];
+      a3 = a3 + w3[k]*s3[k];
+    }
+    dst[x - x0] = a0;
+    dst[x - x0 + 1] = a1;
+    dst[x - x0 + 2] = a2;
+    dst[x - x0 + 3] = a3;
+  }
+  for (; x < x1; ++x) {
+    S const* const w = t.weights(x);
+    S const* const s = src + (t.start(x) - xs0);
+    S a = w[0]*s[0];
+    for (std::size_t k = 1; k < n; ++k) {
+      a = a + w[k]*s[k];
+    }
+    dst[x - x0] = a;
+  }
+}
+
+//! Scratch memory of a tile, reused between the tiles of a task.
+template<typename S>
+struct filter_scratch {
+  std::vector<S, aligned_allocator<S>> line; //!< Edge-extended input row.
+  std::vector<S, aligned_allocator<S>> mid;  //!< Horizontally filtered rows.
+  std::vector<S, aligned_allocator<S>> row;  //!< Output row.
+  std::vector<S const*> src;                 //!< Kernel row pointers.
+};
+
+//! Filter output pixels [x0, x1) x [y0, y1), all channels.
+template<std::size_t N, typename S>
+void
+filter_tile(image_view<N,S const> const& in,
+            image_view<N,S> const& out,
+            filter_taps<S> const& xt,
+            filter_taps<S> const& yt,
+            typename filter_kernel<S>::type const kernel,
+            std::size_t const x0,
+            std::size_t const x1,
+            std::size_t const y0,
+            std::size_t const y1,
+            filter_scratch<S>& scratch) {
+  const std::size_t tw = x1 - x0;
+  const std::size_t xn = xt.size();
+  const std::size_t yn = yt.size();
+
+  // Input columns [xs0, xs1) and rows [r0, r1) that the tile needs.
+  const std::ptrdiff_t xs0 = xt.start(x0);
+  const std::ptrdiff_t xs1 =
+    xt.start(x1 - 1) + static_cast<std::ptrdiff_t>(xn);
+  const std::size_t r0 = filter_clamp(yt.start(y0), in.height());
+  const std::size_t r1 = filter_clamp(
+    yt.start(y1 - 1) + static_cast<std::ptrdiff_t>(yn) - 1, in.height()) + 1;
+  const std::size_t ln = static_cast<std::size_t>(xs1 - xs0);
+  const std::size_t plane = (r1 - r0)*tw;
+
+  // Horizontal pass into one buffer plane per channel.
+  scratch.line.resize(N*ln);
+  scratch.mid.resize(N*plane);
+  scratch.row.resize(N*tw);
+  scratch.src.resize((std::max)(xn, yn));
+  const std::ptrdiff_t ps = static_cast<std::ptrdiff_t>(in.pixel_stride());
+  const std::ptrdiff_t width = static_cast<std::ptrdiff_t>(in.width());
+  const std::ptrdiff_t i0 = (std::max)(xs0, std::ptrdiff_t(0));
+  const std::ptrdiff_t i1 = (std::min)(xs1, width);
+  const bool in_place = (ps == 1 && i0 == xs0 && i1 == xs1);
+  for (std::size_t r = r0; r < r1; ++r) {
+    // Contiguous rows are read in place unless they need extending.
+    // Interleaved rows are split into channels in a single pass.
+    if (!in_place) {
+      S const* const p = in.row(r);
+      const std::ptrdiff_t cs =
+        static_cast<std::ptrdiff_t>(in.channel_stride());
+      for (std::size_t c = 0; c < N; ++c) {
+        S* const l = scratch.line.data() + c*ln;
+        std::fill(l, l + (i0 - xs0), p[c*cs]);
+        std::fill(l + (i1 - xs0), l + ln, p[(width - 1)*ps + c*cs]);
+      }
+      if (N > 1 && cs == 1) {
+        for (std::ptrdiff_t i = i0; i < i1; ++i) {
+          for (std::size_t c = 0; c < N; ++c) {
+            scratch.line[c*ln + (i - xs0)] = p[i*ps + c];
+          }
+        }
+      }
+      else {
+        for (std::size_t c = 0; c < N; ++c) {
+          S* const l = scratch.line.data() + c*ln;
+          for (std::ptrdiff_t i = i0; i < i1; ++i) {
+            l[i - xs0] = p[i*ps + c*cs];
+          }
+        }
+      }
+    }
+    for (std::size_t c = 0; c < N; ++c) {
+      S const* const line =
+        in_place ? in.row(r, c) + xs0 : scratch.line.data() + c*ln;
+      S* const mid = scratch.mid.data() + c*plane + (r - r0)*tw;
+      if (xt.uniform()) {
+        for (std::size_t k = 0; k < xn; ++k) {
+          scratch.src[k] = line + k;
+        }
+        kernel(scratch.src.data(), xt.weights(0), xn, mid, tw);
+      }
+      else {
+        filter_row_taps(xt, x0, x1, line, xs0, mid);
+      }
+    }
+  }
+
+  // Vertical pass. Interleaved output is merged from one row per channel.
+  const std::size_t ops = out.pixel_stride();
+  for (std::size_t y = y0; y < y1; ++y) {
+    for (std::size_t c = 0; c < N; ++c) {
+      S const* const mid = scratch.mid.data() + c*plane;
+      for (std::size_t k = 0; k < yn; ++k) {
+        const std::size_t r = filter_clamp(
+          yt.start(y) + static_cast<std::ptrdiff_t>(k), in.height());
+        scratch.src[k] = mid + (r - r0)*tw;
+      }
+      S* const o = (ops == 1 ? out.at(x0, y, c) : scratch.row.data() + c*tw);
+      kernel(scratch.src.data(), yt.weights(y), yn, o, tw);
+    }
+    if (ops != 1) {
+      S* const o = out.at(x0, y);
+      const std::size_t cs = out.channel_stride();
+      for (std::size_t j = 0; j < tw; ++j) {
+        for (std::size_t c = 0; c < N; ++c) {
+          o[j*ops + c*cs] = scratch.row[c*tw + j];
+        }
+      }
+    }
+  }
+}
+
+} // Namespace: detail.
+
+//------------------------------------------------------------------------------
+
+//! Filter in into out with x_taps along rows and y_taps along columns. Throws
+//! std::invalid_argument if the taps do not map the size of in to the size of
+//! out. See above.
+template<std::size_t N, typename S>
+void
+convolve_separable(image_view<N,S const> const& in,
+                   image_view<N,S> const& out,
+                   filter_taps<S> const& x_taps,
+                   filter_taps<S> const& y_taps,
+                   thread_pool& pool = default_thread_pool()) {
+  static_assert(std::is_floating_point<S>::value,
+                "Filtered images must have floating point channels");
+  if (x_taps.in_size() != in.width() || x_taps.out_size() != out.width() ||
+      y_taps.in_size() != in.height() || y_taps.out_size() != out.height()) {
+    throw std::invalid_argument("filter taps do not match the images");
+  }
+  if (out.empty() || in.empty() || x_taps.size() == 0 || y_taps.size() == 0) {
+    return;
+  }
+
+  // Tile height such that the filtered input rows of a tile fit in cache.
+  const std::size_t tw = (std::min)(detail::filter_tile_width, out.width());
+  const std::size_t budget =
+    (std::max)(detail::filter_cache/(N*tw*sizeof(S)), 2*y_taps.size());
+  const double y_scale =
+    (std::max)(1.0, static_cast<double>(in.height())/out.height());
+  const std::size_t th = (std::min)(out.height(), (std::max)(std::size_t(1),
+    static_cast<std::size_t>((budget - y_taps.size())/y_scale)));
+  const std::size_t nx = (out.width() + tw - 1)/tw;
+  const std::size_t ny = (out.height() + th - 1)/th;
+
+  const typename detail::filter_kernel<S>::type kernel =
+    detail::filter_select_kernel(S(0));
+  parallel_for(0, nx*ny, 1, [&](std::size_t const t0, std::size_t const t1) {
+    detail::filter_scratch<S> scratch;
+    for (std::size_t t = t0; t < t1; ++t) {
+      const std::size_t x0 = (t % nx)*tw;
+      const std::size_t y0 = (t/nx)*th;
+      const std::size_t x1 = (std::min)(x0 + tw, out.width());
+      const std::size_t y1 = (std::min)(y0 + th, out.height());
+      detail::filter_tile(in, out, x_taps, y_taps, kernel,
+                          x0, x1, y0, y1, scratch);
+    }
+  }, pool);
+}
+
+//! Mutable input, e.g. an image<N,S>.
+template<std::size_t N, typename S>
+void
+convolve_separable(image_view<N,S> const& in,
+                   image_view<N,S> const& out,
+                   filter_taps<S> const& x_taps,
+                   filter_taps<S> const& y_taps,
+                   thread_pool& pool = default_thread_pool()) {
+  convolve_separable(image_view<N,S const>(in), out, x_taps, y_taps, pool);
+}
+
+//! Blur in into out, of the same size, with compact_gaussian. sigma is in
+//! pixels.
+template<std::size_t N, typename S>
+void
+gaussian_blur(image_view<N,S const> const& in,
+              image_view<N,S> const& out,
+              S const sigma,
+              thread_pool& pool = default_thread_pool()) {
+  convolve_separable(in, out,
+                     compact_gaussian_taps(in.width(), out.width(), sigma),
+                     compact_gaussian_taps(in.height(), out.height(), sigma),
+                     pool);
+}
+
+//! Mutable input, e.g. an image<N,S>.
+template<std::size_t N, typename S>
+void
+gaussian_blur(image_view<N,S> const& in,
+              image_view<N,S> const& out,
+              S const sigma,
+              thread_pool& pool = default_thread_pool()) {
+  gaussian_blur(image_view<N,S const>(in), out, sigma, pool);
+}
+
+//! Resample in to the size of out with compact_gaussian. sigma is in output
+//! pixels, the default is a good compromise between aliasing and blur.
+template<std::size_t N, typename S>
+void
+resample(image_view<N,S const> const& in,
+         image_view<N,S> const& out,
+         S const sigma = S(0.5),
+         thread_pool& pool = default_thread_pool()) {
+  convolve_separable(in, out,
+                     compact_gaussian_taps(in.width(), out.width(), sigma),
+                     compact_gaussian_taps(in.height(), out.height(), sigma),
+                     pool);
+}
+
+//! Mutable input, e.g. an image<N,S>.
+template<std::size_t N, typename S>
+void
+resample(image_view<N,S> const& in,
+         image_view<N,S> const& out,
+         S const sigma = S(0.5),
+         thread_pool& pool = default_thread_pool()) {
+  resample(image_view<N,S const>(in), out, sigma, pool);
+}
+
+END_THX_NAMESPACE
+
+#endif // THX_IMAGE_FILTER_HPP_INCLUDED
@@ -15,7 +15,7 @@
 namespace std {
 
 //! Binary operator: std::ostream << mat<N,S>
-template<thx::int64 N, typename S>
+template<std::size_t N, typename S>
 ostream&
 operator<<(ostream &os, const thx::mat<N,S> &rhs)
 {
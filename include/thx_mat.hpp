@@ -27,7 +27,7 @@ BEGIN_THX_NAMESPACE
 //
 // constexpr mat<N,S> identity() (specializations only)
 //
-// Default constexpr (specializations only) CTOR (set to identity by default)
+// Default constexpr CTOR (set to identity by default)
 // Array constexpr CTOR (specializations only)
 // Value constexpr CTOR (specializations only)
 // (All mat's have default DTOR)
@@ -67,8 +67,9 @@ public:
 
 public: // CTOR's
   //! Default CTOR.
-  explicit
-  mat(const S x = 1) {
+  explicit THX_CONST_EXPR
+  mat(const S x = 1)
+    : _v() {
     for (size_type i = 0; i < dim; ++i) {
       for (size_type j = 0; j < dim; ++j) {
         _v[i + N*j] = ((i == j) ? x : 0); // Set diagonal to value.
@@ -78,7 +79,7 @@ public: // CTOR's
 
 public: // Operators.
   //! DOCS
-  mat<N,S>& 
+  THX_CONST_EXPR mat<N,S>&
   operator+=(mat<dim, value_type> const& b) {
     for (size_type i = 0; i < linear_size; ++i) {
       _v[i] += b[i];
@@ -87,7 +88,7 @@ public: // Operators.
   }
 
   //! DOCS
-  mat<N,S>& 
+  THX_CONST_EXPR mat<N,S>&
   operator-=(mat<dim, value_type> const& b) {
     for (size_type i = 0; i < linear_size; ++i) {
       _v[i] -= b[i];
@@ -96,7 +97,7 @@ public: // Operators.
   }
 
   //! DOCS
-  mat<N,S>& 
+  THX_CONST_EXPR mat<N,S>&
   operator*=(value_type const x) {
     for (size_type i = 0; i < linear_size; ++i) {
       _v[i] *= x;
@@ -105,7 +106,7 @@ public: // Operators.
   }
 
   //! Matrix multiplication.
-  mat<N,S>& 
+  THX_CONST_EXPR mat<N,S>&
   operator*=(const mat<N,S> &b)
   {	
       const mat<N,S> a(*this);  // Copy.
@@ -123,34 +124,34 @@ public: // Operators.
 public:     // Access operators.
 
     //! Return element at row 'i' and column 'j'. No bounds checking!
-    S
+    THX_CONST_EXPR S
     operator()(const int64 i, const int64 j) const
     { return _v[i + dim*j]; }
 
     //! Return element at row 'i' and column 'j'. No bounds checking!
-    S&
+    THX_CONST_EXPR S&
     operator()(const int64 i, const int64 j)
     { return _v[i + dim*j]; }
 
     //! Return i'th element. No bounds checking!
-    S
+    THX_CONST_EXPR S
     operator[](const int64 i) const
     { return _v[i]; }
 
     //! Return i'th element. No bounds checking!
-    S&
+    THX_CONST_EXPR S&
     operator[](const int64 i)
     { return _v[i]; }
 
 public:		// Data.
 
     //! Const data.
-    const S* 
+    THX_CONST_EXPR const S*
     const_data() const
     { return &_v[0]; }
 
     //! Mutable data.
-    S* 
+    THX_CONST_EXPR S*
     data()
     { return &_v[0]; }
 
@@ -170,7 +171,8 @@ class mat<2,S>
 {
 private:
 
-    static_assert(std::is_arithmetic<S>::value, 
+    static_assert(std::is_arithmetic<
+                    typename arithmetic_type<S>::compute>::value, 
                   "Scalar type must be arithmetic");
 
 public:
@@ -180,66 +182,39 @@ public:
     static const int64 dim = 2;
     static const int64 linear_size = dim*dim;
 
-#if 0 // C++11
-    //! Return matrix dimension.
-    static constexpr int64
-    dim()
-    { return 2; }
-
-    //! Return matrix dimension.
-    static constexpr int64
-    linear_size()
-    { return dim()*dim(); }
-
     //! Return identity matrix.
-    static constexpr mat<2,S>
+    static THX_CONST_EXPR mat<2,S>
     identity()
     { return mat<2,S>(1); }
-#endif
 
 public:
 
     //! Default CTOR.
     explicit THX_CONST_EXPR 
     mat(const S v = 1)
-#if 0 // C++11
         : _v{v, 0, // Col 0.
              0, v} // Col 1.
-#endif
-    {
-        _v[0] = v; _v[2] = 0;
-        _v[1] = 0; _v[3] = 0;
-    }
+    {}
 
     //! Array CTOR - column-major.
     explicit THX_CONST_EXPR
     mat(const S v[4])
-#if 0 // C++11
         : _v{v[0], v[1], // Col 0.
              v[2], v[3]} // Col 1.
-#endif
-    {
-        _v[0] = v[0]; _v[2] = v[2];
-        _v[1] = v[1]; _v[3] = v[3];
-    }		
+    {}
 
     //! Value CTOR - column-major.
     explicit THX_CONST_EXPR
     mat(const S v0, const S v2,
         const S v1, const S v3)
-#if 0 // C++11
         : _v{v0, v1, // Col 0.
              v2, v3} // Col 1.
-#endif
-    {
-        _v[0] = v0; _v[2] = v2;
-        _v[1] = v1; _v[3] = v3;
-    }
+    {}
 
 public:		// Operators.
 
     //! DOCS
-    mat<2,S>& 
+    THX_CONST_EXPR mat<2,S>&
     operator+=(const mat<2,S> &b)
     {
         _v[0] += b._v[0]; _v[2] += b._v[2];
@@ -248,7 +223,7 @@ public:		// Operators.
     }
 
     //! DOCS
-    mat<2,S>& 
+    THX_CONST_EXPR mat<2,S>&
     operator-=(const mat<2,S> &b)
     {
         _v[0] -= b._v[0]; _v[2] -= b._v[2];
@@ -257,7 +232,7 @@ public:		// Operators.
     }
 
     //! DOCS
-    mat<2,S>& 
+    THX_CONST_EXPR mat<2,S>&
     operator*=(const S s)
     {
         _v[0] *= s; _v[2] *= s;
@@ -266,7 +241,7 @@ public:		// Operators.
     }
 
     //! Matrix multiplication.
-    mat<2,S>& 
+    THX_CONST_EXPR mat<2,S>&
     operator*=(const mat<2,S> &b)
     {	
         const mat<2,S> a(*this);
@@ -280,34 +255,34 @@ public:		// Operators.
 public:     // Access operators.
 
     //! Return element at row 'i' and column 'j'. No bounds checking!
-    S
+    THX_CONST_EXPR S
     operator()(const int64 i, const int64 j) const
     { return _v[i + dim*j]; }
 
     //! Return element at row 'i' and column 'j'. No bounds checking!
-    S&
+    THX_CONST_EXPR S&
     operator()(const int64 i, const int64 j)
     { return _v[i + dim*j]; }
 
     //! Return i'th element. No bounds checking!
-    S
+    THX_CONST_EXPR S
     operator[](const int64 i) const
     { return _v[i]; }
 
     //! Return i'th element. No bounds checking!
-    S&
+    THX_CONST_EXPR S&
     operator[](const int64 i)
     { return _v[i]; }
 
 public:		// Data.
 
     //! Const data.
-    const S* 
+    THX_CONST_EXPR const S*
     const_data() const
     { return &_v[0]; }
 
     //! Mutable data.
-    S* 
+    THX_CONST_EXPR S*
     data()
     { return &_v[0]; }
 
@@ -327,7 +302,8 @@ class mat<3,S>
 {
 private:
 
-    static_assert(std::is_arithmetic<S>::value, 
+    static_assert(std::is_arithmetic<
+                    typename arithmetic_type<S>::compute>::value, 
                   "Scalar type must be arithmetic");
 
 public:
@@ -337,73 +313,43 @@ public:
     static const int64 dim = 3;
     static const int64 linear_size = dim*dim;
 
-#if 0 // C++11
-    //! Return matrix dimension.
-    static constexpr int64
-    dim()
-    { return 3; }
-
-    //! Return matrix dimension.
-    static constexpr int64
-    linear_size()
-    { return dim()*dim(); }
-
     //! Return identity matrix.
-    static constexpr mat<3,S>
+    static THX_CONST_EXPR mat<3,S>
     identity()
     { return mat<3,S>(1); }
-#endif // C++11
 
 public:
 
     //! Default CTOR.
     explicit THX_CONST_EXPR 
     mat(const S v = 1)
-#if 0
         : _v{v, 0, 0, // Col 0.
              0, v, 0, // Col 1.
              0, 0, v} // Col 2.
-#endif
-    {
-        _v[0] = v; _v[3] = 0; _v[6] = 0;
-        _v[1] = 0; _v[4] = v; _v[7] = 0;
-        _v[2] = 0; _v[5] = 0; _v[8] = v;
-    }
+    {}
 
     //! Array CTOR - column-major.
     explicit THX_CONST_EXPR 
     mat(const S v[9])
-#if 0
         : _v{v[0], v[1], v[2], // Col 0.
              v[3], v[4], v[5], // Col 1.
              v[6], v[7], v[8]} // Col 2.
-#endif
-    {
-        _v[0] = v[0]; _v[3] = v[3]; _v[6] = v[6];
-        _v[1] = v[1]; _v[4] = v[4]; _v[7] = v[7];
-        _v[2] = v[2]; _v[5] = v[5]; _v[8] = v[8];
-    }
+    {}
 
     //! Value CTOR - column-major.
     explicit THX_CONST_EXPR 
     mat(const S v0, const S v3, const S v6,
         const S v1, const S v4, const S v7,
         const S v2, const S v5, const S v8)
-#if 0
         : _v{v0, v1, v2, // Col 0.
              v3, v4, v5, // Col 1.
              v6, v7, v8} // Col 2.
-#endif
-    {
-        _v[0] = v0; _v[3] = v3; _v[6] = v6;
-        _v[1] = v1; _v[4] = v4; _v[7] = v7;
-        _v[2] = v2; _v[5] = v5; _v[8] = v8;
-    }
+    {}
 
 public:		// Operators.
 
     //! DOCS
-    mat<3,S>& 
+    THX_CONST_EXPR mat<3,S>&
     operator+=(const mat<3,S> &b)
     {
         _v[0] += b._v[0]; _v[3] += b._v[3]; _v[6] += b._v[6];
@@ -413,7 +359,7 @@ public:		// Operators.
     }
 
     //! DOCS
-    mat<3,S>& 
+    THX_CONST_EXPR mat<3,S>&
     operator-=(const mat<3,S> &b)
     {
         _v[0] -= b._v[0]; _v[3] -= b._v[3]; _v[6] -= b._v[6];
@@ -423,7 +369,7 @@ public:		// Operators.
     }
 
     //! DOCS
-    mat<3,S>& 
+    THX_CONST_EXPR mat<3,S>&
     operator*=(const S s)
     {
         _v[0] *= s; _v[3] *= s; _v[6] *= s;
@@ -433,7 +379,7 @@ public:		// Operators.
     }
 
     //! Matrix multiplication.
-    mat<3,S>& 
+    THX_CONST_EXPR mat<3,S>&
     operator*=(const mat<3,S> &b)
     {	
         const mat<3,S> a(*this);    // Copy.
@@ -452,34 +398,34 @@ public:		// Operators.
 public:     // Access operators.
 
     //! Return element at row 'i' and column 'j'. No bounds checking!
-    S
+    THX_CONST_EXPR S
     operator()(const int64 i, const int64 j) const
     { return _v[i + dim*j]; }
 
     //! Return element at row 'i' and column 'j'. No bounds checking!
-    S&
+    THX_CONST_EXPR S&
     operator()(const int64 i, const int64 j)
     { return _v[i + dim*j]; }
 
     //! Return i'th element. No bounds checking!
-    S
+    THX_CONST_EXPR S
     operator[](const int64 i) const
     { return _v[i]; }
 
     //! Return i'th element. No bounds checking!
-    S&	
+    THX_CONST_EXPR S&
     operator[](const int64 i)
     { return _v[i]; }
 
 public:		// Data.
 
     //! Const data.
-    const S* 
+    THX_CONST_EXPR const S*
     const_data() const
     { return &_v[0]; }
 
     //! Mutable data.
-    S* 
+    THX_CONST_EXPR S*
     data()
     { return &_v[0]; }
 
@@ -499,7 +445,8 @@ class mat<4,S>
 {
 private:
 
-    static_assert(std::is_arithmetic<S>::value, 
+    static_assert(std::is_arithmetic<
+                    typename arithmetic_type<S>::compute>::value, 
                   "Scalar type must be arithmetic");
 
 public:
@@ -509,56 +456,30 @@ public:
     static const int64 dim = 4;
     static const int64 linear_size = dim*dim;
 
-#if 0
-    //! Return matrix dimension.
-    static constexpr int64
-    dim()
-    { return 4; }
-
-    //! Return matrix dimension.
-    static constexpr int64
-    linear_size()
-    { return dim()*dim(); }
-
     //! Return identity matrix.
-    static constexpr mat<4,S>
+    static THX_CONST_EXPR mat<4,S>
     identity()
     { return mat<4,S>(1); }
-#endif
 
 public:
 
     //! Default CTOR.
     explicit THX_CONST_EXPR 
     mat(const S v = 1)
-#if 0
         : _v{v, 0, 0, 0, // Col 0.
              0, v, 0, 0, // Col 1.
              0, 0, v, 0, // Col 2.
              0, 0, 0, v} // Col 3.
-#endif
-    {
-        _v[0] = v; _v[4] = 0; _v[8]  = 0; _v[12] = 0;
-        _v[1] = 0; _v[5] = v; _v[9]  = 0; _v[13] = 0;
-        _v[2] = 0; _v[6] = 0; _v[10] = v; _v[14] = 0;
-        _v[3] = 0; _v[7] = 0; _v[11] = 0; _v[15] = v;
-    }
+    {}
 
     //! Array CTOR - column major.
     explicit THX_CONST_EXPR 
     mat(const S v[16])
-#if 0
         : _v{v[0],  v[1],  v[2],  v[3],  // Col 0.
              v[4],  v[5],  v[6],  v[7],  // Col 1.
              v[8],  v[9],  v[10], v[11], // Col 2.
              v[12], v[13], v[14], v[15]} // Col 3.
-#endif
-    {
-        _v[0] = v[0]; _v[4] = v[4]; _v[8]  = v[8];  _v[12] = v[12];
-        _v[1] = v[1]; _v[5] = v[5]; _v[9]  = v[9];  _v[13] = v[13];
-        _v[2] = v[2]; _v[6] = v[6]; _v[10] = v[10]; _v[14] = v[14];
-        _v[3] = v[3]; _v[7] = v[7]; _v[11] = v[11]; _v[15] = v[15];
-    }
+    {}
 
     //! Value CTOR - column major.
     explicit THX_CONST_EXPR 
@@ -566,38 +487,24 @@ public:
         const S v1, const S v5, const S v9,  const S v13,
         const S v2, const S v6, const S v10, const S v14,
         const S v3, const S v7, const S v11, const S v15)
-#if 0
         : _v{v0,  v1,  v2,  v3,  // Col 0.
              v4,  v5,  v6,  v7,  // Col 1.
              v8,  v9,  v10, v11, // Col 2.
              v12, v13, v14, v15} // Col 3.
-#endif
-    {
-      _v[0] = v0; _v[4] = v4; _v[8]  = v8;  _v[12] = v12;
-      _v[1] = v1; _v[5] = v5; _v[9]  = v9;  _v[13] = v13;
-      _v[2] = v2; _v[6] = v6; _v[10] = v10; _v[14] = v14;
-      _v[3] = v3; _v[7] = v7; _v[11] = v11; _v[15] = v15;
-    }
+    {}
 
     explicit THX_CONST_EXPR
     mat(const mat<3,S>& b)    
-#if 0
       : _v{b[0],  b[1],  b[2], 0, // Col 0.
            b[3],  b[4],  b[5], 0, // Col 1.
            b[6],  b[7],  b[8], 0, // Col 2.
            0,     0,     0,    1} // Col 3.
-#endif
-    {
-      _v[0] = b[0]; _v[4] = b[3]; _v[8]  = b[6]; _v[12] = 0;  
-      _v[1] = b[1]; _v[5] = b[4]; _v[9]  = b[7]; _v[13] = 0;
-      _v[2] = b[2]; _v[6] = b[5]; _v[10] = b[8]; _v[14] = 0;
-      _v[3] = 0;    _v[7] = 0;    _v[11] = 0;    _v[15] = 1;
-    }
+    {}
 
 public:		// Operators.
 
     //! DOCS
-    mat<4,S>& 
+    THX_CONST_EXPR mat<4,S>&
     operator+=(const mat<4,S> &b)
     {
         _v[0]+=b._v[0]; _v[4]+=b._v[4]; _v[8] +=b._v[8];  _v[12]+=b._v[12];
@@ -608,7 +515,7 @@ public:		// Operators.
     }
 
     //! DOCS
-    mat<4,S>& 
+    THX_CONST_EXPR mat<4,S>&
     operator-=(const mat<4,S> &b)
     {
         _v[0]-=b._v[0]; _v[4]-=b._v[4]; _v[8] -=b._v[8];  _v[12]-=b._v[12];
@@ -619,7 +526,7 @@ public:		// Operators.
     }
 
     //! DOCS
-    mat<4,S>& 
+    THX_CONST_EXPR mat<4,S>&
     operator*=(const S s)
     {
         _v[0] *= s; _v[4] *= s; _v[8]  *= s; _v[12] *= s;
@@ -630,7 +537,7 @@ public:		// Operators.
     }
 
     //! Matrix multiplication.
-    mat<4,S>&
+    THX_CONST_EXPR mat<4,S>&
     operator*=(const mat<4,S> &b)
     {	
         const mat<4,S> a(*this);    // Copy.
@@ -656,34 +563,34 @@ public:		// Operators.
 public:     // Access operators.
 
     //! Return element at row 'i' and column 'j'. No bounds checking!
-    S
+    THX_CONST_EXPR S
     operator()(const int64 i, const int64 j) const
     { return _v[i + dim*j]; }
 
     //! Return element at row 'i' and column 'j'. No bounds checking!
-    S&
+    THX_CONST_EXPR S&
     operator()(const int64 i, const int64 j)
     { return _v[i + dim*j]; }
 
     //! Return i'th element. No bounds checking!
-    S
+    THX_CONST_EXPR S
     operator[](const int64 i) const
     { return _v[i]; }
 
     //! Return i'th element. No bounds checking!
-    S&	
+    THX_CONST_EXPR S&
     operator[](const int64 i)
     { return _v[i]; }
 
 public:		// Data.
 
     //! Const data.
-    const S* 
+    THX_CONST_EXPR const S*
     const_data() const
     { return &_v[0]; }
 
     //! Mutable data.
-    S* 
+    THX_CONST_EXPR S*
     data()
     { return &_v[0]; }
 
@@ -736,7 +643,7 @@ END_THX_NAMESPACE
 BEGIN_STD_NAMESPACE
 
 //! Binary operator: std::ostream << mat<N,S>
-template<thx::int64 N, typename S>
+template<std::size_t N, typename S>
 ostream&
 operator<<(ostream &os, const thx::mat<N,S> &rhs)
 {
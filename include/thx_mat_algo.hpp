@@ -12,7 +12,11 @@
 #include "thx_mat.hpp"
 #include "thx_vec.hpp"
 #include "thx_scalar_traits.hpp"
+#include "thx_fast_scalar_traits.hpp"
+#include "thx_scalar_algo.hpp"
+#include "thx_simd.hpp"
 #include <cassert>
+#include <limits>
 
 //------------------------------------------------------------------------------
 
@@ -30,7 +34,7 @@ equal_dispatch()
 } // Namespace: detail.
 
 //! DOCS
-template<int64 N, typename S>
+template<std::size_t N, typename S>
 bool
 equal(const mat<N,S> &a, const mat<N,S> &b)
 {
@@ -45,13 +49,54 @@ equal(const mat<N,S> &a, const mat<N,S> &b)
 
 //------------------------------------------------------------------------------
 
+//! mat<N,S> equal comparison, element-wise like vec_equal.
+template<std::size_t N, typename S>
+bool
+mat_equal(const mat<N,S> &a, const mat<N,S> &b)
+{
+  bool t = equal(a[0], b[0]);
+  int64 i = 1;
+  while (i < mat<N,S>::linear_size && t) {
+    t = (t && equal(a[i], b[i]));
+    ++i;
+  }
+  return t;
+}
+
+//------------------------------------------------------------------------------
+
+//! mat<N,S> not equal comparison.
+template<std::size_t N, typename S>
+bool
+mat_not_equal(const mat<N,S> &a, const mat<N,S> &b)
+{
+  return !mat_equal(a, b);
+}
+
+//------------------------------------------------------------------------------
+
 namespace detail {
 
+//! Sine and cosine for the rotation matrices. The C library cannot be called
+//! in constant expressions, a series expansion is used there instead.
+template<typename S> inline THX_CONST_EXPR
+void
+rotation_sincos(const S rad, S& s, S& c) {
+  if (THX_CONSTANT_EVALUATED()) {
+    s = static_cast<S>(series_sin(static_cast<float64>(rad)));
+    c = static_cast<S>(series_cos(static_cast<float64>(rad)));
+  }
+  else {
+    scalar_traits<S>::sincos(rad, s, c);
+  }
+}
+
 template<typename S> inline THX_CONST_EXPR
 mat<3,S>
 rotation_x_dispatch(const S rad, real_scalar_tag) {
-  const S cr = cos(rad);
-  const S sr = sin(rad);
+  S sr = 0;
+  S cr = 0;
+  rotation_sincos(rad, sr, cr);
   return mat<3,S>(
     1,  0,  0,
     0,  cr, sr,
@@ -61,8 +106,9 @@ rotation_x_dispatch(const S rad, real_scalar_tag) {
 template<typename S> inline THX_CONST_EXPR
 mat<3,S>
 rotation_y_dispatch(const S rad, real_scalar_tag) {
-  const S cr = cos(rad);
-  const S sr = sin(rad);
+  S sr = 0;
+  S cr = 0;
+  rotation_sincos(rad, sr, cr);
   return mat<3,S>(
     cr, 0, -sr,
     0,  1,  0,
@@ -72,8 +118,9 @@ rotation_y_dispatch(const S rad, real_scalar_tag) {
 template<typename S> inline THX_CONST_EXPR
 mat<3,S>
 rotation_z_dispatch(const S rad, real_scalar_tag) {
-  const S cr = cos(rad);
-  const S sr = sin(rad);
+  S sr = 0;
+  S cr = 0;
+  rotation_sincos(rad, sr, cr);
   return mat<3,S>(
     cr,  sr, 0,
     -sr, cr, 0,
@@ -103,6 +150,60 @@ rotation_z(const S rad) {
   return detail::rotation_z_dispatch(rad, category());
 }
 
+//! Rotation matrices with a precision policy. precise_math_tag is the same as
+//! no policy, fast_math_tag uses fast_scalar_traits<S> sine and cosine, about
+//! 1.8e-7 absolute error for |rad| <= 8192. Not constant expressions.
+template<typename S> inline
+mat<3,S>
+rotation_x(const S rad, precise_math_tag) {
+  return rotation_x(rad);
+}
+
+template<typename S> inline
+mat<3,S>
+rotation_y(const S rad, precise_math_tag) {
+  return rotation_y(rad);
+}
+
+template<typename S> inline
+mat<3,S>
+rotation_z(const S rad, precise_math_tag) {
+  return rotation_z(rad);
+}
+
+template<typename S> inline
+mat<3,S>
+rotation_x(const S rad, fast_math_tag) {
+  S sr, cr;
+  fast_scalar_traits<S>::sincos(rad, sr, cr);
+  return mat<3,S>(
+    1,  0,  0,
+    0,  cr, sr,
+    0, -sr, cr);
+}
+
+template<typename S> inline
+mat<3,S>
+rotation_y(const S rad, fast_math_tag) {
+  S sr, cr;
+  fast_scalar_traits<S>::sincos(rad, sr, cr);
+  return mat<3,S>(
+    cr, 0, -sr,
+    0,  1,  0,
+    sr, 0,  cr);
+}
+
+template<typename S> inline
+mat<3,S>
+rotation_z(const S rad, fast_math_tag) {
+  S sr, cr;
+  fast_scalar_traits<S>::sincos(rad, sr, cr);
+  return mat<3,S>(
+    cr,  sr, 0,
+    -sr, cr, 0,
+    0,   0,  1);
+}
+
 //------------------------------------------------------------------------------
 
 //! 2D translation matrix.
@@ -212,7 +313,7 @@ persp_projection(const S l,
 //------------------------------------------------------------------------------
 
 //! DOCS
-template<int64 N, typename S>
+template<std::size_t N, typename S>
 bool
 not_equal(const mat<N,S> &a, const mat<N,S> &b)
 {
@@ -228,7 +329,7 @@ not_equal(const mat<N,S> &a, const mat<N,S> &b)
 //------------------------------------------------------------------------------
 
 //! DOCS
-template<int64 N, typename S>
+template<std::size_t N, typename S> inline THX_CONST_EXPR
 mat<N,S>
 add(const mat<N,S> &a, const mat<N,S> &b)
 { 
@@ -236,8 +337,8 @@ add(const mat<N,S> &a, const mat<N,S> &b)
 }
 
 //! DOCS
-template<typename S> 
-mat<2,S> 
+template<typename S> inline THX_CONST_EXPR
+mat<2,S>
 add(const mat<2,S> &a, const mat<2,S> &b)
 {
   return mat<2,S>(
@@ -246,8 +347,8 @@ add(const mat<2,S> &a, const mat<2,S> &b)
 }
 
 //! DOCS
-template<typename S>
-mat<3,S> 
+template<typename S> inline THX_CONST_EXPR
+mat<3,S>
 add(const mat<3,S> &a, const mat<3,S> &b)
 {
   return mat<3,S>(
@@ -257,8 +358,8 @@ add(const mat<3,S> &a, const mat<3,S> &b)
 }
 
 //! DOCS
-template<typename S>
-mat<4,S> 
+template<typename S> inline THX_CONST_EXPR
+mat<4,S>
 add(const mat<4,S> &a, const mat<4,S> &b)
 {
   return mat<4,S>(
@@ -271,7 +372,7 @@ add(const mat<4,S> &a, const mat<4,S> &b)
 //------------------------------------------------------------------------------
 
 //! DOCS
-template<int64 N, typename S>
+template<std::size_t N, typename S> inline THX_CONST_EXPR
 mat<N,S>
 subtract(const mat<N,S> &a, const mat<N,S> &b)
 { 
@@ -279,8 +380,8 @@ subtract(const mat<N,S> &a, const mat<N,S> &b)
 }
 
 //! DOCS
-template<typename S> 
-mat<2,S> 
+template<typename S> inline THX_CONST_EXPR
+mat<2,S>
 subtract(const mat<2,S> &a, const mat<2,S> &b)
 {
   return mat<2,S>(
@@ -289,8 +390,8 @@ subtract(const mat<2,S> &a, const mat<2,S> &b)
 }
 
 //! DOCS
-template<typename S>
-mat<3,S> 
+template<typename S> inline THX_CONST_EXPR
+mat<3,S>
 subtract(const mat<3,S> &a, const mat<3,S> &b)
 {
   return mat<3,S>(
@@ -300,8 +401,8 @@ subtract(const mat<3,S> &a, const mat<3,S> &b)
 }
 
 //! DOCS
-template<typename S>
-mat<4,S> 
+template<typename S> inline THX_CONST_EXPR
+mat<4,S>
 subtract(const mat<4,S> &a, const mat<4,S> &b)
 {
   return mat<4,S>(
@@ -314,7 +415,7 @@ subtract(const mat<4,S> &a, const mat<4,S> &b)
 //------------------------------------------------------------------------------
 
 //! DOCS
-template<int64 N, typename S>
+template<std::size_t N, typename S> inline THX_CONST_EXPR
 mat<N,S>
 mult(const S s, const mat<N,S> &a)
 { 
@@ -323,8 +424,8 @@ mult(const S s, const mat<N,S> &a)
 
 
 //! DOCS
-template<typename S>
-mat<2,S> 
+template<typename S> inline THX_CONST_EXPR
+mat<2,S>
 mult(const S s, const mat<2,S> &a)
 {
   return mat<2,S>(
@@ -350,7 +451,7 @@ template<typename S>
 mat<4,S> 
 elementwiseMult(const S s, const mat<4,S> &a)
 {
-  return mat<4,4,S>(
+  return mat<4,S>(
     s*a[0], s*a[4], s*a[8],  s*a[12], 
     s*a[1], s*a[5], s*a[9],  s*a[13], 
     s*a[2], s*a[6], s*a[10], s*a[14], 
@@ -360,7 +461,7 @@ elementwiseMult(const S s, const mat<4,S> &a)
 //------------------------------------------------------------------------------
 
 //! Matrix multiplication.
-template<int64 N, typename S>
+template<std::size_t N, typename S> inline THX_CONST_EXPR
 mat<N,S>
 mult(const mat<N,S> &a, const mat<N,S> &b)
 { 
@@ -368,8 +469,8 @@ mult(const mat<N,S> &a, const mat<N,S> &b)
 }
 
 //! Matrix multiplication.
-template<typename S>
-mat<2,S> 
+template<typename S> inline THX_CONST_EXPR
+mat<2,S>
 mult(const mat<2,S> &a, const mat<2,S> &b)
 { 
   return mat<2,S>(
@@ -380,8 +481,8 @@ mult(const mat<2,S> &a, const mat<2,S> &b)
 }
 
 //! Matrix multiplication.
-template<typename S>
-mat<3,S> 
+template<typename S> inline THX_CONST_EXPR
+mat<3,S>
 mult(const mat<3,S> &a, const mat<3,S> &b)
 { 
   return mat<3,S>(
@@ -397,8 +498,8 @@ mult(const mat<3,S> &a, const mat<3,S> &b)
 }
 
 //! Matrix multiplication.
-template<typename S>
-mat<4,S> 
+template<typename S> inline THX_CONST_EXPR
+mat<4,S>
 mult(const mat<4,S> &a, const mat<4,S> &b)
 { 
   return mat<4,S>(
@@ -420,18 +521,214 @@ mult(const mat<4,S> &a, const mat<4,S> &b)
     a(3,0)*b(0,3)+a(3,1)*b(1,3)+a(3,2)*b(2,3)+a(3,3)*b(3,3)); // v15
 }
 
+#if defined(THX_SSE2)
+
+// SIMD specializations of mat<4,S> multiplication.
+// -------------------------------------------------
+//
+// Column j of the product is a linear combination of the columns of a, 
+// weighted by the elements of column j in b. Since storage is column-major the 
+// columns of a are loaded directly into registers. The products are summed in 
+// the same order as in the scalar version above, so results are bit-identical
+// to the scalar path as long as neither path is contracted into fused 
+// multiply-add instructions (e.g. by -ffp-contract=fast or /fp:fast). In that 
+// case the two paths may differ by up to 2 ulp per element.
+//
+// The scalar path is still available by explicitly providing the template 
+// argument, e.g. mult<float32>(a, b). It is also used when the product is 
+// evaluated in a constant expression, if the compiler supports 
+// THX_CONSTANT_EVALUATED() (see thx_define.hpp).
+
+namespace detail {
+
+//! Column of a*b, where a0..a3 are the columns of a and bj points to a column 
+//! of b.
+inline
+__m128
+mult4_col_sse(__m128 const a0, 
+              __m128 const a1, 
+              __m128 const a2, 
+              __m128 const a3, 
+              float32 const* const bj) {
+  __m128 c = _mm_mul_ps(a0, _mm_set1_ps(bj[0]));
+  c = _mm_add_ps(c, _mm_mul_ps(a1, _mm_set1_ps(bj[1])));
+  c = _mm_add_ps(c, _mm_mul_ps(a2, _mm_set1_ps(bj[2])));
+  c = _mm_add_ps(c, _mm_mul_ps(a3, _mm_set1_ps(bj[3])));
+  return c;
+}
+
+#if defined(THX_AVX)
+
+//! Column of a*b, where a0..a3 are the columns of a and bj points to a column 
+//! of b.
+inline
+__m256d
+mult4_col_avx(__m256d const a0, 
+              __m256d const a1, 
+              __m256d const a2, 
+              __m256d const a3, 
+              float64 const* const bj) {
+  __m256d c = _mm256_mul_pd(a0, _mm256_set1_pd(bj[0]));
+  c = _mm256_add_pd(c, _mm256_mul_pd(a1, _mm256_set1_pd(bj[1])));
+  c = _mm256_add_pd(c, _mm256_mul_pd(a2, _mm256_set1_pd(bj[2])));
+  c = _mm256_add_pd(c, _mm256_mul_pd(a3, _mm256_set1_pd(bj[3])));
+  return c;
+}
+
+#else
+
+//! Half column (two rows) of a*b, where a0..a3 are the matching halves of the 
+//! columns of a and bj points to a column of b.
+inline
+__m128d
+mult4_col_sse(__m128d const a0, 
+              __m128d const a1, 
+              __m128d const a2, 
+              __m128d const a3, 
+              float64 const* const bj) {
+  __m128d c = _mm_mul_pd(a0, _mm_set1_pd(bj[0]));
+  c = _mm_add_pd(c, _mm_mul_pd(a1, _mm_set1_pd(bj[1])));
+  c = _mm_add_pd(c, _mm_mul_pd(a2, _mm_set1_pd(bj[2])));
+  c = _mm_add_pd(c, _mm_mul_pd(a3, _mm_set1_pd(bj[3])));
+  return c;
+}
+
+#endif // THX_AVX
+
+//! Load/store helpers, aligned if Aligned is true and unaligned otherwise.
+template<bool Aligned> inline
+__m128
+mult4_load_ps(float32 const* const p) {
+  return Aligned ? _mm_load_ps(p) : _mm_loadu_ps(p);
+}
+
+template<bool Aligned> inline
+void
+mult4_store_ps(float32* const p, __m128 const a) {
+  if (Aligned) { _mm_store_ps(p, a); } else { _mm_storeu_ps(p, a); }
+}
+
+template<bool Aligned> inline
+__m128d
+mult4_load_pd(float64 const* const p) {
+  return Aligned ? _mm_load_pd(p) : _mm_loadu_pd(p);
+}
+
+template<bool Aligned> inline
+void
+mult4_store_pd(float64* const p, __m128d const a) {
+  if (Aligned) { _mm_store_pd(p, a); } else { _mm_storeu_pd(p, a); }
+}
+
+#if defined(THX_AVX)
+
+template<bool Aligned> inline
+__m256d
+mult4_load256_pd(float64 const* const p) {
+  return Aligned ? _mm256_load_pd(p) : _mm256_loadu_pd(p);
+}
+
+template<bool Aligned> inline
+void
+mult4_store256_pd(float64* const p, __m256d const a) {
+  if (Aligned) { _mm256_store_pd(p, a); } else { _mm256_storeu_pd(p, a); }
+}
+
+#endif // THX_AVX
+
+//! c = a*b, SSE version for float32. If Aligned is true all matrices must be
+//! 16-byte aligned. c must not alias a or b.
+template<bool Aligned> inline
+void
+mult4_simd(float32 const* const pa, 
+           float32 const* const pb, 
+           float32* const pc) {
+  __m128 const a0 = mult4_load_ps<Aligned>(pa);
+  __m128 const a1 = mult4_load_ps<Aligned>(pa + 4);
+  __m128 const a2 = mult4_load_ps<Aligned>(pa + 8);
+  __m128 const a3 = mult4_load_ps<Aligned>(pa + 12);
+  mult4_store_ps<Aligned>(pc,      mult4_col_sse(a0, a1, a2, a3, pb));
+  mult4_store_ps<Aligned>(pc + 4,  mult4_col_sse(a0, a1, a2, a3, pb + 4));
+  mult4_store_ps<Aligned>(pc + 8,  mult4_col_sse(a0, a1, a2, a3, pb + 8));
+  mult4_store_ps<Aligned>(pc + 12, mult4_col_sse(a0, a1, a2, a3, pb + 12));
+}
+
+//! c = a*b, SSE2/AVX version for float64. If Aligned is true all matrices 
+//! must be 32-byte aligned (16-byte without AVX). c must not alias a or b.
+template<bool Aligned> inline
+void
+mult4_simd(float64 const* const pa, 
+           float64 const* const pb, 
+           float64* const pc) {
+#if defined(THX_AVX)
+  __m256d const a0 = mult4_load256_pd<Aligned>(pa);
+  __m256d const a1 = mult4_load256_pd<Aligned>(pa + 4);
+  __m256d const a2 = mult4_load256_pd<Aligned>(pa + 8);
+  __m256d const a3 = mult4_load256_pd<Aligned>(pa + 12);
+  mult4_store256_pd<Aligned>(pc,      mult4_col_avx(a0, a1, a2, a3, pb));
+  mult4_store256_pd<Aligned>(pc + 4,  mult4_col_avx(a0, a1, a2, a3, pb + 4));
+  mult4_store256_pd<Aligned>(pc + 8,  mult4_col_avx(a0, a1, a2, a3, pb + 8));
+  mult4_store256_pd<Aligned>(pc + 12, mult4_col_avx(a0, a1, a2, a3, pb + 12));
+#else
+  // Rows 0-1 and rows 2-3 of each column are handled separately.
+  __m128d const a0_lo = mult4_load_pd<Aligned>(pa);
+  __m128d const a0_hi = mult4_load_pd<Aligned>(pa + 2);
+  __m128d const a1_lo = mult4_load_pd<Aligned>(pa + 4);
+  __m128d const a1_hi = mult4_load_pd<Aligned>(pa + 6);
+  __m128d const a2_lo = mult4_load_pd<Aligned>(pa + 8);
+  __m128d const a2_hi = mult4_load_pd<Aligned>(pa + 10);
+  __m128d const a3_lo = mult4_load_pd<Aligned>(pa + 12);
+  __m128d const a3_hi = mult4_load_pd<Aligned>(pa + 14);
+  for (int j = 0; j < 4; ++j) {
+    float64 const* const bj = pb + 4*j;
+    mult4_store_pd<Aligned>(pc + 4*j, 
+                            mult4_col_sse(a0_lo, a1_lo, a2_lo, a3_lo, bj));
+    mult4_store_pd<Aligned>(pc + 4*j + 2, 
+                            mult4_col_sse(a0_hi, a1_hi, a2_hi, a3_hi, bj));
+  }
+#endif // THX_AVX
+}
+
+} // Namespace: detail.
+
+//! Matrix multiplication, SSE specialization for float32.
+inline THX_CONST_EXPR_DISPATCH
+mat<4,float32>
+mult(mat<4,float32> const& a, mat<4,float32> const& b) {
+  if (THX_CONSTANT_EVALUATED()) {
+    return mult<float32>(a, b);
+  }
+  mat<4,float32> c;
+  detail::mult4_simd<false>(a.const_data(), b.const_data(), c.data());
+  return c;
+}
+
+//! Matrix multiplication, SSE2/AVX specialization for float64.
+inline THX_CONST_EXPR_DISPATCH
+mat<4,float64>
+mult(mat<4,float64> const& a, mat<4,float64> const& b) {
+  if (THX_CONSTANT_EVALUATED()) {
+    return mult<float64>(a, b);
+  }
+  mat<4,float64> c;
+  detail::mult4_simd<false>(a.const_data(), b.const_data(), c.data());
+  return c;
+}
+
+#endif // THX_SSE2
+
 //------------------------------------------------------------------------------
 
 //! NxN determinant.
-template<int64 N, typename S>
+template<std::size_t N, typename S> inline THX_CONST_EXPR
 S
 determinant(const mat<N,S> &a);
 // TODO: Implement!
 
 
 //! 2x2 determinant.
-template<typename S>	
-S 
+template<typename S> inline THX_CONST_EXPR
+S
 determinant(const mat<2,S> &a) 
 {
   return (a(0,0)*a(1,1) - a(1,0)*a(0,1));
@@ -439,8 +736,8 @@ determinant(const mat<2,S> &a)
 
 
 //! 3x3 determinant.
-template<typename S>	
-S 
+template<typename S> inline THX_CONST_EXPR
+S
 determinant(const mat<3,S> &a) 
 {
   return (a(0,0)*(a(1,1)*a(2,2) - a(1,2)*a(2,1)) - 
@@ -450,8 +747,8 @@ determinant(const mat<3,S> &a)
 
 
 //! 4-by-4 determinant.
-template<typename S>	
-S 
+template<typename S> inline THX_CONST_EXPR
+S
 determinant(const mat<4,S> &a) 
 { 
   return (a(0,0)*a(1,1)*a(2,2)*a(3,3) + 
@@ -467,7 +764,7 @@ determinant(const mat<4,S> &a)
 //------------------------------------------------------------------------------
 
 //! Transpose provided NxN matrix.
-template<int64 N, typename S>
+template<std::size_t N, typename S>
 void
 transpose(mat<N,S> &a)
 { 
@@ -501,15 +798,14 @@ transpose(mat<4,S> &a)
 //------------------------------------------------------------------------------
 
 //! Return NxN transpose.
-template<int64 N, typename S>
-mat<N,S> 
+template<std::size_t N, typename S> inline THX_CONST_EXPR
+mat<N,S>
 transposed(const mat<N,S> &a)
 {
   mat<N,S> b(a);  // Copy.
-  S tmp;
   for (int64 i = 0; i < N; ++i) {
-    for (int64 j = 0; j < N; ++j) {
-      tmp = b(i,j);   // Swap.
+    for (int64 j = i + 1; j < N; ++j) {
+      const S tmp = b(i,j);   // Swap.
       b(i,j) = b(j,i);
       b(j,i) = tmp;
     }
@@ -518,8 +814,8 @@ transposed(const mat<N,S> &a)
 }
 
 //! Return 2x2 transpose.
-template<typename S> 
-mat<2,S> 
+template<typename S> inline THX_CONST_EXPR
+mat<2,S>
 transposed(const mat<2,S> &a)
 {
   return mat<2,S>(a(0,0), a(1,0),
@@ -527,8 +823,8 @@ transposed(const mat<2,S> &a)
 }
 
 //! Return 3x3 transpose.
-template<typename S> 
-mat<3,S> 
+template<typename S> inline THX_CONST_EXPR
+mat<3,S>
 transposed(const mat<3,S> &a)
 {
   return mat<3,S>(a(0,0), a(1,0), a(2,0),
@@ -537,8 +833,8 @@ transposed(const mat<3,S> &a)
 }
 
 //! Return 4x4 transpose.
-template<typename S>
-mat<4,S> 
+template<typename S> inline THX_CONST_EXPR
+mat<4,S>
 transposed(const mat<4,S> &a)
 {
   return mat<4,S>(a(0,0), a(1,0), a(2,0), a(3,0),
@@ -549,49 +845,49 @@ transposed(const mat<4,S> &a)
 
 //------------------------------------------------------------------------------
 
-//namespace detail {
-//
-//  struct real_scalar_tag {};
-//  struct integer_scalar_tag {};
-//
-//  template<int64 N, typename S>
-//  gauss_jacobi_dispatch(mat<N,S> &a, mat<N,S> &b, real_scalar_tag)
-//  {
-//
-//  }
-//
-//} // Namespace: detail.
+namespace detail {
 
+//! True if a matrix with determinant det is considered invertible, i.e. the
+//! magnitude of det is neither zero, denormal nor infinite (or NaN). Used by
+//! gauss_jacobi as well as the batched inversion in thx_mat_batch.hpp.
+template<typename S> inline
+bool
+inverted_ok(S const det) {
+  const S ad = scalar_traits<S>::abs(det);
+  return ad >= (std::numeric_limits<S>::min)() &&
+         ad <= (std::numeric_limits<S>::max)();
+}
 
-template<int64 N, typename S>
-void
+} // Namespace: detail.
+
+//! Gauss-Jordan elimination with full pivoting. On return a is replaced by
+//! its inverse and b by the corresponding set of solution vectors. Returns
+//! false if a is singular according to detail::inverted_ok applied to the
+//! product of the pivots, in which case a and b are left in an unspecified
+//! state.
+template<std::size_t N, typename S>
+bool
 gauss_jacobi(mat<N,S> &a, mat<N,S> &b)
 {
-#if 0
-  //detail::gauss_jacobi_dispatch(a, b, scalar_traits<S>::scalar_category());
-
-  //typename iterator_traits<InputIterator>::iterator_category category;
-  //detail::advance_dispatch(i, n, category);  
-
-
-    static_assert(std::is_floating_point<S>::value, 
+    static_assert(is_real_scalar<S>::value, 
                  "Scalar type must be floating point");
    
-    int64 icol(0);
-    int64 irow(0);
-    int64 idxc[N];
-    int64 idxr[N];
-    int64 ipiv[N];
-
-    for (int64 i(0); i < N; ++i) {
+    std::size_t icol(0);
+    std::size_t irow(0);
+    std::size_t idxc[N];
+    std::size_t idxr[N];
+    std::size_t ipiv[N];
+    S det(1);
+
+    for (std::size_t i(0); i < N; ++i) {
         ipiv[i] = 0;    
     }
 
-    for (int64 i(0); i < N; ++i) {
+    for (std::size_t i(0); i < N; ++i) {
         S big(0);
-        for (int64 j(0); j < N; ++j) {
+        for (std::size_t j(0); j < N; ++j) {
             if (1 != ipiv[j]) {
-                for (int64 k(0); k < N; ++k) {
+                for (std::size_t k(0); k < N; ++k) {
                     if (0 == ipiv[k] && scalar_traits<S>::abs(a(j,k)) >= big) {
                         big = scalar_traits<S>::abs(a(j,k));
                         irow = j;
@@ -603,7 +899,7 @@ gauss_jacobi(mat<N,S> &a, mat<N,S> &b)
 
         ++ipiv[icol];
         if (irow != icol) {
-            for (int64 r(0); r < N; ++r) {	
+            for (std::size_t r(0); r < N; ++r) {	
                 S tmp(a(irow,r));      // Swap a.
                 a(irow,r) = a(icol,r);
                 a(icol,r) = tmp;
@@ -617,21 +913,24 @@ gauss_jacobi(mat<N,S> &a, mat<N,S> &b)
         idxr[i] = irow;
         idxc[i] = icol;
 
-        assert(!is_zero(scalar_traits<S>::abs(a(icol,icol))));
+        det *= a(icol,icol);
+        if (a(icol,icol) == 0) {
+            return false; // Singular, avoid dividing by zero.
+        }
         const S pivinv(1/a(icol,icol));
         a(icol,icol) = 1;
 
-        for (int64 r(0); r < N; ++r) {
+        for (std::size_t r(0); r < N; ++r) {
             a(icol,r) *= pivinv;
             b(icol,r) *= pivinv;
         }
 
-        for (int64 c(0); c < N; ++c) {
+        for (std::size_t c(0); c < N; ++c) {
             if (c != icol) {
                 const S tmp(a(c,icol));
                 a(c,icol) = 0;
 
-                for (int64 r(0); r < N; ++r) {
+                for (std::size_t r(0); r < N; ++r) {
                     a(c,r) -= a(icol,r)*tmp;
                     b(c,r) -= b(icol,r)*tmp;
                 }
@@ -639,23 +938,23 @@ gauss_jacobi(mat<N,S> &a, mat<N,S> &b)
         }
     }
 
-    for (int64 i(N - 1); i >= 0; --i) {
-        if (idxr[i] != idxc[i]) {
-            for (int64 c(0); c < N; ++c) {
-                const S tmp(a(c,idxr[i]));
-                a(c,idxr[i]) = a(c,idxc[i]);
-                a(c,idxc[i]) = tmp;
+    for (std::size_t i(N); i > 0; --i) {
+        if (idxr[i - 1] != idxc[i - 1]) {
+            for (std::size_t c(0); c < N; ++c) {
+                const S tmp(a(c,idxr[i - 1]));
+                a(c,idxr[i - 1]) = a(c,idxc[i - 1]);
+                a(c,idxc[i - 1]) = tmp;
             }
         }
     }
-#endif
+    return detail::inverted_ok(det);
 }
 
 
 //------------------------------------------------------------------------------
 
 //! Invert provided NxN matrix.
-template<int64 N, typename S>
+template<std::size_t N, typename S>
 void 
 invert(mat<N,S> &a)
 { 
@@ -665,7 +964,7 @@ invert(mat<N,S> &a)
 //------------------------------------------------------------------------------
 
 //! Inverted.
-template<int64 N, typename S>
+template<std::size_t N, typename S>
 mat<N,S> 
 inverted(const mat<N,S> &a)
 {
@@ -679,7 +978,7 @@ template<typename S>
 mat<2,S> 
 inverted(const mat<2,S> &a)
 {
-    static_assert(std::is_floating_point<S>::value, 
+    static_assert(is_real_scalar<S>::value, 
                  "Scalar type must be floating point");
 
     const S inv_det = 1/determinant(a);
@@ -692,7 +991,7 @@ template<typename S>
 mat<3,S> 
 inverted(const mat<3,S> &a)
 {
-    static_assert(std::is_floating_point<S>::value, 
+    static_assert(is_real_scalar<S>::value, 
                  "Scalar type must be floating point");
 
     const S inv_det = 1/determinant(a);
@@ -716,7 +1015,7 @@ inverted(const mat<4,S> &a)
 
     // Use the norm of A to establish a sensible tolerance for singularity.
 
-    typedef typename scalar_traits<S> traits;
+    typedef scalar_traits<S> traits;
 
     const S tol = 64*std::numeric_limits<S>::epsilon()*(
                      traits::abs(a(0,0)) + traits::abs(a(0,1)) +
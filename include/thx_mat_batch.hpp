@@ -0,0 +1,1120 @@
+//------------------------------------------------------------------------------
+//
+// Contributors:
+//             1) Tommy Hinks
+//
+//------------------------------------------------------------------------------
+
+#ifndef THX_MAT_BATCH_HPP_INCLUDED
+#define THX_MAT_BATCH_HPP_INCLUDED
+
+#include "thx_namespace.hpp"
+#include "thx_types.hpp"
+#include "thx_vec.hpp"
+#include "thx_mat.hpp"
+#include "thx_mat_algo.hpp"
+#include "thx_scalar_batch.hpp"
+#include "thx_simd.hpp"
+#include "thx_cpu.hpp"
+#include "thx_parallel.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <limits>
+
+//------------------------------------------------------------------------------
+
+BEGIN_THX_NAMESPACE
+
+// Batched mat<4,S> kernels.
+// -------------------------
+//
+// The batched functions operate on contiguous ranges of n elements. Input
+// and output may be the same range (in-place), but must not partially
+// overlap. Results are the same as applying the corresponding single-element
+// operator (see thx_operators.hpp) to each element in turn.
+//
+// The matrix is loaded into registers once per call. The float32 versions
+// process 4 (SSE) or 8 (AVX, vec<3,S>) elements per iteration, and
+// transform_homogeneous 2 (AVX) or 4 (AVX-512) vec<4,float32> per register,
+// weighing the columns of the matrix by the broadcast input elements. The
+// float64 versions of the vec<3,S> kernels process 2 (SSE2) elements per
+// iteration. Remaining elements are handled by the scalar loop. The SIMD
+// kernels rely on vec<N,S> arrays being tightly packed, i.e.
+// sizeof(vec<N,S>) == N*sizeof(S).
+//
+// The AVX and AVX-512 versions are selected at run-time if active_isa() is
+// at least isa_avx or isa_avx512, see thx_cpu.hpp, even if the translation
+// unit is compiled for SSE2 only. All versions sum in the same order as the
+// scalar loop.
+
+namespace detail {
+
+//! Transform n vec<3,S> by the upper 3x4 part of a. If translate is false
+//! the fourth column of a is ignored.
+template<typename S> inline
+void
+transform3_scalar(mat<4,S> const& a,
+                  bool const translate,
+                  vec<3,S> const* const in,
+                  vec<3,S>* const out,
+                  std::size_t const n) {
+  const S m00 = a(0,0), m01 = a(0,1), m02 = a(0,2);
+  const S m10 = a(1,0), m11 = a(1,1), m12 = a(1,2);
+  const S m20 = a(2,0), m21 = a(2,1), m22 = a(2,2);
+  const S m03 = translate ? a(0,3) : S(0);
+  const S m13 = translate ? a(1,3) : S(0);
+  const S m23 = translate ? a(2,3) : S(0);
+  for (std::size_t i = 0; i < n; ++i) {
+    const S x = in[i][0];
+    const S y = in[i][1];
+    const S z = in[i][2];
+    out[i][0] = m00*x + m01*y + m02*z + m03;
+    out[i][1] = m10*x + m11*y + m12*z + m13;
+    out[i][2] = m20*x + m21*y + m22*z + m23;
+  }
+}
+
+//! Transform n vec<4,S> by a.
+template<typename S> inline
+void
+transform4_scalar(mat<4,S> const& a,
+                  vec<4,S> const* const in,
+                  vec<4,S>* const out,
+                  std::size_t const n) {
+  const S m00 = a(0,0), m01 = a(0,1), m02 = a(0,2), m03 = a(0,3);
+  const S m10 = a(1,0), m11 = a(1,1), m12 = a(1,2), m13 = a(1,3);
+  const S m20 = a(2,0), m21 = a(2,1), m22 = a(2,2), m23 = a(2,3);
+  const S m30 = a(3,0), m31 = a(3,1), m32 = a(3,2), m33 = a(3,3);
+  for (std::size_t i = 0; i < n; ++i) {
+    const S x = in[i][0];
+    const S y = in[i][1];
+    const S z = in[i][2];
+    const S w = in[i][3];
+    out[i][0] = m00*x + m01*y + m02*z + m03*w;
+    out[i][1] = m10*x + m11*y + m12*z + m13*w;
+    out[i][2] = m20*x + m21*y + m22*z + m23*w;
+    out[i][3] = m30*x + m31*y + m32*z + m33*w;
+  }
+}
+
+} // Namespace: detail.
+
+//------------------------------------------------------------------------------
+
+//! Transform n points, out[i] = a*in[i], where w = 1 is assumed for the
+//! input points. No perspective division is performed, i.e. the result is
+//! the same as for operator*(mat<4,S>, vec<3,S>).
+template<typename S>
+void
+transform_points(mat<4,S> const& a,
+                 vec<3,S> const* const in,
+                 vec<3,S>* const out,
+                 std::size_t const n) {
+  detail::transform3_scalar(a, true, in, out, n);
+}
+
+//! Transform n direction vectors, where w = 0 is assumed for the input
+//! vectors, i.e. the translation part of a is ignored.
+template<typename S>
+void
+transform_vectors(mat<4,S> const& a,
+                  vec<3,S> const* const in,
+                  vec<3,S>* const out,
+                  std::size_t const n) {
+  detail::transform3_scalar(a, false, in, out, n);
+}
+
+//! Transform n homogeneous vectors, out[i] = a*in[i].
+template<typename S>
+void
+transform_homogeneous(mat<4,S> const& a,
+                      vec<4,S> const* const in,
+                      vec<4,S>* const out,
+                      std::size_t const n) {
+  detail::transform4_scalar(a, in, out, n);
+}
+
+//------------------------------------------------------------------------------
+
+#if defined(THX_SSE2)
+
+namespace detail {
+
+//! Rows of the upper 3x4 part of a, each element broadcast to all lanes.
+struct mat34_sse {
+  __m128 m[3][4];
+};
+
+//! DOCS
+inline
+mat34_sse
+make_mat34_sse(mat<4,float32> const& a, bool const translate) {
+  mat34_sse r;
+  for (int i = 0; i < 3; ++i) {
+    r.m[i][0] = _mm_set1_ps(a(i,0));
+    r.m[i][1] = _mm_set1_ps(a(i,1));
+    r.m[i][2] = _mm_set1_ps(a(i,2));
+    r.m[i][3] = _mm_set1_ps(translate ? a(i,3) : 0.f);
+  }
+  return r;
+}
+
+//! Load 4 consecutive vec<3,float32> (12 floats) and transpose them into
+//! x, y and z registers.
+inline
+void
+load_soa4(float32 const* const p, __m128& x, __m128& y, __m128& z) {
+  const __m128 a = _mm_loadu_ps(p);     // x0 y0 z0 x1
+  const __m128 b = _mm_loadu_ps(p + 4); // y1 z1 x2 y2
+  const __m128 c = _mm_loadu_ps(p + 8); // z2 x3 y3 z3
+  const __m128 t1 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1,1,2,2));
+  const __m128 t2 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0,0,1,1));
+  const __m128 t3 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2,2,3,3));
+  const __m128 t4 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1,1,2,2));
+  const __m128 t5 = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3,3,0,0));
+  x = _mm_shuffle_ps(a, t1, _MM_SHUFFLE(2,0,3,0));
+  y = _mm_shuffle_ps(t2, t3, _MM_SHUFFLE(2,0,2,0));
+  z = _mm_shuffle_ps(t4, t5, _MM_SHUFFLE(2,0,2,0));
+}
+
+//! Inverse of load_soa4.
+inline
+void
+store_soa4(float32* const p, __m128 const x, __m128 const y, __m128 const z) {
+  const __m128 u1 = _mm_shuffle_ps(x, y, _MM_SHUFFLE(0,0,0,0));
+  const __m128 u2 = _mm_shuffle_ps(z, x, _MM_SHUFFLE(1,1,0,0));
+  const __m128 v1 = _mm_shuffle_ps(y, z, _MM_SHUFFLE(1,1,1,1));
+  const __m128 v2 = _mm_shuffle_ps(x, y, _MM_SHUFFLE(2,2,2,2));
+  const __m128 w1 = _mm_shuffle_ps(z, x, _MM_SHUFFLE(3,3,2,2));
+  const __m128 w2 = _mm_shuffle_ps(y, z, _MM_SHUFFLE(3,3,3,3));
+  _mm_storeu_ps(p,     _mm_shuffle_ps(u1, u2, _MM_SHUFFLE(2,0,2,0)));
+  _mm_storeu_ps(p + 4, _mm_shuffle_ps(v1, v2, _MM_SHUFFLE(2,0,2,0)));
+  _mm_storeu_ps(p + 8, _mm_shuffle_ps(w1, w2, _MM_SHUFFLE(2,0,2,0)));
+}
+
+//! Row i of the upper 3x4 part of a times (x, y, z, 1). Summation order
+//! matches the scalar path.
+inline
+__m128
+row_dot_sse(mat34_sse const& a,
+            int const i,
+            __m128 const x,
+            __m128 const y,
+            __m128 const z) {
+  __m128 r = _mm_mul_ps(a.m[i][0], x);
+  r = _mm_add_ps(r, _mm_mul_ps(a.m[i][1], y));
+  r = _mm_add_ps(r, _mm_mul_ps(a.m[i][2], z));
+  return _mm_add_ps(r, a.m[i][3]);
+}
+
+#if defined(THX_AVX) || defined(THX_DISPATCH)
+
+//! Transform the first n - n%8 of n vec<3,float32>, 8 per iteration. Returns
+//! the number of transformed vectors.
+inline THX_TARGET_AVX THX_FLATTEN
+std::size_t
+transform3_avx(mat<4,float32> const& a,
+               bool const translate,
+               vec<3,float32> const* const in,
+               vec<3,float32>* const out,
+               std::size_t const n) {
+  std::size_t i = 0;
+  __m256 m8[3][4];
+  for (int r = 0; r < 3; ++r) {
+    m8[r][0] = _mm256_set1_ps(a(r,0));
+    m8[r][1] = _mm256_set1_ps(a(r,1));
+    m8[r][2] = _mm256_set1_ps(a(r,2));
+    m8[r][3] = _mm256_set1_ps(translate ? a(r,3) : 0.f);
+  }
+  for (; i + 8 <= n; i += 8) {
+    __m128 x0, y0, z0, x1, y1, z1;
+    load_soa4(in[i].const_data(), x0, y0, z0);
+    load_soa4(in[i + 4].const_data(), x1, y1, z1);
+    const __m256 x = _mm256_insertf128_ps(_mm256_castps128_ps256(x0), x1, 1);
+    const __m256 y = _mm256_insertf128_ps(_mm256_castps128_ps256(y0), y1, 1);
+    const __m256 z = _mm256_insertf128_ps(_mm256_castps128_ps256(z0), z1, 1);
+    __m256 r[3];
+    for (int k = 0; k < 3; ++k) {
+      r[k] = _mm256_mul_ps(m8[k][0], x);
+      r[k] = _mm256_add_ps(r[k], _mm256_mul_ps(m8[k][1], y));
+      r[k] = _mm256_add_ps(r[k], _mm256_mul_ps(m8[k][2], z));
+      r[k] = _mm256_add_ps(r[k], m8[k][3]);
+    }
+    store_soa4(out[i].data(),
+               _mm256_castps256_ps128(r[0]),
+               _mm256_castps256_ps128(r[1]),
+               _mm256_castps256_ps128(r[2]));
+    store_soa4(out[i + 4].data(),
+               _mm256_extractf128_ps(r[0], 1),
+               _mm256_extractf128_ps(r[1], 1),
+               _mm256_extractf128_ps(r[2], 1));
+  }
+  return i;
+}
+
+//! Transform the first n - n%2 of n vec<4,float32>, 2 per iteration.
+//! Returns the number of transformed vectors.
+inline THX_TARGET_AVX THX_FLATTEN
+std::size_t
+transform4_avx(mat<4,float32> const& a,
+               vec<4,float32> const* const in,
+               vec<4,float32>* const out,
+               std::size_t const n) {
+  __m256 col[4];
+  for (int c = 0; c < 4; ++c) {
+    const __m128 v = _mm_setr_ps(a(0,c), a(1,c), a(2,c), a(3,c));
+    col[c] = _mm256_insertf128_ps(_mm256_castps128_ps256(v), v, 1);
+  }
+  std::size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    const __m256 v = _mm256_loadu_ps(in[i].const_data());
+    __m256 r = _mm256_mul_ps(col[0], _mm256_permute_ps(v, 0x00));
+    r = _mm256_add_ps(r, _mm256_mul_ps(col[1], _mm256_permute_ps(v, 0x55)));
+    r = _mm256_add_ps(r, _mm256_mul_ps(col[2], _mm256_permute_ps(v, 0xaa)));
+    r = _mm256_add_ps(r, _mm256_mul_ps(col[3], _mm256_permute_ps(v, 0xff)));
+    _mm256_storeu_ps(out[i].data(), r);
+  }
+  return i;
+}
+
+#endif // THX_AVX, THX_DISPATCH
+
+#if defined(THX_DISPATCH)
+
+//! Transform the first n - n%4 of n vec<4,float32>, 4 per iteration.
+//! Returns the number of transformed vectors.
+inline THX_TARGET_AVX512 THX_FLATTEN
+std::size_t
+transform4_avx512(mat<4,float32> const& a,
+                  vec<4,float32> const* const in,
+                  vec<4,float32>* const out,
+                  std::size_t const n) {
+  __m512 col[4];
+  for (int c = 0; c < 4; ++c) {
+    col[c] = _mm512_broadcast_f32x4(
+      _mm_setr_ps(a(0,c), a(1,c), a(2,c), a(3,c)));
+  }
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const __m512 v = _mm512_loadu_ps(in[i].const_data());
+    __m512 r = _mm512_mul_ps(col[0], _mm512_permute_ps(v, 0x00));
+    r = _mm512_add_ps(r, _mm512_mul_ps(col[1], _mm512_permute_ps(v, 0x55)));
+    r = _mm512_add_ps(r, _mm512_mul_ps(col[2], _mm512_permute_ps(v, 0xaa)));
+    r = _mm512_add_ps(r, _mm512_mul_ps(col[3], _mm512_permute_ps(v, 0xff)));
+    _mm512_storeu_ps(out[i].data(), r);
+  }
+  return i;
+}
+
+#endif // THX_DISPATCH
+
+//! Transform n vec<3,float32>, 4 (SSE) or 8 (AVX) per iteration.
+inline
+void
+transform3_simd(mat<4,float32> const& a,
+                bool const translate,
+                vec<3,float32> const* const in,
+                vec<3,float32>* const out,
+                std::size_t const n) {
+  const mat34_sse m = make_mat34_sse(a, translate);
+  std::size_t i = 0;
+#if defined(THX_AVX) || defined(THX_DISPATCH)
+  if (active_isa() >= isa_avx) {
+    i = transform3_avx(a, translate, in, out, n);
+  }
+#endif // THX_AVX, THX_DISPATCH
+  for (; i + 4 <= n; i += 4) {
+    __m128 x, y, z;
+    load_soa4(in[i].const_data(), x, y, z);
+    store_soa4(out[i].data(),
+               row_dot_sse(m, 0, x, y, z),
+               row_dot_sse(m, 1, x, y, z),
+               row_dot_sse(m, 2, x, y, z));
+  }
+  transform3_scalar(a, translate, in + i, out + i, n - i);
+}
+
+//! Transform n vec<3,float64>, 2 per iteration.
+inline
+void
+transform3_simd(mat<4,float64> const& a,
+                bool const translate,
+                vec<3,float64> const* const in,
+                vec<3,float64>* const out,
+                std::size_t const n) {
+  __m128d m[3][4];
+  for (int r = 0; r < 3; ++r) {
+    m[r][0] = _mm_set1_pd(a(r,0));
+    m[r][1] = _mm_set1_pd(a(r,1));
+    m[r][2] = _mm_set1_pd(a(r,2));
+    m[r][3] = _mm_set1_pd(translate ? a(r,3) : 0.0);
+  }
+
+  std::size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    float64 const* const p = in[i].const_data();
+    const __m128d u0 = _mm_loadu_pd(p);     // x0 y0
+    const __m128d u1 = _mm_loadu_pd(p + 2); // z0 x1
+    const __m128d u2 = _mm_loadu_pd(p + 4); // y1 z1
+    const __m128d x = _mm_shuffle_pd(u0, u1, 2);
+    const __m128d y = _mm_shuffle_pd(u0, u2, 1);
+    const __m128d z = _mm_shuffle_pd(u1, u2, 2);
+    __m128d r[3];
+    for (int k = 0; k < 3; ++k) {
+      r[k] = _mm_mul_pd(m[k][0], x);
+      r[k] = _mm_add_pd(r[k], _mm_mul_pd(m[k][1], y));
+      r[k] = _mm_add_pd(r[k], _mm_mul_pd(m[k][2], z));
+      r[k] = _mm_add_pd(r[k], m[k][3]);
+    }
+    float64* const q = out[i].data();
+    _mm_storeu_pd(q,     _mm_shuffle_pd(r[0], r[1], 0));
+    _mm_storeu_pd(q + 2, _mm_shuffle_pd(r[2], r[0], 2));
+    _mm_storeu_pd(q + 4, _mm_shuffle_pd(r[1], r[2], 3));
+  }
+  transform3_scalar(a, translate, in + i, out + i, n - i);
+}
+
+} // Namespace: detail.
+
+//! Transform n points, SSE/AVX specialization for float32.
+inline
+void
+transform_points(mat<4,float32> const& a,
+                 vec<3,float32> const* const in,
+                 vec<3,float32>* const out,
+                 std::size_t const n) {
+  detail::transform3_simd(a, true, in, out, n);
+}
+
+//! Transform n points, SSE2 specialization for float64.
+inline
+void
+transform_points(mat<4,float64> const& a,
+                 vec<3,float64> const* const in,
+                 vec<3,float64>* const out,
+                 std::size_t const n) {
+  detail::transform3_simd(a, true, in, out, n);
+}
+
+//! Transform n direction vectors, SSE/AVX specialization for float32.
+inline
+void
+transform_vectors(mat<4,float32> const& a,
+                  vec<3,float32> const* const in,
+                  vec<3,float32>* const out,
+                  std::size_t const n) {
+  detail::transform3_simd(a, false, in, out, n);
+}
+
+//! Transform n direction vectors, SSE2 specialization for float64.
+inline
+void
+transform_vectors(mat<4,float64> const& a,
+                  vec<3,float64> const* const in,
+                  vec<3,float64>* const out,
+                  std::size_t const n) {
+  detail::transform3_simd(a, false, in, out, n);
+}
+
+//! Transform n homogeneous vectors, SSE/AVX/AVX-512 specialization for
+//! float32. With SSE, blocks of 4 vectors are transposed into x, y, z and w
+//! registers.
+inline
+void
+transform_homogeneous(mat<4,float32> const& a,
+                      vec<4,float32> const* const in,
+                      vec<4,float32>* const out,
+                      std::size_t const n) {
+  __m128 m[4][4];
+  for (int r = 0; r < 4; ++r) {
+    for (int c = 0; c < 4; ++c) {
+      m[r][c] = _mm_set1_ps(a(r,c));
+    }
+  }
+
+  std::size_t i = 0;
+#if defined(THX_DISPATCH)
+  if (active_isa() >= isa_avx512) {
+    i = detail::transform4_avx512(a, in, out, n);
+  }
+#endif // THX_DISPATCH
+#if defined(THX_AVX) || defined(THX_DISPATCH)
+  if (active_isa() >= isa_avx) {
+    i += detail::transform4_avx(a, in + i, out + i, n - i);
+  }
+#endif // THX_AVX, THX_DISPATCH
+  for (; i + 4 <= n; i += 4) {
+    __m128 x = _mm_loadu_ps(in[i].const_data());
+    __m128 y = _mm_loadu_ps(in[i + 1].const_data());
+    __m128 z = _mm_loadu_ps(in[i + 2].const_data());
+    __m128 w = _mm_loadu_ps(in[i + 3].const_data());
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+    __m128 r[4];
+    for (int k = 0; k < 4; ++k) {
+      r[k] = _mm_mul_ps(m[k][0], x);
+      r[k] = _mm_add_ps(r[k], _mm_mul_ps(m[k][1], y));
+      r[k] = _mm_add_ps(r[k], _mm_mul_ps(m[k][2], z));
+      r[k] = _mm_add_ps(r[k], _mm_mul_ps(m[k][3], w));
+    }
+    _MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+    _mm_storeu_ps(out[i].data(),     r[0]);
+    _mm_storeu_ps(out[i + 1].data(), r[1]);
+    _mm_storeu_ps(out[i + 2].data(), r[2]);
+    _mm_storeu_ps(out[i + 3].data(), r[3]);
+  }
+  detail::transform4_scalar(a, in + i, out + i, n - i);
+}
+
+#endif // THX_SSE2
+
+//------------------------------------------------------------------------------
+
+// Batched multiplication.
+// -----------------------
+//
+// mult(a, b, c, n) sets c[i] = a[i]*b[i] for i in [0, n). c may be the same
+// range as a or b. Results are the same as for mult(mat<4,S>, mat<4,S>). The
+// float64 version computes whole columns with AVX if active_isa() is at least
+// isa_avx, and half columns with SSE2 otherwise.
+
+namespace detail {
+
+THX_GENERIC_KERNELS_BEGIN
+
+//! c[i] = a[i]*b[i], one column per packet, Simd::packet_size must be 4.
+//! Column j of the product is summed in the same order as the scalar path.
+template<class Simd, typename S> inline
+void
+mult4_columns(mat<4,S> const* const a,
+              mat<4,S> const* const b,
+              mat<4,S>* const c,
+              std::size_t const n) {
+  typedef Simd simd;
+  typedef typename simd::packet_type packet_type;
+  static_assert(simd::packet_size == 4, "Packets must hold a column");
+
+  for (std::size_t i = 0; i < n; ++i) {
+    S const* const pa = a[i].const_data();
+    S const* const pb = b[i].const_data();
+    const packet_type a0 = simd::loadu(pa);
+    const packet_type a1 = simd::loadu(pa + 4);
+    const packet_type a2 = simd::loadu(pa + 8);
+    const packet_type a3 = simd::loadu(pa + 12);
+    packet_type r[4];
+    for (int j = 0; j < 4; ++j) {
+      S const* const bj = pb + 4*j;
+      r[j] = simd::mul(a0, simd::set1(bj[0]));
+      r[j] = simd::add(r[j], simd::mul(a1, simd::set1(bj[1])));
+      r[j] = simd::add(r[j], simd::mul(a2, simd::set1(bj[2])));
+      r[j] = simd::add(r[j], simd::mul(a3, simd::set1(bj[3])));
+    }
+    S* const pc = c[i].data(); // May alias pa or pb, both are read above.
+    for (int j = 0; j < 4; ++j) {
+      simd::storeu(pc + 4*j, r[j]);
+    }
+  }
+}
+
+THX_GENERIC_KERNELS_END
+
+#if defined(THX_DISPATCH)
+
+inline THX_TARGET_AVX THX_FLATTEN
+void
+mult4_avx(mat<4,float64> const* const a,
+          mat<4,float64> const* const b,
+          mat<4,float64>* const c,
+          std::size_t const n) {
+  mult4_columns<avx_traits<float64>>(a, b, c, n);
+}
+
+#endif // THX_DISPATCH
+
+} // Namespace: detail.
+
+//! Batched multiplication. See above.
+template<typename S>
+void
+mult(mat<4,S> const* const a,
+     mat<4,S> const* const b,
+     mat<4,S>* const c,
+     std::size_t const n) {
+  for (std::size_t i = 0; i < n; ++i) {
+    c[i] = mult(a[i], b[i]);
+  }
+}
+
+#if defined(THX_DISPATCH)
+
+//! Batched multiplication, dispatched on active_isa(). See above.
+inline
+void
+mult(mat<4,float64> const* const a,
+     mat<4,float64> const* const b,
+     mat<4,float64>* const c,
+     std::size_t const n) {
+  if (active_isa() >= isa_avx) {
+    detail::mult4_avx(a, b, c, n);
+    return;
+  }
+  for (std::size_t i = 0; i < n; ++i) {
+    c[i] = mult(a[i], b[i]);
+  }
+}
+
+#endif // THX_DISPATCH
+
+//------------------------------------------------------------------------------
+
+// Batched inversion.
+// ------------------
+//
+// inverted(a, b, status, n) writes the inverses of a[0..n) to b[0..n) and
+// sets status[i] to 1 if a[i] is invertible and 0 otherwise, in which case
+// b[i] is unspecified. Returns the number of singular matrices. a and b may
+// be the same range.
+//
+// The range is split into chunks that are inverted on default_thread_pool().
+// Within a chunk, mat<4,S> are transposed into structure-of-arrays form so
+// that simd_traits<S>::packet_size matrices are inverted at once by cofactor
+// expansion. With run-time dispatch (see thx_cpu.hpp) float32 and float64
+// packets are as wide as active_isa() allows, i.e. up to 16 float32 with
+// AVX-512. mat<3,S> use scalar cofactor expansion and other sizes use
+// gauss_jacobi, one matrix at a time. A matrix of any size is considered
+// singular if the magnitude of its determinant is zero, denormal or not
+// finite, see detail::inverted_ok. Relies on mat<N,S> arrays being tightly
+// packed.
+
+namespace detail {
+
+//! Number of matrices per parallel task.
+static const std::size_t inverted_grain = 2048;
+
+//! Number of matrices per structure-of-arrays block, a multiple of any
+//! packet_size. Large enough that packet loads do not stall on the scalar
+//! stores of the gather.
+static const std::size_t inverted_block = 64;
+
+//! Gather n <= B matrices into structure-of-arrays form, t[k*B + l] is
+//! element k of matrix l. Lanes past n are set to identity.
+template<std::size_t B, std::size_t N, typename S> inline
+void
+inverted_gather(mat<N,S> const* const a, std::size_t const n, S* const t) {
+  S const* const m = a[0].const_data();
+  for (std::size_t k = 0; k < N*N; ++k) {
+    for (std::size_t l = 0; l < n; ++l) {
+      t[k*B + l] = m[l*N*N + k];
+    }
+    for (std::size_t l = n; l < B; ++l) {
+      t[k*B + l] = (k%(N + 1) == 0 ? S(1) : S(0));
+    }
+  }
+}
+
+//! Scatter the first n lanes of t back to matrices and set status from the
+//! determinants d. Returns the number of singular lanes.
+template<std::size_t B, std::size_t N, typename S> inline
+std::size_t
+inverted_scatter(S const* const t,
+                 S const* const d,
+                 std::size_t const n,
+                 mat<N,S>* const b,
+                 uint8* const status) {
+  S* const m = b[0].data();
+  for (std::size_t k = 0; k < N*N; ++k) {
+    for (std::size_t l = 0; l < n; ++l) {
+      m[l*N*N + k] = t[k*B + l];
+    }
+  }
+  std::size_t singular = 0;
+  for (std::size_t l = 0; l < n; ++l) {
+    const bool ok = inverted_ok(d[l]);
+    status[l] = (ok ? 1 : 0);
+    singular += (ok ? 0 : 1);
+  }
+  return singular;
+}
+
+THX_GENERIC_KERNELS_BEGIN
+
+//! Store sign*(x*y - z*u + v*w) to p. Packets are passed by reference so
+//! that instantiations for wider instruction sets keep the calling convention
+//! of the translation unit.
+template<class Simd, typename S> inline
+void
+inverted_cofactor(S* const p,
+                  typename Simd::packet_type const& sign,
+                  typename Simd::packet_type const& x,
+                  typename Simd::packet_type const& y,
+                  typename Simd::packet_type const& z,
+                  typename Simd::packet_type const& u,
+                  typename Simd::packet_type const& v,
+                  typename Simd::packet_type const& w) {
+  typedef Simd simd;
+  simd::storeu(p, simd::mul(sign, simd::add(
+    simd::sub(simd::mul(x, y), simd::mul(z, u)), simd::mul(v, w))));
+}
+
+//! Invert Simd::packet_size 4x4 matrices in structure-of-arrays form in
+//! place. Element k of the matrix in lane l is t[k*B + l]. Determinants are
+//! stored to d.
+template<std::size_t B, typename S, class Simd = simd_traits<S>>
+void
+inverted4_packet(S* const t, S* const d) {
+  typedef Simd simd;
+  typedef typename simd::packet_type packet_type;
+
+  // aRC is the element at row R, column C, stored at R + 4*C.
+  const packet_type a00 = simd::loadu(t + 0*B);
+  const packet_type a10 = simd::loadu(t + 1*B);
+  const packet_type a20 = simd::loadu(t + 2*B);
+  const packet_type a30 = simd::loadu(t + 3*B);
+  const packet_type a01 = simd::loadu(t + 4*B);
+  const packet_type a11 = simd::loadu(t + 5*B);
+  const packet_type a21 = simd::loadu(t + 6*B);
+  const packet_type a31 = simd::loadu(t + 7*B);
+  const packet_type a02 = simd::loadu(t + 8*B);
+  const packet_type a12 = simd::loadu(t + 9*B);
+  const packet_type a22 = simd::loadu(t + 10*B);
+  const packet_type a32 = simd::loadu(t + 11*B);
+  const packet_type a03 = simd::loadu(t + 12*B);
+  const packet_type a13 = simd::loadu(t + 13*B);
+  const packet_type a23 = simd::loadu(t + 14*B);
+  const packet_type a33 = simd::loadu(t + 15*B);
+
+  // 2x2 minors of rows 0-1 (s) and rows 2-3 (c).
+  const packet_type s0 = simd::sub(simd::mul(a00, a11), simd::mul(a10, a01));
+  const packet_type s1 = simd::sub(simd::mul(a00, a12), simd::mul(a10, a02));
+  const packet_type s2 = simd::sub(simd::mul(a00, a13), simd::mul(a10, a03));
+  const packet_type s3 = simd::sub(simd::mul(a01, a12), simd::mul(a11, a02));
+  const packet_type s4 = simd::sub(simd::mul(a01, a13), simd::mul(a11, a03));
+  const packet_type s5 = simd::sub(simd::mul(a02, a13), simd::mul(a12, a03));
+  const packet_type c0 = simd::sub(simd::mul(a20, a31), simd::mul(a30, a21));
+  const packet_type c1 = simd::sub(simd::mul(a20, a32), simd::mul(a30, a22));
+  const packet_type c2 = simd::sub(simd::mul(a20, a33), simd::mul(a30, a23));
+  const packet_type c3 = simd::sub(simd::mul(a21, a32), simd::mul(a31, a22));
+  const packet_type c4 = simd::sub(simd::mul(a21, a33), simd::mul(a31, a23));
+  const packet_type c5 = simd::sub(simd::mul(a22, a33), simd::mul(a32, a23));
+
+  // det = s0*c5 - s1*c4 + s2*c3 + s3*c2 - s4*c1 + s5*c0
+  const packet_type det = simd::add(
+    simd::add(simd::sub(simd::mul(s0, c5), simd::mul(s1, c4)),
+              simd::mul(s2, c3)),
+    simd::add(simd::sub(simd::mul(s3, c2), simd::mul(s4, c1)),
+              simd::mul(s5, c0)));
+  const packet_type pos = simd::div(simd::set1(S(1)), det);
+  const packet_type neg = simd::sub(simd::set1(S(0)), pos);
+  simd::storeu(d, det);
+
+  // Element (R,C) of the inverse is stored at R + 4*C.
+  inverted_cofactor<simd>(t + 0*B, pos, a11, c5, a12, c4, a13, c3);
+  inverted_cofactor<simd>(t + 1*B, neg, a10, c5, a12, c2, a13, c1);
+  inverted_cofactor<simd>(t + 2*B, pos, a10, c4, a11, c2, a13, c0);
+  inverted_cofactor<simd>(t + 3*B, neg, a10, c3, a11, c1, a12, c0);
+  inverted_cofactor<simd>(t + 4*B, neg, a01, c5, a02, c4, a03, c3);
+  inverted_cofactor<simd>(t + 5*B, pos, a00, c5, a02, c2, a03, c1);
+  inverted_cofactor<simd>(t + 6*B, neg, a00, c4, a01, c2, a03, c0);
+  inverted_cofactor<simd>(t + 7*B, pos, a00, c3, a01, c1, a02, c0);
+  inverted_cofactor<simd>(t + 8*B, pos, a31, s5, a32, s4, a33, s3);
+  inverted_cofactor<simd>(t + 9*B, neg, a30, s5, a32, s2, a33, s1);
+  inverted_cofactor<simd>(t + 10*B, pos, a30, s4, a31, s2, a33, s0);
+  inverted_cofactor<simd>(t + 11*B, neg, a30, s3, a31, s1, a32, s0);
+  inverted_cofactor<simd>(t + 12*B, neg, a21, s5, a22, s4, a23, s3);
+  inverted_cofactor<simd>(t + 13*B, pos, a20, s5, a22, s2, a23, s1);
+  inverted_cofactor<simd>(t + 14*B, neg, a20, s4, a21, s2, a23, s0);
+  inverted_cofactor<simd>(t + 15*B, pos, a20, s3, a21, s1, a22, s0);
+}
+
+THX_GENERIC_KERNELS_END
+
+//! Invert n matrices on the calling thread, one block at a time.
+//! kernel inverts P matrices of a block in place.
+template<std::size_t P, std::size_t N, typename S>
+std::size_t
+inverted_blocks(mat<N,S> const* const a,
+                mat<N,S>* const b,
+                uint8* const status,
+                std::size_t const n,
+                void (*kernel)(S*, S*)) {
+  static const std::size_t B = inverted_block;
+
+  S t[N*N*B];
+  S d[B];
+  std::size_t singular = 0;
+  for (std::size_t i = 0; i < n; i += B) {
+    const std::size_t m = (std::min)(B, n - i);
+    inverted_gather<B>(a + i, m, t);
+    for (std::size_t j = 0; j < m; j += P) {
+      kernel(t + j, d + j);
+    }
+    singular += inverted_scatter<B>(t, d, m, b + i, status + i);
+  }
+  return singular;
+}
+
+//! Invert n 3x3 matrices on the calling thread. Transposing 3x3 matrices to
+//! structure-of-arrays form costs more than the packet arithmetic saves, so
+//! these are inverted one at a time by cofactor expansion.
+template<typename S>
+std::size_t
+inverted3_range(mat<3,S> const* const a,
+                mat<3,S>* const b,
+                uint8* const status,
+                std::size_t const n) {
+  std::size_t singular = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    // aRC is the element at row R, column C, stored at R + 3*C.
+    S const* const m = a[i].const_data();
+    const S a00 = m[0];
+    const S a10 = m[1];
+    const S a20 = m[2];
+    const S a01 = m[3];
+    const S a11 = m[4];
+    const S a21 = m[5];
+    const S a02 = m[6];
+    const S a12 = m[7];
+    const S a22 = m[8];
+
+    const S c00 = a11*a22 - a12*a21;
+    const S c10 = a12*a20 - a10*a22;
+    const S c20 = a10*a21 - a11*a20;
+    const S det = a00*c00 + a01*c10 + a02*c20;
+    const S inv_det = 1/det;
+
+    S* const r = b[i].data();
+    r[0] = inv_det*c00;
+    r[1] = inv_det*c10;
+    r[2] = inv_det*c20;
+    r[3] = inv_det*(a02*a21 - a01*a22);
+    r[4] = inv_det*(a00*a22 - a02*a20);
+    r[5] = inv_det*(a01*a20 - a00*a21);
+    r[6] = inv_det*(a01*a12 - a02*a11);
+    r[7] = inv_det*(a02*a10 - a00*a12);
+    r[8] = inv_det*(a00*a11 - a01*a10);
+
+    const bool ok = inverted_ok(det);
+    status[i] = (ok ? 1 : 0);
+    singular += (ok ? 0 : 1);
+  }
+  return singular;
+}
+
+//! Invert n 4x4 matrices on the calling thread.
+template<typename S>
+std::size_t
+inverted4_blocks(mat<4,S> const* const a,
+                 mat<4,S>* const b,
+                 uint8* const status,
+                 std::size_t const n) {
+  return inverted_blocks<simd_traits<S>::packet_size>(
+    a, b, status, n, &inverted4_packet<inverted_block,S>);
+}
+
+#if defined(THX_DISPATCH)
+
+template<std::size_t B, typename S> THX_TARGET_AVX THX_FLATTEN
+void
+inverted4_avx(S* const t, S* const d) {
+  inverted4_packet<B, S, avx_traits<S>>(t, d);
+}
+
+template<std::size_t B, typename S> THX_TARGET_AVX512 THX_FLATTEN
+void
+inverted4_avx512(S* const t, S* const d) {
+  inverted4_packet<B, S, avx512_traits<S>>(t, d);
+}
+
+//! Invert n 4x4 matrices on the calling thread, dispatched on active_isa().
+template<typename S>
+std::size_t
+inverted4_dispatch(mat<4,S> const* const a,
+                   mat<4,S>* const b,
+                   uint8* const status,
+                   std::size_t const n) {
+  const isa t = active_isa();
+  if (t >= isa_avx512) {
+    return inverted_blocks<avx512_traits<S>::packet_size>(
+      a, b, status, n, &inverted4_avx512<inverted_block,S>);
+  }
+  if (t >= isa_avx) {
+    return inverted_blocks<avx_traits<S>::packet_size>(
+      a, b, status, n, &inverted4_avx<inverted_block,S>);
+  }
+  return inverted4_blocks<S>(a, b, status, n); // Template, not dispatched.
+}
+
+inline
+std::size_t
+inverted4_blocks(mat<4,float32> const* const a,
+                 mat<4,float32>* const b,
+                 uint8* const status,
+                 std::size_t const n) {
+  return inverted4_dispatch(a, b, status, n);
+}
+
+inline
+std::size_t
+inverted4_blocks(mat<4,float64> const* const a,
+                 mat<4,float64>* const b,
+                 uint8* const status,
+                 std::size_t const n) {
+  return inverted4_dispatch(a, b, status, n);
+}
+
+#endif // THX_DISPATCH
+
+//! Invert n 4x4 matrices on the calling thread.
+template<typename S>
+std::size_t
+inverted4_range(mat<4,S> const* const a,
+                mat<4,S>* const b,
+                uint8* const status,
+                std::size_t const n) {
+  return inverted4_blocks(a, b, status, n);
+}
+
+//! Invert n NxN matrices on the calling thread.
+template<std::size_t N, typename S>
+std::size_t
+inverted_gauss_jacobi(mat<N,S> const* const a,
+                      mat<N,S>* const b,
+                      uint8* const status,
+                      std::size_t const n) {
+  std::size_t singular = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    mat<N,S> c(a[i]); // Copy.
+    mat<N,S> e(1);    // Identity.
+    const bool ok = gauss_jacobi(c, e);
+    b[i] = c;
+    status[i] = (ok ? 1 : 0);
+    singular += (ok ? 0 : 1);
+  }
+  return singular;
+}
+
+//! Run f(a, b, status, n) on sub-ranges in parallel, summing the results.
+template<std::size_t N, typename S, class F>
+std::size_t
+inverted_parallel(mat<N,S> const* const a,
+                  mat<N,S>* const b,
+                  uint8* const status,
+                  std::size_t const n,
+                  F const f) {
+  std::atomic<std::size_t> singular(0);
+  parallel_for(0, n, inverted_grain,
+    [&](std::size_t const i0, std::size_t const i1) {
+      singular += f(a + i0, b + i0, status + i0, i1 - i0);
+    });
+  return singular;
+}
+
+} // Namespace: detail.
+
+//! Batched NxN inversion. See above.
+template<std::size_t N, typename S>
+std::size_t
+inverted(mat<N,S> const* const a,
+         mat<N,S>* const b,
+         uint8* const status,
+         std::size_t const n) {
+  return detail::inverted_parallel(
+    a, b, status, n, &detail::inverted_gauss_jacobi<N,S>);
+}
+
+//! Batched 3x3 inversion. See above.
+template<typename S>
+std::size_t
+inverted(mat<3,S> const* const a,
+         mat<3,S>* const b,
+         uint8* const status,
+         std::size_t const n) {
+  return detail::inverted_parallel(
+    a, b, status, n, &detail::inverted3_range<S>);
+}
+
+//! Batched 4x4 inversion. See above.
+template<typename S>
+std::size_t
+inverted(mat<4,S> const* const a,
+         mat<4,S>* const b,
+         uint8* const status,
+         std::size_t const n) {
+  return detail::inverted_parallel(
+    a, b, status, n, &detail::inverted4_range<S>);
+}
+
+//------------------------------------------------------------------------------
+
+// Batched rotations.
+// ------------------
+//
+// rotation_from_angles(angles, out, n) sets
+//
+//   out[i] = rotation_z(angles[i][2])*rotation_y(angles[i][1])*
+//            rotation_x(angles[i][0])
+//
+// for i in [0, n), with angles in radians, see thx_mat_algo.hpp. Sines and
+// cosines come from the batched sincos, see thx_scalar_batch.hpp, so results
+// match the products of the single-axis rotations to 1e-7 for float32 and
+// 1e-15 for float64. Like the sines and cosines, results do not depend on
+// position or instruction set unless multiplies and adds are contracted.
+//
+// The range is split into chunks that are built on default_thread_pool().
+// Within a chunk, angles are gathered into structure-of-arrays blocks so that
+// simd_traits<S>::packet_size matrices are built at once, or as many as
+// active_isa() allows with run-time dispatch (see thx_cpu.hpp). Relies on
+// vec<3,S> and mat<3,S> arrays being tightly packed.
+
+namespace detail {
+
+//! Number of matrices per parallel task.
+static const std::size_t rotation_grain = 4096;
+
+//! Number of matrices per structure-of-arrays block, a multiple of any
+//! packet_size.
+static const std::size_t rotation_block = 64;
+
+THX_GENERIC_KERNELS_BEGIN
+
+//! Build Simd::packet_size rotations from angles in structure-of-arrays
+//! form, a[c*B + l] is angle c of matrix l. Element k of matrix l, in
+//! column-major order, is written to m[k*B + l].
+template<std::size_t B, typename S, class Simd = simd_traits<S>>
+void
+rotation_packet(S const* const a, S* const m) {
+  typedef Simd simd;
+  typedef typename simd::packet_type packet_type;
+
+  packet_type sx, cx, sy, cy, sz, cz;
+  sincos_packet<S, Simd>(simd::loadu(a), sx, cx);
+  sincos_packet<S, Simd>(simd::loadu(a + B), sy, cy);
+  sincos_packet<S, Simd>(simd::loadu(a + 2*B), sz, cz);
+  const packet_type sysx = simd::mul(sy, sx);
+  const packet_type sycx = simd::mul(sy, cx);
+  simd::storeu(m + 0*B, simd::mul(cz, cy));
+  simd::storeu(m + 1*B, simd::sub(simd::set1(S(0)), simd::mul(sz, cy)));
+  simd::storeu(m + 2*B, sy);
+  simd::storeu(m + 3*B, simd::add(simd::mul(sz, cx), simd::mul(cz, sysx)));
+  simd::storeu(m + 4*B, simd::sub(simd::mul(cz, cx), simd::mul(sz, sysx)));
+  simd::storeu(m + 5*B, simd::sub(simd::set1(S(0)), simd::mul(cy, sx)));
+  simd::storeu(m + 6*B, simd::sub(simd::mul(sz, sx), simd::mul(cz, sycx)));
+  simd::storeu(m + 7*B, simd::add(simd::mul(cz, sx), simd::mul(sz, sycx)));
+  simd::storeu(m + 8*B, simd::mul(cy, cx));
+}
+
+THX_GENERIC_KERNELS_END
+
+//! Build n rotations on the calling thread, one block at a time. kernel
+//! builds P matrices of a block.
+template<std::size_t P, typename S>
+void
+rotation_blocks(vec<3,S> const* const angles,
+                std::size_t const n,
+                mat<3,S>* const out,
+                void (*kernel)(S const*, S*)) {
+  static const std::size_t B = rotation_block;
+
+  S a[3*B];
+  S m[9*B];
+  for (std::size_t i = 0; i < n; i += B) {
+    const std::size_t b = (std::min)(B, n - i);
+    for (std::size_t c = 0; c < 3; ++c) {
+      for (std::size_t l = 0; l < b; ++l) {
+        a[c*B + l] = angles[i + l][c];
+      }
+      for (std::size_t l = b; l < B; ++l) {
+        a[c*B + l] = S(0);
+      }
+    }
+    for (std::size_t j = 0; j < b; j += P) {
+      kernel(a + j, m + j);
+    }
+    for (std::size_t l = 0; l < b; ++l) {
+      S* const d = out[i + l].data();
+      for (std::size_t k = 0; k < 9; ++k) {
+        d[k] = m[k*B + l];
+      }
+    }
+  }
+}
+
+//! Build n rotations on the calling thread.
+template<typename S>
+void
+rotation_range(vec<3,S> const* const angles,
+               std::size_t const n,
+               mat<3,S>* const out) {
+  rotation_blocks<simd_traits<S>::packet_size>(
+    angles, n, out, &rotation_packet<rotation_block,S>);
+}
+
+#if defined(THX_DISPATCH)
+
+template<std::size_t B, typename S> THX_TARGET_AVX THX_FLATTEN
+void
+rotation_avx(S const* const a, S* const m) {
+  rotation_packet<B, S, avx_traits<S>>(a, m);
+}
+
+template<std::size_t B, typename S> THX_TARGET_AVX512 THX_FLATTEN
+void
+rotation_avx512(S const* const a, S* const m) {
+  rotation_packet<B, S, avx512_traits<S>>(a, m);
+}
+
+//! Build n rotations on the calling thread, dispatched on active_isa().
+template<typename S>
+void
+rotation_dispatch(vec<3,S> const* const angles,
+                  std::size_t const n,
+                  mat<3,S>* const out) {
+  const isa i = active_isa();
+  if (i >= isa_avx512) {
+    rotation_blocks<avx512_traits<S>::packet_size>(
+      angles, n, out, &rotation_avx512<rotation_block,S>);
+  }
+  else if (i >= isa_avx) {
+    rotation_blocks<avx_traits<S>::packet_size>(
+      angles, n, out, &rotation_avx<rotation_block,S>);
+  }
+  else {
+    rotation_range<S>(angles, n, out);
+  }
+}
+
+inline
+void
+rotation_range(vec<3,float32> const* const angles,
+               std::size_t const n,
+               mat<3,float32>* const out) {
+  rotation_dispatch(angles, n, out);
+}
+
+inline
+void
+rotation_range(vec<3,float64> const* const angles,
+               std::size_t const n,
+               mat<3,float64>* const out) {
+  rotation_dispatch(angles, n, out);
+}
+
+#endif // THX_DISPATCH
+
+} // Namespace: detail.
+
+//! Batched rotations from angles, S = float32 or float64. See above.
+template<typename S>
+void
+rotation_from_angles(vec<3,S> const* const angles,
+                     mat<3,S>* const out,
+                     std::size_t const n) {
+  parallel_for(0, n, detail::rotation_grain,
+    [&](std::size_t const i0, std::size_t const i1) {
+      detail::rotation_range(angles + i0, i1 - i0, out + i0);
+    });
+}
+
+END_THX_NAMESPACE
+
+#endif // THX_MAT_BATCH_HPP_INCLUDED
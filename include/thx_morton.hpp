@@ -0,0 +1,468 @@
+//------------------------------------------------------------------------------
+//
+// Contributors:
+//             1) Tommy Hinks
+//
+//------------------------------------------------------------------------------
+
+#ifndef THX_MORTON_HPP_INCLUDED
+#define THX_MORTON_HPP_INCLUDED
+
+#include "thx_namespace.hpp"
+#include "thx_define.hpp"
+#include "thx_types.hpp"
+#include "thx_vec.hpp"
+#include "thx_cpu.hpp"
+#include "thx_parallel.hpp"
+#include "thx_radix_sort.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+#if defined(THX_DISPATCH) && (defined(__x86_64__) || defined(_M_X64))
+#  define THX_MORTON_PDEP
+#endif
+
+//------------------------------------------------------------------------------
+
+BEGIN_THX_NAMESPACE
+
+// Morton codes.
+// -------------
+//
+// uint64 morton_encode(uint32 x, uint32 y)
+// uint64 morton_encode(uint32 x, uint32 y, uint32 z)
+// uint64 morton_encode(vec<2,uint32>)
+// uint64 morton_encode(vec<3,uint32>)
+// vec<2,uint32> morton_decode2(uint64)
+// vec<3,uint32> morton_decode3(uint64)
+//
+// morton_bits<N>
+// morton_quantizer<N,S>
+//
+// void morton_encode([quantizer,] vec<N,S> const*, n, uint64*[, thread_pool&])
+// void morton_order(vec<N,S> const*, n, uint32*[, thread_pool&])
+// void morton_sort(vec<N,S>*, n[, thread_pool&])
+//
+// The Morton code, or Z-order index, of a point with integer coordinates
+// interleaves the bits of the coordinates, starting with the lowest bit of x.
+// Points that are close in space mostly have close codes, so sorting by code
+// improves the memory locality of spatial processing, which lexicographic
+// order (less) does not. 2D codes use all 32 bits of each coordinate, 3D codes
+// the low 21 bits (morton_bits<N>).
+//
+// morton_quantizer<N,S> maps floating point vecs in a box to integer
+// coordinates of morton_bits<N> bits. All axes use the same scale, so cells
+// are squares or cubes. Points outside the box are clamped to it and NaN
+// coordinates map to zero.
+//
+// The batched functions quantize floating point vecs with the bounds of the
+// whole array unless a quantizer is given, and use vec<N,uint32> as they are.
+// morton_order writes the permutation that sorts the points by code, ties in
+// input order, so that companion arrays can be reordered the same way.
+// morton_sort reorders the points themselves. Codes are sorted with
+// radix_sort, which skips the high bits that all codes share, and at most
+// 2^32 - 1 points are supported. Codes are computed in parallel, with the
+// BMI2 pdep instruction where it is fast (cpu().fast_pdep, i.e. not on AMD
+// CPUs before Zen 3, where it is microcoded) and with shifts and masks
+// otherwise. pdep is also not used if the active tier has been lowered below
+// AVX2 (all CPUs with BMI2 have AVX2).
+
+//------------------------------------------------------------------------------
+
+//! Bits per coordinate of N-dimensional codes.
+template<std::size_t N>
+struct morton_bits;
+
+template<>
+struct morton_bits<2> {
+  static const uint32 value = 32;
+};
+
+template<>
+struct morton_bits<3> {
+  static const uint32 value = 21;
+};
+
+//------------------------------------------------------------------------------
+
+namespace detail {
+
+//! Bit i of x moved to bit 2i.
+inline THX_CONST_EXPR
+uint64
+morton_spread2(uint32 const x) {
+  uint64 v = x;
+  v = (v | (v << 16)) & 0x0000ffff0000ffffull;
+  v = (v | (v << 8))  & 0x00ff00ff00ff00ffull;
+  v = (v | (v << 4))  & 0x0f0f0f0f0f0f0f0full;
+  v = (v | (v << 2))  & 0x3333333333333333ull;
+  v = (v | (v << 1))  & 0x5555555555555555ull;
+  return v;
+}
+
+//! Bit 2i of v moved to bit i, the inverse of morton_spread2.
+inline THX_CONST_EXPR
+uint32
+morton_compact2(uint64 v) {
+  v &= 0x5555555555555555ull;
+  v = (v | (v >> 1))  & 0x3333333333333333ull;
+  v = (v | (v >> 2))  & 0x0f0f0f0f0f0f0f0full;
+  v = (v | (v >> 4))  & 0x00ff00ff00ff00ffull;
+  v = (v | (v >> 8))  & 0x0000ffff0000ffffull;
+  v = (v | (v >> 16)) & 0x00000000ffffffffull;
+  return static_cast<uint32>(v);
+}
+
+//! Bit i of the low 21 bits of x moved to bit 3i.
+inline THX_CONST_EXPR
+uint64
+morton_spread3(uint32 const x) {
+  uint64 v = x & 0x1fffffu;
+  v = (v | (v << 32)) & 0x001f00000000ffffull;
+  v = (v | (v << 16)) & 0x001f0000ff0000ffull;
+  v = (v | (v << 8))  & 0x100f00f00f00f00full;
+  v = (v | (v << 4))  & 0x10c30c30c30c30c3ull;
+  v = (v | (v << 2))  & 0x1249249249249249ull;
+  return v;
+}
+
+//! Bit 3i of v moved to bit i, the inverse of morton_spread3.
+inline THX_CONST_EXPR
+uint32
+morton_compact3(uint64 v) {
+  v &= 0x1249249249249249ull;
+  v = (v | (v >> 2))  & 0x10c30c30c30c30c3ull;
+  v = (v | (v >> 4))  & 0x100f00f00f00f00full;
+  v = (v | (v >> 8))  & 0x001f0000ff0000ffull;
+  v = (v | (v >> 16)) & 0x001f00000000ffffull;
+  v = (v | (v >> 32)) & 0x00000000001fffffull;
+  return static_cast<uint32>(v);
+}
+
+} // Namespace: detail.
+
+//------------------------------------------------------------------------------
+
+//! 2D Morton code, bits of x at even and bits of y at odd positions.
+inline THX_CONST_EXPR
+uint64
+morton_encode(uint32 const x, uint32 const y) {
+  return detail::morton_spread2(x) | (detail::morton_spread2(y) << 1);
+}
+
+//! 3D Morton code of the low 21 bits of x, y and z.
+inline THX_CONST_EXPR
+uint64
+morton_encode(uint32 const x, uint32 const y, uint32 const z) {
+  return detail::morton_spread3(x) |
+         (detail::morton_spread3(y) << 1) |
+         (detail::morton_spread3(z) << 2);
+}
+
+//! 2D Morton code of v.
+inline THX_CONST_EXPR
+uint64
+morton_encode(vec<2,uint32> const& v) {
+  return morton_encode(v[0], v[1]);
+}
+
+//! 3D Morton code of v.
+inline THX_CONST_EXPR
+uint64
+morton_encode(vec<3,uint32> const& v) {
+  return morton_encode(v[0], v[1], v[2]);
+}
+
+//! Coordinates of a 2D Morton code.
+inline THX_CONST_EXPR
+vec<2,uint32>
+morton_decode2(uint64 const code) {
+  return vec<2,uint32>(detail::morton_compact2(code),
+                       detail::morton_compact2(code >> 1));
+}
+
+//! Coordinates of a 3D Morton code.
+inline THX_CONST_EXPR
+vec<3,uint32>
+morton_decode3(uint64 const code) {
+  return vec<3,uint32>(detail::morton_compact3(code),
+                       detail::morton_compact3(code >> 1),
+                       detail::morton_compact3(code >> 2));
+}
+
+//------------------------------------------------------------------------------
+
+// morton_quantizer<N,S> anatomy:
+// ------------------------------
+//
+// Bounds CTOR
+//
+// vec<N,uint32> operator()(vec<N,S>) const
+// vec<N,S> lo() const
+// S scale() const
+
+//! DOCS
+template<std::size_t N, typename S>
+class morton_quantizer {
+public:
+  static_assert(std::is_floating_point<S>::value,
+                "Scalar type must be floating point");
+
+  //! Largest quantized coordinate.
+  static const uint64 max_level = (uint64(1) << morton_bits<N>::value) - 1;
+
+public: // CTOR's.
+  //! Bounds CTOR, maps the box [lo, hi] to [0, max_level] along its longest
+  //! side.
+  morton_quantizer(vec<N,S> const& lo, vec<N,S> const& hi)
+    : _lo(lo)
+    , _scale(0) {
+    S extent = 0;
+    for (std::size_t i = 0; i < N; ++i) {
+      extent = (std::max)(extent, hi[i] - lo[i]);
+    }
+    if (extent > 0) {
+      _scale = S(max_level)/extent;
+    }
+  }
+
+public: // Operators.
+  //! Quantized coordinates of p.
+  vec<N,uint32>
+  operator()(vec<N,S> const& p) const {
+    vec<N,uint32> q;
+    for (std::size_t i = 0; i < N; ++i) {
+      S const x = (p[i] - _lo[i])*_scale;
+      q[i] = !(x > 0) ? 0 : (x >= S(max_level) ? static_cast<uint32>(max_level)
+                                                : static_cast<uint32>(x));
+    }
+    return q;
+  }
+
+public: // Access.
+  //! Corner mapped to zero.
+  vec<N,S> const&
+  lo() const {
+    return _lo;
+  }
+
+  //! Quantization steps per unit length.
+  S
+  scale() const {
+    return _scale;
+  }
+
+private: // Member variables.
+  vec<N,S> _lo;
+  S _scale;
+};
+
+//------------------------------------------------------------------------------
+
+namespace detail {
+
+//! Points per task of the batched functions.
+const std::size_t morton_grain = 16384;
+
+//! Quantizer for integer coordinates, which are used as they are.
+template<std::size_t N>
+struct morton_identity {
+  vec<N,uint32> const&
+  operator()(vec<N,uint32> const& p) const {
+    return p;
+  }
+};
+
+//! Encoder using shifts and masks.
+struct morton_magic {
+  template<std::size_t N>
+  static
+  uint64
+  encode(vec<N,uint32> const& c) {
+    return morton_encode(c);
+  }
+};
+
+#if defined(THX_MORTON_PDEP)
+
+//! Encoder using the BMI2 pdep instruction.
+struct morton_pdep {
+  THX_TARGET_BMI2 static
+  uint64
+  encode(vec<2,uint32> const& c) {
+    return _pdep_u64(c[0], 0x5555555555555555ull) |
+           _pdep_u64(c[1], 0xaaaaaaaaaaaaaaaaull);
+  }
+
+  THX_TARGET_BMI2 static
+  uint64
+  encode(vec<3,uint32> const& c) {
+    return _pdep_u64(c[0], 0x1249249249249249ull) |
+           _pdep_u64(c[1], 0x2492492492492492ull) |
+           _pdep_u64(c[2], 0x4924924924924924ull);
+  }
+};
+
+#endif // THX_MORTON_PDEP
+
+//! codes[i] = Enc::encode(quantize(p[i])) for i in [i0, i1).
+template<class Enc, std::size_t N, typename S, class Q> inline
+void
+morton_encode_range(Q const& quantize,
+                    vec<N,S> const* const p,
+                    uint64* const codes,
+                    std::size_t const i0,
+                    std::size_t const i1) {
+  for (std::size_t i = i0; i < i1; ++i) {
+    codes[i] = Enc::encode(quantize(p[i]));
+  }
+}
+
+#if defined(THX_MORTON_PDEP)
+
+template<std::size_t N, typename S, class Q>
+THX_TARGET_BMI2 THX_FLATTEN
+void
+morton_encode_bmi2(Q const& quantize,
+                   vec<N,S> const* const p,
+                   uint64* const codes,
+                   std::size_t const i0,
+                   std::size_t const i1) {
+  morton_encode_range<morton_pdep>(quantize, p, codes, i0, i1);
+}
+
+#endif // THX_MORTON_PDEP
+
+template<std::size_t N, typename S, class Q>
+void
+morton_encode_dispatch(Q const& quantize,
+                       vec<N,S> const* const p,
+                       uint64* const codes,
+                       std::size_t const i0,
+                       std::size_t const i1) {
+#if defined(THX_MORTON_PDEP)
+  if (cpu().fast_pdep && active_isa() >= isa_avx2) {
+    morton_encode_bmi2(quantize, p, codes, i0, i1);
+    return;
+  }
+#endif
+  morton_encode_range<morton_magic>(quantize, p, codes, i0, i1);
+}
+
+//! Quantizer for the bounds of p[0..n).
+template<std::size_t N, typename S>
+morton_quantizer<N,S>
+morton_bounds(vec<N,S> const* const p,
+              std::size_t const n,
+              thread_pool& pool) {
+  vec<N,S> lo(std::numeric_limits<S>::max());
+  vec<N,S> hi(-std::numeric_limits<S>::max());
+  std::mutex mutex;
+  parallel_for(0, n, morton_grain,
+    [&](std::size_t const i0, std::size_t const i1) {
+      vec<N,S> clo(std::numeric_limits<S>::max());
+      vec<N,S> chi(-std::numeric_limits<S>::max());
+      for (std::size_t i = i0; i < i1; ++i) {
+        for (std::size_t k = 0; k < N; ++k) {
+          clo[k] = p[i][k] < clo[k] ? p[i][k] : clo[k];
+          chi[k] = p[i][k] > chi[k] ? p[i][k] : chi[k];
+        }
+      }
+      std::lock_guard<std::mutex> lock(mutex);
+      for (std::size_t k = 0; k < N; ++k) {
+        lo[k] = (std::min)(lo[k], clo[k]);
+        hi[k] = (std::max)(hi[k], chi[k]);
+      }
+    }, pool);
+  return morton_quantizer<N,S>(lo, hi);
+}
+
+} // Namespace: detail.
+
+//------------------------------------------------------------------------------
+
+//! codes[i] = morton_encode(quantize(p[i])), see above.
+template<std::size_t N, typename S>
+void
+morton_encode(morton_quantizer<N,S> const& quantize,
+              vec<N,S> const* const p,
+              std::size_t const n,
+              uint64* const codes,
+              thread_pool& pool = default_thread_pool()) {
+  parallel_for(0, n, detail::morton_grain,
+    [&](std::size_t const i0, std::size_t const i1) {
+      detail::morton_encode_dispatch(quantize, p, codes, i0, i1);
+    }, pool);
+}
+
+//! codes[i] = morton_encode(p[i]).
+template<std::size_t N>
+void
+morton_encode(vec<N,uint32> const* const p,
+              std::size_t const n,
+              uint64* const codes,
+              thread_pool& pool = default_thread_pool()) {
+  detail::morton_identity<N> const quantize;
+  parallel_for(0, n, detail::morton_grain,
+    [&](std::size_t const i0, std::size_t const i1) {
+      detail::morton_encode_dispatch(quantize, p, codes, i0, i1);
+    }, pool);
+}
+
+//! Morton codes of p quantized with the bounds of p[0..n).
+template<std::size_t N, typename S>
+void
+morton_encode(vec<N,S> const* const p,
+              std::size_t const n,
+              uint64* const codes,
+              thread_pool& pool = default_thread_pool()) {
+  morton_encode(detail::morton_bounds(p, n, pool), p, n, codes, pool);
+}
+
+//! Permutation that sorts p[0..n) by Morton code: p[order[0]],
+//! p[order[1]], ... are in Z-order.
+template<std::size_t N, typename S>
+void
+morton_order(vec<N,S> const* const p,
+             std::size_t const n,
+             uint32* const order,
+             thread_pool& pool = default_thread_pool()) {
+  std::vector<uint64> codes(n);
+  morton_encode(p, n, codes.data(), pool);
+  parallel_for(0, n, detail::morton_grain,
+    [&](std::size_t const i0, std::size_t const i1) {
+      for (std::size_t i = i0; i < i1; ++i) {
+        order[i] = static_cast<uint32>(i);
+      }
+    }, pool);
+  radix_sort(codes.data(), order, n, pool);
+}
+
+//! Reorder p[0..n) by Morton code.
+template<std::size_t N, typename S>
+void
+morton_sort(vec<N,S>* const p,
+            std::size_t const n,
+            thread_pool& pool = default_thread_pool()) {
+  std::vector<uint32> order(n);
+  morton_order(p, n, order.data(), pool);
+  std::vector<vec<N,S>> sorted(n);
+  parallel_for(0, n, detail::morton_grain,
+    [&](std::size_t const i0, std::size_t const i1) {
+      for (std::size_t i = i0; i < i1; ++i) {
+        sorted[i] = p[order[i]];
+      }
+    }, pool);
+  parallel_for(0, n, detail::morton_grain,
+    [&](std::size_t const i0, std::size_t const i1) {
+      std::copy(sorted.begin() + i0, sorted.begin() + i1, p + i0);
+    }, pool);
+}
+
+END_THX_NAMESPACE
+
+#endif // THX_MORTON_HPP_INCLUDED
@@ -22,7 +22,7 @@
 BEGIN_THX_NAMESPACE
 
 //! Unary operator: -vec<N,S>
-template<int64 N, typename S>
+template<std::size_t N, typename S> inline THX_CONST_EXPR
 vec<N,S>
 operator-(vec<N,S> const& v) {
   return vec_negate(v);
@@ -31,7 +31,7 @@ operator-(vec<N,S> const& v) {
 //------------------------------------------------------------------------------
 
 //! Binary operator: vec<N,S> == vec<N,S>
-template<int64 N, typename S>
+template<std::size_t N, typename S> inline THX_CONST_EXPR
 bool
 operator==(vec<N,S> const& u, vec<N,S> const& v) {
   return vec_equal(u, v);
@@ -40,7 +40,7 @@ operator==(vec<N,S> const& u, vec<N,S> const& v) {
 //------------------------------------------------------------------------------
 
 //! Binary operator: vec<N,S> != vec<N,S>
-template<int64 N, typename S>
+template<std::size_t N, typename S> inline THX_CONST_EXPR
 bool
 operator!=(vec<N,S> const& u, vec<N,S> const& v) {	
   return vec_not_equal(u, v);
@@ -49,7 +49,7 @@ operator!=(vec<N,S> const& u, vec<N,S> const& v) {
 //------------------------------------------------------------------------------
 
 //! Binary operator: vec<N,S> + vec<N,S>
-template<int64 N, typename S>
+template<std::size_t N, typename S> inline THX_CONST_EXPR
 vec<N,S>
 operator+(vec<N,S> const& u, vec<N,S> const& v) { 
   return vec_add(u, v);
@@ -58,7 +58,7 @@ operator+(vec<N,S> const& u, vec<N,S> const& v) {
 //------------------------------------------------------------------------------
 
 //! Binary operator: vec<N,S> - vec<N,S>
-template<int64 N, typename S>
+template<std::size_t N, typename S> inline THX_CONST_EXPR
 vec<N,S>
 operator-(vec<N,S> const& u, vec<N,S> const& v) { 
   return vec_subtract(u, v);
@@ -67,7 +67,7 @@ operator-(vec<N,S> const& u, vec<N,S> const& v) {
 //------------------------------------------------------------------------------
 
 //! Binary operator: scalar * vec<N,S>
-template<int64 N, typename S>
+template<std::size_t N, typename S> inline THX_CONST_EXPR
 vec<N,S>
 operator*(S const s, vec<N,S> const& v) { 
 	return vec_scale(s, v);
@@ -76,7 +76,7 @@ operator*(S const s, vec<N,S> const& v) {
 //------------------------------------------------------------------------------
 
 //! Binary operator: vec<N,S> * scalar
-template<int64 N, typename S>
+template<std::size_t N, typename S> inline THX_CONST_EXPR
 vec<N,S>
 operator*(vec<N,S> const& v, S const s) { 
   return vec_scale(s, v);
@@ -85,7 +85,7 @@ operator*(vec<N,S> const& v, S const s) {
 //------------------------------------------------------------------------------
 
 //! Binary operator: mat<N,S> == mat<N,S>
-template<int64 N, typename S>
+template<std::size_t N, typename S> inline THX_CONST_EXPR
 bool
 operator==(mat<N,S> const& a, mat<N,S> const& b) {
   return mat_equal(a, b);
@@ -94,7 +94,7 @@ operator==(mat<N,S> const& a, mat<N,S> const& b) {
 //------------------------------------------------------------------------------
 
 //! Binary operator: mat<N,S> != mat<N,S>
-template<int64 N, typename S>
+template<std::size_t N, typename S> inline THX_CONST_EXPR
 bool
 operator!=(mat<N,S> const& a, mat<N,S> const& b) {
   return mat_not_equal(a, b);
@@ -103,7 +103,7 @@ operator!=(mat<N,S> const& a, mat<N,S> const& b) {
 //------------------------------------------------------------------------------
 
 //! Binary operator: mat<N,S> + mat<N,S>
-template<int64 N, typename S>
+template<std::size_t N, typename S> inline THX_CONST_EXPR
 mat<N,S>
 operator+(const mat<N,S> &a, const mat<N,S> &b) { 
   return mat_add(a, b);
@@ -112,8 +112,8 @@ operator+(const mat<N,S> &a, const mat<N,S> &b) {
 //------------------------------------------------------------------------------
 
 //! Binary operator: mat<N,S> - mat<N,S>
-template<int64 N, typename S>
-bool
+template<std::size_t N, typename S> inline THX_CONST_EXPR
+mat<N,S>
 operator-(const mat<N,S> &a, const mat<N,S> &b) { 
 	return subtract(a, b); 
 }
@@ -121,14 +121,14 @@ operator-(const mat<N,S> &a, const mat<N,S> &b) {
 //------------------------------------------------------------------------------
 
 //! Binary operator: scalar * mat<N,S>
-template<int64 N, typename S>
+template<std::size_t N, typename S> inline THX_CONST_EXPR
 mat<N,S>
 operator*(const S s, const mat<N,S> &a) { 
 	return mult(s, a);
 }
 
 //! Binary operator: mat<N,S> * scalar
-template<int64 N, typename S>
+template<std::size_t N, typename S> inline THX_CONST_EXPR
 mat<N,S>
 operator*(const mat<N,S> &a, const S s) { 
   return mult(s, a);
@@ -137,7 +137,7 @@ operator*(const mat<N,S> &a, const S s) {
 //------------------------------------------------------------------------------
 
 //! Binary operator: mat<N,S> * mat<N,S>
-template<int64 N, typename S>
+template<std::size_t N, typename S> inline THX_CONST_EXPR
 mat<N,S>
 operator*(const mat<N,S> &a, const mat<N,S> &b)
 { 
@@ -147,7 +147,7 @@ operator*(const mat<N,S> &a, const mat<N,S> &b)
 //------------------------------------------------------------------------------
 
 //! Binary operator: mat<N,S> * vec<N,S>
-template<int64 N, typename S>
+template<std::size_t N, typename S> inline THX_CONST_EXPR
 vec<N,S>
 operator*(const mat<N,S> &a, const vec<N,S> &v) { 
   vec<N,S> u(0);
@@ -161,8 +161,8 @@ operator*(const mat<N,S> &a, const vec<N,S> &v) {
 
 
 //! Binary operator: mat<2,S> * vec<2,S>
-template<typename S>
-vec<2,S> 
+template<typename S> inline THX_CONST_EXPR
+vec<2,S>
 operator*(const mat<2,S> &a, const vec<2,S> &v) {	
   return vec<2,S>(
     a(0,0)*v[0] + a(0,1)*v[1], 
@@ -171,8 +171,8 @@ operator*(const mat<2,S> &a, const vec<2,S> &v) {
 
 
 //! Binary operator: mat<3,S> * vec<3,S>
-template<typename S>
-vec<3,S> 
+template<typename S> inline THX_CONST_EXPR
+vec<3,S>
 operator*(const mat<3,S> &a, const vec<3,S> &v) {	
   return vec<3,S>(
     a(0,0)*v[0] + a(0,1)*v[1] + a(0,2)*v[2],
@@ -181,8 +181,8 @@ operator*(const mat<3,S> &a, const vec<3,S> &v) {
 }
 
 //! Binary operator: mat<4,S> * vec<4,S>
-template<typename S>
-vec<4,S> 
+template<typename S> inline THX_CONST_EXPR
+vec<4,S>
 operator*(const mat<4,S> &a, const vec<4,S> &v) { 
   return vec<4,S>(
     a(0,0)*v[0] + a(0,1)*v[1] + a(0,2)*v[2] + a(0,3)*v[3],
@@ -192,8 +192,8 @@ operator*(const mat<4,S> &a, const vec<4,S> &v) {
 }
 
 //! Binary operator: mat<4,S> * vec<3,S> (assume w = 1)
-template<typename S>
-vec<3,S> 
+template<typename S> inline THX_CONST_EXPR
+vec<3,S>
 operator*(const mat<4,S> &a, const vec<3,S> &v) { 
   return vec<3,S>(
     a(0,0)*v[0] + a(0,1)*v[1] + a(0,2)*v[2] + a(0,3),
@@ -204,11 +204,11 @@ operator*(const mat<4,S> &a, const vec<3,S> &v) {
 //------------------------------------------------------------------------------
 
 //! Binary operator: vec<N,S> * mat<N,S>
-template<int64 N, typename S>
+template<std::size_t N, typename S> inline THX_CONST_EXPR
 vec<N,S>
 operator*(const vec<N,S> &v, const mat<N,S> &a)
 { 
-    vec<R,S> u(0);
+    vec<N,S> u(0);
     for (auto j = 0; j < N; ++j) {
         for (auto i = 0; i < N; ++i) {
             u[j] += v[i]*a(i,j);
@@ -219,8 +219,8 @@ operator*(const vec<N,S> &v, const mat<N,S> &a)
 
 
 //! Binary operator: vec<2,S> * mat<2,S>
-template<typename S>
-vec<2,S> 
+template<typename S> inline THX_CONST_EXPR
+vec<2,S>
 operator*(const vec<2,S> &v, const mat<2,S> &a)
 {	
     return vec<2,S>(
@@ -230,8 +230,8 @@ operator*(const vec<2,S> &v, const mat<2,S> &a)
 
 
 //! Binary operator: vec<3,S> * mat<3,S>
-template<typename S>
-vec<3,S> 
+template<typename S> inline THX_CONST_EXPR
+vec<3,S>
 operator*(const vec<3,S> &v, const mat<3,S> &a)
 {	
     return vec<3,S>(
@@ -242,8 +242,8 @@ operator*(const vec<3,S> &v, const mat<3,S> &a)
 
 
 //! Binary operator: vec<4,S> * mat<4,S>
-template<typename S>
-vec<4,S> 
+template<typename S> inline THX_CONST_EXPR
+vec<4,S>
 operator*(const vec<4,S> &v, const mat<4,S> &a)
 {	
     return vec<4,S>(
@@ -256,7 +256,7 @@ operator*(const vec<4,S> &v, const mat<4,S> &a)
 //------------------------------------------------------------------------------
 
 // Binary operator: quat == quat
-template<typename S>
+template<typename S> inline THX_CONST_EXPR
 bool
 operator==(const quat<S>& q, const quat<S>& r)
 { 
@@ -266,7 +266,7 @@ operator==(const quat<S>& q, const quat<S>& r)
 //------------------------------------------------------------------------------
 
 // Binary operator: quat != quat
-template<typename S> 
+template<typename S> inline THX_CONST_EXPR
 bool
 operator!=(const quat<S> &q, const quat<S> &r)
 { return !(q == r); }
@@ -274,7 +274,7 @@ operator!=(const quat<S> &q, const quat<S> &r)
 //------------------------------------------------------------------------------
 
 // Binary operator: quat + quat
-template<typename S> 
+template<typename S> inline THX_CONST_EXPR
 quat<S>
 operator+(const quat<S> &q, const quat<S> &r)
 { return quat<S>(q[0] + r[0], q[1] + r[1], q[2] + r[2], q[3] + r[3]); }
@@ -282,7 +282,7 @@ operator+(const quat<S> &q, const quat<S> &r)
 //------------------------------------------------------------------------------
 
 // Binary operator: quat - quat
-template<typename S> 
+template<typename S> inline THX_CONST_EXPR
 quat<S>
 operator-(const quat<S> &q, const quat<S> &r)
 { return quat<S>(q[0] - r[0], q[1] - r[1], q[2] - r[2], q[3] - r[3]); }
@@ -290,7 +290,7 @@ operator-(const quat<S> &q, const quat<S> &r)
 //------------------------------------------------------------------------------
 
 // Binary operator: scalar * quat
-template<typename S> 
+template<typename S> inline THX_CONST_EXPR
 quat<S>
 operator*(const S s, const quat<S> &q)
 { return quat<S>(s*q[0], s*q[1], s*q[2], s*q[3]); }
@@ -298,7 +298,7 @@ operator*(const S s, const quat<S> &q)
 //------------------------------------------------------------------------------
 
 // Binary operator: quat * scalar
-template<typename S> 
+template<typename S> inline THX_CONST_EXPR
 quat<S>
 operator*(const quat<S>& q, const S s)
 { return s*q; }
@@ -306,7 +306,7 @@ operator*(const quat<S>& q, const S s)
 //------------------------------------------------------------------------------
 
 // Binary operator: quat * quat
-template<typename S> 
+template<typename S> inline THX_CONST_EXPR
 quat<S>
 operator*(const quat<S> &q, const quat<S> &r)
 {
@@ -328,7 +328,7 @@ template<size_t N, typename S>
 ostream&
 operator<<(ostream &os, thx::vec<N,S> const& rhs) {
   typedef typename thx::vec<N,S>::size_type size_type;
-  static const size_type size = typename thx::vec<N,S>::linear_size;
+  static const size_type size = thx::vec<N,S>::linear_size;
 
   os  << "[";
   for (size_type i = 0; i < size; ++i) {
@@ -338,23 +338,6 @@ operator<<(ostream &os, thx::vec<N,S> const& rhs) {
   return os;
 }
 
-//! Binary operator: std::ostream << mat<N,S>
-template<size_t N, typename S>
-ostream&
-operator<<(ostream &os, const thx::mat<N,S> &rhs) {
-  typedef typename thx::vec<N,S>::size_type size_type;
-  static const size_type size = typename thx::vec<N,S>::linear_size;
-
-  for (size_type i = 0; i < size; ++i) {
-    os  << "[";
-    for (thx::int64 j = 0; j < size; ++j) {
-      os << rhs(i,j) << (j != (size - 1) ? ", " : "");
-    }
-    os << "]\n";
-  }
-  return os;
-}
-
 END_STD_NAMESPACE
 
 #endif // THX_OPERATORS_HPP_INCLUDED
@@ -0,0 +1,557 @@
+//------------------------------------------------------------------------------
+//
+// Contributors:
+//             1) Tommy Hinks
+//
+//------------------------------------------------------------------------------
+
+#ifndef THX_PACKED_QUAT_HPP_INCLUDED
+#define THX_PACKED_QUAT_HPP_INCLUDED
+
+#include "thx_namespace.hpp"
+#include "thx_define.hpp"
+#include "thx_types.hpp"
+#include "thx_quat.hpp"
+#include "thx_scalar_traits.hpp"
+#include "thx_simd.hpp"
+#include "thx_parallel.hpp"
+#include <cstddef>
+#include <type_traits>
+
+//------------------------------------------------------------------------------
+
+BEGIN_THX_NAMESPACE
+
+// packed_quat<Bits> anatomy:
+// --------------------------
+//
+// Define bits (32, 48 or 64)
+// Define component_bits (10, 15 or 20)
+// Define words (2, 3 or 4)
+// Define max_level
+//
+// constexpr float64 max_error()
+//
+// Default CTOR (identity)
+// quat<S> CTOR (explicit, encodes)
+// (Compiler-generated DTOR, copy CTOR and operator=)
+//
+// uint64 code() const
+// void set_code(uint64)
+//
+// A unit quaternion in "smallest three" form. The component with the largest
+// magnitude is dropped after flipping the sign of the quaternion so that it
+// is positive, which does not change the rotation. The remaining three lie in
+// [-1/sqrt(2), 1/sqrt(2)] and are quantized to component_bits each, with an
+// even number of steps so that zero is exact. The dropped component is
+// recovered from the unit length. The code is
+//
+//   index << 3*component_bits | c0 << 2*component_bits |
+//   c1 << component_bits | c2
+//
+// stored as 16-bit words, least significant first, so that sizeof is bits/8
+// (4, 6 or 8 bytes instead of 16 for quat<float32>).
+
+namespace detail {
+
+template<std::size_t B, typename S>
+uint64
+pack_code(quat<S> const& q);
+
+} // Namespace: detail.
+
+//! DOCS
+template<std::size_t Bits>
+class packed_quat {
+public:
+  static_assert(Bits == 32 || Bits == 48 || Bits == 64,
+                "Bits must be 32, 48 or 64");
+
+  typedef std::size_t size_type;
+
+  static const size_type bits = Bits;
+  static const size_type component_bits = (Bits - 2)/3;
+  static const size_type words = Bits/16;
+
+  //! Largest quantization level, quantized components are in [0, max_level]
+  //! and max_level/2 is zero.
+  static const uint32 max_level = (uint32(1) << component_bits) - 2;
+
+  //! Bound on the absolute error of each component of a decoded unit
+  //! quaternion, up to sign, not counting rounding in the scalar type. Four
+  //! times half a quantization step, the dropped component may be off by
+  //! three half steps.
+  static THX_CONST_EXPR float64
+  max_error() {
+    return 4/(1.4142135623730951*max_level);
+  }
+
+public: // CTOR's.
+  //! Default CTOR, identity rotation.
+  packed_quat() {
+    const uint64 h = max_level/2;
+    set_code((h << 2*component_bits) | (h << component_bits) | h);
+  }
+
+  //! Encode unit quaternion q.
+  template<typename S>
+  explicit
+  packed_quat(quat<S> const& q) {
+    set_code(detail::pack_code<Bits>(q));
+  }
+
+public: // Code.
+  //! Return code, see above.
+  uint64
+  code() const {
+    uint64 c = 0;
+    for (size_type i = words; i > 0; --i) {
+      c = (c << 16) | _v[i - 1];
+    }
+    return c;
+  }
+
+  //! Set code, see above. Bits past bits are ignored.
+  void
+  set_code(uint64 c) {
+    for (size_type i = 0; i < words; ++i) {
+      _v[i] = static_cast<uint16>(c & 0xffff);
+      c >>= 16;
+    }
+  }
+
+private: // Member variables.
+  uint16 _v[words]; //!< Code, least significant word first.
+};
+
+//------------------------------------------------------------------------------
+
+namespace detail {
+
+//! Smallest three code of unit quaternion q, see above.
+template<std::size_t B, typename S>
+uint64
+pack_code(quat<S> const& q) {
+  static_assert(std::is_floating_point<S>::value,
+                "Scalar type must be floating point");
+
+  typedef packed_quat<B> packed_type;
+
+  const S scale = S(packed_type::max_level*0.70710678118654752440);
+  const S offset = S(packed_type::max_level/2) + S(0.5);
+  const S top = S(packed_type::max_level);
+
+  std::size_t i = 0;
+  S m = (q[0] < 0 ? -q[0] : q[0]);
+  for (std::size_t k = 1; k < 4; ++k) {
+    const S a = (q[k] < 0 ? -q[k] : q[k]);
+    i = (a > m ? k : i);
+    m = (a > m ? a : m);
+  }
+  const S s = (q[i] < 0 ? S(-1) : S(1));
+  uint64 c = i;
+  for (std::size_t j = 0; j < 3; ++j) {
+    S x = s*q[j < i ? j : j + 1]*scale + offset;
+    x = (x < 0 ? S(0) : x);
+    x = (x > top ? top : x);
+    c = (c << packed_type::component_bits) | static_cast<uint32>(x);
+  }
+  return c;
+}
+
+//! Unit quaternion of smallest three code c, see above.
+template<std::size_t B, typename S>
+quat<S>
+unpack_code(uint64 const c) {
+  static_assert(std::is_floating_point<S>::value,
+                "Scalar type must be floating point");
+
+  typedef packed_quat<B> packed_type;
+  static const std::size_t b = packed_type::component_bits;
+
+  const uint64 mask = (uint64(1) << b) - 1;
+  const int32 h = static_cast<int32>(packed_type::max_level/2);
+  const S step = S(1.41421356237309504880/packed_type::max_level);
+
+  const std::size_t i = static_cast<std::size_t>((c >> 3*b) & 3);
+  S v[3];
+  for (std::size_t j = 0; j < 3; ++j) {
+    const int32 u = static_cast<int32>((c >> (2 - j)*b) & mask);
+    v[j] = S(u - h)*step;
+  }
+  const S t = 1 - ((v[0]*v[0] + v[1]*v[1]) + v[2]*v[2]);
+  const S w = scalar_traits<S>::sqrt(t > 0 ? t : S(0));
+  quat<S> q;
+  for (std::size_t k = 0; k < 4; ++k) {
+    q[k] = (k < i ? v[k] : (k == i ? w : v[k - 1]));
+  }
+  return q;
+}
+
+} // Namespace: detail.
+
+//------------------------------------------------------------------------------
+
+//! Encode unit quaternion q.
+template<std::size_t B, typename S> inline
+packed_quat<B>
+pack(quat<S> const& q) {
+  return packed_quat<B>(q);
+}
+
+//! Decode p, which equals the encoded quaternion up to sign and
+//! packed_quat<B>::max_error() per component.
+template<typename S, std::size_t B> inline
+quat<S>
+unpack(packed_quat<B> const& p) {
+  return detail::unpack_code<B,S>(p.code());
+}
+
+//! Equal codes.
+template<std::size_t B> inline
+bool
+operator==(packed_quat<B> const& p, packed_quat<B> const& r) {
+  return p.code() == r.code();
+}
+
+template<std::size_t B> inline
+bool
+operator!=(packed_quat<B> const& p, packed_quat<B> const& r) {
+  return !(p == r);
+}
+
+//------------------------------------------------------------------------------
+
+// Batched encoding.
+// -----------------
+//
+// pack(q, out, n) encodes q[0..n) to out[0..n) and unpack(p, out, n) decodes
+// p[0..n) to out[0..n). Results are identical to the single element
+// functions as long as these are not contracted into fused multiply-add
+// instructions, see thx_cpu.hpp. Otherwise a component may be rounded to an
+// adjacent level.
+//
+// The range is split into chunks that are processed on default_thread_pool().
+// With SSE2, float32 quaternions are processed four at a time: the largest
+// component is found with compares and masks instead of branches, and the
+// fields are shifted into place in 32-bit lanes, holding the low and high
+// halves of the 48 and 64-bit codes in separate packets.
+
+namespace detail {
+
+//! Number of quaternions per parallel task.
+static const std::size_t packed_grain = 16384;
+
+//! Encode n quaternions on the calling thread.
+template<std::size_t B, typename S>
+void
+pack_range(quat<S> const* const q,
+           packed_quat<B>* const out,
+           std::size_t const n) {
+  for (std::size_t i = 0; i < n; ++i) {
+    out[i] = packed_quat<B>(q[i]);
+  }
+}
+
+//! Decode n quaternions on the calling thread.
+template<std::size_t B, typename S>
+void
+unpack_range(packed_quat<B> const* const p,
+             quat<S>* const out,
+             std::size_t const n) {
+  for (std::size_t i = 0; i < n; ++i) {
+    out[i] = unpack<S>(p[i]);
+  }
+}
+
+#if defined(THX_SSE2)
+
+//! Bits [s, s + 32) of the 64-bit values whose low and high halves are in lo
+//! and hi.
+inline
+__m128i
+packed_shr_sse(__m128i const lo, __m128i const hi, int const s) {
+  if (s == 0) {
+    return lo;
+  }
+  if (s < 32) {
+    return _mm_or_si128(_mm_srl_epi32(lo, _mm_cvtsi32_si128(s)),
+                        _mm_sll_epi32(hi, _mm_cvtsi32_si128(32 - s)));
+  }
+  return _mm_srl_epi32(hi, _mm_cvtsi32_si128(s - 32));
+}
+
+//! Or f << s into the 64-bit values whose low and high halves are in lo and
+//! hi.
+inline
+void
+packed_shl_or_sse(__m128i const f, int const s, __m128i& lo, __m128i& hi) {
+  if (s < 32) {
+    lo = _mm_or_si128(lo, _mm_sll_epi32(f, _mm_cvtsi32_si128(s)));
+    if (s > 0) {
+      hi = _mm_or_si128(hi, _mm_srl_epi32(f, _mm_cvtsi32_si128(32 - s)));
+    }
+  }
+  else {
+    hi = _mm_or_si128(hi, _mm_sll_epi32(f, _mm_cvtsi32_si128(s - 32)));
+  }
+}
+
+//! Lanes of a where m is set, lanes of b elsewhere.
+inline
+__m128
+packed_select_sse(__m128 const m, __m128 const a, __m128 const b) {
+  return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+}
+
+inline
+void
+packed_store_sse(__m128i const lo, __m128i, packed_quat<32>* const out) {
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out), lo);
+}
+
+inline
+void
+packed_store_sse(__m128i const lo,
+                 __m128i const hi,
+                 packed_quat<48>* const out) {
+  uint32 l[4];
+  uint32 h[4];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(l), lo);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(h), hi);
+  for (std::size_t k = 0; k < 4; ++k) {
+    out[k].set_code((uint64(h[k]) << 32) | l[k]);
+  }
+}
+
+inline
+void
+packed_store_sse(__m128i const lo,
+                 __m128i const hi,
+                 packed_quat<64>* const out) {
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+                   _mm_unpacklo_epi32(lo, hi));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2),
+                   _mm_unpackhi_epi32(lo, hi));
+}
+
+inline
+void
+packed_load_sse(packed_quat<32> const* const p, __m128i& lo, __m128i& hi) {
+  lo = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+  hi = _mm_setzero_si128();
+}
+
+//! Split four little-endian 64-bit codes at p, 16 bytes of any type, into
+//! their low and high 32 bits.
+inline
+void
+packed_load_sse_u64(void const* const p, __m128i& lo, __m128i& hi) {
+  __m128i const* const v = static_cast<__m128i const*>(p);
+  const __m128 a = _mm_castsi128_ps(_mm_loadu_si128(v));
+  const __m128 b = _mm_castsi128_ps(_mm_loadu_si128(v + 1));
+  lo = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+  hi = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+inline
+void
+packed_load_sse(packed_quat<64> const* const p, __m128i& lo, __m128i& hi) {
+  packed_load_sse_u64(p, lo, hi);
+}
+
+inline
+void
+packed_load_sse(packed_quat<48> const* const p, __m128i& lo, __m128i& hi) {
+  uint64 c[4];
+  for (std::size_t k = 0; k < 4; ++k) {
+    c[k] = p[k].code();
+  }
+  packed_load_sse_u64(c, lo, hi);
+}
+
+//! Encode four float32 quaternions, see pack_code.
+template<std::size_t B> inline
+void
+pack_sse(quat<float32> const* const q, packed_quat<B>* const out) {
+  typedef packed_quat<B> packed_type;
+  static const int b = static_cast<int>(packed_type::component_bits);
+
+  __m128 c0 = _mm_loadu_ps(&q[0][0]);
+  __m128 c1 = _mm_loadu_ps(&q[1][0]);
+  __m128 c2 = _mm_loadu_ps(&q[2][0]);
+  __m128 c3 = _mm_loadu_ps(&q[3][0]);
+  _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+  // Index and value of the component with the largest magnitude, the first
+  // one on ties.
+  const __m128 sign = _mm_set1_ps(-0.f);
+  __m128 m = _mm_andnot_ps(sign, c0);
+  __m128 qm = c0;
+  __m128 i = _mm_setzero_ps();
+  __m128 a = _mm_andnot_ps(sign, c1);
+  __m128 gt = _mm_cmpgt_ps(a, m);
+  m = _mm_max_ps(m, a);
+  qm = packed_select_sse(gt, c1, qm);
+  i = packed_select_sse(gt, _mm_castsi128_ps(_mm_set1_epi32(1)), i);
+  a = _mm_andnot_ps(sign, c2);
+  gt = _mm_cmpgt_ps(a, m);
+  m = _mm_max_ps(m, a);
+  qm = packed_select_sse(gt, c2, qm);
+  i = packed_select_sse(gt, _mm_castsi128_ps(_mm_set1_epi32(2)), i);
+  a = _mm_andnot_ps(sign, c3);
+  gt = _mm_cmpgt_ps(a, m);
+  qm = packed_select_sse(gt, c3, qm);
+  i = packed_select_sse(gt, _mm_castsi128_ps(_mm_set1_epi32(3)), i);
+  const __m128i idx = _mm_castps_si128(i);
+
+  // Flip so that the dropped component is positive.
+  const __m128 flip = _mm_and_ps(qm, sign);
+  c0 = _mm_xor_ps(c0, flip);
+  c1 = _mm_xor_ps(c1, flip);
+  c2 = _mm_xor_ps(c2, flip);
+  c3 = _mm_xor_ps(c3, flip);
+
+  // Remaining components, in order.
+  const __m128 s0 = packed_select_sse(
+    _mm_castsi128_ps(_mm_cmpgt_epi32(idx, _mm_set1_epi32(0))), c0, c1);
+  const __m128 s1 = packed_select_sse(
+    _mm_castsi128_ps(_mm_cmpgt_epi32(idx, _mm_set1_epi32(1))), c1, c2);
+  const __m128 s2 = packed_select_sse(
+    _mm_castsi128_ps(_mm_cmpgt_epi32(idx, _mm_set1_epi32(2))), c2, c3);
+
+  const __m128 scale = _mm_set1_ps(
+    float32(packed_type::max_level*0.70710678118654752440));
+  const __m128 offset = _mm_set1_ps(
+    float32(packed_type::max_level/2) + float32(0.5));
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 top = _mm_set1_ps(float32(packed_type::max_level));
+  const __m128i u0 = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(
+    _mm_add_ps(_mm_mul_ps(s0, scale), offset), zero), top));
+  const __m128i u1 = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(
+    _mm_add_ps(_mm_mul_ps(s1, scale), offset), zero), top));
+  const __m128i u2 = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(
+    _mm_add_ps(_mm_mul_ps(s2, scale), offset), zero), top));
+
+  __m128i lo = u2;
+  __m128i hi = _mm_setzero_si128();
+  packed_shl_or_sse(u1, b, lo, hi);
+  packed_shl_or_sse(u0, 2*b, lo, hi);
+  packed_shl_or_sse(idx, 3*b, lo, hi);
+  packed_store_sse(lo, hi, out);
+}
+
+//! Decode four float32 quaternions, see unpack_code.
+template<std::size_t B> inline
+void
+unpack_sse(packed_quat<B> const* const p, quat<float32>* const out) {
+  typedef packed_quat<B> packed_type;
+  static const int b = static_cast<int>(packed_type::component_bits);
+
+  __m128i lo;
+  __m128i hi;
+  packed_load_sse(p, lo, hi);
+
+  const __m128i mask = _mm_set1_epi32((1 << b) - 1);
+  const __m128i h =
+    _mm_set1_epi32(static_cast<int32>(packed_type::max_level/2));
+  const __m128 step = _mm_set1_ps(
+    float32(1.41421356237309504880/packed_type::max_level));
+  const __m128i idx = _mm_and_si128(packed_shr_sse(lo, hi, 3*b),
+                                    _mm_set1_epi32(3));
+  const __m128 v0 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(
+    _mm_and_si128(packed_shr_sse(lo, hi, 2*b), mask), h)), step);
+  const __m128 v1 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(
+    _mm_and_si128(packed_shr_sse(lo, hi, b), mask), h)), step);
+  const __m128 v2 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(
+    _mm_and_si128(lo, mask), h)), step);
+  const __m128 t = _mm_sub_ps(_mm_set1_ps(1), _mm_add_ps(
+    _mm_add_ps(_mm_mul_ps(v0, v0), _mm_mul_ps(v1, v1)), _mm_mul_ps(v2, v2)));
+  const __m128 w = _mm_sqrt_ps(_mm_max_ps(t, _mm_setzero_ps()));
+
+  const __m128 gt0 = _mm_castsi128_ps(_mm_cmpgt_epi32(idx, _mm_set1_epi32(0)));
+  const __m128 gt1 = _mm_castsi128_ps(_mm_cmpgt_epi32(idx, _mm_set1_epi32(1)));
+  const __m128 gt2 = _mm_castsi128_ps(_mm_cmpgt_epi32(idx, _mm_set1_epi32(2)));
+  const __m128 eq1 = _mm_castsi128_ps(_mm_cmpeq_epi32(idx, _mm_set1_epi32(1)));
+  const __m128 eq2 = _mm_castsi128_ps(_mm_cmpeq_epi32(idx, _mm_set1_epi32(2)));
+  const __m128 eq3 = _mm_castsi128_ps(_mm_cmpeq_epi32(idx, _mm_set1_epi32(3)));
+  __m128 c0 = packed_select_sse(gt0, v0, w);
+  __m128 c1 = packed_select_sse(gt1, v1, packed_select_sse(eq1, w, v0));
+  __m128 c2 = packed_select_sse(gt2, v2, packed_select_sse(eq2, w, v1));
+  __m128 c3 = packed_select_sse(eq3, w, v2);
+  _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+  _mm_storeu_ps(&out[0][0], c0);
+  _mm_storeu_ps(&out[1][0], c1);
+  _mm_storeu_ps(&out[2][0], c2);
+  _mm_storeu_ps(&out[3][0], c3);
+}
+
+//! Encode n float32 quaternions on the calling thread, SSE2 version.
+template<std::size_t B>
+void
+pack_range(quat<float32> const* const q,
+           packed_quat<B>* const out,
+           std::size_t const n) {
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    pack_sse(q + i, out + i);
+  }
+  for (; i < n; ++i) {
+    out[i] = packed_quat<B>(q[i]);
+  }
+}
+
+//! Decode n float32 quaternions on the calling thread, SSE2 version.
+template<std::size_t B>
+void
+unpack_range(packed_quat<B> const* const p,
+             quat<float32>* const out,
+             std::size_t const n) {
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    unpack_sse(p + i, out + i);
+  }
+  for (; i < n; ++i) {
+    out[i] = unpack<float32>(p[i]);
+  }
+}
+
+#endif // THX_SSE2
+
+} // Namespace: detail.
+
+//! Batched encoding. See above.
+template<std::size_t B, typename S>
+void
+pack(quat<S> const* const q,
+     packed_quat<B>* const out,
+     std::size_t const n) {
+  parallel_for(0, n, detail::packed_grain,
+    [&](std::size_t const i0, std::size_t const i1) {
+      detail::pack_range(q + i0, out + i0, i1 - i0);
+    });
+}
+
+//! Batched decoding. See above.
+template<std::size_t B, typename S>
+void
+unpack(packed_quat<B> const* const p,
+       quat<S>* const out,
+       std::size_t const n) {
+  parallel_for(0, n, detail::packed_grain,
+    [&](std::size_t const i0, std::size_t const i1) {
+      detail::unpack_range(p + i0, out + i0, i1 - i0);
+    });
+}
+
+//------------------------------------------------------------------------------
+
+// Convenient types, add more if appropriate.
+
+typedef packed_quat<32>  packed_quat32;
+typedef packed_quat<48>  packed_quat48;
+typedef packed_quat<64>  packed_quat64;
+
+END_THX_NAMESPACE
+
+#endif // THX_PACKED_QUAT_HPP_INCLUDED
@@ -0,0 +1,296 @@
+//------------------------------------------------------------------------------
+//
+// Contributors:
+//             1) Tommy Hinks
+//
+//------------------------------------------------------------------------------
+
+#ifndef THX_PARALLEL_HPP_INCLUDED
+#define THX_PARALLEL_HPP_INCLUDED
+
+#include "thx_namespace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+BEGIN_THX_NAMESPACE
+
+// thread_pool anatomy:
+// --------------------
+//
+// Size CTOR
+// DTOR (finishes queued tasks, then joins)
+//
+// std::size_t size() const
+// void run(std::function<void()>)
+//
+// Tasks are run by a fixed set of worker threads. Each worker has its own
+// task deque. Tasks queued from a worker go to the back of its own deque and
+// are run newest first, so nested work, e.g. rows within a tile, stays on the
+// thread that has its data in cache. Tasks queued from other threads are
+// spread over the deques round robin. Idle workers steal the oldest task from
+// the other deques, so all workers stay busy without contending on a single
+// queue. The pool is non-copyable.
+
+//! DOCS
+class thread_pool {
+public:
+  //! Size CTOR. A pool without threads is allowed, parallel_for then runs
+  //! everything on the calling thread and run() calls the task directly.
+  explicit
+  thread_pool(std::size_t const threads)
+    : _pending(0)
+    , _next(0)
+    , _stop(false) {
+    _queues.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) {
+      _queues.push_back(std::unique_ptr<_queue>(new _queue));
+    }
+    _threads.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) {
+      _threads.push_back(std::thread(&thread_pool::_work, this, i));
+    }
+  }
+
+  //! DTOR. Queued tasks are run before the workers are joined.
+  ~thread_pool() {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stop = true;
+    }
+    _cv.notify_all();
+    for (std::size_t i = 0; i < _threads.size(); ++i) {
+      _threads[i].join();
+    }
+  }
+
+  //! Number of worker threads.
+  std::size_t
+  size() const {
+    return _threads.size();
+  }
+
+  //! Queue a task. Tasks must not throw.
+  void
+  run(std::function<void()> task) {
+    if (_queues.empty()) {
+      task();
+      return;
+    }
+    const _worker w = _current();
+    const std::size_t q =
+      (w.pool == this ? w.index : _next++ % _queues.size());
+    {
+      // Counted first, so that _pending never drops below zero.
+      std::lock_guard<std::mutex> lock(_mutex);
+      ++_pending;
+    }
+    {
+      std::lock_guard<std::mutex> lock(_queues[q]->mutex);
+      _queues[q]->tasks.push_back(std::move(task));
+    }
+    _cv.notify_one();
+  }
+
+private:
+  thread_pool(thread_pool const&);            // Disabled.
+  thread_pool& operator=(thread_pool const&); // Disabled.
+
+  //! Task deque of a worker.
+  struct _queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  //! Pool and index of the calling thread, if it is a worker.
+  struct _worker {
+    thread_pool const* pool;
+    std::size_t index;
+  };
+
+  static
+  _worker&
+  _current() {
+    static thread_local _worker w = { 0, 0 };
+    return w;
+  }
+
+  //! Take the newest task of worker i, or else steal the oldest task of
+  //! another worker.
+  bool
+  _pop(std::size_t const i, std::function<void()>& task) {
+    const std::size_t n = _queues.size();
+    for (std::size_t k = 0; k < n; ++k) {
+      _queue& q = *_queues[(i + k) % n];
+      std::lock_guard<std::mutex> lock(q.mutex);
+      if (!q.tasks.empty()) {
+        if (k == 0) {
+          task = std::move(q.tasks.back());
+          q.tasks.pop_back();
+        }
+        else {
+          task = std::move(q.tasks.front());
+          q.tasks.pop_front();
+        }
+        --_pending;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  //! Worker loop.
+  void
+  _work(std::size_t const i) {
+    _worker& w = _current();
+    w.pool = this;
+    w.index = i;
+    for (;;) {
+      std::function<void()> task;
+      if (_pop(i, task)) {
+        task();
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(_mutex);
+      while (!_stop && _pending == 0) {
+        _cv.wait(lock);
+      }
+      if (_stop && _pending == 0) {
+        return; // Stopped and drained.
+      }
+    }
+  }
+
+private: // Member variables.
+  std::vector<std::unique_ptr<_queue>> _queues;
+  std::vector<std::thread> _threads;
+  std::atomic<std::size_t> _pending;  //!< Queued tasks, raised under _mutex.
+  std::atomic<std::size_t> _next;     //!< Round robin for outside threads.
+  std::mutex _mutex;
+  std::condition_variable _cv;
+  bool _stop;
+};
+
+//------------------------------------------------------------------------------
+
+//! Process-wide pool used by the parallel algorithms unless another pool is
+//! given. Created on first use with one thread less than the number of
+//! hardware threads, since the calling thread also does work.
+inline
+thread_pool&
+default_thread_pool() {
+  static thread_pool pool(
+    (std::max)(1u, std::thread::hardware_concurrency()) - 1);
+  return pool;
+}
+
+//------------------------------------------------------------------------------
+
+namespace detail {
+
+//! Shared between the caller and the helper tasks of parallel_for. Owned
+//! through a shared_ptr since helpers may start after the caller returned.
+struct parallel_for_state {
+  parallel_for_state(std::size_t const chunks)
+    : next(0)
+    , done(0)
+    , chunks(chunks) {
+  }
+
+  std::atomic<std::size_t> next;  //!< Next chunk to claim.
+  std::size_t done;               //!< Finished chunks, guarded by mutex.
+  std::size_t const chunks;
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::exception_ptr error;       //!< First exception, guarded by mutex.
+};
+
+//! Claim and run chunks until there are none left.
+template<class F>
+void
+parallel_for_chunks(parallel_for_state& s,
+                    std::size_t const begin,
+                    std::size_t const end,
+                    std::size_t const grain,
+                    F const& f) {
+  for (;;) {
+    const std::size_t c = s.next++;
+    if (c >= s.chunks) {
+      return;
+    }
+    const std::size_t i0 = begin + c*grain;
+    const std::size_t i1 = (std::min)(i0 + grain, end);
+    std::exception_ptr error;
+    try {
+      f(i0, i1);
+    }
+    catch (...) {
+      error = std::current_exception();
+    }
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (error && !s.error) {
+      s.error = error;
+    }
+    if (++s.done == s.chunks) {
+      s.cv.notify_all();
+    }
+  }
+}
+
+} // Namespace: detail.
+
+//! Call f(i0, i1) for consecutive sub-ranges [i0, i1) of [begin, end), each
+//! at most grain long, on the calling thread and the threads of pool. Returns
+//! when all sub-ranges have been processed. The first exception thrown by f is
+//! rethrown. Nested calls are allowed, the calling thread always makes
+//! progress on its own sub-ranges.
+template<class F>
+void
+parallel_for(std::size_t const begin,
+             std::size_t const end,
+             std::size_t grain,
+             F const& f,
+             thread_pool& pool = default_thread_pool()) {
+  if (end <= begin) {
+    return;
+  }
+  grain = (std::max)(grain, std::size_t(1));
+  const std::size_t chunks = (end - begin + grain - 1)/grain;
+  if (chunks == 1 || pool.size() == 0) {
+    f(begin, end);
+    return;
+  }
+
+  typedef detail::parallel_for_state state_type;
+  const std::shared_ptr<state_type> s = std::make_shared<state_type>(chunks);
+  F const* const pf = &f;
+  const std::size_t helpers = (std::min)(pool.size(), chunks - 1);
+  for (std::size_t i = 0; i < helpers; ++i) {
+    pool.run([s, begin, end, grain, pf]() {
+      detail::parallel_for_chunks(*s, begin, end, grain, *pf);
+    });
+  }
+  detail::parallel_for_chunks(*s, begin, end, grain, f);
+
+  std::unique_lock<std::mutex> lock(s->mutex);
+  while (s->done < chunks) {
+    s->cv.wait(lock);
+  }
+  if (s->error) {
+    std::rethrow_exception(s->error);
+  }
+}
+
+END_THX_NAMESPACE
+
+#endif // THX_PARALLEL_HPP_INCLUDED
@@ -0,0 +1,116 @@
+//------------------------------------------------------------------------------
+//
+// Contributors:
+//             1) Tommy Hinks
+//
+//------------------------------------------------------------------------------
+
+#ifndef THX_PIXEL_HPP_INCLUDED
+#define THX_PIXEL_HPP_INCLUDED
+
+#include "thx_namespace.hpp"
+#include "thx_define.hpp"
+#include "thx_types.hpp"
+#include "thx_vec.hpp"
+#include <cstddef>
+
+//------------------------------------------------------------------------------
+
+BEGIN_THX_NAMESPACE
+
+// pixel<N,S> anatomy:
+// -------------------
+//
+// typedef vec<N,S>::value_type value_type;
+// typedef std::size_t size_type;
+//
+// define channel_count = N
+//
+// Value constexpr CTOR (set all channels, zero by default)
+// vec<N,S> constexpr CTOR
+// (Compiler-generated copy CTOR, operator= and DTOR)
+//
+// value_type operator[](c) const
+// value_type& operator[](c)
+// vec<N,S> const& channels() const
+//
+// A pixel stores its N channels like vec<N,S>. Images hold pixels either
+// interleaved or as separate planes, see thx_image.hpp.
+
+//! DOCS
+template<std::size_t N, typename S = uint8>
+class pixel {
+public:
+  typedef typename vec<N,S>::value_type value_type;
+  typedef std::size_t size_type;
+
+  static const size_type channel_count = N;
+
+public: // CTOR's.
+  //! Value CTOR, all channels are set to value.
+  explicit THX_CONST_EXPR
+  pixel(value_type const value = 0)
+    : _data(value) {
+  }
+
+  //! vec<N,S> CTOR, channel c is v[c].
+  explicit THX_CONST_EXPR
+  pixel(vec<N,S> const& v)
+    : _data(v) {
+  }
+
+public: // Operator access.
+  //! Returns the value of channel c. No bounds checking!
+  THX_CONST_EXPR value_type
+  operator[](size_type const c) const {
+    return _data[c];
+  }
+
+  //! Returns the value of channel c. No bounds checking!
+  THX_CONST_EXPR value_type&
+  operator[](size_type const c) {
+    return _data[c];
+  }
+
+  //! All channels.
+  THX_CONST_EXPR vec<N,S> const&
+  channels() const {
+    return _data;
+  }
+
+private: // Member variables.
+  vec<N,S> _data; //!< Channel data.
+};
+
+//------------------------------------------------------------------------------
+
+//! True if all channels are equal.
+template<std::size_t N, typename S> inline
+bool
+operator==(pixel<N,S> const& p, pixel<N,S> const& q) {
+  for (std::size_t c = 0; c < N; ++c) {
+    if (p[c] != q[c]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+//! True if any channel differs.
+template<std::size_t N, typename S> inline
+bool
+operator!=(pixel<N,S> const& p, pixel<N,S> const& q) {
+  return !(p == q);
+}
+
+//------------------------------------------------------------------------------
+
+// Convenient types.
+
+typedef pixel<1,uint8> luminance_pixel;
+typedef pixel<3,uint8> rgb_pixel;
+typedef pixel<4,uint8> rgba_pixel;
+
+END_THX_NAMESPACE
+
+#endif // THX_PIXEL_HPP_INCLUDED
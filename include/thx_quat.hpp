@@ -8,6 +8,7 @@
 #ifndef THX_QUAT_HPP_INCLUDED
 #define THX_QUAT_HPP_INCLUDED
 
+#include "thx_define.hpp"
 #include "thx_vec.hpp"
 #include "thx_types.hpp"
 #include <iostream>
@@ -27,52 +28,52 @@ public:
 public:
     
     //! Default CTOR.
-    explicit
+    explicit THX_CONST_EXPR
     quat(const S real = 1)
         : _v(real, 0, 0, 0)
     {}
 
     //! Value CTOR.
-    explicit
+    explicit THX_CONST_EXPR
     quat(const S v0, const S v1, const S v2, const S v3)
         : _v(v0, v1, v2, v3)
     {}
 
     //! Array CTOR.
-    explicit
+    explicit THX_CONST_EXPR
     quat(const S v[4])
         : _v(v)
     {}
 
     //! Vec CTOR.
-    explicit
+    explicit THX_CONST_EXPR
     quat(const vec<4,S> &v)
         : _v(v)
     {}
 
     //! CTOR.
-    explicit
+    explicit THX_CONST_EXPR
     quat(const S real, const vec<3,S> &imag)
-        : v(real, imag[0], imag[1], imag[2])
+        : _v(real, imag[0], imag[1], imag[2])
     {}
 
 public:     // Operators.
 
-    quat<S>&
+    THX_CONST_EXPR quat<S>&
     operator+=(const quat<S> &rhs)
     {
         _v += rhs._v;
         return *this;
     }
 
-    quat<S>&
+    THX_CONST_EXPR quat<S>&
     operator-=(const quat<S> &rhs)
     {
         _v -= rhs._v;
         return *this;
     }
 
-    quat<S>&
+    THX_CONST_EXPR quat<S>&
     operator*=(const S s)
     {
         _v *= s;
@@ -80,7 +81,7 @@ public:     // Operators.
     }
 
     //! Quaternion multiplication.
-    quat<S>&
+    THX_CONST_EXPR quat<S>&
     operator*=(const quat<S> &r)
     {	
         const quat<S> t(*this); // Copy.
@@ -91,11 +92,11 @@ public:     // Operators.
         return *this;
     }
 
-    const S&  
+    THX_CONST_EXPR const S&
     operator[](const int64 i) const	
     { return _v[i]; }
 
-    S& 
+    THX_CONST_EXPR S&
     operator[](const int64 i)		
     { return _v[i]; }
 
@@ -124,7 +125,7 @@ ostream&
 operator<<(ostream& os, const thx::quat<S>& rhs)
 {
 
-    os	<< "[" << rhs[0] << ", " << 
+    os	<< "[" << rhs[0] << ", " 
         << "(" << rhs[1] << ", " << rhs[2] << ", " << rhs[3] << ")]";
     return os;
 }
@@ -9,8 +9,13 @@
 #define THX_QUAT_ALGO_HPP_INCLUDED
 
 #include "thx_quat.hpp"
+#include "thx_arithmetic_type.hpp"
 #include "thx_vec.hpp"
+#include "thx_operators.hpp"
 #include "thx_scalar_traits.hpp"
+#include "thx_fast_scalar_traits.hpp"
+#include <limits>
+#include <type_traits>
 
 //------------------------------------------------------------------------------
 
@@ -23,10 +28,11 @@ template<typename S>
 void
 set_axis_angle(quat<S> &q, const vec<3,S> &axis, const S theta_rad)
 {
-    THX_STATIC_ASSERT(traits<S>::is_floating);
+    static_assert(is_real_scalar<S>::value, 
+                  "Scalar type must be floating point");
     
-    const S st = traits<S>::sin(0.5*theta_rad);
-    const S ct = traits<S>::cos(0.5*theta_rad);
+    S st, ct;
+    scalar_traits<S>::sincos(S(0.5)*theta_rad, st, ct);
 
     q[0] = ct;
     q[1] = st*axis[0];
@@ -34,6 +40,151 @@ set_axis_angle(quat<S> &q, const vec<3,S> &axis, const S theta_rad)
     q[3] = st*axis[2];                
 }
 
+//! As above, precise policy.
+template<typename S> 
+void
+set_axis_angle(quat<S> &q, const vec<3,S> &axis, const S theta_rad, 
+               precise_math_tag)
+{
+    set_axis_angle(q, axis, theta_rad);
+}
+
+//! As above, with fast_scalar_traits<S> sine and cosine.
+template<typename S> 
+void
+set_axis_angle(quat<S> &q, const vec<3,S> &axis, const S theta_rad, 
+               fast_math_tag)
+{
+    static_assert(is_real_scalar<S>::value, 
+                  "Scalar type must be floating point");
+
+    S st, ct;
+    fast_scalar_traits<S>::sincos(S(0.5)*theta_rad, st, ct);
+
+    q[0] = ct;
+    q[1] = st*axis[0];
+    q[2] = st*axis[1];
+    q[3] = st*axis[2];
+}
+
+//------------------------------------------------------------------------------
+
+//! Dot product, q and r seen as 4-vectors.
+template<typename S> inline THX_CONST_EXPR
+S
+dot(const quat<S> &q, const quat<S> &r)
+{
+    return q[0]*r[0] + q[1]*r[1] + q[2]*r[2] + q[3]*r[3];
+}
+
+//------------------------------------------------------------------------------
+
+//! Conjugate, which is the inverse of a unit quaternion.
+template<typename S> inline THX_CONST_EXPR
+quat<S>
+conjugated(const quat<S> &q)
+{
+    return quat<S>(q[0], -q[1], -q[2], -q[3]);
+}
+
+//------------------------------------------------------------------------------
+
+//! Return q scaled to unit length. No divide-by-zero checking!
+template<typename S> inline
+quat<S>
+normalized(const quat<S> &q)
+{
+    static_assert(is_real_scalar<S>::value, 
+                  "Scalar type must be floating point");
+
+    return S(1/scalar_traits<S>::sqrt(dot(q, q)))*q;
+}
+
+//------------------------------------------------------------------------------
+
+//! Scale q to unit length. No divide-by-zero checking!
+template<typename S> inline
+void
+normalize(quat<S> &q)
+{
+    q = normalized(q);
+}
+
+//------------------------------------------------------------------------------
+
+//! Normalized linear interpolation between unit quaternions q and r along
+//! the shorter arc, t in [0, 1]. Constant-time and exact at t = 0, 0.5 and 1,
+//! but the angular velocity is not constant, see slerp_fast.
+template<typename S> inline
+quat<S>
+nlerp(const quat<S> &q, const quat<S> &r, const S t)
+{
+    const S s = dot(q, r) < 0 ? -t : t;
+    return normalized((1 - t)*q + s*r);
+}
+
+//------------------------------------------------------------------------------
+
+//! Spherical linear interpolation between unit quaternions q and r along
+//! the shorter arc, t in [0, 1]. Falls back to linear interpolation when q
+//! and r are too close for the sine ratios to be accurate.
+template<typename S> 
+quat<S>
+slerp(const quat<S> &q, const quat<S> &r, const S t)
+{
+    static_assert(is_real_scalar<S>::value, 
+                  "Scalar type must be floating point");
+
+    typedef scalar_traits<S> traits;
+
+    const S d = dot(q, r);
+    const S ad = d < 0 ? -d : d;
+    S a = 1 - t;
+    S b = t;
+    if (ad < 1 - 16*std::numeric_limits<S>::epsilon()) {
+        const S theta = traits::acos(ad);
+        const S inv_sin = 1/traits::sin(theta);
+        a = traits::sin(a*theta)*inv_sin;
+        b = traits::sin(b*theta)*inv_sin;
+    }
+    return a*q + (d < 0 ? -b : b)*r;
+}
+
+//------------------------------------------------------------------------------
+
+namespace detail {
+
+//! Corrected interpolation parameter for slerp_fast, given the absolute 
+//! cosine d of the half-angle between the quaternions. A cubic in t that 
+//! matches the angle of slerp at t = 0, 0.5 and 1, with coefficients fitted 
+//! over d in [0, 1].
+template<typename S> inline THX_CONST_EXPR
+S
+slerp_fast_t(const S d, const S t)
+{
+    const S a = S(1.0904) + d*(S(-3.2452) + d*(S(3.55645) - d*S(1.43519)));
+    const S b = S(0.848013) + d*(S(-1.06021) + d*S(0.215638));
+    const S k = a*(t - S(0.5))*(t - S(0.5)) + b;
+    return t + t*(t - S(0.5))*(t - 1)*k;
+}
+
+} // Namespace: detail.
+
+//------------------------------------------------------------------------------
+
+//! Approximate slerp, nlerp with a polynomial correction of t so that the
+//! angular velocity is close to constant. No trigonometric functions, the
+//! result deviates from slerp by less than 1e-3 radians of rotation (4e-4 
+//! per component). Unit quaternions only, t in [0, 1].
+template<typename S> inline
+quat<S>
+slerp_fast(const quat<S> &q, const quat<S> &r, const S t)
+{
+    const S d = dot(q, r);
+    const S u = detail::slerp_fast_t(d < 0 ? -d : d, t);
+    return normalized((1 - u)*q + (d < 0 ? -u : u)*r);
+}
+
 //------------------------------------------------------------------------------
 
 //template<typename S> 
@@ -98,26 +249,6 @@ set_axis_angle(quat<S> &q, const vec<3,S> &axis, const S theta_rad)
 
 //------------------------------------------------------------------------------
 
-//template<typename S, class T>
-//void
-//normalize(quaternion<S,T>* q)
-//{
-//	normalize(&q.v);
-//    //a/=mag(a)+std::numeric_limits<T>::min();
-//}
-
-//------------------------------------------------------------------------------
-
-//template<typename S>
-//quat<S>
-//normalized(const quat<S>& q)
-//{
-//	return quat<S,T>(normalized(q.v));
-//    //return a/(mag(a)+std::numeric_limits<T>::min());
-//}
-
-//------------------------------------------------------------------------------
-
 //template<typename T> unsigned int 
 //hash(const quaternion<S,T>& a)
 //{
@@ -0,0 +1,488 @@
+//------------------------------------------------------------------------------
+//
+// Contributors:
+//             1) Tommy Hinks
+//
+//------------------------------------------------------------------------------
+
+#ifndef THX_QUAT_BATCH_HPP_INCLUDED
+#define THX_QUAT_BATCH_HPP_INCLUDED
+
+#include "thx_namespace.hpp"
+#include "thx_types.hpp"
+#include "thx_quat.hpp"
+#include "thx_quat_algo.hpp"
+#include "thx_quat_utils.hpp"
+#include "thx_mat.hpp"
+#include "thx_vec_soa.hpp"
+#include "thx_simd.hpp"
+#include "thx_cpu.hpp"
+#include "thx_parallel.hpp"
+#include <algorithm>
+#include <cstddef>
+
+//------------------------------------------------------------------------------
+
+BEGIN_THX_NAMESPACE
+
+// quat_track<S> anatomy:
+// ----------------------
+//
+// S const* times
+// quat<S> const* keys
+// std::size_t size
+//
+// A rotation animation track, size keys with strictly increasing times. The
+// track does not own the keys. Before the first and after the last key the
+// track holds the first and last key.
+
+//! DOCS
+template<typename S>
+struct quat_track {
+  S const* times;       //!< Key times, strictly increasing.
+  quat<S> const* keys;  //!< Unit key rotations.
+  std::size_t size;     //!< Number of keys, at least one.
+};
+
+//------------------------------------------------------------------------------
+
+// Batched sampling.
+// -----------------
+//
+// sample(tracks, n, t, out) evaluates tracks[0..n) at time t and writes the
+// rotations to out[0..n), interpolating between the surrounding keys with
+// slerp_fast. Results match slerp_fast to rounding.
+//
+// The range is split into chunks that are sampled on default_thread_pool().
+// Within a chunk, the surrounding keys and interpolation parameters are
+// gathered into structure-of-arrays blocks so that simd_traits<S>::packet_size
+// tracks are interpolated at once, or as many as active_isa() allows with
+// run-time dispatch (see thx_cpu.hpp).
+
+namespace detail {
+
+//! Number of tracks per parallel task.
+static const std::size_t sample_grain = 8192;
+
+//! Number of tracks per structure-of-arrays block, a multiple of any
+//! packet_size.
+static const std::size_t sample_block = 64;
+
+//! Components per track in a block: keys (4 + 4), absolute cosine of the
+//! half-angle between them (1) and interpolation parameter (1).
+static const std::size_t sample_components = 10;
+
+//! Find the keys of n <= B tracks around t and gather them into structure-
+//! of-arrays form, t[c*B + l] is component c of track l. The second key is
+//! flipped into the hemisphere of the first. Lanes past n hold identity.
+template<std::size_t B, typename S> inline
+void
+sample_gather(quat_track<S> const* const tracks,
+              std::size_t const n,
+              S const t,
+              S* const buf) {
+  for (std::size_t l = 0; l < n; ++l) {
+    quat_track<S> const& tr = tracks[l];
+    std::size_t i = 0;
+    std::size_t j = 0;
+    S u = 0;
+    if (t >= tr.times[tr.size - 1]) {
+      i = j = tr.size - 1;
+    }
+    else if (t > tr.times[0]) {
+      j = std::upper_bound(tr.times, tr.times + tr.size, t) - tr.times;
+      i = j - 1;
+      u = (t - tr.times[i])/(tr.times[j] - tr.times[i]);
+    }
+    quat<S> const& q = tr.keys[i];
+    quat<S> const& r = tr.keys[j];
+    const S d = dot(q, r);
+    const S s = (d < 0 ? S(-1) : S(1));
+    for (std::size_t c = 0; c < 4; ++c) {
+      buf[c*B + l] = q[c];
+      buf[(c + 4)*B + l] = s*r[c];
+    }
+    buf[8*B + l] = s*d;
+    buf[9*B + l] = u;
+  }
+  for (std::size_t l = n; l < B; ++l) {
+    for (std::size_t c = 0; c < sample_components; ++c) {
+      buf[c*B + l] = (c == 0 || c == 4 || c == 8 ? S(1) : S(0));
+    }
+  }
+}
+
+//! Scatter the first n interpolated rotations of buf.
+template<std::size_t B, typename S> inline
+void
+sample_scatter(S const* const buf, std::size_t const n, quat<S>* const out) {
+  for (std::size_t l = 0; l < n; ++l) {
+    out[l] = quat<S>(buf[0*B + l], buf[1*B + l], buf[2*B + l], buf[3*B + l]);
+  }
+}
+
+THX_GENERIC_KERNELS_BEGIN
+
+//! Interpolate Simd::packet_size tracks in structure-of-arrays form, see
+//! slerp_fast. The results are stored over the first keys.
+template<std::size_t B, typename S, class Simd = simd_traits<S>>
+void
+sample_packet(S* const buf) {
+  typedef Simd simd;
+  typedef typename simd::packet_type packet_type;
+
+  const packet_type one = simd::set1(S(1));
+  const packet_type half = simd::set1(S(0.5));
+  const packet_type d = simd::loadu(buf + 8*B);
+  const packet_type t = simd::loadu(buf + 9*B);
+
+  // Corrected parameter, see detail::slerp_fast_t.
+  const packet_type a = simd::add(simd::set1(S(1.0904)), simd::mul(d,
+    simd::add(simd::set1(S(-3.2452)), simd::mul(d,
+      simd::sub(simd::set1(S(3.55645)), simd::mul(d, simd::set1(S(1.43519))))))));
+  const packet_type b = simd::add(simd::set1(S(0.848013)), simd::mul(d,
+    simd::add(simd::set1(S(-1.06021)), simd::mul(d, simd::set1(S(0.215638))))));
+  const packet_type th = simd::sub(t, half);
+  const packet_type k = simd::add(simd::mul(simd::mul(a, th), th), b);
+  const packet_type u = simd::add(t,
+    simd::mul(simd::mul(simd::mul(t, th), simd::sub(t, one)), k));
+  const packet_type v = simd::sub(one, u);
+
+  packet_type q[4];
+  packet_type m = simd::set1(S(0));
+  for (std::size_t c = 0; c < 4; ++c) {
+    q[c] = simd::add(simd::mul(v, simd::loadu(buf + c*B)),
+                     simd::mul(u, simd::loadu(buf + (c + 4)*B)));
+    m = simd::add(m, simd::mul(q[c], q[c]));
+  }
+  const packet_type inv_mag = simd::div(one, simd::sqrt(m));
+  for (std::size_t c = 0; c < 4; ++c) {
+    simd::storeu(buf + c*B, simd::mul(q[c], inv_mag));
+  }
+}
+
+THX_GENERIC_KERNELS_END
+
+//! Sample n tracks on the calling thread, one block at a time. kernel
+//! interpolates P tracks of a block in place.
+template<std::size_t P, typename S>
+void
+sample_blocks(quat_track<S> const* const tracks,
+              std::size_t const n,
+              S const t,
+              quat<S>* const out,
+              void (*kernel)(S*)) {
+  static const std::size_t B = sample_block;
+
+  S buf[sample_components*B];
+  for (std::size_t i = 0; i < n; i += B) {
+    const std::size_t m = (std::min)(B, n - i);
+    sample_gather<B>(tracks + i, m, t, buf);
+    for (std::size_t j = 0; j < m; j += P) {
+      kernel(buf + j);
+    }
+    sample_scatter<B>(buf, m, out + i);
+  }
+}
+
+//! Sample n tracks on the calling thread.
+template<typename S>
+void
+sample_range(quat_track<S> const* const tracks,
+             std::size_t const n,
+             S const t,
+             quat<S>* const out) {
+  sample_blocks<simd_traits<S>::packet_size>(
+    tracks, n, t, out, &sample_packet<sample_block,S>);
+}
+
+#if defined(THX_DISPATCH)
+
+template<std::size_t B, typename S> THX_TARGET_AVX THX_FLATTEN
+void
+sample_avx(S* const buf) {
+  sample_packet<B, S, avx_traits<S>>(buf);
+}
+
+template<std::size_t B, typename S> THX_TARGET_AVX512 THX_FLATTEN
+void
+sample_avx512(S* const buf) {
+  sample_packet<B, S, avx512_traits<S>>(buf);
+}
+
+//! Sample n tracks on the calling thread, dispatched on active_isa().
+template<typename S>
+void
+sample_dispatch(quat_track<S> const* const tracks,
+                std::size_t const n,
+                S const t,
+                quat<S>* const out) {
+  const isa i = active_isa();
+  if (i >= isa_avx512) {
+    sample_blocks<avx512_traits<S>::packet_size>(
+      tracks, n, t, out, &sample_avx512<sample_block,S>);
+  }
+  else if (i >= isa_avx) {
+    sample_blocks<avx_traits<S>::packet_size>(
+      tracks, n, t, out, &sample_avx<sample_block,S>);
+  }
+  else {
+    sample_range<S>(tracks, n, t, out);
+  }
+}
+
+inline
+void
+sample_range(quat_track<float32> const* const tracks,
+             std::size_t const n,
+             float32 const t,
+             quat<float32>* const out) {
+  sample_dispatch(tracks, n, t, out);
+}
+
+inline
+void
+sample_range(quat_track<float64> const* const tracks,
+             std::size_t const n,
+             float64 const t,
+             quat<float64>* const out) {
+  sample_dispatch(tracks, n, t, out);
+}
+
+#endif // THX_DISPATCH
+
+} // Namespace: detail.
+
+//! Batched track sampling. See above.
+template<typename S>
+void
+sample(quat_track<S> const* const tracks,
+       std::size_t const n,
+       S const t,
+       quat<S>* const out) {
+  parallel_for(0, n, detail::sample_grain,
+    [&](std::size_t const i0, std::size_t const i1) {
+      detail::sample_range(tracks + i0, i1 - i0, t, out + i0);
+    });
+}
+
+//------------------------------------------------------------------------------
+
+// Batched conversion.
+// -------------------
+//
+// to_mat(q, m) writes the rotation matrices of the unit quaternions in q to m,
+// m[i] = to_mat3(q[i]). Quaternions are stored as vec_soa<4,S> with components
+// (w, x, y, z) and matrices as vec_soa<9,S> where component r + 3*c holds
+// element (r, c), i.e. the column-major order of mat<3,S>. The conversion is
+// branch-free and runs one packet at a time straight from the component
+// arrays, with run-time dispatch like sample. Results are identical to
+// to_mat3 as long as neither is contracted into fused multiply-add
+// instructions, see thx_cpu.hpp. Otherwise they agree to within a few ulp.
+//
+// to_quat(m, q) converts back. Shepperd's method picks one of four formulas
+// per matrix, which does not map onto packet arithmetic without a select, so
+// it runs element-wise. Results are identical to to_quat.
+//
+// The array-of-structures overloads convert quat<S> to mat<3,S> or mat<4,S>
+// and back element-wise. Gathering into structure-of-arrays blocks costs more
+// than the conversion itself, so callers that convert every frame should keep
+// their rotations in vec_soa form.
+//
+// All of them split the range into chunks that are converted on
+// default_thread_pool().
+
+namespace detail {
+
+//! Number of elements per parallel task, a multiple of any packet_size.
+static const std::size_t convert_grain = 16384;
+
+THX_GENERIC_KERNELS_BEGIN
+
+//! Convert quaternions [i0, i1) to rotation matrices, one packet of
+//! Simd::packet_size quaternions at a time. i0 is a multiple of the packet
+//! size, see to_mat3.
+template<class Simd, typename S> inline
+void
+to_mat_packets(vec_soa<4,S> const& q,
+               vec_soa<9,S>& m,
+               std::size_t const i0,
+               std::size_t const i1) {
+  typedef Simd simd;
+  typedef typename simd::packet_type packet_type;
+
+  const packet_type one = simd::set1(S(1));
+  for (std::size_t i = i0; i < i1; i += simd::packet_size) {
+    const packet_type w = simd::load(q.component(0) + i);
+    const packet_type x = simd::load(q.component(1) + i);
+    const packet_type y = simd::load(q.component(2) + i);
+    const packet_type z = simd::load(q.component(3) + i);
+    const packet_type x2 = simd::add(x, x);
+    const packet_type y2 = simd::add(y, y);
+    const packet_type z2 = simd::add(z, z);
+    const packet_type xx = simd::mul(x, x2);
+    const packet_type yy = simd::mul(y, y2);
+    const packet_type zz = simd::mul(z, z2);
+    const packet_type xy = simd::mul(x, y2);
+    const packet_type xz = simd::mul(x, z2);
+    const packet_type yz = simd::mul(y, z2);
+    const packet_type wx = simd::mul(w, x2);
+    const packet_type wy = simd::mul(w, y2);
+    const packet_type wz = simd::mul(w, z2);
+    simd::store(m.component(0) + i, simd::sub(one, simd::add(yy, zz)));
+    simd::store(m.component(1) + i, simd::add(xy, wz));
+    simd::store(m.component(2) + i, simd::sub(xz, wy));
+    simd::store(m.component(3) + i, simd::sub(xy, wz));
+    simd::store(m.component(4) + i, simd::sub(one, simd::add(xx, zz)));
+    simd::store(m.component(5) + i, simd::add(yz, wx));
+    simd::store(m.component(6) + i, simd::add(xz, wy));
+    simd::store(m.component(7) + i, simd::sub(yz, wx));
+    simd::store(m.component(8) + i, simd::sub(one, simd::add(xx, yy)));
+  }
+}
+
+THX_GENERIC_KERNELS_END
+
+//! Convert quaternions [i0, i1) on the calling thread.
+template<typename S>
+void
+to_mat_range(vec_soa<4,S> const& q,
+             vec_soa<9,S>& m,
+             std::size_t const i0,
+             std::size_t const i1) {
+  to_mat_packets<simd_traits<S>>(q, m, i0, i1);
+}
+
+#if defined(THX_DISPATCH)
+
+template<typename S> THX_TARGET_AVX THX_FLATTEN
+void
+to_mat_avx(vec_soa<4,S> const& q,
+           vec_soa<9,S>& m,
+           std::size_t const i0,
+           std::size_t const i1) {
+  to_mat_packets<avx_traits<S>>(q, m, i0, i1);
+}
+
+template<typename S> THX_TARGET_AVX512 THX_FLATTEN
+void
+to_mat_avx512(vec_soa<4,S> const& q,
+              vec_soa<9,S>& m,
+              std::size_t const i0,
+              std::size_t const i1) {
+  to_mat_packets<avx512_traits<S>>(q, m, i0, i1);
+}
+
+//! Convert quaternions [i0, i1) on the calling thread, dispatched on
+//! active_isa(). Packets never exceed the simd_alignment padding of the
+//! components.
+template<typename S>
+void
+to_mat_dispatch(vec_soa<4,S> const& q,
+                vec_soa<9,S>& m,
+                std::size_t const i0,
+                std::size_t const i1) {
+  const isa t = active_isa();
+  if (t >= isa_avx512) {
+    to_mat_avx512(q, m, i0, i1);
+  }
+  else if (t >= isa_avx) {
+    to_mat_avx(q, m, i0, i1);
+  }
+  else {
+    to_mat_range<S>(q, m, i0, i1);
+  }
+}
+
+inline
+void
+to_mat_range(vec_soa<4,float32> const& q,
+             vec_soa<9,float32>& m,
+             std::size_t const i0,
+             std::size_t const i1) {
+  to_mat_dispatch(q, m, i0, i1);
+}
+
+inline
+void
+to_mat_range(vec_soa<4,float64> const& q,
+             vec_soa<9,float64>& m,
+             std::size_t const i0,
+             std::size_t const i1) {
+  to_mat_dispatch(q, m, i0, i1);
+}
+
+#endif // THX_DISPATCH
+
+} // Namespace: detail.
+
+//! Batched quaternion to rotation matrix conversion, m must have the same
+//! size as q. See above.
+template<typename S>
+void
+to_mat(vec_soa<4,S> const& q, vec_soa<9,S>& m) {
+  parallel_for(0, q.size(), detail::convert_grain,
+    [&](std::size_t const i0, std::size_t const i1) {
+      detail::to_mat_range(q, m, i0, i1);
+    });
+}
+
+//! Batched rotation matrix to quaternion conversion, q must have the same
+//! size as m. See above.
+template<typename S>
+void
+to_quat(vec_soa<9,S> const& m, vec_soa<4,S>& q) {
+  parallel_for(0, m.size(), detail::convert_grain,
+    [&](std::size_t const i0, std::size_t const i1) {
+      for (std::size_t i = i0; i < i1; ++i) {
+        S v[9];
+        for (std::size_t k = 0; k < 9; ++k) {
+          v[k] = m.component(k)[i];
+        }
+        const quat<S> r = to_quat(mat<3,S>(v));
+        for (std::size_t k = 0; k < 4; ++k) {
+          q.component(k)[i] = r[k];
+        }
+      }
+    });
+}
+
+//! Batched quaternion to rotation matrix conversion, out[i] is to_mat3(q[i])
+//! or to_mat4(q[i]) for N = 3 or 4. See above.
+template<std::size_t N, typename S>
+void
+to_mat(quat<S> const* const q,
+       mat<N,S>* const out,
+       std::size_t const n) {
+  parallel_for(0, n, detail::convert_grain,
+    [&](std::size_t const i0, std::size_t const i1) {
+      for (std::size_t i = i0; i < i1; ++i) {
+        out[i] = mat<N,S>(to_mat3(q[i]));
+      }
+    });
+}
+
+//! Batched rotation matrix to quaternion conversion, N is 3 or 4. See above.
+template<std::size_t N, typename S>
+void
+to_quat(mat<N,S> const* const m,
+        quat<S>* const out,
+        std::size_t const n) {
+  parallel_for(0, n, detail::convert_grain,
+    [&](std::size_t const i0, std::size_t const i1) {
+      for (std::size_t i = i0; i < i1; ++i) {
+        out[i] = to_quat(m[i]);
+      }
+    });
+}
+
+//------------------------------------------------------------------------------
+
+// Convenient types, add more if appropriate.
+
+typedef quat_track<float32>  quat_trackf32;
+typedef quat_track<float64>  quat_trackf64;
+
+END_THX_NAMESPACE
+
+#endif // THX_QUAT_BATCH_HPP_INCLUDED
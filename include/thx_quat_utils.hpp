@@ -1,6 +1,6 @@
 //------------------------------------------------------------------------------
 //
-// Contributors: 
+// Contributors:
 //             1) Tommy Hinks
 //
 //------------------------------------------------------------------------------
@@ -8,9 +8,13 @@
 #ifndef THX_QUAT_UTILS_HPP_INCLUDED
 #define THX_QUAT_UTILS_HPP_INCLUDED
 
+#include "thx_define.hpp"
 #include "thx_quat.hpp"
+#include "thx_quat_algo.hpp"
+#include "thx_mat.hpp"
 #include "thx_vec.hpp"
-#include "thx_traits.hpp"
+#include "thx_scalar_traits.hpp"
+#include <type_traits>
 
 //------------------------------------------------------------------------------
 
@@ -18,129 +22,99 @@ namespace thx {
 
 //------------------------------------------------------------------------------
 
-//! NB: Axis should be normalized, i.e. have unit length.
-template<typename S> 
-void
-set_axis_angle(quat<S> &q, const vec<3,S> &axis, const S theta_rad)
+//! Rotation matrix of the unit quaternion q, i.e. to_mat3(q)*v rotates v
+//! like q*(0,v)*conj(q).
+template<typename S> inline THX_CONST_EXPR
+mat<3,S>
+to_mat3(const quat<S> &q)
 {
-    THX_STATIC_ASSERT(traits<S>::is_floating);
-    
-    const S st(traits<S>::sin(0.5*theta_rad));
-    const S ct(traits<S>::cos(0.5*theta_rad));
-
-    q[0] = ct;
-    q[1] = st*axis[0];
-    q[2] = st*axis[1];
-    q[3] = st*axis[2];                
+    const S x2 = q[1] + q[1];
+    const S y2 = q[2] + q[2];
+    const S z2 = q[3] + q[3];
+    const S xx = q[1]*x2;
+    const S yy = q[2]*y2;
+    const S zz = q[3]*z2;
+    const S xy = q[1]*y2;
+    const S xz = q[1]*z2;
+    const S yz = q[2]*z2;
+    const S wx = q[0]*x2;
+    const S wy = q[0]*y2;
+    const S wz = q[0]*z2;
+    return mat<3,S>(
+        1 - (yy + zz), xy - wz,       xz + wy,
+        xy + wz,       1 - (xx + zz), yz - wx,
+        xz - wy,       yz + wx,       1 - (xx + yy));
 }
 
 //------------------------------------------------------------------------------
 
-//template<typename S> 
-//vec<3,S,T>
-//euler_angles(const quaternion<S,T>& q)
-//{        
-//   return vec<3,S,T>(
-//	    rad2deg(T::pi() - T::atan2(
-//							static_cast<S>(2)*(q[2]*q[3] - q[1]*q[0]), 
-//				 T::one() - static_cast<S>(2)*(q[2]*q[2] + q[1]*q[1]))),
-//		rad2deg(T::pi() - T::asin(static_cast<S>(2)*(q[3]*q[1] + q[2]*q[0]))),
-//		rad2deg(T::pi() - T::atan2(
-//							static_cast<S>(2)*(q[1]*q[2] - q[3]*q[0]), 
-//			     T::one() - static_cast<S>(2)*(q[2]*q[2] + q[3]*q[3]))));
-//}
-
-//------------------------------------------------------------------------------
-
-//template<typename S, class T> 
-//void
-//set_euler_angles(quaternion<S,T>* q, const vec<3,S,T>& deg)
-//{        
-//    quaternion<S,T> x, y, z;
-//	set_axis_angle(&x, 
-//				   vec<3,S,T>(T::one(), T::zero(), T::zero()), deg2rad(deg.x));
-//    set_axis_angle(&y, 
-//				   vec<3,S,T>(T::zero(), T::one(), T::zero()), deg2rad(deg.y));
-//    set_axis_angle(&z, 
-//		           vec<3,S,T>(T::zero(), T::zero(), T::one()), deg2rad(deg.z));
-//    *q = x*y*z;
-//}
-
-//------------------------------------------------------------------------------
-
-//template<typename S, class T> 
-//bool
-//nonzero(const quaternion<S,T>& q)
-//{
-//    return !(is_zero(q.v[0]) && 
-//		     is_zero(q.v[1]) && 
-//		     is_zero(q.v[2]) && 
-//		     is_zero(q.v[3]));
-//}
-
-//------------------------------------------------------------------------------
-
-//template<typename S, class T> 
-//S
-//mag2(const quaternion<S,T>& q)
-//{
-//    return mag2(q.v);
-//}
-
-//------------------------------------------------------------------------------
-
-//template<typename S, class T> 
-//S
-//mag(const quaternion<S,T>& q)
-//{
-//    return mag(q.v);
-//}
-
-//------------------------------------------------------------------------------
-
-//template<typename S, class T>
-//void
-//normalize(quaternion<S,T>* q)
-//{
-//	normalize(&q.v);
-//    //a/=mag(a)+std::numeric_limits<T>::min();
-//}
-
-//------------------------------------------------------------------------------
-
-//template<typename S>
-//quat<S>
-//normalized(const quat<S>& q)
-//{
-//	return quat<S,T>(normalized(q.v));
-//    //return a/(mag(a)+std::numeric_limits<T>::min());
-//}
+//! Homogeneous rotation matrix of the unit quaternion q, see to_mat3.
+template<typename S> inline THX_CONST_EXPR
+mat<4,S>
+to_mat4(const quat<S> &q)
+{
+    return mat<4,S>(to_mat3(q));
+}
 
 //------------------------------------------------------------------------------
 
-//template<typename T> unsigned int 
-//hash(const quaternion<S,T>& a)
-//{
-//    return hash(hash(hash(hash(a.v[0])^a.v[1])^a.v[2])^a.v[3]);
-//}
+//! Unit quaternion of the rotation matrix a, the inverse of to_mat3 up to
+//! the sign of the result. Divides by the largest of 4|w|, 4|x|, 4|y| and
+//! 4|z| (Shepperd's method), so rotations by any angle are accurate.
+template<typename S>
+quat<S>
+to_quat(const mat<3,S> &a)
+{
+    static_assert(std::is_floating_point<S>::value,
+                  "Scalar type must be floating point");
+
+    typedef scalar_traits<S> traits;
+
+    const S tr = a(0,0) + a(1,1) + a(2,2);
+    if (tr > 0) {
+        const S s = 2*traits::sqrt(1 + tr);  // 4|w|
+        const S r = 1/s;
+        return quat<S>(S(0.25)*s,
+                       (a(2,1) - a(1,2))*r,
+                       (a(0,2) - a(2,0))*r,
+                       (a(1,0) - a(0,1))*r);
+    }
+    if (a(0,0) > a(1,1) && a(0,0) > a(2,2)) {
+        const S s = 2*traits::sqrt(1 + a(0,0) - a(1,1) - a(2,2));  // 4|x|
+        const S r = 1/s;
+        return quat<S>((a(2,1) - a(1,2))*r,
+                       S(0.25)*s,
+                       (a(0,1) + a(1,0))*r,
+                       (a(0,2) + a(2,0))*r);
+    }
+    if (a(1,1) > a(2,2)) {
+        const S s = 2*traits::sqrt(1 + a(1,1) - a(0,0) - a(2,2));  // 4|y|
+        const S r = 1/s;
+        return quat<S>((a(0,2) - a(2,0))*r,
+                       (a(0,1) + a(1,0))*r,
+                       S(0.25)*s,
+                       (a(1,2) + a(2,1))*r);
+    }
+    const S s = 2*traits::sqrt(1 + a(2,2) - a(0,0) - a(1,1));  // 4|z|
+    const S r = 1/s;
+    return quat<S>((a(1,0) - a(0,1))*r,
+                   (a(0,2) + a(2,0))*r,
+                   (a(1,2) + a(2,1))*r,
+                   S(0.25)*s);
+}
 
 //------------------------------------------------------------------------------
 
-// multiply (0,y)=q*(0,x)*q_conjugate
-// requires that q be unit-length for this to be a rotation
-//template<typename T> void
-//apply_rotation(quaternion<S,T>& q, const vec<3,T>& x, vec<3,T>& y)
-//{
-//    // first form (A,B,C,D)=q*(0,x)
-//    T A=-q.v[1]*x.v[0]-q.v[2]*x.v[1]-q.v[3]*x.v[2];
-//    T B= q.v[0]*x.v[0]-q.v[3]*x.v[1]+q.v[2]*x.v[2];
-//    T C= q.v[3]*x.v[0]+q.v[0]*x.v[1]-q.v[1]*x.v[2];
-//    T D=-q.v[2]*x.v[0]+q.v[1]*x.v[1]+q.v[0]*x.v[2];
-//    // then (0,y)=(A,B,C,D)*q_conjugate
-//    y.v[0]=-A*q.v[1]+B*q.v[0]-C*q.v[3]+D*q.v[2];
-//    y.v[1]=-A*q.v[2]+B*q.v[3]+C*q.v[0]-D*q.v[1];
-//    y.v[2]=-A*q.v[3]-B*q.v[2]+C*q.v[1]+D*q.v[0];
-//}
+//! Unit quaternion of the upper left 3x3 part of a, see to_quat(mat<3,S>).
+template<typename S>
+quat<S>
+to_quat(const mat<4,S> &a)
+{
+    return to_quat(mat<3,S>(
+        a(0,0), a(0,1), a(0,2),
+        a(1,0), a(1,1), a(1,2),
+        a(2,0), a(2,1), a(2,2)));
+}
 
 }   // Namespace: thx.
 
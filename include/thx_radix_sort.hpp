@@ -0,0 +1,298 @@
+//------------------------------------------------------------------------------
+//
+// Contributors:
+//             1) Tommy Hinks
+//
+//------------------------------------------------------------------------------
+
+#ifndef THX_RADIX_SORT_HPP_INCLUDED
+#define THX_RADIX_SORT_HPP_INCLUDED
+
+#include "thx_namespace.hpp"
+#include "thx_types.hpp"
+#include "thx_parallel.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+BEGIN_THX_NAMESPACE
+
+// Radix sort.
+// -----------
+//
+// void radix_sort(K* keys, std::size_t n[, thread_pool&])
+// void radix_sort(K* keys, V* values, std::size_t n[, thread_pool&])
+//
+// Stable radix sort of unsigned integer keys, 11 bits per pass. The second
+// form moves values[i] along with keys[i], e.g. to sort indices by Morton code.
+//
+// Sorting is bound by memory bandwidth, so only one pass goes through main
+// memory: keys are scattered into buckets by their most significant digit,
+// counting digits per chunk of radix_grain keys and then writing the chunks in
+// parallel to precomputed offsets. Each bucket is then sorted by the remaining
+// digits, least significant first, while it is in cache, buckets in parallel.
+// Digits that are equal for all keys, e.g. the high bits of small keys, are
+// found up front and skipped. The sort is stable, so the output does not
+// depend on the number of threads. Scratch memory of the size of the input is
+// allocated.
+
+//------------------------------------------------------------------------------
+
+namespace detail {
+
+//! Keys per chunk of a pass.
+const std::size_t radix_grain = 65536;
+
+//! Digit width in bits. 11 bits keep the offset tables of a pass in L1 and L2.
+const int radix_bits = 11;
+const std::size_t radix_size = std::size_t(1) << radix_bits;
+
+//! Buckets smaller than this are insertion sorted.
+const std::size_t radix_small = 64;
+
+//! Values pointer type when sorting keys only.
+struct radix_no_values {};
+
+template<typename V> inline
+void
+radix_move(V const* const src, V* const dst, std::size_t const i,
+           std::size_t const j) {
+  dst[j] = src[i];
+}
+
+inline
+void
+radix_move(radix_no_values const*, radix_no_values*, std::size_t,
+           std::size_t) {
+}
+
+//! Call f(c, i0, i1) for the chunks [i0, i1) = [c*grain, (c + 1)*grain) of
+//! [0, n) in parallel. Unlike parallel_for the chunks never merge, so f may
+//! keep per-chunk state indexed by c.
+template<class F>
+void
+radix_for_chunks(std::size_t const n,
+                 std::size_t const grain,
+                 thread_pool& pool,
+                 F const& f) {
+  std::size_t const chunks = (n + grain - 1)/grain;
+  parallel_for(0, chunks, 1, [&](std::size_t const c0, std::size_t const c1) {
+    for (std::size_t c = c0; c < c1; ++c) {
+      f(c, c*grain, (std::min)((c + 1)*grain, n));
+    }
+  }, pool);
+}
+
+template<typename V> inline
+V*
+radix_offset(V* const p, std::size_t const i) {
+  return p + i;
+}
+
+inline
+radix_no_values*
+radix_offset(radix_no_values* const p, std::size_t) {
+  return p;
+}
+
+//! Sort the m keys src_keys, which agree on all bits from top up, by the
+//! varying bits below top into dst_keys, values moved along. Both buffers are
+//! used as scratch space.
+template<typename K, typename V>
+void
+radix_sort_bucket(K* src_keys, V* src_values, K* dst_keys, V* dst_values,
+                  std::size_t const m, K const varying, int const top) {
+  K* const out_keys = dst_keys;
+  V* const out_values = dst_values;
+
+  if (m < radix_small) {
+    // Stable insertion sort of indices.
+    uint16 order[radix_small];
+    for (std::size_t i = 0; i < m; ++i) {
+      std::size_t j = i;
+      while (j > 0 && src_keys[i] < src_keys[order[j - 1]]) {
+        order[j] = order[j - 1];
+        --j;
+      }
+      order[j] = static_cast<uint16>(i);
+    }
+    for (std::size_t j = 0; j < m; ++j) {
+      dst_keys[j] = src_keys[order[j]];
+      radix_move(src_values, dst_values, order[j], j);
+    }
+    return;
+  }
+
+  K const digit_mask = static_cast<K>(radix_size - 1);
+  std::size_t count[radix_size];
+  for (int shift = 0; shift < top; shift += radix_bits) {
+    // Bits from top up are equal within the bucket and do not reorder keys.
+    if (((varying >> shift) & digit_mask) == 0) {
+      continue;
+    }
+    std::fill(count, count + radix_size, std::size_t(0));
+    for (std::size_t i = 0; i < m; ++i) {
+      ++count[(src_keys[i] >> shift) & digit_mask];
+    }
+    std::size_t start = 0;
+    for (std::size_t b = 0; b < radix_size; ++b) {
+      std::size_t const c = count[b];
+      count[b] = start;
+      start += c;
+    }
+    for (std::size_t i = 0; i < m; ++i) {
+      std::size_t const j = count[(src_keys[i] >> shift) & digit_mask]++;
+      dst_keys[j] = src_keys[i];
+      radix_move(src_values, dst_values, i, j);
+    }
+    std::swap(src_keys, dst_keys);
+    std::swap(src_values, dst_values);
+  }
+
+  if (src_keys != out_keys) {
+    for (std::size_t i = 0; i < m; ++i) {
+      out_keys[i] = src_keys[i];
+      radix_move(src_values, out_values, i, i);
+    }
+  }
+}
+
+//! Sort keys[0..n) with values moved along, using the scratch buffers
+//! key_tmp and value_tmp of size n.
+template<typename K, typename V>
+void
+radix_sort(K* const keys, V* const values, K* const key_tmp,
+           V* const value_tmp, std::size_t const n, thread_pool& pool) {
+  static_assert(std::is_unsigned<K>::value, "Keys must be unsigned integers");
+
+  if (n < 2) {
+    return;
+  }
+
+  std::size_t const grain = radix_grain;
+  std::size_t const chunks = (n + grain - 1)/grain;
+  K const digit_mask = static_cast<K>(radix_size - 1);
+
+  // Bits that differ between keys. Digits without such bits are skipped.
+  std::vector<K> chunk_and(chunks);
+  std::vector<K> chunk_or(chunks);
+  radix_for_chunks(n, grain, pool, [&](std::size_t const c,
+                                       std::size_t const i0,
+                                       std::size_t const i1) {
+    K a = keys[i0];
+    K o = keys[i0];
+    for (std::size_t i = i0 + 1; i < i1; ++i) {
+      a &= keys[i];
+      o |= keys[i];
+    }
+    chunk_and[c] = a;
+    chunk_or[c] = o;
+  });
+  K all = chunk_and[0];
+  K any = chunk_or[0];
+  for (std::size_t c = 1; c < chunks; ++c) {
+    all &= chunk_and[c];
+    any |= chunk_or[c];
+  }
+  K const varying = all ^ any;
+
+  if (varying == 0) {
+    return; // All keys are equal.
+  }
+
+  // The first digit holds the highest varying bits, so that the buckets are
+  // balanced also for keys with few varying bits in the top digit.
+  int top = 0;
+  while (top < std::numeric_limits<K>::digits && (varying >> top) != 0) {
+    ++top;
+  }
+  int const shift = (std::max)(0, top - radix_bits);
+
+  // First digit counts per chunk.
+  std::vector<std::size_t> offset(chunks*radix_size);
+  radix_for_chunks(n, grain, pool, [&](std::size_t const c,
+                                       std::size_t const i0,
+                                       std::size_t const i1) {
+    std::size_t* const count = &offset[c*radix_size];
+    for (std::size_t i = i0; i < i1; ++i) {
+      ++count[(keys[i] >> shift) & digit_mask];
+    }
+  });
+
+  // Output offsets, digit major and chunk minor.
+  std::vector<std::size_t> bucket_start(radix_size + 1);
+  std::size_t start = 0;
+  for (std::size_t b = 0; b < radix_size; ++b) {
+    bucket_start[b] = start;
+    for (std::size_t c = 0; c < chunks; ++c) {
+      std::size_t const count = offset[c*radix_size + b];
+      offset[c*radix_size + b] = start;
+      start += count;
+    }
+  }
+  bucket_start[radix_size] = start;
+
+  // Scatter into buckets.
+  radix_for_chunks(n, grain, pool, [&](std::size_t const c,
+                                       std::size_t const i0,
+                                       std::size_t const i1) {
+    std::size_t* const cursor = &offset[c*radix_size];
+    for (std::size_t i = i0; i < i1; ++i) {
+      std::size_t const j = cursor[(keys[i] >> shift) & digit_mask]++;
+      key_tmp[j] = keys[i];
+      radix_move(values, value_tmp, i, j);
+    }
+  });
+
+  // Sort the buckets by the remaining digits, back into keys and values.
+  std::size_t const bucket_grain =
+    (std::max)(std::size_t(1), radix_size*grain/n);
+  parallel_for(0, radix_size, bucket_grain,
+    [&](std::size_t const b0, std::size_t const b1) {
+      for (std::size_t b = b0; b < b1; ++b) {
+        std::size_t const s = bucket_start[b];
+        radix_sort_bucket(key_tmp + s, radix_offset(value_tmp, s),
+                          keys + s, radix_offset(values, s),
+                          bucket_start[b + 1] - s, varying, shift);
+      }
+    }, pool);
+}
+
+} // Namespace: detail.
+
+//------------------------------------------------------------------------------
+
+//! Sort the n keys in ascending order, see above.
+template<typename K>
+void
+radix_sort(K* const keys,
+           std::size_t const n,
+           thread_pool& pool = default_thread_pool()) {
+  std::vector<K> key_tmp(n);
+  detail::radix_sort(keys,
+                     static_cast<detail::radix_no_values*>(0),
+                     key_tmp.data(),
+                     static_cast<detail::radix_no_values*>(0),
+                     n, pool);
+}
+
+//! Sort the n keys in ascending order and reorder values the same way. The
+//! sort is stable, values with equal keys keep their order.
+template<typename K, typename V>
+void
+radix_sort(K* const keys,
+           V* const values,
+           std::size_t const n,
+           thread_pool& pool = default_thread_pool()) {
+  std::vector<K> key_tmp(n);
+  std::vector<V> value_tmp(n);
+  detail::radix_sort(keys, values, key_tmp.data(), value_tmp.data(), n, pool);
+}
+
+END_THX_NAMESPACE
+
+#endif // THX_RADIX_SORT_HPP_INCLUDED
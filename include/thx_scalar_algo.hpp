@@ -9,6 +9,7 @@
 #define THX_SCALAR_ALGO_HPP_INCLUDED
 
 #include "thx_namespace.hpp"
+#include "thx_define.hpp"
 #include "thx_scalar_traits.hpp"
 #include <type_traits>
 
@@ -266,6 +267,47 @@ rad_to_deg_dispatch(const S rad, real_scalar_tag)
 
 } // Namespace: detail.
 
+namespace detail {
+
+//! Reduce x to the range [-pi..pi].
+inline THX_CONST_EXPR
+float64
+series_reduce(const float64 x)
+{
+  const float64 two_pi = 6.283185307179586476925;
+  const float64 k = 
+    static_cast<float64>(static_cast<int64>(x/two_pi + (x < 0 ? -0.5 : 0.5)));
+  return x - k*two_pi;
+}
+
+//! Taylor series of sin(x). Slow, but usable in constant expressions.
+inline THX_CONST_EXPR
+float64
+series_sin(const float64 x)
+{
+  const float64 r = series_reduce(x);
+  float64 sum = 1;
+  for (int64 n = 15; n > 0; --n) { // Horner, smallest terms first.
+    sum = 1 - r*r/((2*n)*(2*n + 1))*sum;
+  }
+  return r*sum;
+}
+
+//! Taylor series of cos(x). Slow, but usable in constant expressions.
+inline THX_CONST_EXPR
+float64
+series_cos(const float64 x)
+{
+  const float64 r = series_reduce(x);
+  float64 sum = 1;
+  for (int64 n = 15; n > 0; --n) { // Horner, smallest terms first.
+    sum = 1 - r*r/((2*n - 1)*(2*n))*sum;
+  }
+  return sum;
+}
+
+} // Namespace: detail.
+
 //! Convert degrees to radians. 
 template<typename S> inline THX_CONST_EXPR
 S 
@@ -333,7 +375,7 @@ signum_dispatch(const S x, std::true_type /*is_signed*/) {
 template <typename S> inline THX_CONST_EXPR
 int 
 signum(const S x) {
-  return detail::signum_dispatch(x, std::is_signed<S>::type());
+  return detail::signum_dispatch(x, typename std::is_signed<S>::type());
 }
 
 //------------------------------------------------------------------------------
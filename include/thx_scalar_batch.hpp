@@ -0,0 +1,240 @@
+//------------------------------------------------------------------------------
+//
+// Contributors:
+//             1) Tommy Hinks
+//
+//------------------------------------------------------------------------------
+
+#ifndef THX_SCALAR_BATCH_HPP_INCLUDED
+#define THX_SCALAR_BATCH_HPP_INCLUDED
+
+#include "thx_namespace.hpp"
+#include "thx_types.hpp"
+#include "thx_scalar_traits.hpp"
+#include "thx_fast_scalar_traits.hpp"
+#include "thx_simd.hpp"
+#include "thx_cpu.hpp"
+#include <cstddef>
+
+//------------------------------------------------------------------------------
+
+BEGIN_THX_NAMESPACE
+
+// Batched sine and cosine.
+// ------------------------
+//
+// sincos(x, s, c, n) writes the sine and cosine of x[0..n) to s[0..n) and
+// c[0..n). Outputs may be the same range as the input.
+//
+// The angle is reduced to r in [-pi/4, pi/4] and a quadrant with three parts
+// of pi/2, and minimax polynomials of sin(r) and cos(r) are combined with
+// selects, simd_traits<S>::packet_size angles at a time, or as many as
+// active_isa() allows with run-time dispatch (see thx_cpu.hpp). The maximum
+// absolute error is 1.0e-7 for float32 and |x| <= 8192, and 2.3e-16 for
+// float64 and |x| <= 1e8. The remaining elements use the same polynomials
+// one at a time, so results do not depend on position or instruction set as
+// long as multiplies and adds are not contracted into fused multiply-add
+// instructions, see thx_cpu.hpp. Otherwise they agree to within a few ulp.
+
+namespace detail {
+
+THX_GENERIC_KERNELS_BEGIN
+
+//! Range reduction and polynomials, sin(r) = r + r*z*ps and cos(r) = 1 - z/2
+//! + z*z*pc, where z = r*r. Results are returned through references, which
+//! unlike packet return values do not depend on the vector ABI.
+template<typename S>
+struct sincos_poly;
+
+//! The float32 constants are those of fast_sincos.
+template<>
+struct sincos_poly<float32> {
+  typedef fast_sincos_consts<float32> consts;
+
+  static THX_CONST_EXPR float32 pio2_1() { return consts::pio2_1(); }
+  static THX_CONST_EXPR float32 pio2_2() { return consts::pio2_2(); }
+  static THX_CONST_EXPR float32 pio2_3() { return consts::pio2_3(); }
+
+  template<class Simd> static
+  void
+  eval(typename Simd::packet_type const& z,
+       typename Simd::packet_type& ps,
+       typename Simd::packet_type& pc) {
+    typedef Simd simd;
+    ps = simd::add(simd::set1(consts::s1()), simd::mul(z,
+      simd::add(simd::set1(consts::s2()),
+                simd::mul(z, simd::set1(consts::s3())))));
+    pc = simd::add(simd::set1(consts::c2()), simd::mul(z,
+      simd::add(simd::set1(consts::c3()),
+                simd::mul(z, simd::set1(consts::c4())))));
+  }
+};
+
+template<>
+struct sincos_poly<float64> {
+  static THX_CONST_EXPR float64 pio2_1() { return 1.57079625129699707031; }
+  static THX_CONST_EXPR float64 pio2_2() { return 7.54978941586159635335e-8; }
+  static THX_CONST_EXPR float64 pio2_3() { return 5.39030285815811905290e-15; }
+
+  template<class Simd> static
+  void
+  eval(typename Simd::packet_type const& z,
+       typename Simd::packet_type& ps,
+       typename Simd::packet_type& pc) {
+    typedef Simd simd;
+    ps = simd::set1(1.58962301576546568060e-10);
+    ps = simd::add(simd::mul(ps, z), simd::set1(-2.50507477628578072866e-8));
+    ps = simd::add(simd::mul(ps, z), simd::set1(2.75573136213857245213e-6));
+    ps = simd::add(simd::mul(ps, z), simd::set1(-1.98412698295895385996e-4));
+    ps = simd::add(simd::mul(ps, z), simd::set1(8.33333333332211858878e-3));
+    ps = simd::add(simd::mul(ps, z), simd::set1(-1.66666666666666307295e-1));
+    pc = simd::set1(-1.13585365213876817300e-11);
+    pc = simd::add(simd::mul(pc, z), simd::set1(2.08757008419747316778e-9));
+    pc = simd::add(simd::mul(pc, z), simd::set1(-2.75573141792967388112e-7));
+    pc = simd::add(simd::mul(pc, z), simd::set1(2.48015872888517045348e-5));
+    pc = simd::add(simd::mul(pc, z), simd::set1(-1.38888888888730564116e-3));
+    pc = simd::add(simd::mul(pc, z), simd::set1(4.16666666666665929218e-2));
+  }
+};
+
+//! Sine and cosine of a packet of angles, see above. The quadrant is kept as
+//! a floating point value in [0, 4), since simd_traits has no integer
+//! operations.
+template<typename S, class Simd = simd_traits<S>> inline
+void
+sincos_packet(typename Simd::packet_type const& x,
+              typename Simd::packet_type& s,
+              typename Simd::packet_type& c) {
+  typedef Simd simd;
+  typedef typename simd::packet_type packet_type;
+  typedef sincos_poly<S> poly;
+
+  const packet_type magic = simd::set1(fast_math_bits<S>::round_magic());
+  const packet_type one = simd::set1(S(1));
+  const packet_type k = simd::sub(simd::add(
+    simd::mul(x, simd::set1(fast_sincos_consts<S>::two_over_pi())), magic),
+    magic);
+
+  // q = k mod 4. k/4 is exact, rounding it may round up.
+  const packet_type k4 = simd::mul(k, simd::set1(S(0.25)));
+  packet_type f = simd::sub(simd::add(k4, magic), magic);
+  f = simd::select(simd::cmplt(k4, f), simd::sub(f, one), f);
+  const packet_type q = simd::sub(k, simd::mul(f, simd::set1(S(4))));
+
+  const packet_type r = simd::sub(simd::sub(simd::sub(x,
+    simd::mul(k, simd::set1(poly::pio2_1()))),
+    simd::mul(k, simd::set1(poly::pio2_2()))),
+    simd::mul(k, simd::set1(poly::pio2_3())));
+  const packet_type z = simd::mul(r, r);
+  packet_type ps, pc;
+  poly::template eval<Simd>(z, ps, pc);
+  const packet_type sp = simd::add(r, simd::mul(simd::mul(r, z), ps));
+  const packet_type cp = simd::add(
+    simd::sub(one, simd::mul(simd::set1(S(0.5)), z)),
+    simd::mul(simd::mul(z, z), pc));
+
+  const packet_type zero = simd::set1(S(0));
+  const packet_type three = simd::set1(S(3));
+  const packet_type two = simd::set1(S(2));
+  const packet_type s0 = simd::select(simd::cmpeq(q, one), cp,
+                           simd::select(simd::cmpeq(q, three), cp, sp));
+  const packet_type c0 = simd::select(simd::cmpeq(q, one), sp,
+                           simd::select(simd::cmpeq(q, three), sp, cp));
+  s = simd::select(simd::cmplt(one, q), simd::sub(zero, s0), s0);
+  c = simd::select(simd::cmpeq(q, one), simd::sub(zero, c0),
+        simd::select(simd::cmpeq(q, two), simd::sub(zero, c0), c0));
+}
+
+//! Sine and cosine of n angles.
+template<typename S, class Simd = simd_traits<S>>
+void
+sincos_range(S const* const x, S* const s, S* const c, std::size_t const n) {
+  typedef Simd simd;
+  typedef typename simd::packet_type packet_type;
+  typedef single_lane_traits<S> lane;
+  static const std::size_t P = simd::packet_size;
+
+  std::size_t i = 0;
+  for (; i + P <= n; i += P) {
+    packet_type ps, pc;
+    sincos_packet<S, Simd>(simd::loadu(x + i), ps, pc);
+    simd::storeu(s + i, ps);
+    simd::storeu(c + i, pc);
+  }
+  for (; i < n; ++i) {
+    S si, ci;
+    sincos_packet<S, lane>(x[i], si, ci);
+    s[i] = si;
+    c[i] = ci;
+  }
+}
+
+THX_GENERIC_KERNELS_END
+
+//! Kernel computing sine and cosine of a range.
+template<typename S>
+struct sincos_kernel {
+  typedef void (*type)(S const*, S*, S*, std::size_t);
+};
+
+//! Kernel for the instruction sets enabled at compile time.
+template<typename S> inline
+typename sincos_kernel<S>::type
+sincos_select_kernel(S) {
+  return &sincos_range<S>;
+}
+
+#if defined(THX_DISPATCH)
+
+template<typename S> THX_TARGET_AVX THX_FLATTEN
+void
+sincos_avx(S const* const x, S* const s, S* const c, std::size_t const n) {
+  sincos_range<S, avx_traits<S>>(x, s, c, n);
+}
+
+template<typename S> THX_TARGET_AVX512 THX_FLATTEN
+void
+sincos_avx512(S const* const x, S* const s, S* const c, std::size_t const n) {
+  sincos_range<S, avx512_traits<S>>(x, s, c, n);
+}
+
+//! Kernel dispatched on active_isa().
+template<typename S> inline
+typename sincos_kernel<S>::type
+sincos_select_dispatch() {
+  const isa t = active_isa();
+  if (t >= isa_avx512) {
+    return &sincos_avx512<S>;
+  }
+  if (t >= isa_avx) {
+    return &sincos_avx<S>;
+  }
+  return &sincos_range<S>;
+}
+
+inline
+sincos_kernel<float32>::type
+sincos_select_kernel(float32) {
+  return sincos_select_dispatch<float32>();
+}
+
+inline
+sincos_kernel<float64>::type
+sincos_select_kernel(float64) {
+  return sincos_select_dispatch<float64>();
+}
+
+#endif // THX_DISPATCH
+
+} // Namespace: detail.
+
+//! Batched sine and cosine, S = float32 or float64. See above.
+template<typename S>
+void
+sincos(S const* const x, S* const s, S* const c, std::size_t const n) {
+  detail::sincos_select_kernel(S(0))(x, s, c, n);
+}
+
+END_THX_NAMESPACE
+
+#endif // THX_SCALAR_BATCH_HPP_INCLUDED
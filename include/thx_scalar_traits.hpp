@@ -9,12 +9,25 @@
 #define THX_TRAITS_HPP_INCLUDED
 
 #include "thx_namespace.hpp"
+#include "thx_define.hpp"
 #include "thx_types.hpp"
 #include <limits>
 #include <cmath>
 #include <cstdlib>
 #include <cassert>
 
+// THX_SINCOS_GNU - the C library declares sincosf/sincos (glibc with
+//                  _GNU_SOURCE, which g++ defines by default).
+// THX_SINCOS_APPLE - the C library declares __sincosf/__sincos.
+//
+// Without either, scalar_traits<S>::sincos calls sin and cos separately.
+
+#if defined(__GLIBC__) && defined(_GNU_SOURCE)
+#  define THX_SINCOS_GNU
+#elif defined(__APPLE__)
+#  define THX_SINCOS_APPLE
+#endif
+
 //------------------------------------------------------------------------------
 
 BEGIN_THX_NAMESPACE
@@ -48,7 +61,7 @@ public:
 
   typedef real_scalar_tag scalar_category;
 
-  static /*constexpr*/ float32 
+  static THX_CONST_EXPR float32
   pi()		
   { return 3.1415926535897f; }
 
@@ -88,6 +101,21 @@ public:
     return ::cosf(x); 
   }
 
+  //! Sine and cosine of the same angle, with a single C library call where
+  //! one is available (see THX_SINCOS_GNU).
+  static void
+  sincos(const float32 x, float32& s, float32& c)
+  {
+#if defined(THX_SINCOS_GNU)
+    ::sincosf(x, &s, &c);
+#elif defined(THX_SINCOS_APPLE)
+    ::__sincosf(x, &s, &c);
+#else
+    s = ::sinf(x);
+    c = ::cosf(x);
+#endif
+  }
+
   static float32 
   tan(const float32 x)  
   { 
@@ -142,7 +170,9 @@ class scalar_traits<float64> : private detail::nonconstructible
 {
 public:
 
-  static /*constexpr*/ float64 
+  typedef real_scalar_tag scalar_category;
+
+  static THX_CONST_EXPR float64
   pi()		
   { return 3.1415926535897; }
 
@@ -178,6 +208,20 @@ public:
   cos(const float64 x)  
   { return ::cos(x); }
 
+  //! Sine and cosine, see float32 version.
+  static void
+  sincos(const float64 x, float64& s, float64& c)
+  {
+#if defined(THX_SINCOS_GNU)
+    ::sincos(x, &s, &c);
+#elif defined(THX_SINCOS_APPLE)
+    ::__sincos(x, &s, &c);
+#else
+    s = ::sin(x);
+    c = ::cos(x);
+#endif
+  }
+
   static float64 
   tan(const float64 x)  
   { return ::tan(x); }
@@ -268,7 +312,7 @@ public:
 
   static int64 
   abs(const int64 x)  
-  { return _abs64(x); }
+  { return std::llabs(x); }
 };
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,482 @@
+//------------------------------------------------------------------------------
+//
+// Contributors:
+//             1) Tommy Hinks
+//
+//------------------------------------------------------------------------------
+
+#ifndef THX_SIMD_HPP_INCLUDED
+#define THX_SIMD_HPP_INCLUDED
+
+// Compile-time instruction set selection.
+// ---------------------------------------
+//
+// SIMD code paths are enabled based on the instruction sets the compiler is
+// allowed to emit for the current translation unit, i.e. /arch:AVX (MSVC) or
+// -mavx (gcc/clang) enables THX_AVX. SSE2 is always available on x64.
+//
+// Define THX_NO_SIMD before including any thx header to force the scalar
+// code paths.
+//
+// THX_SSE2 - 128-bit float32/float64 kernels.
+// THX_AVX  - 256-bit float32/float64 kernels.
+
+#if !defined(THX_NO_SIMD)
+#  if defined(__SSE2__) || defined(_M_X64) || \
+      (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define THX_SSE2
+#  endif
+#  if defined(THX_SSE2) && defined(__AVX__)
+#    define THX_AVX
+#  endif
+#endif
+
+#if defined(THX_SSE2)
+#  include <emmintrin.h>
+#endif
+
+#if defined(THX_AVX)
+#  include <immintrin.h>
+#endif
+
+#include "thx_namespace.hpp"
+#include "thx_types.hpp"
+#include "thx_scalar_traits.hpp"
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+//------------------------------------------------------------------------------
+
+BEGIN_THX_NAMESPACE
+
+//! Alignment in bytes of buffers handed out by aligned_malloc. A cache line,
+//! which is also enough for aligned AVX loads and stores.
+static const std::size_t simd_alignment = 64;
+
+namespace detail {
+
+//! Allocate size bytes aligned to a multiple of simd_alignment. Throws
+//! std::bad_alloc on failure. Free with aligned_free.
+inline
+void*
+aligned_malloc(std::size_t const size) {
+  // Over-allocate and store the offset to the original pointer just in
+  // front of the aligned block.
+  void* const p = std::malloc(size + simd_alignment);
+  if (p == 0) {
+    throw std::bad_alloc();
+  }
+  const std::size_t offset =
+    simd_alignment - reinterpret_cast<std::size_t>(p)%simd_alignment;
+  unsigned char* const q = static_cast<unsigned char*>(p) + offset;
+  q[-1] = static_cast<unsigned char>(offset);
+  return q;
+}
+
+//! Free memory allocated with aligned_malloc. Null is ignored.
+inline
+void
+aligned_free(void* const p) {
+  if (p != 0) {
+    unsigned char* const q = static_cast<unsigned char*>(p);
+    std::free(q - q[-1]);
+  }
+}
+
+} // Namespace: detail.
+
+//------------------------------------------------------------------------------
+
+// simd_traits<S> anatomy:
+// -----------------------
+//
+// typedef packet_type
+// typedef mask_type (result of comparisons, one flag per element)
+// define packet_size (number of S in a packet)
+//
+// packet_type load(const S*)   (aligned)
+// packet_type loadu(const S*)  (unaligned)
+// void store(S*, packet_type)  (aligned)
+// void storeu(S*, packet_type) (unaligned)
+// packet_type set1(S)
+// packet_type add/sub/mul/div(packet_type, packet_type)
+// packet_type sqrt/min/max
+// mask_type cmplt/cmpeq(packet_type, packet_type)
+// packet_type select(mask_type m, packet_type a, packet_type b) (m ? a : b)
+//
+// Kernels written against simd_traits<S> process packet_size elements per
+// iteration, using the widest instruction set enabled for the translation
+// unit, and fall back to a single scalar lane. Single-element versions of a
+// kernel instantiate it with detail::single_lane_traits<S>, so that they
+// perform the same operations as every lane of the packet versions.
+
+namespace detail {
+
+//! Single scalar lane.
+template<typename S>
+class single_lane_traits : private nonconstructible
+{
+public:
+  typedef S packet_type;
+  typedef bool mask_type;
+  static const std::size_t packet_size = 1;
+
+  static packet_type
+  load(S const* const p)
+  { return *p; }
+
+  static packet_type
+  loadu(S const* const p)
+  { return *p; }
+
+  static void
+  store(S* const p, packet_type const a)
+  { *p = a; }
+
+  static void
+  storeu(S* const p, packet_type const a)
+  { *p = a; }
+
+  static packet_type
+  set1(S const x)
+  { return x; }
+
+  static packet_type
+  add(packet_type const a, packet_type const b)
+  { return a + b; }
+
+  static packet_type
+  sub(packet_type const a, packet_type const b)
+  { return a - b; }
+
+  static packet_type
+  mul(packet_type const a, packet_type const b)
+  { return a*b; }
+
+  static packet_type
+  div(packet_type const a, packet_type const b)
+  { return a/b; }
+
+  static packet_type
+  sqrt(packet_type const a)
+  { return scalar_traits<S>::sqrt(a); }
+
+  static packet_type
+  min(packet_type const a, packet_type const b)
+  { return b < a ? b : a; }
+
+  static packet_type
+  max(packet_type const a, packet_type const b)
+  { return a < b ? b : a; }
+
+  static mask_type
+  cmplt(packet_type const a, packet_type const b)
+  { return a < b; }
+
+  static mask_type
+  cmpeq(packet_type const a, packet_type const b)
+  { return a == b; }
+
+  static packet_type
+  select(mask_type const m, packet_type const a, packet_type const b)
+  { return m ? a : b; }
+};
+
+} // Namespace: detail.
+
+//! Generic, single scalar lane.
+template<typename S>
+class simd_traits : public detail::single_lane_traits<S>
+{
+};
+
+#if defined(THX_AVX)
+
+//! AVX, 8 x float32.
+template<>
+class simd_traits<float32> : private detail::nonconstructible
+{
+public:
+  typedef __m256 packet_type;
+  typedef __m256 mask_type;
+  static const std::size_t packet_size = 8;
+
+  static packet_type
+  load(float32 const* const p)
+  { return _mm256_load_ps(p); }
+
+  static packet_type
+  loadu(float32 const* const p)
+  { return _mm256_loadu_ps(p); }
+
+  static void
+  store(float32* const p, packet_type const a)
+  { _mm256_store_ps(p, a); }
+
+  static void
+  storeu(float32* const p, packet_type const a)
+  { _mm256_storeu_ps(p, a); }
+
+  static packet_type
+  set1(float32 const x)
+  { return _mm256_set1_ps(x); }
+
+  static packet_type
+  add(packet_type const a, packet_type const b)
+  { return _mm256_add_ps(a, b); }
+
+  static packet_type
+  sub(packet_type const a, packet_type const b)
+  { return _mm256_sub_ps(a, b); }
+
+  static packet_type
+  mul(packet_type const a, packet_type const b)
+  { return _mm256_mul_ps(a, b); }
+
+  static packet_type
+  div(packet_type const a, packet_type const b)
+  { return _mm256_div_ps(a, b); }
+
+  static packet_type
+  sqrt(packet_type const a)
+  { return _mm256_sqrt_ps(a); }
+
+  static packet_type
+  min(packet_type const a, packet_type const b)
+  { return _mm256_min_ps(a, b); }
+
+  static packet_type
+  max(packet_type const a, packet_type const b)
+  { return _mm256_max_ps(a, b); }
+
+  static mask_type
+  cmplt(packet_type const a, packet_type const b)
+  { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+
+  static mask_type
+  cmpeq(packet_type const a, packet_type const b)
+  { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+
+  static packet_type
+  select(mask_type const m, packet_type const a, packet_type const b)
+  { return _mm256_blendv_ps(b, a, m); }
+};
+
+//! AVX, 4 x float64.
+template<>
+class simd_traits<float64> : private detail::nonconstructible
+{
+public:
+  typedef __m256d packet_type;
+  typedef __m256d mask_type;
+  static const std::size_t packet_size = 4;
+
+  static packet_type
+  load(float64 const* const p)
+  { return _mm256_load_pd(p); }
+
+  static packet_type
+  loadu(float64 const* const p)
+  { return _mm256_loadu_pd(p); }
+
+  static void
+  store(float64* const p, packet_type const a)
+  { _mm256_store_pd(p, a); }
+
+  static void
+  storeu(float64* const p, packet_type const a)
+  { _mm256_storeu_pd(p, a); }
+
+  static packet_type
+  set1(float64 const x)
+  { return _mm256_set1_pd(x); }
+
+  static packet_type
+  add(packet_type const a, packet_type const b)
+  { return _mm256_add_pd(a, b); }
+
+  static packet_type
+  sub(packet_type const a, packet_type const b)
+  { return _mm256_sub_pd(a, b); }
+
+  static packet_type
+  mul(packet_type const a, packet_type const b)
+  { return _mm256_mul_pd(a, b); }
+
+  static packet_type
+  div(packet_type const a, packet_type const b)
+  { return _mm256_div_pd(a, b); }
+
+  static packet_type
+  sqrt(packet_type const a)
+  { return _mm256_sqrt_pd(a); }
+
+  static packet_type
+  min(packet_type const a, packet_type const b)
+  { return _mm256_min_pd(a, b); }
+
+  static packet_type
+  max(packet_type const a, packet_type const b)
+  { return _mm256_max_pd(a, b); }
+
+  static mask_type
+  cmplt(packet_type const a, packet_type const b)
+  { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+
+  static mask_type
+  cmpeq(packet_type const a, packet_type const b)
+  { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+
+  static packet_type
+  select(mask_type const m, packet_type const a, packet_type const b)
+  { return _mm256_blendv_pd(b, a, m); }
+};
+
+#elif defined(THX_SSE2)
+
+//! SSE, 4 x float32.
+template<>
+class simd_traits<float32> : private detail::nonconstructible
+{
+public:
+  typedef __m128 packet_type;
+  typedef __m128 mask_type;
+  static const std::size_t packet_size = 4;
+
+  static packet_type
+  load(float32 const* const p)
+  { return _mm_load_ps(p); }
+
+  static packet_type
+  loadu(float32 const* const p)
+  { return _mm_loadu_ps(p); }
+
+  static void
+  store(float32* const p, packet_type const a)
+  { _mm_store_ps(p, a); }
+
+  static void
+  storeu(float32* const p, packet_type const a)
+  { _mm_storeu_ps(p, a); }
+
+  static packet_type
+  set1(float32 const x)
+  { return _mm_set1_ps(x); }
+
+  static packet_type
+  add(packet_type const a, packet_type const b)
+  { return _mm_add_ps(a, b); }
+
+  static packet_type
+  sub(packet_type const a, packet_type const b)
+  { return _mm_sub_ps(a, b); }
+
+  static packet_type
+  mul(packet_type const a, packet_type const b)
+  { return _mm_mul_ps(a, b); }
+
+  static packet_type
+  div(packet_type const a, packet_type const b)
+  { return _mm_div_ps(a, b); }
+
+  static packet_type
+  sqrt(packet_type const a)
+  { return _mm_sqrt_ps(a); }
+
+  static packet_type
+  min(packet_type const a, packet_type const b)
+  { return _mm_min_ps(a, b); }
+
+  static packet_type
+  max(packet_type const a, packet_type const b)
+  { return _mm_max_ps(a, b); }
+
+  static mask_type
+  cmplt(packet_type const a, packet_type const b)
+  { return _mm_cmplt_ps(a, b); }
+
+  static mask_type
+  cmpeq(packet_type const a, packet_type const b)
+  { return _mm_cmpeq_ps(a, b); }
+
+  static packet_type
+  select(mask_type const m, packet_type const a, packet_type const b)
+  { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+};
+
+//! SSE2, 2 x float64.
+template<>
+class simd_traits<float64> : private detail::nonconstructible
+{
+public:
+  typedef __m128d packet_type;
+  typedef __m128d mask_type;
+  static const std::size_t packet_size = 2;
+
+  static packet_type
+  load(float64 const* const p)
+  { return _mm_load_pd(p); }
+
+  static packet_type
+  loadu(float64 const* const p)
+  { return _mm_loadu_pd(p); }
+
+  static void
+  store(float64* const p, packet_type const a)
+  { _mm_store_pd(p, a); }
+
+  static void
+  storeu(float64* const p, packet_type const a)
+  { _mm_storeu_pd(p, a); }
+
+  static packet_type
+  set1(float64 const x)
+  { return _mm_set1_pd(x); }
+
+  static packet_type
+  add(packet_type const a, packet_type const b)
+  { return _mm_add_pd(a, b); }
+
+  static packet_type
+  sub(packet_type const a, packet_type const b)
+  { return _mm_sub_pd(a, b); }
+
+  static packet_type
+  mul(packet_type const a, packet_type const b)
+  { return _mm_mul_pd(a, b); }
+
+  static packet_type
+  div(packet_type const a, packet_type const b)
+  { return _mm_div_pd(a, b); }
+
+  static packet_type
+  sqrt(packet_type const a)
+  { return _mm_sqrt_pd(a); }
+
+  static packet_type
+  min(packet_type const a, packet_type const b)
+  { return _mm_min_pd(a, b); }
+
+  static packet_type
+  max(packet_type const a, packet_type const b)
+  { return _mm_max_pd(a, b); }
+
+  static mask_type
+  cmplt(packet_type const a, packet_type const b)
+  { return _mm_cmplt_pd(a, b); }
+
+  static mask_type
+  cmpeq(packet_type const a, packet_type const b)
+  { return _mm_cmpeq_pd(a, b); }
+
+  static packet_type
+  select(mask_type const m, packet_type const a, packet_type const b)
+  { return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b)); }
+};
+
+#endif // THX_AVX, THX_SSE2
+
+END_THX_NAMESPACE
+
+#endif // THX_SIMD_HPP_INCLUDED
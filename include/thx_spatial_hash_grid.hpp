@@ -0,0 +1,619 @@
+//------------------------------------------------------------------------------
+//
+// Contributors:
+//             1) Tommy Hinks
+//
+//------------------------------------------------------------------------------
+
+#ifndef THX_SPATIAL_HASH_GRID_HPP_INCLUDED
+#define THX_SPATIAL_HASH_GRID_HPP_INCLUDED
+
+#include "thx_namespace.hpp"
+#include "thx_types.hpp"
+#include "thx_vec.hpp"
+#include "thx_vec_algo.hpp"
+#include "thx_operators.hpp"
+#include "thx_hashing.hpp"
+#include "thx_parallel.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+BEGIN_THX_NAMESPACE
+
+// spatial_hash_grid<S> anatomy:
+// -----------------------------
+//
+// typedef S value_type;
+// typedef uint32 index_type;
+// typedef std::size_t size_type;
+//
+// Cell size CTOR
+//
+// S cell_size() const
+// size_type size() const
+// bool empty() const
+// void clear()
+//
+// void build(vec<3,S> const*, size_type[, thread_pool&])
+// void rebuild([thread_pool&])
+// void insert(index_type, vec<3,S>[, thread_pool&])
+// bool remove(index_type, vec<3,S>)
+//
+// void radius_query(vec<3,S>, S, std::vector<index_type>&) const
+// void knn_query(vec<3,S>, size_type, std::vector<index_type>&) const
+//
+// Points are quantized into cubic cells of side cell_size and the cells are
+// hashed into a power of two number of buckets, at least as many as there are
+// points. The bucket of cell (x, y, z) is murmur(y, z) + x, so that a row of
+// cells maps to consecutive buckets. The points of a bucket are stored
+// together with their ids in one contiguous range of a single flat array.
+// Queries scan rows of cells and thus mostly read memory sequentially.
+// Different cells may share a bucket, queries therefore check the cell of
+// each point they accept.
+//
+// build replaces the contents with the points 0..n-1, sorting them by bucket
+// in parallel. The sort is stable, so points are ordered by id within each
+// bucket and the layout, and thereby query output, does not depend on the
+// number of threads.
+//
+// insert appends to the range of a bucket. A full range is moved to the end
+// of the array with twice the capacity, the old range becomes garbage.
+// remove swaps the point with the last one of its bucket and must be given
+// the position the point was inserted with. Both are amortized O(1): the
+// grid is rebuilt when garbage exceeds the number of points and with twice
+// the buckets when there are more points than buckets, on the pool given to
+// insert. rebuild compacts the array explicitly, e.g. after many removals.
+//
+// radius_query returns the ids of the points within distance r of a center
+// (inclusive) in storage order. knn_query returns the ids of the k nearest
+// points, closest first, with ties broken by id. It visits shells of cells
+// of growing radius around the center and stops as soon as no unseen point
+// can be closer than the k:th point found so far. Both fall back to scanning
+// all points when the region to visit has more cells than there are buckets.
+// Queries are const and may run concurrently.
+//
+// Cell coordinates are int32, so positions divided by cell_size must be
+// within the range of int32.
+
+//------------------------------------------------------------------------------
+
+namespace detail {
+
+//! Points per task in parallel builds.
+const std::size_t grid_grain = 16384;
+
+//! Maximum number of bucket groups in the first pass of a build.
+const std::size_t grid_groups = 1024;
+
+} // Namespace: detail.
+
+//------------------------------------------------------------------------------
+
+//! DOCS
+template<typename S>
+class spatial_hash_grid {
+public:
+  static_assert(std::is_floating_point<S>::value,
+                "Scalar type must be floating point");
+
+  typedef S value_type;
+  typedef uint32 index_type;
+  typedef std::size_t size_type;
+
+public: // CTOR's.
+  //! Cell size CTOR. Queries are fastest when the cell size is close to the
+  //! typical query radius.
+  explicit
+  spatial_hash_grid(S const cell_size)
+    : _cell_size(cell_size)
+    , _inv_cell_size(S(1)/cell_size)
+    , _size(0)
+    , _garbage(0) {
+    _reset(_lo, _hi);
+  }
+
+public: // Size.
+  //! Side of the cubic cells.
+  S
+  cell_size() const {
+    return _cell_size;
+  }
+
+  //! Number of points.
+  size_type
+  size() const {
+    return _size;
+  }
+
+  //! True if there are no points.
+  bool
+  empty() const {
+    return _size == 0;
+  }
+
+  //! Remove all points.
+  void
+  clear() {
+    _buckets.clear();
+    _entries.clear();
+    _size = 0;
+    _garbage = 0;
+    _reset(_lo, _hi);
+  }
+
+public: // Modifiers.
+  //! Replace the contents with the n points p, point i gets id i.
+  void
+  build(vec<3,S> const* const p,
+        size_type const n,
+        thread_pool& pool = default_thread_pool()) {
+    _build(n, [p](size_type const i) {
+      entry e;
+      e.p = p[i];
+      e.id = static_cast<index_type>(i);
+      return e;
+    }, 0, pool);
+  }
+
+  //! Rebuild from the current contents, releasing garbage.
+  void
+  rebuild(thread_pool& pool = default_thread_pool()) {
+    _rebuild(0, pool);
+  }
+
+  //! Add the point p with the given id. Rebuilds triggered by the insert 
+  //! run on pool.
+  void
+  insert(index_type const id, 
+         vec<3,S> const& p,
+         thread_pool& pool = default_thread_pool()) {
+    if (_size >= _buckets.size()) {
+      _rebuild(2*_size, pool);
+    }
+    cell_type const c = _cell(p);
+    _extend(_lo, _hi, c);
+    bucket& b = _buckets[_hash(c) & (_buckets.size() - 1)];
+    if (b.count == b.capacity) {
+      // Move the range to the end of the array with twice the capacity.
+      index_type const capacity = (std::max)(2*b.capacity, index_type(4));
+      size_type const start = _entries.size();
+      _entries.resize(start + capacity);
+      std::copy(_entries.begin() + b.start,
+                _entries.begin() + b.start + b.count,
+                _entries.begin() + start);
+      _garbage += b.capacity;
+      b.start = static_cast<index_type>(start);
+      b.capacity = capacity;
+    }
+    entry& e = _entries[b.start + b.count];
+    e.p = p;
+    e.id = id;
+    ++b.count;
+    ++_size;
+    if (_garbage > _size) {
+      _rebuild(0, pool);
+    }
+  }
+
+  //! Remove the point with the given id, inserted at position p. Returns
+  //! false if there is no such point.
+  bool
+  remove(index_type const id, vec<3,S> const& p) {
+    if (_size == 0) {
+      return false;
+    }
+    bucket& b = _buckets[_hash(_cell(p)) & (_buckets.size() - 1)];
+    entry* const e = _entries.data() + b.start;
+    for (index_type i = 0; i < b.count; ++i) {
+      if (e[i].id == id) {
+        e[i] = e[b.count - 1];
+        --b.count;
+        --_size;
+        return true;
+      }
+    }
+    return false;
+  }
+
+public: // Queries.
+  //! Ids of the points within distance r of center, see above.
+  void
+  radius_query(vec<3,S> const& center,
+               S const r,
+               std::vector<index_type>& out) const {
+    out.clear();
+    if (_size == 0 || !(r >= 0)) {
+      return;
+    }
+    S const r2 = r*r;
+    vec<3,S> const d(r);
+    cell_type const c0 = _cell(center - d);
+    cell_type const c1 = _cell(center + d);
+    int64 lo[3];
+    int64 hi[3];
+    lo[0] = (std::max)(int64(c0.x), int64(_lo.x));
+    lo[1] = (std::max)(int64(c0.y), int64(_lo.y));
+    lo[2] = (std::max)(int64(c0.z), int64(_lo.z));
+    hi[0] = (std::min)(int64(c1.x), int64(_hi.x));
+    hi[1] = (std::min)(int64(c1.y), int64(_hi.y));
+    hi[2] = (std::min)(int64(c1.z), int64(_hi.z));
+    if (lo[0] > hi[0] || lo[1] > hi[1] || lo[2] > hi[2]) {
+      return;
+    }
+
+    if (_volume(lo, hi) >= _buckets.size()) {
+      _visit_all([&](entry const& e) {
+        if (dist_squared(e.p, center) <= r2) {
+          out.push_back(e.id);
+        }
+      });
+      return;
+    }
+
+    for (int64 z = lo[2]; z <= hi[2]; ++z) {
+      for (int64 y = lo[1]; y <= hi[1]; ++y) {
+        for (int64 x = lo[0]; x <= hi[0]; ++x) {
+          cell_type const c = _make_cell(x, y, z);
+          _visit_cell(c, [&](entry const& e) {
+            if (dist_squared(e.p, center) <= r2 && _equal(_cell(e.p), c)) {
+              out.push_back(e.id);
+            }
+          });
+        }
+      }
+    }
+  }
+
+  //! Ids of the k points nearest to center, closest first, see above.
+  //! Returns fewer than k ids if there are fewer points.
+  void
+  knn_query(vec<3,S> const& center,
+            size_type const k,
+            std::vector<index_type>& out) const {
+    typedef std::pair<S, index_type> candidate;
+
+    out.clear();
+    if (_size == 0 || k == 0) {
+      return;
+    }
+    std::vector<candidate> heap;
+    heap.reserve((std::min)(k, _size) + 1);
+    const auto offer = [&](candidate const& x) {
+      if (heap.size() < k) {
+        heap.push_back(x);
+        std::push_heap(heap.begin(), heap.end());
+      }
+      else if (x < heap.front()) {
+        std::pop_heap(heap.begin(), heap.end());
+        heap.back() = x;
+        std::push_heap(heap.begin(), heap.end());
+      }
+    };
+
+    // Chebyshev distances in cells from the center cell to the nearest and
+    // farthest cells of the bounds.
+    cell_type const c = _cell(center);
+    int64 const cq[3] = { c.x, c.y, c.z };
+    int64 const blo[3] = { _lo.x, _lo.y, _lo.z };
+    int64 const bhi[3] = { _hi.x, _hi.y, _hi.z };
+    int64 ring_begin = 0;
+    int64 ring_end = 0;
+    for (int i = 0; i < 3; ++i) {
+      ring_begin = (std::max)(ring_begin,
+                              (std::max)(blo[i] - cq[i], cq[i] - bhi[i]));
+      ring_end = (std::max)(ring_end,
+                            (std::max)(cq[i] - blo[i], bhi[i] - cq[i]));
+    }
+
+    bool scan_all = false;
+    for (int64 ring = ring_begin; ring <= ring_end; ++ring) {
+      int64 lo[3];
+      int64 hi[3];
+      for (int i = 0; i < 3; ++i) {
+        lo[i] = (std::max)(cq[i] - ring, blo[i]);
+        hi[i] = (std::min)(cq[i] + ring, bhi[i]);
+      }
+      if (_volume(lo, hi) >= _buckets.size()) {
+        scan_all = true;
+        break;
+      }
+
+      for (int64 z = lo[2]; z <= hi[2]; ++z) {
+        for (int64 y = lo[1]; y <= hi[1]; ++y) {
+          // Inside the shell only the first and last cell of a row are new.
+          bool const face =
+            z == cq[2] - ring || z == cq[2] + ring ||
+            y == cq[1] - ring || y == cq[1] + ring;
+          int64 const x0 = face ? lo[0] : cq[0] - ring;
+          int64 const x1 = face ? hi[0] : cq[0] + ring;
+          int64 const step = (face || ring == 0) ? 1 : 2*ring;
+          for (int64 x = x0; x <= x1; x += step) {
+            if (x < lo[0] || x > hi[0]) {
+              continue;
+            }
+            cell_type const cx = _make_cell(x, y, z);
+            _visit_cell(cx, [&](entry const& e) {
+              candidate const m(dist_squared(e.p, center), e.id);
+              if ((heap.size() < k || m < heap.front()) &&
+                  _equal(_cell(e.p), cx)) {
+                offer(m);
+              }
+            });
+          }
+        }
+      }
+
+      // Unseen points lie outside the cube of visited cells. The margin
+      // covers rounding in the cell computation.
+      if (heap.size() == k) {
+        S reach = (std::numeric_limits<S>::max)();
+        for (int i = 0; i < 3; ++i) {
+          reach = (std::min)(reach, (std::min)(
+            center[i] - S(cq[i] - ring)*_cell_size,
+            S(cq[i] + ring + 1)*_cell_size - center[i]));
+        }
+        reach *= 1 - 16*std::numeric_limits<S>::epsilon();
+        if (reach > 0 && heap.front().first < reach*reach) {
+          break;
+        }
+      }
+    }
+
+    if (scan_all) {
+      heap.clear();
+      _visit_all([&](entry const& e) {
+        offer(candidate(dist_squared(e.p, center), e.id));
+      });
+    }
+
+    std::sort_heap(heap.begin(), heap.end());
+    out.resize(heap.size());
+    for (size_type i = 0; i < heap.size(); ++i) {
+      out[i] = heap[i].second;
+    }
+  }
+
+private:
+  //! Point stored in the grid.
+  struct entry {
+    vec<3,S> p;
+    index_type id;
+  };
+
+  //! Range of the entry array. Entries [start, start + count) are points,
+  //! [start + count, start + capacity) is free.
+  struct bucket {
+    index_type start;
+    index_type count;
+    index_type capacity;
+  };
+
+  //! Integer cell coordinates.
+  struct cell_type {
+    int32 x;
+    int32 y;
+    int32 z;
+  };
+
+  static
+  cell_type
+  _make_cell(int64 const x, int64 const y, int64 const z) {
+    cell_type c;
+    c.x = static_cast<int32>(x);
+    c.y = static_cast<int32>(y);
+    c.z = static_cast<int32>(z);
+    return c;
+  }
+
+  static
+  bool
+  _equal(cell_type const& a, cell_type const& b) {
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+  }
+
+  //! Hash of the (y, z) row plus x, so that the cells of a row fall into
+  //! consecutive buckets.
+  static
+  size_type
+  _hash(cell_type const& c) {
+    return murmur<uint32>(&c.y, 2*sizeof(int32), 0) + static_cast<uint32>(c.x);
+  }
+
+  //! Number of cells in the box [lo, hi], saturated well below overflow.
+  static
+  size_type
+  _volume(int64 const* const lo, int64 const* const hi) {
+    uint64 v = 1;
+    for (int i = 0; i < 3; ++i) {
+      v *= static_cast<uint64>((std::min)(hi[i] - lo[i] + 1, int64(1) << 20));
+    }
+    return static_cast<size_type>(
+      (std::min)(v, uint64((std::numeric_limits<size_type>::max)())));
+  }
+
+  cell_type
+  _cell(vec<3,S> const& p) const {
+    return _make_cell(static_cast<int64>(std::floor(p[0]*_inv_cell_size)),
+                      static_cast<int64>(std::floor(p[1]*_inv_cell_size)),
+                      static_cast<int64>(std::floor(p[2]*_inv_cell_size)));
+  }
+
+  //! Empty bounds.
+  static
+  void
+  _reset(cell_type& lo, cell_type& hi) {
+    int32 const big = (std::numeric_limits<int32>::max)();
+    int32 const small = (std::numeric_limits<int32>::min)();
+    lo = _make_cell(big, big, big);
+    hi = _make_cell(small, small, small);
+  }
+
+  //! Grow the bounds [lo, hi] to include c.
+  static
+  void
+  _extend(cell_type& lo, cell_type& hi, cell_type const& c) {
+    lo = _make_cell((std::min)(lo.x, c.x),
+                    (std::min)(lo.y, c.y),
+                    (std::min)(lo.z, c.z));
+    hi = _make_cell((std::max)(hi.x, c.x),
+                    (std::max)(hi.y, c.y),
+                    (std::max)(hi.z, c.z));
+  }
+
+  //! Call f for each entry in the bucket of c, including those of other
+  //! cells that hash to the same bucket.
+  template<class F>
+  void
+  _visit_cell(cell_type const& c, F const& f) const {
+    bucket const& b = _buckets[_hash(c) & (_buckets.size() - 1)];
+    entry const* const e = _entries.data() + b.start;
+    for (index_type i = 0; i < b.count; ++i) {
+      f(e[i]);
+    }
+  }
+
+  //! Call f for each entry.
+  template<class F>
+  void
+  _visit_all(F const& f) const {
+    for (size_type j = 0; j < _buckets.size(); ++j) {
+      entry const* const e = _entries.data() + _buckets[j].start;
+      for (index_type i = 0; i < _buckets[j].count; ++i) {
+        f(e[i]);
+      }
+    }
+  }
+
+  //! Rebuild from the current contents with at least min_buckets buckets.
+  void
+  _rebuild(size_type const min_buckets, thread_pool& pool) {
+    std::vector<entry> live;
+    live.reserve(_size);
+    _visit_all([&](entry const& e) { live.push_back(e); });
+    entry const* const e = live.data();
+    _build(live.size(), [e](size_type const i) { return e[i]; },
+           min_buckets, pool);
+  }
+
+  //! Replace the contents with the n entries get(i). A counting sort by
+  //! bucket in two passes: entries are first partitioned into groups of
+  //! consecutive buckets, then each group is sorted by bucket. Both passes
+  //! write to a few active regions at a time instead of all over the array,
+  //! and both are stable.
+  template<class F>
+  void
+  _build(size_type const n,
+         F const& get,
+         size_type const min_buckets,
+         thread_pool& pool) {
+    size_type nb = 16;
+    while (nb < n || nb < min_buckets) {
+      nb *= 2;
+    }
+    size_type const mask = nb - 1;
+    size_type const groups = (std::min)(nb, detail::grid_groups);
+    size_type const group_size = nb/groups;
+    size_type const grain = detail::grid_grain;
+    size_type const chunks = (n + grain - 1)/grain;
+
+    // Buckets, bounds and group sizes per chunk.
+    std::vector<index_type> slot(n);
+    std::vector<index_type> offset(chunks*groups);
+    _reset(_lo, _hi);
+    std::mutex mutex;
+    parallel_for(0, n, grain, [&](size_type const i0, size_type const i1) {
+      index_type* const count = &offset[(i0/grain)*groups];
+      cell_type lo;
+      cell_type hi;
+      _reset(lo, hi);
+      for (size_type i = i0; i < i1; ++i) {
+        cell_type const c = _cell(get(i).p);
+        _extend(lo, hi, c);
+        slot[i] = static_cast<index_type>(_hash(c) & mask);
+        ++count[slot[i]/group_size];
+      }
+      std::lock_guard<std::mutex> lock(mutex);
+      _extend(_lo, _hi, lo);
+      _extend(_lo, _hi, hi);
+    }, pool);
+
+    // Output offsets of each chunk within each group, in input order.
+    std::vector<index_type> group_start(groups + 1);
+    index_type start = 0;
+    for (size_type g = 0; g < groups; ++g) {
+      group_start[g] = start;
+      for (size_type c = 0; c < chunks; ++c) {
+        index_type const count = offset[c*groups + g];
+        offset[c*groups + g] = start;
+        start += count;
+      }
+    }
+    group_start[groups] = start;
+
+    // Partition input indices by group.
+    std::vector<index_type> order(n);
+    parallel_for(0, n, grain, [&](size_type const i0, size_type const i1) {
+      index_type* const cursor = &offset[(i0/grain)*groups];
+      for (size_type i = i0; i < i1; ++i) {
+        order[cursor[slot[i]/group_size]++] = static_cast<index_type>(i);
+      }
+    }, pool);
+
+    // Sort each group by bucket into tightly packed ranges.
+    std::vector<bucket> buckets(nb);
+    std::vector<entry> entries(n);
+    size_type const group_grain = (std::max)(size_type(1), groups*grain/(n + 1));
+    parallel_for(0, groups, group_grain,
+      [&](size_type const g0, size_type const g1) {
+        for (size_type g = g0; g < g1; ++g) {
+          bucket* const b = &buckets[g*group_size];
+          for (index_type k = group_start[g]; k < group_start[g + 1]; ++k) {
+            ++b[slot[order[k]] - g*group_size].capacity;
+          }
+          index_type next = group_start[g];
+          for (size_type j = 0; j < group_size; ++j) {
+            b[j].start = next;
+            next += b[j].capacity;
+          }
+          for (index_type k = group_start[g]; k < group_start[g + 1]; ++k) {
+            bucket& bk = buckets[slot[order[k]]];
+            entries[bk.start + bk.count++] = get(order[k]);
+          }
+        }
+      }, pool);
+
+    _buckets.swap(buckets);
+    _entries.swap(entries);
+    _size = n;
+    _garbage = 0;
+  }
+
+private: // Member variables.
+  S _cell_size;
+  S _inv_cell_size;
+  std::vector<bucket> _buckets;
+  std::vector<entry> _entries;
+  size_type _size;
+  size_type _garbage;   //!< Entries in abandoned ranges.
+  cell_type _lo;        //!< Bounds of the cells of all inserted points.
+  cell_type _hi;
+};
+
+//------------------------------------------------------------------------------
+
+// Convenient types, add more if appropriate.
+
+typedef spatial_hash_grid<float32> spatial_hash_grid32;
+typedef spatial_hash_grid<float64> spatial_hash_grid64;
+
+END_THX_NAMESPACE
+
+#endif // THX_SPATIAL_HASH_GRID_HPP_INCLUDED
@@ -0,0 +1,183 @@
+//------------------------------------------------------------------------------
+//
+// Contributors:
+//             1) Tommy Hinks
+//
+//------------------------------------------------------------------------------
+
+#ifndef THX_STD_HASH_HPP_INCLUDED
+#define THX_STD_HASH_HPP_INCLUDED
+
+#include "thx_namespace.hpp"
+#include "thx_define.hpp"
+#include "thx_types.hpp"
+#include "thx_hashing.hpp"
+#include "thx_vec.hpp"
+#include "thx_mat.hpp"
+#include "thx_quat.hpp"
+#include <cstddef>
+#include <functional>
+#include <limits>
+
+//------------------------------------------------------------------------------
+
+BEGIN_THX_NAMESPACE
+
+// Hashing of vectors, matrices and quaternions.
+// ---------------------------------------------
+//
+// std::size_t hash_value(vec<N,S>, seed = 0)
+// std::size_t hash_value(mat<N,S>, seed = 0)
+// std::size_t hash_value(quat<S>, seed = 0)
+// std::size_t hash_combine(seed, h)
+//
+// std::hash<vec<N,S>>
+// std::hash<mat<N,S>>
+// std::hash<quat<S>>
+//
+// hash_value hashes all components in one pass with murmur, using the 64-bit
+// variant where std::size_t is 64 bits wide. Before hashing, -0 is replaced
+// by +0 and every NaN by the same quiet NaN. Values that compare equal
+// (vec_equal, mat_equal, operator==) therefore hash equal, and NaN keys that
+// only differ in sign or payload end up in the same bucket.
+//
+// hash_combine mixes the hash h into seed using the inner loop of murmur.
+// It is cheap enough to fold the hashes of the members of a larger key, e.g.
+// the position, normal and texture coordinate of a vertex.
+
+namespace detail {
+
+template<std::size_t Bytes>
+struct size_hash;
+
+template<>
+struct size_hash<4> {
+  typedef uint32 word_type;
+
+  static
+  std::size_t
+  combine(uint32 h, uint32 k) {
+    uint32 const m = 0x5bd1e995u;
+    k *= m;
+    k ^= k >> 24;
+    k *= m;
+    h *= m;
+    return h ^ k;
+  }
+};
+
+template<>
+struct size_hash<8> {
+  typedef uint64 word_type;
+
+  static
+  std::size_t
+  combine(uint64 h, uint64 k) {
+    uint64 const m = 0xc6a4a7935bd1e995ull;
+    k *= m;
+    k ^= k >> 47;
+    k *= m;
+    h ^= k;
+    return h*m;
+  }
+};
+
+typedef size_hash<sizeof(std::size_t)> host_size_hash;
+
+//! Maps -0 to +0 and all NaNs to a single quiet NaN.
+template<typename S> inline
+S
+hash_canonical(S const x) {
+  return x != x ? std::numeric_limits<S>::quiet_NaN() : (x == S(0) ? S(0) : x);
+}
+
+//! Hash of the N canonical components of p. N is a template parameter so
+//! that the copy and the murmur block loop unroll for small keys.
+template<std::size_t N, typename S> inline
+std::size_t
+hash_components(S const* const p, std::size_t const seed) {
+  typedef host_size_hash::word_type word_type;
+  S buf[N];
+  for (std::size_t i = 0; i < N; ++i) {
+    buf[i] = hash_canonical(p[i]);
+  }
+  return static_cast<std::size_t>(murmur<word_type>(
+    buf, sizeof(buf), static_cast<word_type>(seed)));
+}
+
+} // Namespace: detail.
+
+//------------------------------------------------------------------------------
+
+//! Hash of v that agrees with vec_equal, see above.
+template<std::size_t N, typename S> inline
+std::size_t
+hash_value(vec<N,S> const& v, std::size_t const seed = 0) {
+  return detail::hash_components<N>(v.const_data(), seed);
+}
+
+//! Hash of a that agrees with mat_equal, see above.
+template<std::size_t N, typename S> inline
+std::size_t
+hash_value(mat<N,S> const& a, std::size_t const seed = 0) {
+  return detail::hash_components<N*N>(a.const_data(), seed);
+}
+
+//! Hash of q that agrees with operator==, see above.
+template<typename S> inline
+std::size_t
+hash_value(quat<S> const& q, std::size_t const seed = 0) {
+  return detail::hash_components<4>(&q[0], seed);
+}
+
+//! Mixes the hash h into seed, e.g. seed = hash_combine(seed, hash_value(v)).
+inline
+std::size_t
+hash_combine(std::size_t const seed, std::size_t const h) {
+  typedef detail::host_size_hash::word_type word_type;
+  return detail::host_size_hash::combine(static_cast<word_type>(seed),
+                                         static_cast<word_type>(h));
+}
+
+END_THX_NAMESPACE
+
+//------------------------------------------------------------------------------
+
+namespace std {
+
+template<std::size_t N, typename S>
+struct hash<thx::vec<N,S>> {
+  typedef thx::vec<N,S> argument_type;
+  typedef std::size_t result_type;
+
+  std::size_t
+  operator()(thx::vec<N,S> const& v) const {
+    return thx::hash_value(v);
+  }
+};
+
+template<std::size_t N, typename S>
+struct hash<thx::mat<N,S>> {
+  typedef thx::mat<N,S> argument_type;
+  typedef std::size_t result_type;
+
+  std::size_t
+  operator()(thx::mat<N,S> const& a) const {
+    return thx::hash_value(a);
+  }
+};
+
+template<typename S>
+struct hash<thx::quat<S>> {
+  typedef thx::quat<S> argument_type;
+  typedef std::size_t result_type;
+
+  std::size_t
+  operator()(thx::quat<S> const& q) const {
+    return thx::hash_value(q);
+  }
+};
+
+} // Namespace: std.
+
+#endif // THX_STD_HASH_HPP_INCLUDED
@@ -9,6 +9,7 @@
 #define THX_TYPES_HPP_INCLUDED
 
 #include "thx_namespace.hpp"
+#include <cstdint>
 
 //------------------------------------------------------------------------------
 
@@ -16,6 +17,7 @@ BEGIN_THX_NAMESPACE
 
 typedef double            float64;
 typedef float             float32;
+#if defined(_MSC_VER)
 typedef __int8            int8;
 typedef __int16	          int16;
 typedef __int32           int32;
@@ -24,6 +26,16 @@ typedef unsigned __int8   uint8;
 typedef unsigned __int16  uint16;
 typedef unsigned __int32  uint32;
 typedef unsigned __int64  uint64;
+#else
+typedef std::int8_t       int8;
+typedef std::int16_t      int16;
+typedef std::int32_t      int32;
+typedef std::int64_t      int64;
+typedef std::uint8_t      uint8;
+typedef std::uint16_t     uint16;
+typedef std::uint32_t     uint32;
+typedef std::uint64_t     uint64;
+#endif
 
 END_THX_NAMESPACE
 
@@ -30,10 +30,10 @@ BEGIN_THX_NAMESPACE
 // define linear_size = N
 // define dim = N
 // 
-// Default constexpr (specializations only) CTOR (set all zeros by default)
-// Array constexpr CTOR (specializations only)
+// Default constexpr CTOR (set all zeros by default)
+// Array constexpr CTOR
 // Value constexpr CTOR (specializations only)
-// Vec<N-1> CTOR (specializations only)
+// Vec<N-1> constexpr CTOR (specializations only)
 // (All vec's have compiler-generated DTOR)
 // (All vec's have compiler-generated copy CTOR)
 // (All vec's have compiler-generated operator=)
@@ -66,16 +66,18 @@ public:
 
 public: // CTOR's.
   //! Default CTOR.
-  explicit 
-  vec(value_type const x = 0) { 
+  explicit THX_CONST_EXPR
+  vec(value_type const x = 0)
+    : _v() {
     for (size_type i = 0; i < linear_size; ++i) { 
       _v[i] = x; 
     }
   }
 
   //! Array CTOR.
-  explicit 
-  vec(const_pointer const v) { 
+  explicit THX_CONST_EXPR
+  vec(const_pointer const v)
+    : _v() {
     for (size_type i = 0; i < linear_size; ++i) { 
       _v[i] = v[i]; 
     }
@@ -83,7 +85,7 @@ public: // CTOR's.
 
 public: // Operators.
   //! DOCS
-  vec<linear_size, value_type>& 
+  THX_CONST_EXPR vec<linear_size, value_type>&
   operator+=(vec<linear_size, value_type> const& u) {
     for (size_type i = 0; i < linear_size; ++i) { 
       _v[i] += u[i]; 
@@ -92,7 +94,7 @@ public: // Operators.
   }
 
   //! DOCS
-  vec<linear_size, value_type>& 
+  THX_CONST_EXPR vec<linear_size, value_type>&
   operator-=(vec<linear_size, value_type> const& u) {
     for (size_type i = 0; i < linear_size; ++i) { 
       _v[i] -= u[i]; 
@@ -101,7 +103,7 @@ public: // Operators.
   }
 
   //! Scalar multiplication.
-  vec<linear_size, value_type>& 
+  THX_CONST_EXPR vec<linear_size, value_type>&
   operator*=(value_type const x) {
     for (size_type i = 0; i < linear_size; ++i) { 
       _v[i] *= x; 
@@ -111,26 +113,26 @@ public: // Operators.
 
 public: // Access operators.
   //! Return i'th component. No bounds checking!
-  const_reference 
+  THX_CONST_EXPR const_reference
   operator[](size_type const i) const { 
     return _v[i];	
   }
 
   //! Return i'th component. No bounds checking!
-  reference 
+  THX_CONST_EXPR reference
   operator[](size_type const i) { 
     return _v[i];	
   }
 
 public: // Data.
   //! Const data.
-  const_pointer
+  THX_CONST_EXPR const_pointer
   const_data() const { 
     return &_v[0]; 
   }
 
   //! Mutable data.
-  pointer 
+  THX_CONST_EXPR pointer
   data() { 
     return &_v[0]; 
   }
@@ -160,39 +162,24 @@ public: // CTOR's.
   //! Default CTOR.
   explicit THX_CONST_EXPR 
   vec(value_type const x = 0) 
-#if 0 // C++11
-    : _v{x, x}
-#endif
-  {
-    _v[0] = x; 
-    _v[1] = x;
-  }	
+    : _v{x, x} {
+  }
   
   //! Array CTOR.
   explicit THX_CONST_EXPR 
   vec(const_pointer const v)
-#if 0 // C++11
-    : _v{v[0], v[1]}
-#endif
-  {
-    _v[0] = v[0];
-    _v[1] = v[1];
-  }		
+    : _v{v[0], v[1]} {
+  }
 
   //! Value CTOR.
   explicit THX_CONST_EXPR
   vec(value_type const v0, value_type const v1)
-#if 0 // C++11
-    : _v{v0, v1}
-#endif
-  {
-    _v[0] = v0;
-    _v[1] = v1;
+    : _v{v0, v1} {
   }
 
 public: // Operators.
   //! DOCS
-  vec<linear_size, value_type>& 
+  THX_CONST_EXPR vec<linear_size, value_type>&
   operator+=(vec<linear_size,value_type> const& u) {
     _v[0] += u._v[0]; 
     _v[1] += u._v[1];
@@ -200,7 +187,7 @@ public: // Operators.
   }
 
   //! DOCS
-  vec<linear_size, value_type>& 
+  THX_CONST_EXPR vec<linear_size, value_type>&
   operator-=(vec<linear_size,value_type> const& u) {
     _v[0] -= u._v[0]; 
     _v[1] -= u._v[1];
@@ -208,7 +195,7 @@ public: // Operators.
   }
 
   //! Scalar multiplication.
-  vec<linear_size, value_type>& 
+  THX_CONST_EXPR vec<linear_size, value_type>&
   operator*=(S const x) {
     _v[0] *= x; 
     _v[1] *= x;
@@ -217,26 +204,26 @@ public: // Operators.
 
 public: // Access operators.
   //! Return i'th component. No bounds checking!
-  const_reference
+  THX_CONST_EXPR const_reference
   operator[](size_type const i) const { 
     return _v[i];	
   }
 
   //! Return i'th component. No bounds checking!
-  reference
+  THX_CONST_EXPR reference
   operator[](size_type const i) { 
     return _v[i];	
   }
 
 public: // Data.
   //! Const data.
-  const_pointer 
+  THX_CONST_EXPR const_pointer
   const_data() const { 
     return &_v[0]; 
   }
 
   //! Mutable data.
-  pointer
+  THX_CONST_EXPR pointer
   data() { 
     return &_v[0]; 
   }
@@ -266,54 +253,30 @@ public: // CTOR's.
   //! Default CTOR.
   explicit THX_CONST_EXPR
   vec(value_type const x = 0) 
-#if 0 // C++11
-    : _v{x, x, x}
-#endif
-  {
-    _v[0] = x;
-    _v[1] = x;
-    _v[2] = x;
-  }	
+    : _v{x, x, x} {
+  }
   
   //! Array CTOR.
   explicit THX_CONST_EXPR
   vec(const_pointer const v)
-#if 0 // C++11
-    : _v{v[0], v[1], v[2]}
-#endif
-  {
-    _v[0] = v[0];
-    _v[1] = v[1];
-    _v[2] = v[2];
+    : _v{v[0], v[1], v[2]} {
   }
 
   //! Value CTOR.
   explicit THX_CONST_EXPR
   vec(value_type const v0, value_type const v1, value_type const v2)
-#if 0 // C++11
-    : _v{v0, v1, v2}
-#endif
-  {
-    _v[0] = v0;
-    _v[1] = v1;
-    _v[2] = v2;
+    : _v{v0, v1, v2} {
   }
 
   //! Vec<N-1, S> CTOR.
   explicit THX_CONST_EXPR
   vec(vec<2,S> const& v, value_type const v2)
-#if 0 // C++11
-    : _v{v[0], v[1], v2}
-#endif
-  {
-    _v[0] = v[0];
-    _v[1] = v[1];
-    _v[2] = v2;
+    : _v{v[0], v[1], v2} {
   }
 
 public: // Operators.
   //! DOCS
-  vec<linear_size, value_type>& 
+  THX_CONST_EXPR vec<linear_size, value_type>&
   operator+=(vec<linear_size,value_type> const& u) {
     _v[0] += u._v[0]; 
     _v[1] += u._v[1]; 
@@ -322,7 +285,7 @@ public: // Operators.
   }
 
   //! DOCS
-  vec<linear_size, value_type>& 
+  THX_CONST_EXPR vec<linear_size, value_type>&
   operator-=(vec<linear_size, value_type> const& u) {
     _v[0] -= u._v[0]; 
     _v[1] -= u._v[1]; 
@@ -331,7 +294,7 @@ public: // Operators.
   }
 
   //! Scalar multiplication.
-  vec<linear_size, value_type>& 
+  THX_CONST_EXPR vec<linear_size, value_type>&
   operator*=(value_type const x) {
     _v[0] *= x; 
     _v[1] *= x; 
@@ -341,26 +304,26 @@ public: // Operators.
 
 public: // Access operators.
   //! Return i'th component. No bounds checking!
-  const_reference
+  THX_CONST_EXPR const_reference
   operator[](size_type const i) const { 
     return _v[i];	
   }
 
   //! Return i'th component. No bounds checking!
-  reference 
+  THX_CONST_EXPR reference
   operator[](size_type const i) { 
     return _v[i];	
   }
 
 public: // Data.
   //! Const data.
-  const_pointer 
+  THX_CONST_EXPR const_pointer
   const_data() const { 
     return &_v[0]; 
   }
 
   //! Mutable data.
-  pointer 
+  THX_CONST_EXPR pointer
   data() { 
     return &_v[0]; 
   }
@@ -390,28 +353,14 @@ public: // CTOR's.
   //! Default CTOR.
   explicit THX_CONST_EXPR
   vec(value_type const x = 0)
-#if 0 // C++11
-    : _v{x, x, x, x}
-#endif
-  {
-      _v[0] = x; 
-      _v[1] = x; 
-      _v[2] = x; 
-      _v[3] = x; 
-  }	
+    : _v{x, x, x, x} {
+  }
   
   //! Array CTOR.
   explicit THX_CONST_EXPR 
   vec(const_pointer const v)
-#if 0 // C++11
-    : _v{v[0], v[1], v[2], v[3]}
-#endif
-  {
-      _v[0] = v[0]; 
-      _v[1] = v[1]; 
-      _v[2] = v[2]; 
-      _v[3] = v[3]; 
-  }		
+    : _v{v[0], v[1], v[2], v[3]} {
+  }
 
   //! Value CTOR.
   explicit THX_CONST_EXPR
@@ -419,32 +368,18 @@ public: // CTOR's.
       value_type const v1, 
       value_type const v2, 
       value_type const v3)
-#if 0 // C++11
-    : _v{v0, v1, v2, v3}
-#endif
-  {
-      _v[0] = v0; 
-      _v[1] = v1; 
-      _v[2] = v2; 
-      _v[3] = v3; 
+    : _v{v0, v1, v2, v3} {
   }
 
   //! Vec<N-1,S> CTOR.
   explicit THX_CONST_EXPR
   vec(vec<3, S> const& v, S const v3 = S(1))
-#if 0 // C++11
-    : _v{v[0], v[1], v[2], w}
-#endif
-  {
-      _v[0] = v[0]; 
-      _v[1] = v[1]; 
-      _v[2] = v[2]; 
-      _v[3] = v3; 
+    : _v{v[0], v[1], v[2], v3} {
   }
 
 public: // Operators.
   //! DOCS
-  vec<linear_size, value_type>& 
+  THX_CONST_EXPR vec<linear_size, value_type>&
   operator+=(vec<linear_size, value_type> const& u) {
     _v[0] += u._v[0]; 
     _v[1] += u._v[1]; 
@@ -454,7 +389,7 @@ public: // Operators.
   }
 
   //! DOCS
-  vec<linear_size, value_type>& 
+  THX_CONST_EXPR vec<linear_size, value_type>&
   operator-=(vec<linear_size, value_type> const& u) {
     _v[0] -= u._v[0]; 
     _v[1] -= u._v[1]; 
@@ -464,7 +399,7 @@ public: // Operators.
   }
 
   //! Scalar multiplication.
-  vec<linear_size, value_type>& 
+  THX_CONST_EXPR vec<linear_size, value_type>&
   operator*=(S const x) {
     _v[0] *= x; 
     _v[1] *= x; 
@@ -475,26 +410,26 @@ public: // Operators.
 
 public: // Access operators.
   //! Return i'th component. No bounds checking!
-  const_reference
+  THX_CONST_EXPR const_reference
   operator[](size_type const i) const { 
     return _v[i];	
   }
 
   //! Return i'th component. No bounds checking!
-  reference 
+  THX_CONST_EXPR reference
   operator[](size_type const i) { 
     return _v[i];	
   }
 
 public: // Data.
   //! Const data.
-  const_pointer 
+  THX_CONST_EXPR const_pointer
   const_data() const { 
     return &_v[0]; 
   }
 
   //! Mutable data.
-  pointer 
+  THX_CONST_EXPR pointer
   data() { 
     return &_v[0]; 
   }
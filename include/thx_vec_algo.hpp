@@ -14,6 +14,7 @@
 #include "thx_vec_traits.hpp"
 #include "thx_mat.hpp"
 #include "thx_scalar_traits.hpp"
+#include "thx_fast_scalar_traits.hpp"
 #include "thx_scalar_algo.hpp"
 #include <type_traits>
 #include <cassert>
@@ -22,8 +23,9 @@
 
 BEGIN_THX_NAMESPACE
 
-//! vec<N,S> less comparison.
-template<int64 N, typename S>
+//! vec<N,S> less comparison. Elements are compared from the last to the
+//! first, so the last element is the most significant.
+template<std::size_t N, typename S>
 bool
 less(const vec<N,S> &u, const vec<N,S> &v) {
   for (auto i = vec<N,S>::linear_size; i > 0; --i) {
@@ -41,55 +43,33 @@ less(const vec<N,S> &u, const vec<N,S> &v) {
 template<typename S>
 bool
 less(const vec<2,S> &u, const vec<2,S> &v) {
-
+  return u[1] < v[1] || (!(v[1] < u[1]) && u[0] < v[0]);
 }
 
 //! vec<3,S> less comparison.
 template<typename S>
 bool
 less(const vec<3,S> &u, const vec<3,S> &v) {
+  return u[2] < v[2] || (!(v[2] < u[2]) &&
+         (u[1] < v[1] || (!(v[1] < u[1]) && u[0] < v[0])));
 }
 
 //! vec<4,S> less comparison.
 template<typename S>
 bool
 less(const vec<4,S> &u, const vec<4,S> &v) {
+  return u[3] < v[3] || (!(v[3] < u[3]) &&
+         (u[2] < v[2] || (!(v[2] < u[2]) &&
+         (u[1] < v[1] || (!(v[1] < u[1]) && u[0] < v[0])))));
 }
 
 //------------------------------------------------------------------------------
 
-//! vec<N,S> less comparison.
-template<int64 N, typename S>
+//! vec<N,S> greater comparison, true if v is less than u.
+template<std::size_t N, typename S>
 bool
 greater(const vec<N,S> &u, const vec<N,S> &v) {
-  for (auto i = vec<N,S>::linear_size; i > 0; --i) {
-    if (u[i - 1] < v[i - 1]) {
-      return true;
-    }    
-    else if (u[i - 1] > v[i - 1]) {
-      return false;
-    }
-  }
-  return false;
-}
-
-//! vec<2,S> less comparison.
-template<typename S>
-bool
-greater(const vec<2,S> &u, const vec<2,S> &v) {
-}
-
-//! vec<3,S> less comparison.
-template<typename S>
-bool
-greater(const vec<3,S> &u, const vec<3,S> &v) {
-}
-
-//! vec<4,S> less comparison.
-template<typename S>
-bool
-greater(const vec<4,S> &u, const vec<4,S> &v) {
-  return false;
+  return less(v, u);
 }
 
 //------------------------------------------------------------------------------
@@ -99,7 +79,7 @@ template<class V>
 bool
 vec_equal(V const& u, V const& v) 
 {
-  typedef vec_traits<V>::size_type size_type;
+  typedef typename vec_traits<V>::size_type size_type;
 
   bool t = equal(u[0], v[0]);
   size_type i = 1;
@@ -117,7 +97,7 @@ template<class V>
 bool
 vec_not_equal(V const& u, V const&v) 
 {
-  typedef vec_traits<V>::size_type size_type;
+  typedef typename vec_traits<V>::size_type size_type;
 
   bool t = not_equal(u[0], v[0]);
   size_type i = 1;
@@ -140,7 +120,7 @@ vec_negate(V const& v) {
   for (size_type i = 0; i < vec_traits<V>::linear_size; ++i) {
     u[i] = negate(v[i]); 
   }
-  return r;    
+  return u;    
 }
 
 //! DOCS
@@ -170,10 +150,11 @@ vec_negate(vec<4,S> const& v) {
 template<class V>
 V
 vec_abs(V const& v) {
-  using scalar_traits<vec_traits<V>::value_type>::abs;
+  typedef scalar_traits<typename vec_traits<V>::value_type> traits;
   V u;
-  for (vec_traits<V>::size_type i = 0; i < vec_traits<V>::linear_size; ++i) {
-    u[i] = abs(v[i]); 
+  for (typename vec_traits<V>::size_type i = 0; 
+       i < vec_traits<V>::linear_size; ++i) {
+    u[i] = traits::abs(v[i]); 
   }
   return u;  
 }
@@ -182,51 +163,51 @@ vec_abs(V const& v) {
 template<typename S>
 vec<2,S>
 vec_abs(vec<2,S> const& v) { 
-  using scalar_traits<vec_traits<vec<2,S>>::value_type>::abs;
-  return vec<2,S>(abs(v[0]), abs(v[1])); 
+  typedef scalar_traits<S> traits;
+  return vec<2,S>(traits::abs(v[0]), traits::abs(v[1])); 
 }
 
 //! DOCS
 template<typename S>
 vec<3,S>
 vec_abs(vec<3,S> const& v) { 
-  using scalar_traits<vec_traits<vec<3,S>>::value_type>::abs;
-  return vec<3,S>(abs(v[0]), abs(v[1]), abs(v[2])); 
+  typedef scalar_traits<S> traits;
+  return vec<3,S>(traits::abs(v[0]), traits::abs(v[1]), traits::abs(v[2])); 
 }
 
 //! DOCS
 template<typename S>
 vec<4,S>
 vec_abs(vec<4,S> const& v) { 
-  using scalar_traits<vec_traits<vec<4,S>>::value_type>::abs;
-  return vec<4,S>(abs(v[0]), abs(v[1]), abs(v[2]), abs(v[3])); 
+  typedef scalar_traits<S> traits;
+  return vec<4,S>(traits::abs(v[0]), traits::abs(v[1]), traits::abs(v[2]), traits::abs(v[3])); 
 }
 
 //------------------------------------------------------------------------------
 
 //! Docs
-template<int64 N, typename S>
+template<std::size_t N, typename S> inline THX_CONST_EXPR
 vec<N,S>
 vec_add(vec<N,S> const& u, vec<N,S> const& v) { 
   return vec<N,S>(u) += v; 
 }
 
 //! Docs
-template<typename S>
+template<typename S> inline THX_CONST_EXPR
 vec<2,S>
 vec_add(vec<2,S> const& u, vec<2,S> const& v) { 
   return vec<2,S>(u[0] + v[0], u[1] + v[1]); 
 }
 
 //! Docs
-template<typename S>
+template<typename S> inline THX_CONST_EXPR
 vec<3,S>
 vec_add(vec<3,S> const& u, vec<3,S> const& v) { 
   return vec<3,S>(u[0] + v[0], u[1] + v[1], u[2] + v[2]); 
 }
 
 //! Docs
-template<typename S>
+template<typename S> inline THX_CONST_EXPR
 vec<4,S>
 vec_add(vec<4,S> const& u, vec<4,S> const& v) { 
   return vec<4,S>(u[0] + v[0], u[1] + v[1], u[2] + v[2], u[3] + v[3]); 
@@ -235,28 +216,28 @@ vec_add(vec<4,S> const& u, vec<4,S> const& v) {
 //------------------------------------------------------------------------------
 
 //! Docs
-template<int64 N, typename S>
+template<std::size_t N, typename S> inline THX_CONST_EXPR
 vec<N,S>
 vec_subtract(vec<N,S> const& u, vec<N,S> const& v) { 
   return vec<N,S>(u) -= v; 
 }
 
 //! Docs
-template<typename S>
+template<typename S> inline THX_CONST_EXPR
 vec<2,S>
 vec_subtract(vec<2,S> const& u, vec<2,S> const& v) { 
   return vec<2,S>(u[0] - v[0], u[1] - v[1]); 
 }
 
 //! Docs
-template<typename S>
+template<typename S> inline THX_CONST_EXPR
 vec<3,S>
 vec_subtract(vec<3,S> const& u, vec<3,S> const& v) { 
   return vec<3,S>(u[0] - v[0], u[1] - v[1], u[2] - v[2]); 
 }
 
 //! Docs
-template<typename S>
+template<typename S> inline THX_CONST_EXPR
 vec<4,S>
 vec_subtract(vec<4,S> const& u, vec<4,S> const& v) { 
   return vec<4,S>(u[0] - v[0], u[1] - v[1], u[2] - v[2], u[3] - v[3]); 
@@ -265,28 +246,28 @@ vec_subtract(vec<4,S> const& u, vec<4,S> const& v) {
 //------------------------------------------------------------------------------
 
 //! DOCS
-template<int64 N, typename S>
+template<std::size_t N, typename S> inline THX_CONST_EXPR
 vec<N,S>
 vec_scale(S const s, vec<N,S> const& v) { 
   return vec<N,S>(v) *= s; 
 }
 
 //! DOCS
-template<typename S>
+template<typename S> inline THX_CONST_EXPR
 vec<2,S>
 vec_scale(S const s, vec<2,S> const& v) { 
   return vec<2,S>(s*v[0], s*v[1]); 
 }
 
 //! DOCS
-template<typename S>
+template<typename S> inline THX_CONST_EXPR
 vec<3,S>
 vec_scale(S const s, vec<3,S> const& v) { 
   return vec<3,S>(s*v[0], s*v[1], s*v[2]); 
 }
 
 //! DOCS
-template<typename S>
+template<typename S> inline THX_CONST_EXPR
 vec<4,S>
 vec_scale(S const s, vec<4,S> const& v) { 
   return vec<4,S>(s*v[0], s*v[1], s*v[2], s*v[3]); 
@@ -295,7 +276,7 @@ vec_scale(S const s, vec<4,S> const& v) {
 //------------------------------------------------------------------------------
 
 //! Compute vec<N,S> inner product.
-template<class V>
+template<class V> inline THX_CONST_EXPR
 typename vec_traits<V>::value_type
 inner_product(V const& u, V const& v) {
   static_assert(vec_traits<V>::linear_size >= 2, 
@@ -312,21 +293,21 @@ inner_product(V const& u, V const& v) {
 }
 
 //! Compute vec<2,S> inner product.
-template<typename S>
+template<typename S> inline THX_CONST_EXPR
 S
 inner_product(vec<2,S> const& u, vec<2,S> const& v) { 
   return (u[0]*v[0] + u[1]*v[1]); 
 }
 
 //! Compute vec<3,S> inner product.
-template<typename S>
+template<typename S> inline THX_CONST_EXPR
 S
 inner_product(vec<3,S> const& u, vec<3,S> const& v) { 
   return (u[0]*v[0] + u[1]*v[1] + u[2]*v[2]); 
 }
 
 //! Compute vec<4,S> inner product.
-template<typename S>
+template<typename S> inline THX_CONST_EXPR
 S
 inner_product(vec<4,S> const& u, vec<4,S> const& v) { 
   return (u[0]*v[0] + u[1]*v[1] + u[2]*v[2] + u[3]*v[3]); 
@@ -338,9 +319,9 @@ inner_product(vec<4,S> const& u, vec<4,S> const& v) {
 template<class V>
 mat<vec_traits<V>::linear_size, typename vec_traits<V>::value_type> 
 outer_product(V const& u, V const& v) {
-  mat<typename vec_traits<V>::dim, typename vec_traits<V>::value_type> r;
-  for (auto i = 0; i < typename vec_traits<V>::linear_size; ++i) {
-    for (auto j = 0; j < typename vec_traits<V>::linear_size; ++j) {
+  mat<vec_traits<V>::dim, typename vec_traits<V>::value_type> r;
+  for (auto i = 0; i < vec_traits<V>::linear_size; ++i) {
+    for (auto j = 0; j < vec_traits<V>::linear_size; ++j) {
       r(i,j) = u[i]*v[j];
     }
   }
@@ -381,7 +362,7 @@ outer_product(vec<4,S> const& u, vec<4,S> const& v) {
 //------------------------------------------------------------------------------
 
 //! Dot product, convenience wrapper for inner product.
-template<int64 N, typename S>
+template<std::size_t N, typename S> inline THX_CONST_EXPR
 S
 dot(vec<N,S> const& u, vec<N,S> const& v) { 
 	return inner_product(u, v); 
@@ -390,8 +371,8 @@ dot(vec<N,S> const& u, vec<N,S> const& v) {
 //------------------------------------------------------------------------------
 
 //! Squared magnitude of a vector.
-template<int64 N, typename S>
-S 
+template<std::size_t N, typename S> inline THX_CONST_EXPR
+S
 mag_squared(vec<N,S> const& v) { 
 	return dot(v,v); 
 }
@@ -399,7 +380,7 @@ mag_squared(vec<N,S> const& v) {
 //------------------------------------------------------------------------------
 
 //! Magnitude of a vector. No zero checking!
-template<int64 N, typename S>	
+template<std::size_t N, typename S>	
 S 
 mag(vec<N,S> const& v)  { 
 	return scalar_traits<S>::sqrt(mag_squared(v)); 
@@ -408,7 +389,7 @@ mag(vec<N,S> const& v)  {
 //------------------------------------------------------------------------------
 
 //! Euclidean distance squared.
-template<int64 N, typename S> 
+template<std::size_t N, typename S> inline THX_CONST_EXPR
 S
 dist_squared(vec<N,S> const& u, vec<N,S> const& v) { 
 	return mag_squared(u - v); 
@@ -417,7 +398,7 @@ dist_squared(vec<N,S> const& u, vec<N,S> const& v) {
 //------------------------------------------------------------------------------
 
 //! Euclidean distance.
-template<int64 N, typename S>	
+template<std::size_t N, typename S>	
 S 
 dist(vec<N,S> const& u, vec<N,S> const& v)  { 
 	return mag(u - v); 
@@ -428,8 +409,8 @@ dist(vec<N,S> const& u, vec<N,S> const& v)  {
 namespace detail {
 
 //! Normalize input. No divide-by-zero checking!
-template<int64 N, typename S> inline THX_CONST_EXPR
-S
+template<std::size_t N, typename S> inline
+void
 normalize_dispatch(vec<N,S> &v, real_scalar_tag) {
   v *= (1/mag(v));
 }
@@ -437,38 +418,69 @@ normalize_dispatch(vec<N,S> &v, real_scalar_tag) {
 } // Namespace: detail.
 
 //! Normalize input. No divide-by-zero checking!
-template<int64 N, typename S>
+template<std::size_t N, typename S>
 void 
 normalize(vec<N,S> &v) { 
   typedef typename scalar_traits<S>::scalar_category category;
   detail::normalize_dispatch(v, category());
 }
 
+//! Normalize input, precise policy. No divide-by-zero checking!
+template<std::size_t N, typename S>
+void 
+normalize(vec<N,S> &v, precise_math_tag) { 
+  normalize(v);
+}
+
+//! Normalize input using fast_scalar_traits<S>::rsqrt, about 2.3e-7 relative
+//! error for float32. No divide-by-zero checking!
+template<std::size_t N, typename S>
+void 
+normalize(vec<N,S> &v, fast_math_tag) { 
+  v *= fast_scalar_traits<S>::rsqrt(mag_squared(v));
+}
+
 //------------------------------------------------------------------------------
 
 // TODO dispatch!
 
 //! Return normalized version of input.
-template<int64 N, typename S> 
+template<std::size_t N, typename S> 
 vec<N,S> 
 normalized(const vec<N,S> &v) 
 { 
-	static_assert(std::is_floating_point<S>::value, 
+	static_assert(is_real_scalar<S>::value, 
 				        "Scalar type must be floating point");
-  return (1/mag(v))*v;
+  return S(1/mag(v))*v;
+}
+
+//! Return normalized version of input, precise policy.
+template<std::size_t N, typename S> 
+vec<N,S> 
+normalized(const vec<N,S> &v, precise_math_tag) 
+{ 
+  return normalized(v);
+}
+
+//! Return normalized version of input, fast policy.
+template<std::size_t N, typename S> 
+vec<N,S> 
+normalized(const vec<N,S> &v, fast_math_tag) 
+{ 
+  return fast_scalar_traits<S>::rsqrt(mag_squared(v))*v;
 }
 
 //------------------------------------------------------------------------------
 
 //! 2D cross product.
-template<typename S> 
+template<typename S> inline THX_CONST_EXPR
 S
 cross(vec<2,S> const& u, vec<2,S> const& v) { 
 	return (u[0]*v[1] - u[1]*v[0]); 
 }
 
 //! 3D cross product.
-template<typename S> 
+template<typename S> inline THX_CONST_EXPR
 vec<3,S>
 cross(vec<3,S> const& u, vec<3,S> const& v) { 
   return vec<3,S>(u[1]*v[2] - u[2]*v[1], 
@@ -479,8 +491,8 @@ cross(vec<3,S> const& u, vec<3,S> const& v) {
 //------------------------------------------------------------------------------
 
 //! Returns a perpendicular vector.
-template<typename S> 
-vec<2,S> 
+template<typename S> inline THX_CONST_EXPR
+vec<2,S>
 perp(vec<2,S> const& v) { 
   return vec<2,S>(-v[1], v[0]); 
 }
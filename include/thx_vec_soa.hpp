@@ -0,0 +1,480 @@
+//------------------------------------------------------------------------------
+//
+// Contributors:
+//             1) Tommy Hinks
+//
+//------------------------------------------------------------------------------
+
+#ifndef THX_VEC_SOA_HPP_INCLUDED
+#define THX_VEC_SOA_HPP_INCLUDED
+
+#include "thx_namespace.hpp"
+#include "thx_arithmetic_type.hpp"
+#include "thx_types.hpp"
+#include "thx_vec.hpp"
+#include "thx_simd.hpp"
+#include "thx_cpu.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+BEGIN_THX_NAMESPACE
+
+// vec_soa<N,S> anatomy:
+// ---------------------
+//
+// typedef arithmetic_type<S>::value value_type;
+// typedef std::size_t size_type;
+// typedef value_type* pointer;
+// typedef const value_type* const_pointer;
+//
+// define dim = N
+//
+// Size CTOR (set all zeros)
+// Array CTOR (from vec<N,S> array)
+// std::vector<vec<N,S>> CTOR
+// Copy CTOR, Move CTOR, operator=, DTOR
+//
+// size_type size() const
+// size_type stride() const
+// void resize(size_type)
+//
+// vec<N,S> get(size_type) const
+// void set(size_type, vec<N,S>)
+// std::vector<vec<N,S>> to_vector() const
+//
+// const_pointer component(d) const
+// pointer component(d)
+//
+// Components are stored in separate arrays, i.e. all x-values followed by all
+// y-values, and so on. Each component array starts on a simd_alignment
+// boundary and is padded with zeros to a multiple of simd_alignment bytes, so
+// that bulk kernels always operate on whole packets.
+
+//------------------------------------------------------------------------------
+
+//! DOCS
+template<std::size_t N, typename S>
+class vec_soa {
+public:
+  typedef typename arithmetic_type<S>::value value_type;
+  typedef std::size_t size_type;
+  typedef value_type* pointer;
+  typedef value_type const* const_pointer;
+
+  static const size_type dim = N;
+
+public: // CTOR's.
+  //! Size CTOR, all components are set to zero.
+  explicit
+  vec_soa(size_type const size = 0)
+    : _size(0)
+    , _stride(0)
+    , _data(0) {
+    resize(size);
+  }
+
+  //! Array CTOR.
+  vec_soa(vec<N,S> const* const v, size_type const size)
+    : _size(0)
+    , _stride(0)
+    , _data(0) {
+    resize(size);
+    for (size_type i = 0; i < size; ++i) {
+      set(i, v[i]);
+    }
+  }
+
+  //! std::vector CTOR.
+  explicit
+  vec_soa(std::vector<vec<N,S>> const& v)
+    : _size(0)
+    , _stride(0)
+    , _data(0) {
+    resize(v.size());
+    for (size_type i = 0; i < v.size(); ++i) {
+      set(i, v[i]);
+    }
+  }
+
+  //! Copy CTOR.
+  vec_soa(vec_soa<N,S> const& rhs)
+    : _size(0)
+    , _stride(0)
+    , _data(0) {
+    _alloc(rhs._size);
+    if (_stride > 0) {
+      std::memcpy(_data, rhs._data, N*_stride*sizeof(value_type));
+    }
+  }
+
+  //! Move CTOR, rhs is left empty.
+  vec_soa(vec_soa<N,S>&& rhs)
+    : _size(0)
+    , _stride(0)
+    , _data(0) {
+    swap(rhs);
+  }
+
+  //! DTOR.
+  ~vec_soa() {
+    detail::aligned_free(_data);
+  }
+
+  //! Assignment operator, copies or moves depending on how rhs is passed.
+  vec_soa<N,S>&
+  operator=(vec_soa<N,S> rhs) {
+    swap(rhs);
+    return *this;
+  }
+
+  //! Swap contents with rhs. Never throws.
+  void
+  swap(vec_soa<N,S>& rhs) {
+    std::swap(_size, rhs._size);
+    std::swap(_stride, rhs._stride);
+    std::swap(_data, rhs._data);
+  }
+
+public: // Size.
+  //! Number of vectors.
+  size_type
+  size() const {
+    return _size;
+  }
+
+  //! Padded length of each component array, size() rounded up to a whole
+  //! number of simd_alignment bytes, i.e. a multiple of the packet_size of
+  //! every instruction set tier. Zero if size() is zero.
+  size_type
+  stride() const {
+    return _stride;
+  }
+
+  //! Change the number of vectors. Existing vectors are kept, new vectors are
+  //! set to zero.
+  void
+  resize(size_type const size) {
+    if (size == _size) {
+      return;
+    }
+    vec_soa<N,S> tmp;
+    tmp._alloc(size);
+    const size_type n = (std::min)(size, _size);
+    for (size_type d = 0; n > 0 && d < N; ++d) {
+      std::memcpy(tmp.component(d), component(d), n*sizeof(value_type));
+    }
+    swap(tmp);
+  }
+
+public: // Element access.
+  //! Return i'th vector. No bounds checking!
+  vec<N,S>
+  get(size_type const i) const {
+    vec<N,S> v;
+    for (size_type d = 0; d < N; ++d) {
+      v[d] = _data[d*_stride + i];
+    }
+    return v;
+  }
+
+  //! Set i'th vector. No bounds checking!
+  void
+  set(size_type const i, vec<N,S> const& v) {
+    for (size_type d = 0; d < N; ++d) {
+      _data[d*_stride + i] = v[d];
+    }
+  }
+
+  //! Convert to array-of-structures.
+  std::vector<vec<N,S>>
+  to_vector() const {
+    std::vector<vec<N,S>> v(_size);
+    for (size_type i = 0; i < _size; ++i) {
+      v[i] = get(i);
+    }
+    return v;
+  }
+
+public: // Data.
+  //! Const component array d. No bounds checking!
+  const_pointer
+  component(size_type const d) const {
+    return _data + d*_stride;
+  }
+
+  //! Mutable component array d. No bounds checking!
+  pointer
+  component(size_type const d) {
+    return _data + d*_stride;
+  }
+
+private:
+  //! Allocate zeroed storage for size vectors. Assumes that no storage is
+  //! currently held.
+  void
+  _alloc(size_type const size) {
+    static const size_type lane = simd_alignment/sizeof(value_type);
+    const size_type stride = ((size + lane - 1)/lane)*lane;
+    if (stride > 0) {
+      _data = static_cast<pointer>(
+        detail::aligned_malloc(N*stride*sizeof(value_type)));
+      std::memset(_data, 0, N*stride*sizeof(value_type));
+    }
+    _size = size;
+    _stride = stride;
+  }
+
+private: // Member variables.
+  size_type _size;    //!< Number of vectors.
+  size_type _stride;  //!< Padded component array length.
+  pointer _data;      //!< Component arrays, back to back.
+};
+
+//------------------------------------------------------------------------------
+
+// Bulk vec_algo kernels.
+// ----------------------
+//
+// The kernels below apply the corresponding vec_algo function to every vector
+// in a vec_soa<N,S>, one packet of simd_traits<S>::packet_size vectors at a
+// time. Arguments must have the same size. Scalar results are written to an
+// output array of size() elements. Vector results are written to a vec_soa of
+// the same size, which may be one of the inputs.
+
+namespace detail {
+
+//! Store packet a to out[i..], writing no more than n - i elements.
+template<typename S>
+void
+store_partial(S* const out,
+              std::size_t const i,
+              std::size_t const n,
+              typename simd_traits<S>::packet_type const a) {
+  typedef simd_traits<S> simd;
+  if (i + simd::packet_size <= n) {
+    simd::storeu(out + i, a);
+  }
+  else {
+    S tmp[simd::packet_size];
+    simd::storeu(tmp, a);
+    std::copy(tmp, tmp + (n - i), out + i);
+  }
+}
+
+} // Namespace: detail.
+
+//! out[i] = dot(u[i], v[i]).
+template<std::size_t N, typename S>
+void
+dot(vec_soa<N,S> const& u, vec_soa<N,S> const& v, S* const out) {
+  typedef simd_traits<S> simd;
+  typedef typename simd::packet_type packet_type;
+
+  for (std::size_t i = 0; i < u.size(); i += simd::packet_size) {
+    packet_type d = simd::mul(simd::load(u.component(0) + i),
+                              simd::load(v.component(0) + i));
+    for (std::size_t k = 1; k < N; ++k) {
+      d = simd::add(d, simd::mul(simd::load(u.component(k) + i),
+                                 simd::load(v.component(k) + i)));
+    }
+    detail::store_partial(out, i, u.size(), d);
+  }
+}
+
+//! out[i] = mag_squared(v[i]).
+template<std::size_t N, typename S>
+void
+mag_squared(vec_soa<N,S> const& v, S* const out) {
+  dot(v, v, out);
+}
+
+//! out[i] = dist_squared(u[i], v[i]).
+template<std::size_t N, typename S>
+void
+dist_squared(vec_soa<N,S> const& u, vec_soa<N,S> const& v, S* const out) {
+  typedef simd_traits<S> simd;
+  typedef typename simd::packet_type packet_type;
+
+  for (std::size_t i = 0; i < u.size(); i += simd::packet_size) {
+    packet_type t = simd::sub(simd::load(u.component(0) + i),
+                              simd::load(v.component(0) + i));
+    packet_type d = simd::mul(t, t);
+    for (std::size_t k = 1; k < N; ++k) {
+      t = simd::sub(simd::load(u.component(k) + i),
+                    simd::load(v.component(k) + i));
+      d = simd::add(d, simd::mul(t, t));
+    }
+    detail::store_partial(out, i, u.size(), d);
+  }
+}
+
+//! r[i] = vec_add(u[i], v[i]).
+template<std::size_t N, typename S>
+void
+vec_add(vec_soa<N,S> const& u, vec_soa<N,S> const& v, vec_soa<N,S>& r) {
+  typedef simd_traits<S> simd;
+
+  for (std::size_t k = 0; k < N; ++k) {
+    S const* const pu = u.component(k);
+    S const* const pv = v.component(k);
+    S* const pr = r.component(k);
+    for (std::size_t i = 0; i < u.size(); i += simd::packet_size) {
+      simd::store(pr + i, simd::add(simd::load(pu + i), simd::load(pv + i)));
+    }
+  }
+}
+
+//! r[i] = vec_subtract(u[i], v[i]).
+template<std::size_t N, typename S>
+void
+vec_subtract(vec_soa<N,S> const& u, vec_soa<N,S> const& v, vec_soa<N,S>& r) {
+  typedef simd_traits<S> simd;
+
+  for (std::size_t k = 0; k < N; ++k) {
+    S const* const pu = u.component(k);
+    S const* const pv = v.component(k);
+    S* const pr = r.component(k);
+    for (std::size_t i = 0; i < u.size(); i += simd::packet_size) {
+      simd::store(pr + i, simd::sub(simd::load(pu + i), simd::load(pv + i)));
+    }
+  }
+}
+
+//! r[i] = cross(u[i], v[i]).
+template<typename S>
+void
+cross(vec_soa<3,S> const& u, vec_soa<3,S> const& v, vec_soa<3,S>& r) {
+  typedef simd_traits<S> simd;
+  typedef typename simd::packet_type packet_type;
+
+  for (std::size_t i = 0; i < u.size(); i += simd::packet_size) {
+    const packet_type u0 = simd::load(u.component(0) + i);
+    const packet_type u1 = simd::load(u.component(1) + i);
+    const packet_type u2 = simd::load(u.component(2) + i);
+    const packet_type v0 = simd::load(v.component(0) + i);
+    const packet_type v1 = simd::load(v.component(1) + i);
+    const packet_type v2 = simd::load(v.component(2) + i);
+    simd::store(r.component(0) + i,
+                simd::sub(simd::mul(u1, v2), simd::mul(u2, v1)));
+    simd::store(r.component(1) + i,
+                simd::sub(simd::mul(u2, v0), simd::mul(u0, v2)));
+    simd::store(r.component(2) + i,
+                simd::sub(simd::mul(u0, v1), simd::mul(u1, v0)));
+  }
+}
+
+namespace detail {
+
+THX_GENERIC_KERNELS_BEGIN
+
+//! Normalize all vectors, one packet of Simd::packet_size vectors at a time.
+//! Zero vectors, including the padding, are left unchanged without raising
+//! floating point exceptions.
+template<class Simd, std::size_t N, typename S> inline
+void
+normalize_packets(vec_soa<N,S>& v) {
+  typedef Simd simd;
+  typedef typename simd::packet_type packet_type;
+
+  const packet_type zero = simd::set1(S(0));
+  const packet_type one = simd::set1(S(1));
+  for (std::size_t i = 0; i < v.size(); i += simd::packet_size) {
+    packet_type t = simd::load(v.component(0) + i);
+    packet_type d = simd::mul(t, t);
+    for (std::size_t k = 1; k < N; ++k) {
+      t = simd::load(v.component(k) + i);
+      d = simd::add(d, simd::mul(t, t));
+    }
+    const typename simd::mask_type z = simd::cmpeq(d, zero);
+    const packet_type inv_mag = simd::select(z, zero,
+      simd::div(one, simd::sqrt(simd::select(z, one, d))));
+    for (std::size_t k = 0; k < N; ++k) {
+      S* const p = v.component(k) + i;
+      simd::store(p, simd::mul(simd::load(p), inv_mag));
+    }
+  }
+}
+
+THX_GENERIC_KERNELS_END
+
+#if defined(THX_DISPATCH)
+
+template<std::size_t N, typename S> THX_TARGET_AVX THX_FLATTEN
+void
+normalize_avx(vec_soa<N,S>& v) {
+  normalize_packets<avx_traits<S>>(v);
+}
+
+template<std::size_t N, typename S> THX_TARGET_AVX512 THX_FLATTEN
+void
+normalize_avx512(vec_soa<N,S>& v) {
+  normalize_packets<avx512_traits<S>>(v);
+}
+
+#endif // THX_DISPATCH
+
+} // Namespace: detail.
+
+//! Normalize all vectors. Zero vectors are left unchanged, unlike the single
+//! vector normalize.
+template<std::size_t N, typename S>
+void
+normalize(vec_soa<N,S>& v) {
+  detail::normalize_packets<simd_traits<S>>(v);
+}
+
+#if defined(THX_DISPATCH)
+
+//! Normalize all vectors, dispatched on active_isa(). Packets never exceed
+//! the simd_alignment padding of the components.
+template<std::size_t N>
+void
+normalize(vec_soa<N,float32>& v) {
+  const isa t = active_isa();
+  if (t >= isa_avx512) {
+    detail::normalize_avx512(v);
+  }
+  else if (t >= isa_avx) {
+    detail::normalize_avx(v);
+  }
+  else {
+    detail::normalize_packets<simd_traits<float32>>(v);
+  }
+}
+
+//! Normalize all vectors, dispatched on active_isa().
+template<std::size_t N>
+void
+normalize(vec_soa<N,float64>& v) {
+  const isa t = active_isa();
+  if (t >= isa_avx512) {
+    detail::normalize_avx512(v);
+  }
+  else if (t >= isa_avx) {
+    detail::normalize_avx(v);
+  }
+  else {
+    detail::normalize_packets<simd_traits<float64>>(v);
+  }
+}
+
+#endif // THX_DISPATCH
+
+//------------------------------------------------------------------------------
+
+// Convenient types, add more if appropriate.
+
+typedef vec_soa<2,float32>  vec2f32_soa;
+typedef vec_soa<2,float64>  vec2f64_soa;
+typedef vec_soa<3,float32>  vec3f32_soa;
+typedef vec_soa<3,float64>  vec3f64_soa;
+typedef vec_soa<4,float32>  vec4f32_soa;
+typedef vec_soa<4,float64>  vec4f64_soa;
+
+END_THX_NAMESPACE
+
+#endif // THX_VEC_SOA_HPP_INCLUDED
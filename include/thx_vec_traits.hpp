@@ -21,12 +21,12 @@ struct vec_traits;
 
 //! Specialization for vec.
 template<std::size_t N, typename S>
-struct vec_traits<typename vec<N,S>>
+struct vec_traits<vec<N,S>>
 {
   typedef typename vec<N,S>::value_type value_type;
   typedef typename vec<N,S>::size_type size_type;
-  static const size_type linear_size = typename vec<N,S>::linear_size;
-  static const size_type dim = typename vec<N,S>::dim;
+  static const size_type linear_size = vec<N,S>::linear_size;
+  static const size_type dim = vec<N,S>::dim;
 };
 
 END_THX_NAMESPACE
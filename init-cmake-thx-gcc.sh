@@ -0,0 +1,16 @@
+#!/bin/bash
+
+# gcc 5 or clang 3.4 or newer, see CMakeLists.txt. Set CXX=clang++ for clang.
+# Release enables optimization, which run-time dispatch requires.
+build_path="build/gcc"
+rm -rf $build_path
+echo "Removed $build_path"
+mkdir -p $build_path
+echo "Created $build_path"
+cd $build_path
+
+cmake \
+  -DCMAKE_BUILD_TYPE=Release \
+  -DCMAKE_INSTALL_PREFIX=../.. \
+  ../.. \
+  -G "Unix Makefiles"
@@ -1,6 +1,8 @@
 #!/bin/bash
 
-build_path="build/vc10"
+# Visual Studio 2017 (15) is the oldest supported MSVC, see CMakeLists.txt.
+
+build_path="build/vc15"
 rm -rf $build_path
 echo "Removed $build_path"
 mkdir $build_path
@@ -13,7 +15,9 @@ cmake \
   -DTHX_INCLUDE_PATH=D:/GitHub/thx/include \
   -DGTEST_INCLUDE_PATH=D:/code/gtest-1.6.0/include \
   -DGTEST_LIB_PATH=D:/code/gtest-1.6.0/msvc/gtest \
+  -DBENCHMARK_INCLUDE_PATH=D:/code/benchmark/include \
+  -DBENCHMARK_LIB_PATH=D:/code/benchmark/build/src \
   ../.. \
-  -G "Visual Studio 10"
+  -G "Visual Studio 15 2017"
 
 
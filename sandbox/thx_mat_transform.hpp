@@ -10,7 +10,7 @@
 
 #include "thx_mat.hpp"
 #include "thx_vec.hpp"
-#include "thx_traits.hpp"
+#include "thx_scalar_traits.hpp"
 
 //------------------------------------------------------------------------------
 
@@ -41,8 +41,8 @@ template<typename S>
 mat<2,S>
 rotate(const S theta)
 {
-    const S ct(traits<S>::cos(theta));
-    const S st(traits<S>::sin(theta));
+    S st, ct;
+    scalar_traits<S>::sincos(theta, st, ct);
     return mat<2,S>(
         ct, -st,
         st,  ct);
@@ -55,8 +55,8 @@ template<typename S>
 mat<4,S>
 rotate_x(const S theta)
 {
-    const S ct(traits<S>::cos(theta));
-    const S st(traits<S>::sin(theta));
+    S st, ct;
+    scalar_traits<S>::sincos(theta, st, ct);
     return mat<4,S>(
         1,  0,   0, 0,
         0, ct, -st, 0,
@@ -71,8 +71,8 @@ template<typename S>
 mat<4,S>
 rotate_y(const S theta)
 {
-    const S ct(traits<S>::cos(theta));
-    const S st(traits<S>::sin(theta));
+    S st, ct;
+    scalar_traits<S>::sincos(theta, st, ct);
     return mat<4,S>(
          ct, 0, st, 0,
           0, 1,  0, 0,
@@ -87,8 +87,8 @@ template<typename S>
 mat<4,S>
 rotate_z(const S theta)
 {
-    const S ct(traits<S>::cos(theta));
-    const S st(traits<S>::sin(theta));
+    S st, ct;
+    scalar_traits<S>::sincos(theta, st, ct);
     return mat<4,S>(
         ct, -st, 0, 0,
         st,  ct, 0, 0,
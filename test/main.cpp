@@ -6,6 +6,7 @@
 //------------------------------------------------------------------------------
 
 #include <thx.hpp>
+#include <thx_expr.hpp>
 #include <gtest/gtest.h>
 #include <iostream>
 #include <limits>
@@ -15,6 +16,11 @@
 #include <vector>
 #include <functional>
 #include <cstdlib>
+#include <cstring>
+#include <cfenv>
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
 
 //------------------------------------------------------------------------------
 
@@ -136,7 +142,7 @@ makeRandVec(const int offset = 0, const int range = 1000)
 {
   typedef typename V::value_type value_type;
   typedef typename V::size_type size_type;
-  static const size_type size = typename V::linear_size;
+  static const size_type size = V::linear_size;
 
   V v;
   for (size_type i = 0; i < size; ++i) {
@@ -162,6 +168,43 @@ makeRandArray(const std::size_t size,
   return v;
 }
 
+//! Results of different code paths, e.g. instruction set tiers or batched and
+//! single element functions, are bit-identical unless the compiler contracts
+//! multiplies and adds into FMAs, see thx_cpu.hpp.
+#if defined(__FP_FAST_FMA) || defined(__FP_FAST_FMAF)
+const bool fpContracted = true;
+#else
+const bool fpContracted = false;
+#endif
+
+//! Success if a and b are equal or, when contracted, agree to within a few ulp
+//! of the larger of their magnitudes and one.
+template<typename S>
+::testing::AssertionResult
+samePath(const S a, const S b)
+{
+  using std::abs;
+  const S m = std::max(S(1), std::max(abs(a), abs(b)));
+  if (a == b || 
+      (fpContracted && abs(a - b) <= 16*std::numeric_limits<S>::epsilon()*m)) {
+    return ::testing::AssertionSuccess();
+  }
+  return ::testing::AssertionFailure() << a << " != " << b;
+}
+
+//! As above, element-wise.
+template<std::size_t N, typename S>
+::testing::AssertionResult
+samePath(const thx::vec<N,S> &u, const thx::vec<N,S> &v)
+{
+  for (std::size_t i = 0; i < N; ++i) {
+    if (!samePath(u[i], v[i])) {
+      return samePath(u[i], v[i]) << " (element " << i << ")";
+    }
+  }
+  return ::testing::AssertionSuccess();
+}
+
 //! Define a test fixture class template.
 template <class T>
 class TypeTest : public ::testing::Test {
@@ -200,7 +243,7 @@ TYPED_TEST_CASE(TypeTest, TypeTestTypes);
 
 //! DOCS
 TYPED_TEST(TypeTest, bitsize) {
-  ASSERT_TRUE(BitSize<TypeParam::Type>::value == TypeParam::Size);
+  ASSERT_TRUE(BitSize<typename TypeParam::Type>::value == TypeParam::Size);
 }
 
 
@@ -247,8 +290,8 @@ template<typename S>
 struct TestVecValueCtor<2, S> {
   static bool
   test() {
-    typedef typename thx::vec<2,S> Vec;
-    typedef Vec::value_type ValueType;
+    typedef thx::vec<2,S> Vec;
+    typedef typename Vec::value_type ValueType;
     const ValueType r0 = makeRandScalar<ValueType>();  
     const ValueType r1 = makeRandScalar<ValueType>();  
     Vec v(r0, r1);
@@ -261,8 +304,8 @@ template<typename S>
 struct TestVecValueCtor<3, S> {
   static bool
   test() {
-    typedef typename thx::vec<3,S> Vec;
-    typedef Vec::value_type ValueType;
+    typedef thx::vec<3,S> Vec;
+    typedef typename Vec::value_type ValueType;
     const ValueType r0 = makeRandScalar<ValueType>();  
     const ValueType r1 = makeRandScalar<ValueType>();  
     const ValueType r2 = makeRandScalar<ValueType>();  
@@ -276,8 +319,8 @@ template<typename S>
 struct TestVecValueCtor<4, S> {
   static bool 
   test() {
-    typedef typename thx::vec<4,S> Vec;
-    typedef Vec::value_type ValueType;
+    typedef thx::vec<4,S> Vec;
+    typedef typename Vec::value_type ValueType;
     const ValueType r0 = makeRandScalar<ValueType>();  
     const ValueType r1 = makeRandScalar<ValueType>();  
     const ValueType r2 = makeRandScalar<ValueType>();  
@@ -304,22 +347,22 @@ TYPED_TEST_CASE(VecTest, VecTestTypes);
 
 //! DOCS
 TYPED_TEST(VecTest, alignment) {
-  typedef Vec<TypeParam>::Type V;
+  typedef typename Vec<TypeParam>::Type V;
   ASSERT_TRUE(
-    BitSize<V>::value == V::linear_size*BitSize<V::value_type>::value);
+    BitSize<V>::value == V::linear_size*BitSize<typename V::value_type>::value);
 }
 
 //! DOCS
 TYPED_TEST(VecTest, default_ctor) {
-  Vec<TypeParam>::Type::value_type value = 0;
-  Vec<TypeParam>::Type u(value);
-  Vec<TypeParam>::Type v;
+  typename Vec<TypeParam>::Type::value_type value = 0;
+  typename Vec<TypeParam>::Type u(value);
+  typename Vec<TypeParam>::Type v;
   ASSERT_TRUE(u == v);
 }
 
 //! DOCS
 TYPED_TEST(VecTest, copy_ctor) {
-  typedef Vec<TypeParam>::Type VecType;
+  typedef typename Vec<TypeParam>::Type VecType;
   VecType v = makeRandVec<VecType>();  
   VecType u(v); // u is a copy of v. They should be equal.
   ASSERT_TRUE(u == v);
@@ -327,9 +370,9 @@ TYPED_TEST(VecTest, copy_ctor) {
 
 //! DOCS
 TYPED_TEST(VecTest, array_ctor) {
-  typedef Vec<TypeParam>::Type VecType;
-  typedef VecType::value_type ValueType;
-  typedef VecType::size_type SizeType;
+  typedef typename Vec<TypeParam>::Type VecType;
+  typedef typename VecType::value_type ValueType;
+  typedef typename VecType::size_type SizeType;
   static const SizeType size = VecType::linear_size;
   std::vector<ValueType> randArray = makeRandArray<ValueType>(size);
   VecType v(&randArray[0]);
@@ -340,8 +383,8 @@ TYPED_TEST(VecTest, array_ctor) {
 
 //! DOCS
 TYPED_TEST(VecTest, value_ctor) {
-  typedef Vec<TypeParam>::Type VecType;
-  typedef VecType::value_type ValueType;
+  typedef typename Vec<TypeParam>::Type VecType;
+  typedef typename VecType::value_type ValueType;
   ASSERT_TRUE((TestVecValueCtor<2,ValueType>::test()));
   ASSERT_TRUE((TestVecValueCtor<3,ValueType>::test()));
   ASSERT_TRUE((TestVecValueCtor<4,ValueType>::test()));
@@ -349,7 +392,7 @@ TYPED_TEST(VecTest, value_ctor) {
 
 //! DOCS
 TYPED_TEST(VecTest, assign_operator) {
-  typedef Vec<TypeParam>::Type VecType;
+  typedef typename Vec<TypeParam>::Type VecType;
   const VecType u = makeRandVec<VecType>();
   VecType v(1); // Assume u != v.
   v = u;
@@ -358,7 +401,7 @@ TYPED_TEST(VecTest, assign_operator) {
 
 //! DOCS
 TYPED_TEST(VecTest, add_equals_operator) {
-  typedef Vec<TypeParam>::Type VecType;
+  typedef typename Vec<TypeParam>::Type VecType;
   VecType u(1);
   VecType v(1);
   u += v;
@@ -367,15 +410,15 @@ TYPED_TEST(VecTest, add_equals_operator) {
 
 //! DOCS
 TYPED_TEST(VecTest, subtract_equal_operator) {
-  typedef Vec<TypeParam>::Type VecType;
+  typedef typename Vec<TypeParam>::Type VecType;
   VecType v(1);
   v -= v; // Subtract vec from itself. Should be all zeros.
-  ASSERT_TRUE(v == VecType(VecType::value_type(0)));
+  ASSERT_TRUE(v == VecType(typename VecType::value_type(0)));
 }
 
 //! DOCS
 TYPED_TEST(VecTest, multiply_equals_operator) {
-  typedef Vec<TypeParam>::Type VecType;
+  typedef typename Vec<TypeParam>::Type VecType;
   VecType v(1);
   v *= 2; // Multiply (1,1,1) by 2. Should be (2,2,2).
   ASSERT_TRUE(v == VecType(2));
@@ -417,17 +460,2391 @@ TYPED_TEST_CASE(VecAlgoTest, VecAlgoTestTypes);
 
 // Test that vector equality.
 TYPED_TEST(VecAlgoTest, vec_equal) {
-  Vec<TypeParam>::Type v;
+  typename Vec<TypeParam>::Type v;
   ASSERT_TRUE(thx::vec_equal(v, v)); 
 }
 
 // Test that vector inequality.
 TYPED_TEST(VecAlgoTest, vec_not_equal) {
-  Vec<TypeParam>::Type u(1);
-  Vec<TypeParam>::Type v(2);
+  typename Vec<TypeParam>::Type u(1);
+  typename Vec<TypeParam>::Type v(2);
   ASSERT_TRUE(thx::vec_not_equal(u, v)); 
 }
 
+// Test that vectors are ordered with the last element most significant.
+TYPED_TEST(VecAlgoTest, less_greater) {
+  typedef typename Vec<TypeParam>::Type VecType;
+  const VecType v(1);
+  ASSERT_FALSE(thx::less(v, v));
+  ASSERT_FALSE(thx::greater(v, v));
+  for (std::size_t i = 0; i < VecType::linear_size; ++i) {
+    VecType u(1);
+    u[i] = 2;
+    ASSERT_TRUE(thx::less(v, u)) << i;
+    ASSERT_FALSE(thx::less(u, v)) << i;
+    ASSERT_TRUE(thx::greater(u, v)) << i;
+    ASSERT_FALSE(thx::greater(v, u)) << i;
+    if (i > 0) {
+      // A larger element i outweighs any difference below it.
+      VecType w(1);
+      w[i - 1] = 3;
+      ASSERT_TRUE(thx::less(w, u)) << i;
+      ASSERT_TRUE(thx::greater(u, w)) << i;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+// The list of types we want to test.
+typedef ::testing::Types<thx::float32, thx::float64> MatAlgoTestTypes;
+
+// Define a test fixture class template.
+template <class T>
+class MatAlgoTest : public ::testing::Test {
+protected:
+  MatAlgoTest() {
+    srand(1981);
+  }
+
+  virtual 
+  ~MatAlgoTest() {
+  }
+};
+
+TYPED_TEST_CASE(MatAlgoTest, MatAlgoTestTypes);
+
+//! DOCS
+template<class M>
+M
+makeRandMat(const int offset = 0, const int range = 1000)
+{
+  typedef typename M::value_type value_type;
+
+  M a;
+  for (int i = 0; i < M::linear_size; ++i) {
+    a[i] = makeRandScalar<value_type>(offset, range);
+  }
+  return a;
+}
+
+// Test that the (possibly SIMD) mat<4,S> product matches the scalar path. 
+// Integer valued elements keep the products exact, so results must be equal.
+TYPED_TEST(MatAlgoTest, mult4) {
+  typedef thx::mat<4,TypeParam> MatType;
+  const MatType a = makeRandMat<MatType>();
+  const MatType b = makeRandMat<MatType>();
+  const MatType c = thx::mult(a, b);
+  const MatType d = thx::mult<TypeParam>(a, b); // Scalar path.
+  for (int i = 0; i < MatType::linear_size; ++i) {
+    ASSERT_EQ(d[i], c[i]);
+  }
+}
+
+// Test that batched point transforms match the single-element operator.
+// The size is chosen so that both the SIMD and the scalar tail loops run.
+TYPED_TEST(MatAlgoTest, transform_points) {
+  typedef thx::mat<4,TypeParam> MatType;
+  typedef thx::vec<3,TypeParam> VecType;
+  const MatType a = makeRandMat<MatType>();
+  std::vector<VecType> p(19);
+  for (std::size_t i = 0; i < p.size(); ++i) {
+    p[i] = makeRandVec<VecType>();
+  }
+  std::vector<VecType> q(p.size());
+  thx::transform_points(a, &p[0], &q[0], p.size());
+  for (std::size_t i = 0; i < p.size(); ++i) {
+    ASSERT_TRUE(a*p[i] == q[i]);
+  }
+  thx::transform_points(a, &p[0], &p[0], p.size()); // In-place.
+  ASSERT_TRUE(p == q);
+}
+
+// Test that affine<S> composition and point transforms match mat<4,S> with
+// bottom row 0 0 0 1. Integer valued elements keep the results exact.
+TYPED_TEST(MatAlgoTest, affine) {
+  typedef thx::mat<4,TypeParam> MatType;
+  typedef thx::affine<TypeParam> AffineType;
+  typedef thx::vec<3,TypeParam> VecType;
+  MatType a = makeRandMat<MatType>();
+  MatType b = makeRandMat<MatType>();
+  for (int j = 0; j < 4; ++j) {
+    a(3,j) = j == 3 ? 1 : 0;
+    b(3,j) = j == 3 ? 1 : 0;
+  }
+  const AffineType fa(a);
+  const AffineType fb(b);
+  const MatType c = thx::mult(a, b);
+  const MatType fc = (fa*fb).to_mat();
+  for (std::size_t i = 0; i < MatType::linear_size; ++i) {
+    ASSERT_EQ(c[i], fc[i]);
+  }
+  ASSERT_TRUE(thx::mult<TypeParam>(fa, fb) == fa*fb); // Scalar path.
+  const VecType p = makeRandVec<VecType>();
+  ASSERT_TRUE(a*p == fa*p);
+  ASSERT_TRUE(thx::transform_vector(fa, p) == fa*p - fa.translation());
+  ASSERT_EQ(TypeParam(8), thx::determinant(AffineType(2)));
+
+  // Rigid inverse, rotation about z followed by a translation.
+  const TypeParam s = TypeParam(0.6);
+  const TypeParam t = TypeParam(0.8);
+  const AffineType r(t, -s, 0, 3,
+                     s,  t, 0, -2,
+                     0,  0, 1, 5);
+  const AffineType ri = thx::inverted_rigid(r);
+  const AffineType rg = thx::inverted(r);
+  const AffineType id = r*ri;
+  const TypeParam tol = 8*std::numeric_limits<TypeParam>::epsilon();
+  for (std::size_t i = 0; i < AffineType::linear_size; ++i) {
+    ASSERT_NEAR(AffineType::identity()[i], id[i], tol);
+    ASSERT_NEAR(ri[i], rg[i], tol);
+  }
+}
+
+//! Check batched inversion of n random NxN matrices, one of which is made
+//! singular by zeroing its first row. Diagonal dominance keeps the others
+//! well-conditioned, so products must be close to identity.
+template<std::size_t N, typename S>
+void
+checkInvertedBatch(S const tol, std::size_t const n = 37) {
+  typedef thx::mat<N,S> MatType;
+  std::vector<MatType> a(n);
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    a[i] = makeRandMat<MatType>();
+    for (std::size_t c = 0; c < N; ++c) {
+      a[i](c,c) += static_cast<S>(N*1000);
+    }
+  }
+  for (std::size_t c = 0; c < N; ++c) {
+    a[5](0,c) = 0;
+  }
+  std::vector<MatType> b(a.size());
+  std::vector<thx::uint8> status(a.size());
+  ASSERT_EQ(1, thx::inverted(&a[0], &b[0], &status[0], a.size()));
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    ASSERT_EQ(i == 5 ? 0 : 1, status[i]);
+    if (status[i]) {
+      const MatType c = a[i]*b[i];
+      for (std::size_t r = 0; r < N; ++r) {
+        for (std::size_t k = 0; k < N; ++k) {
+          ASSERT_NEAR(r == k ? 1 : 0, c(r,k), tol);
+        }
+      }
+    }
+  }
+}
+
+// Test batched inversion for the SIMD (3x3, 4x4) and generic paths.
+TYPED_TEST(MatAlgoTest, inverted_batch) {
+  const TypeParam tol = 
+    100*std::numeric_limits<TypeParam>::epsilon();
+  checkInvertedBatch<3>(tol);
+  checkInvertedBatch<4>(tol);
+  checkInvertedBatch<4>(tol, 5000); // Several parallel chunks.
+  checkInvertedBatch<5>(tol);
+}
+
+//! Check that gauss_jacobi and batched inversion agree on a diagonal NxN
+//! matrix whose pivots are normal but whose determinant is denormal, and on
+//! the same matrix scaled so that the determinant is just normal.
+template<std::size_t N, typename S>
+void
+checkNearSingular() {
+  typedef thx::mat<N,S> MatType;
+  const S s = std::sqrt((std::numeric_limits<S>::min)())/2;
+  for (int k = 1; k <= 2; ++k) {
+    MatType a(1);
+    a(0,0) = k*s;
+    a(1,1) = k*s;
+    const bool ok = (k == 2);
+    MatType c(a);
+    MatType e(1);
+    ASSERT_EQ(ok, thx::gauss_jacobi(c, e)) << N;
+    MatType b;
+    thx::uint8 status = 2;
+    ASSERT_EQ(ok ? 0u : 1u, thx::inverted(&a, &b, &status, 1)) << N;
+    ASSERT_EQ(ok ? 1 : 0, status) << N;
+  }
+}
+
+// Test that all inversion paths use the same singularity criterion.
+TYPED_TEST(MatAlgoTest, inverted_near_singular) {
+  checkNearSingular<3,TypeParam>();
+  checkNearSingular<4,TypeParam>();
+  checkNearSingular<5,TypeParam>();
+}
+
+//------------------------------------------------------------------------------
+
+typedef ::testing::Types<thx::float32, thx::float64> VecSoaTestTypes;
+
+template<typename S>
+class VecSoaTest : public ::testing::Test {
+protected:
+  VecSoaTest() {
+    srand(1981);
+  }
+
+  virtual 
+  ~VecSoaTest() {
+  }
+};
+
+TYPED_TEST_CASE(VecSoaTest, VecSoaTestTypes);
+
+// Test conversions between array-of-structures and structure-of-arrays.
+TYPED_TEST(VecSoaTest, convert) {
+  typedef thx::vec<3,TypeParam> VecType;
+  std::vector<VecType> p(19);
+  for (std::size_t i = 0; i < p.size(); ++i) {
+    p[i] = makeRandVec<VecType>();
+  }
+  thx::vec_soa<3,TypeParam> s(p);
+  ASSERT_EQ(p.size(), s.size());
+  const std::size_t addr = reinterpret_cast<std::size_t>(s.component(0));
+  ASSERT_EQ(0, addr%thx::simd_alignment);
+  ASSERT_TRUE(p == s.to_vector());
+  s.resize(23);
+  ASSERT_TRUE(VecType(TypeParam(0)) == s.get(22));
+  ASSERT_TRUE(p[18] == s.get(18));
+  const std::size_t lane = thx::simd_alignment/sizeof(TypeParam);
+  ASSERT_EQ(((23 + lane - 1)/lane)*lane, s.stride());
+
+  // Moves take over the storage and leave the source empty.
+  TypeParam const* const c0 = s.component(0);
+  thx::vec_soa<3,TypeParam> m(std::move(s));
+  ASSERT_EQ(c0, m.component(0));
+  ASSERT_EQ(0u, s.size());
+  ASSERT_EQ(0u, s.stride());
+  s = std::move(m);
+  ASSERT_EQ(c0, s.component(0));
+  ASSERT_EQ(23u, s.size());
+  ASSERT_TRUE(p[18] == s.get(18));
+}
+
+// Test that bulk kernels match the single-element vec_algo functions. The size
+// is chosen so that the last packet is partially filled.
+TYPED_TEST(VecSoaTest, kernels) {
+  typedef thx::vec<3,TypeParam> VecType;
+  std::vector<VecType> p(19);
+  std::vector<VecType> q(p.size());
+  for (std::size_t i = 0; i < p.size(); ++i) {
+    p[i] = makeRandVec<VecType>();
+    q[i] = makeRandVec<VecType>();
+  }
+  const thx::vec_soa<3,TypeParam> u(p);
+  const thx::vec_soa<3,TypeParam> v(q);
+  std::vector<TypeParam> d(p.size());
+  thx::dot(u, v, &d[0]);
+  for (std::size_t i = 0; i < p.size(); ++i) {
+    ASSERT_EQ(thx::dot(p[i], q[i]), d[i]);
+  }
+  thx::dist_squared(u, v, &d[0]);
+  for (std::size_t i = 0; i < p.size(); ++i) {
+    ASSERT_EQ(thx::dist_squared(p[i], q[i]), d[i]);
+  }
+  thx::vec_soa<3,TypeParam> r(p.size());
+  thx::cross(u, v, r);
+  for (std::size_t i = 0; i < p.size(); ++i) {
+    ASSERT_TRUE(thx::cross(p[i], q[i]) == r.get(i));
+  }
+  thx::vec_subtract(u, v, r);
+  for (std::size_t i = 0; i < p.size(); ++i) {
+    ASSERT_TRUE(p[i] - q[i] == r.get(i));
+  }
+  r.set(3, VecType(TypeParam(0)));
+  std::feclearexcept(FE_ALL_EXCEPT);
+  thx::normalize(r);
+  EXPECT_FALSE(std::fetestexcept(FE_INVALID | FE_DIVBYZERO));
+  for (std::size_t i = 0; i < p.size(); ++i) {
+    VecType w = p[i] - q[i];
+    thx::normalize(w);
+    ASSERT_TRUE(i == 3 ? VecType(TypeParam(0)) == r.get(i)
+                       : samePath(w, r.get(i)));
+  }
+
+  // Zero vectors and the padding stay zero.
+  for (std::size_t k = 0; k < 3; ++k) {
+    for (std::size_t i = r.size(); i < r.stride(); ++i) {
+      ASSERT_EQ(TypeParam(0), r.component(k)[i]);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+// Test that lazy expressions give the same result as the eager operators.
+TYPED_TEST(MatAlgoTest, expr) {
+  typedef thx::vec<16,TypeParam> VecType;
+  typedef thx::mat<4,TypeParam> MatType;
+  const TypeParam a = makeRandScalar<TypeParam>();
+  const TypeParam b = makeRandScalar<TypeParam>();
+  const VecType x = makeRandVec<VecType>();
+  const VecType y = makeRandVec<VecType>();
+  const VecType z = makeRandVec<VecType>();
+  const VecType u = a*thx::lazy(x) + thx::lazy(y)*b - z;
+  ASSERT_TRUE(a*x + y*b - z == u);
+  ASSERT_TRUE(-x - y == thx::eval(-thx::lazy(x) - thx::lazy(y)));
+  VecType v = x;
+  thx::assign(v, z + thx::lazy(v)*a); // Destination in the expression.
+  ASSERT_TRUE(z + x*a == v);
+
+  const MatType c = makeRandMat<MatType>();
+  const MatType d = makeRandMat<MatType>();
+  const MatType e = thx::lazy(c) - b*thx::lazy(d);
+  const MatType f = c - b*d;
+  for (int i = 0; i < MatType::linear_size; ++i) {
+    ASSERT_EQ(f[i], e[i]);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+// Test that the aligned variants are aligned, also in std containers, and 
+// that aligned products match the unaligned ones.
+TYPED_TEST(MatAlgoTest, aligned) {
+  typedef thx::mat<4,TypeParam> BaseType;
+  typedef thx::aligned<thx::vec<4,TypeParam>> VecType;
+  typedef thx::aligned<thx::mat<4,TypeParam>> MatType;
+  static_assert(alignof(VecType) == 4*sizeof(TypeParam), "vec alignment");
+  static_assert(alignof(MatType) == 64, "mat alignment");
+  static_assert(sizeof(MatType) == sizeof(BaseType), "mat size");
+
+  std::vector<MatType, thx::aligned_allocator<MatType>> a(7);
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    ASSERT_EQ(0u, reinterpret_cast<std::size_t>(&a[i]) % 64);
+    a[i] = makeRandMat<MatType>();
+  }
+  for (std::size_t i = 1; i < a.size(); ++i) {
+    const MatType c = a[i - 1]*a[i];
+    const BaseType d = thx::mult<TypeParam>(
+      static_cast<BaseType const&>(a[i - 1]), 
+      static_cast<BaseType const&>(a[i])); // Scalar path.
+    for (int k = 0; k < MatType::linear_size; ++k) {
+      ASSERT_EQ(d[k], c[k]);
+    }
+  }
+
+  const VecType u(1, 2, 3, 4);
+  const VecType v = u + u;
+  ASSERT_TRUE((thx::vec<4,TypeParam>(2, 4, 6, 8) == v));
+}
+
+//------------------------------------------------------------------------------
+
+// Test that every instruction set tier available on this CPU gives the same
+// results as the lowest one. No kernel uses FMA, so results must be equal.
+TYPED_TEST(MatAlgoTest, dispatch) {
+  typedef thx::mat<4,TypeParam> MatType;
+  typedef thx::vec<3,TypeParam> VecType;
+  typedef thx::vec<4,TypeParam> Vec4Type;
+  const std::size_t n = 37;
+  std::vector<MatType> a(n);
+  std::vector<VecType> p(n);
+  std::vector<Vec4Type> h(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    a[i] = makeRandMat<MatType>();
+    p[i] = makeRandVec<VecType>();
+    h[i] = makeRandVec<Vec4Type>();
+    for (std::size_t c = 0; c < 4; ++c) {
+      a[i](c,c) += 4000;
+    }
+  }
+
+  const thx::isa max = thx::max_isa();
+  ASSERT_TRUE(thx::active_isa() == max);
+  ASSERT_TRUE(std::string(thx::isa_name(max)).size() > 0);
+
+  std::vector<VecType> q0, q;
+  std::vector<Vec4Type> g0, g;
+  std::vector<MatType> m, b0, b;
+  std::vector<VecType> s0, s;
+  for (int t = thx::isa_scalar; t <= thx::isa_avx512; ++t) {
+    const thx::isa r = thx::set_active_isa(static_cast<thx::isa>(t));
+    ASSERT_TRUE(r <= max && r == thx::active_isa());
+
+    q.resize(n);
+    thx::transform_points(a[0], &p[0], &q[0], n);
+    g.resize(n);
+    thx::transform_homogeneous(a[0], &h[0], &g[0], n);
+    m.resize(n);
+    thx::mult(&a[0], &a[0], &m[0], n);
+    b.resize(n);
+    std::vector<thx::uint8> status(n);
+    ASSERT_EQ(0, thx::inverted(&a[0], &b[0], &status[0], n));
+    thx::vec_soa<3,TypeParam> v(p);
+    thx::normalize(v);
+    s = v.to_vector();
+
+    if (t == thx::isa_scalar) {
+      q0 = q;
+      g0 = g;
+      b0 = b;
+      s0 = s;
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+      const MatType c = thx::mult<TypeParam>(a[i], a[i]); // Scalar path.
+      ASSERT_TRUE(samePath(q0[i], q[i]));
+      ASSERT_TRUE(samePath(s0[i], s[i]));
+      ASSERT_TRUE(samePath(a[0]*p[i], q[i]));
+      ASSERT_TRUE(samePath(g0[i], g[i]));
+      ASSERT_TRUE(samePath(a[0]*h[i], g[i]));
+      for (int k = 0; k < MatType::linear_size; ++k) {
+        ASSERT_TRUE(samePath(c[k], m[i][k]));
+        ASSERT_TRUE(samePath(b0[i][k], b[i][k]));
+      }
+    }
+  }
+  thx::set_active_isa(max);
+}
+
+// Batched rotations match the products of the single-axis rotations.
+TYPED_TEST(MatAlgoTest, rotation_from_angles) {
+  typedef TypeParam S;
+  typedef thx::mat<3,S> MatType;
+  typedef thx::vec<3,S> VecType;
+  const double tol = sizeof(S) == 4 ? 1e-6 : 1e-14;
+  const std::size_t n = 5003;
+  std::vector<VecType> angles(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t c = 0; c < 3; ++c) {
+      angles[i][c] = S(0.01)*makeRandScalar<S>(-1000, 2000);
+    }
+  }
+
+  const thx::isa max = thx::max_isa();
+  std::vector<MatType> r0;
+  for (int t = thx::isa_scalar; t <= thx::isa_avx512; ++t) {
+    thx::set_active_isa(static_cast<thx::isa>(t));
+    std::vector<MatType> r(n);
+    thx::rotation_from_angles(&angles[0], &r[0], n);
+    if (t == thx::isa_scalar) {
+      r0 = r;
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+      const MatType e = thx::rotation_z(angles[i][2])*
+                        thx::rotation_y(angles[i][1])*
+                        thx::rotation_x(angles[i][0]);
+      for (int k = 0; k < MatType::linear_size; ++k) {
+        ASSERT_NEAR(e[k], r[i][k], tol);
+        ASSERT_TRUE(samePath(r0[i][k], r[i][k]));
+      }
+    }
+  }
+  thx::set_active_isa(max);
+}
+
+//------------------------------------------------------------------------------
+
+// The list of types we want to test.
+typedef ::testing::Types<thx::float32, thx::float64> QuatAlgoTestTypes;
+
+// Define a test fixture class template.
+template <class T>
+class QuatAlgoTest : public ::testing::Test {
+protected:
+  QuatAlgoTest() {
+    srand(1981);
+  }
+
+  virtual 
+  ~QuatAlgoTest() {
+  }
+};
+
+TYPED_TEST_CASE(QuatAlgoTest, QuatAlgoTestTypes);
+
+//! Random unit quaternion.
+template<typename S>
+thx::quat<S>
+makeRandRotation()
+{
+  thx::vec<3,S> axis = makeRandVec<thx::vec<3,S>>(-500, 1000);
+  axis[0] += S(0.5); // Never zero.
+  thx::normalize(axis);
+  thx::quat<S> q;
+  thx::set_axis_angle(q, axis, S(0.006)*makeRandScalar<S>(-500, 1000));
+  return q;
+}
+
+//! v rotated by the unit quaternion q, q*(0,v)*conj(q).
+template<typename S>
+thx::vec<3,S>
+rotated(const thx::quat<S> &q, const thx::vec<3,S> &v)
+{
+  const thx::quat<S> r = q*thx::quat<S>(S(0), v)*thx::conjugated(q);
+  return thx::vec<3,S>(r[1], r[2], r[3]);
+}
+
+//! Check that |u - v| <= tol.
+template<typename S>
+void
+assertNear(const thx::vec<3,S> &u, const thx::vec<3,S> &v, const S tol)
+{
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_NEAR(u[i], v[i], tol);
+  }
+}
+
+// Test that dual quaternions compose and transform like the rotation and 
+// translation they are built from.
+TYPED_TEST(QuatAlgoTest, dual_quat) {
+  typedef TypeParam S;
+  typedef thx::dual_quat<S> DualQuatType;
+  typedef thx::vec<3,S> VecType;
+  const S tol = 64*std::numeric_limits<S>::epsilon();
+
+  const thx::quat<S> ra = makeRandRotation<S>();
+  const thx::quat<S> rb = makeRandRotation<S>();
+  const VecType ta = S(0.002)*makeRandVec<VecType>(-500, 1000);
+  const VecType tb = S(0.002)*makeRandVec<VecType>(-500, 1000);
+  const VecType p = S(0.002)*makeRandVec<VecType>(-500, 1000);
+  const DualQuatType a(ra, ta);
+  const DualQuatType b(rb, tb);
+
+  assertNear(ta, thx::translation(a), tol);
+  assertNear(rotated(ra, p) + ta, a*p, tol);
+  assertNear(rotated(ra, p), thx::transform_vector(a, p), tol);
+  assertNear(a*(b*p), (a*b)*p, tol);
+  assertNear(p, thx::conjugated(a)*(a*p), tol);
+  ASSERT_TRUE(DualQuatType::identity()*p == p);
+
+  const DualQuatType c = thx::normalized(S(3)*a);
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_NEAR(a.real()[i], c.real()[i], tol);
+    ASSERT_NEAR(a.dual()[i], c.dual()[i], tol);
+  }
+}
+
+// Test batched skinning against blending one point at a time, for every 
+// instruction set tier, with antipodal bones and in-place output.
+TYPED_TEST(QuatAlgoTest, skin) {
+  typedef TypeParam S;
+  typedef thx::dual_quat<S> DualQuatType;
+  typedef thx::vec<3,S> VecType;
+  const S tol = 256*std::numeric_limits<S>::epsilon();
+
+  const std::size_t bone_count = 7;
+  std::vector<DualQuatType> bones(bone_count);
+  for (std::size_t i = 0; i < bone_count; ++i) {
+    bones[i] = DualQuatType(makeRandRotation<S>(), 
+                            S(0.002)*makeRandVec<VecType>(-500, 1000));
+  }
+  bones[3] = S(-1)*bones[3]; // Same transform, opposite hemisphere.
+
+  const std::size_t n = 301;
+  const std::size_t k = 3;
+  std::vector<VecType> p(n);
+  std::vector<VecType> nrm(n);
+  std::vector<thx::uint32> index(n*k);
+  std::vector<S> weight(n*k);
+  std::vector<VecType> p0(n);
+  std::vector<VecType> nrm0(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    p[i] = S(0.002)*makeRandVec<VecType>(-500, 1000);
+    nrm[i] = S(0.002)*makeRandVec<VecType>(-500, 1000);
+    DualQuatType b(thx::quat<S>(S(0)), thx::quat<S>(S(0)));
+    for (std::size_t j = 0; j < k; ++j) {
+      index[i*k + j] = static_cast<thx::uint32>(rand()%bone_count);
+      weight[i*k + j] = makeRandScalar<S>(1, 100);
+      const DualQuatType& bj = bones[index[i*k + j]];
+      const S s = thx::dot(bones[index[i*k]].real(), bj.real()) < 0 ? -1 : 1;
+      b += s*weight[i*k + j]*bj;
+    }
+    thx::normalize(b);
+    p0[i] = b*p[i];
+    nrm0[i] = thx::transform_vector(b, nrm[i]);
+  }
+
+  const thx::isa max = thx::max_isa();
+  for (int t = thx::isa_scalar; t <= thx::isa_avx512; ++t) {
+    thx::set_active_isa(static_cast<thx::isa>(t));
+    std::vector<VecType> q(n);
+    thx::skin(&bones[0], &index[0], &weight[0], k, &p[0], &q[0], n);
+    std::vector<VecType> r(p);
+    std::vector<VecType> m(nrm);
+    thx::skin(&bones[0], &index[0], &weight[0], k, 
+              &r[0], &r[0], &m[0], &m[0], n); // In-place.
+    for (std::size_t i = 0; i < n; ++i) {
+      assertNear(p0[i], q[i], tol);
+      assertNear(nrm0[i], m[i], tol);
+      ASSERT_TRUE(q[i] == r[i]);
+    }
+  }
+  thx::set_active_isa(max);
+}
+
+// Test interpolation between rotations about the same axis, where slerp 
+// interpolates the angle linearly, and the error bound of slerp_fast.
+TYPED_TEST(QuatAlgoTest, slerp) {
+  typedef TypeParam S;
+  typedef thx::quat<S> QuatType;
+  const S tol = 16*std::numeric_limits<S>::epsilon();
+  const thx::vec<3,S> z(S(0), S(0), S(1));
+
+  QuatType q;
+  QuatType r;
+  thx::set_axis_angle(q, z, S(0.5));
+  thx::set_axis_angle(r, z, S(2.5));
+  for (int i = 0; i <= 8; ++i) {
+    const S t = S(i)/8;
+    QuatType e;
+    thx::set_axis_angle(e, z, S(0.5) + 2*t);
+    const QuatType s = thx::slerp(q, r, t);
+    const QuatType s_neg = thx::slerp(q, S(-1)*r, t); // Same rotation.
+    for (int k = 0; k < 4; ++k) {
+      ASSERT_NEAR(e[k], s[k], tol);
+      ASSERT_NEAR(e[k], s_neg[k], tol);
+    }
+  }
+  const QuatType n = thx::nlerp(q, r, S(0.5));
+  const QuatType s = thx::slerp(q, r, S(0.5));
+  const QuatType c = thx::slerp(q, q, S(0.3)); // Linear fallback.
+  for (int k = 0; k < 4; ++k) {
+    ASSERT_NEAR(s[k], n[k], tol);
+    ASSERT_NEAR(q[k], c[k], tol);
+  }
+
+  for (int j = 0; j < 64; ++j) {
+    const QuatType a = makeRandRotation<S>();
+    const QuatType b = makeRandRotation<S>();
+    for (int i = 0; i <= 16; ++i) {
+      const S t = S(i)/16;
+      const QuatType e = thx::slerp(a, b, t);
+      const QuatType f = thx::slerp_fast(a, b, t);
+      for (int k = 0; k < 4; ++k) {
+        ASSERT_NEAR(e[k], f[k], S(4e-4) + tol);
+      }
+    }
+  }
+}
+
+// Test batched track sampling against slerp_fast, for every instruction set 
+// tier, before, between, at and after the keys.
+TYPED_TEST(QuatAlgoTest, sample) {
+  typedef TypeParam S;
+  typedef thx::quat<S> QuatType;
+  const S tol = 4*std::numeric_limits<S>::epsilon();
+
+  const std::size_t n = 203;
+  std::vector<std::vector<S>> times(n);
+  std::vector<std::vector<QuatType>> keys(n);
+  std::vector<thx::quat_track<S>> tracks(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    const std::size_t size = 1 + i%7;
+    S time = S(0.25)*makeRandScalar<S>(-4, 8);
+    for (std::size_t j = 0; j < size; ++j) {
+      times[i].push_back(time);
+      keys[i].push_back(makeRandRotation<S>());
+      time += S(0.25)*makeRandScalar<S>(1, 8);
+    }
+    thx::quat_track<S> const tr = { &times[i][0], &keys[i][0], size };
+    tracks[i] = tr;
+  }
+
+  const thx::isa max = thx::max_isa();
+  for (int a = thx::isa_scalar; a <= thx::isa_avx512; ++a) {
+    thx::set_active_isa(static_cast<thx::isa>(a));
+    for (int j = -8; j < 64; ++j) {
+      const S t = S(0.125)*j;
+      std::vector<QuatType> out(n);
+      thx::sample(&tracks[0], n, t, &out[0]);
+      for (std::size_t i = 0; i < n; ++i) {
+        const std::vector<S>& ti = times[i];
+        const std::vector<QuatType>& ki = keys[i];
+        QuatType e = ki.back();
+        if (t <= ti.front()) {
+          e = ki.front();
+        }
+        else if (t < ti.back()) {
+          std::size_t k = 1;
+          while (ti[k] <= t) {
+            ++k;
+          }
+          e = thx::slerp_fast(ki[k - 1], ki[k], 
+                              (t - ti[k - 1])/(ti[k] - ti[k - 1]));
+        }
+        for (int c = 0; c < 4; ++c) {
+          ASSERT_NEAR(e[c], out[i][c], tol);
+        }
+      }
+    }
+  }
+  thx::set_active_isa(max);
+}
+
+// Test that quaternions and rotation matrices convert both ways, including
+// half-turns where the real part vanishes, and that batched conversion 
+// matches the single element functions.
+TYPED_TEST(QuatAlgoTest, to_mat) {
+  typedef TypeParam S;
+  typedef thx::quat<S> QuatType;
+  typedef thx::vec<3,S> VecType;
+  const S tol = 16*std::numeric_limits<S>::epsilon();
+
+  const std::size_t n = 203;
+  std::vector<QuatType> q(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    q[i] = makeRandRotation<S>();
+  }
+  q[0] = QuatType(1);
+  thx::set_axis_angle(q[1], VecType(1, 0, 0), S(3.14159265358979323846));
+  thx::set_axis_angle(q[2], VecType(0, 1, 0), S(3.14159265358979323846));
+  thx::set_axis_angle(q[3], VecType(0, 0, 1), S(3.14159265358979323846));
+  q[4] = QuatType(0, thx::normalized(VecType(1, -1, 2)));
+
+  for (std::size_t i = 0; i < n; ++i) {
+    const thx::mat<3,S> a = thx::to_mat3(q[i]);
+    const thx::mat<4,S> b = thx::to_mat4(q[i]);
+    const VecType v = makeRandVec<VecType>(-100, 200);
+    assertNear(rotated(q[i], v), a*v, S(400)*tol);
+    for (int r = 0; r < 4; ++r) {
+      for (int c = 0; c < 4; ++c) {
+        ASSERT_EQ(r < 3 && c < 3 ? a(r, c) : S(r == c ? 1 : 0), b(r, c));
+      }
+    }
+
+    // Same rotation up to sign.
+    const QuatType p = thx::to_quat(a);
+    const S s = thx::dot(p, q[i]) < 0 ? S(-1) : S(1);
+    for (int c = 0; c < 4; ++c) {
+      ASSERT_NEAR(q[i][c], s*p[c], tol);
+    }
+    ASSERT_EQ(p, thx::to_quat(b));
+  }
+
+  std::vector<thx::mat<3,S>> a(n);
+  std::vector<thx::mat<4,S>> b(n);
+  thx::to_mat(&q[0], &a[0], n);
+  thx::to_mat(&q[0], &b[0], n);
+  std::vector<QuatType> p(n);
+  std::vector<QuatType> r(n);
+  thx::to_quat(&a[0], &p[0], n);
+  thx::to_quat(&b[0], &r[0], n);
+  for (std::size_t i = 0; i < n; ++i) {
+    const thx::mat<3,S> e = thx::to_mat3(q[i]);
+    const thx::mat<4,S> f = thx::to_mat4(q[i]);
+    for (std::size_t k = 0; k < 9; ++k) {
+      ASSERT_EQ(e[k], a[i][k]);
+    }
+    for (std::size_t k = 0; k < 16; ++k) {
+      ASSERT_EQ(f[k], b[i][k]);
+    }
+    ASSERT_EQ(thx::to_quat(e), p[i]);
+    ASSERT_EQ(p[i], r[i]);
+  }
+
+  thx::vec_soa<4,S> qs(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    qs.set(i, thx::vec<4,S>(q[i][0], q[i][1], q[i][2], q[i][3]));
+  }
+  const thx::isa max = thx::max_isa();
+  for (int t = thx::isa_scalar; t <= thx::isa_avx512; ++t) {
+    thx::set_active_isa(static_cast<thx::isa>(t));
+    thx::vec_soa<9,S> ms(n);
+    thx::vec_soa<4,S> ps(n);
+    thx::to_mat(qs, ms);
+    thx::to_quat(ms, ps);
+    for (std::size_t i = 0; i < n; ++i) {
+      for (std::size_t k = 0; k < 9; ++k) {
+        ASSERT_TRUE(samePath(a[i][k], ms.component(k)[i]));
+      }
+      for (std::size_t k = 0; k < 4; ++k) {
+        ASSERT_TRUE(samePath(p[i][k], ps.component(k)[i]));
+      }
+    }
+  }
+  thx::set_active_isa(max);
+}
+
+//! Check that packed_quat<B> decodes within its error bound and that
+//! batched encoding matches single element encoding.
+template<std::size_t B, typename S>
+void
+checkPacked()
+{
+  typedef thx::quat<S> QuatType;
+  typedef thx::packed_quat<B> PackedType;
+  const S tol = S(PackedType::max_error()) + 4*std::numeric_limits<S>::epsilon();
+
+  ASSERT_EQ(B/8, sizeof(PackedType));
+  ASSERT_EQ(QuatType(1), thx::unpack<S>(PackedType()));
+  ASSERT_EQ(PackedType(), thx::pack<B>(QuatType(1)));
+
+  const std::size_t n = 203;
+  std::vector<QuatType> q(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    q[i] = makeRandRotation<S>();
+  }
+  q[0] = QuatType(-1);
+  q[1] = QuatType(0, 1, 0, 0);
+  q[2] = QuatType(0, 0, 0, -1);
+  q[3] = QuatType(S(0.5), S(-0.5), S(0.5), S(-0.5));
+  q[4] = QuatType(0, S(0.6), S(-0.8), 0);
+
+  std::vector<PackedType> p(n);
+  std::vector<QuatType> r(n);
+  thx::pack(&q[0], &p[0], n);
+  thx::unpack(&p[0], &r[0], n);
+  for (std::size_t i = 0; i < n; ++i) {
+    const PackedType pi = thx::pack<B>(q[i]);
+    const QuatType ri = thx::unpack<S>(p[i]);
+    const QuatType u = thx::unpack<S>(pi);
+    const S s = thx::dot(q[i], r[i]) < 0 ? S(-1) : S(1);
+    for (int c = 0; c < 4; ++c) {
+      ASSERT_NEAR(q[i][c], s*r[i][c], tol);
+      ASSERT_TRUE(samePath(ri[c], r[i][c]));
+      // Contracted components may round to adjacent levels.
+      ASSERT_NEAR(u[c], r[i][c], fpContracted ? 2*tol : S(0));
+    }
+    if (!fpContracted) {
+      ASSERT_EQ(pi, p[i]);
+    }
+  }
+}
+
+// Test the error bounds of smallest three quaternion encoding.
+TYPED_TEST(QuatAlgoTest, packed_quat) {
+  checkPacked<32, TypeParam>();
+  checkPacked<48, TypeParam>();
+  checkPacked<64, TypeParam>();
+}
+
+//------------------------------------------------------------------------------
+
+// The list of types we want to test.
+typedef ::testing::Types<thx::uint32, thx::uint64> HashTestTypes;
+
+// Define a test fixture class template.
+template <class T>
+class HashTest : public ::testing::Test {
+protected:
+  HashTest() {
+    srand(1981);
+  }
+
+  virtual 
+  ~HashTest() {
+  }
+};
+
+TYPED_TEST_CASE(HashTest, HashTestTypes);
+
+//! Keys and seeds of the reference hashes below.
+const char* const hashKeys[] = {
+  "", "", "Hello, world!", "The quick brown fox jumps over the lazy dog", "abc"
+};
+const unsigned hashSeeds[] = { 0, 1, 1234, 0, 0 };
+
+//! Reference MurmurHash2, MurmurHash64A, MurmurHash3_x86_32 and 
+//! MurmurHash3_x64_128 (first half) of hashKeys.
+template<typename U>
+U
+hashRef(const int i, const bool v3)
+{
+  static const thx::uint32 ref2_32[] = {
+    0x0, 0x5bd15e36, 0xeeaa5e2e, 0x212729d0, 0x13577c9b
+  };
+  static const thx::uint64 ref2_64[] = {
+    0x0ULL, 0xc6a4a7935bd064dcULL, 0x6b669a47c42e4f91ULL, 
+    0x5589ca33042a861bULL, 0x9cc9c33498a95efbULL
+  };
+  static const thx::uint32 ref3_32[] = {
+    0x0, 0x514e28b7, 0xfaf6cdb3, 0x2e4ff723, 0xb3dd93fa
+  };
+  static const thx::uint64 ref3_64[] = {
+    0x0ULL, 0x4610abe56eff5cb5ULL, 0x61130e64aa0ac6feULL, 
+    0xe34bbc7bbc071b6cULL, 0xb4963f3f3fad7867ULL
+  };
+  return static_cast<U>(sizeof(U) == 4 ? (v3 ? ref3_32[i] : ref2_32[i]) 
+                                       : (v3 ? ref3_64[i] : ref2_64[i]));
+}
+
+//! murmur<U> with byte-wise loads, the big-endian path.
+inline thx::uint32
+murmurBytes(const void *key, std::size_t len, thx::uint32 seed)
+{
+  return thx::detail::murmur2_32<thx::detail::le_bytes_load>(key, len, seed);
+}
+
+inline thx::uint64
+murmurBytes(const void *key, std::size_t len, thx::uint64 seed)
+{
+  return thx::detail::murmur2_64<thx::detail::le_bytes_load>(key, len, seed);
+}
+
+//! Random bytes.
+std::vector<thx::uint8>
+makeRandBytes(const std::size_t n)
+{
+  std::vector<thx::uint8> b(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    b[i] = static_cast<thx::uint8>(rand() & 0xff);
+  }
+  return b;
+}
+
+// Test against reference hashes, with both the native and the big-endian 
+// word loads, and that both agree on unaligned keys of every tail length.
+TYPED_TEST(HashTest, murmur) {
+  typedef TypeParam U;
+  typedef thx::murmur3_hasher<U, thx::detail::le_bytes_load> BytesHasher;
+
+  for (int i = 0; i < 5; ++i) {
+    const std::size_t len = std::strlen(hashKeys[i]);
+    const U seed = static_cast<U>(hashSeeds[i]);
+    ASSERT_EQ(hashRef<U>(i, false), thx::murmur<U>(hashKeys[i], len, seed));
+    ASSERT_EQ(hashRef<U>(i, false), murmurBytes(hashKeys[i], len, seed));
+    ASSERT_EQ(hashRef<U>(i, true), thx::murmur3<U>(hashKeys[i], len, seed));
+    ASSERT_EQ(hashRef<U>(i, true), 
+              BytesHasher(seed).update(hashKeys[i], len).digest());
+  }
+
+  const std::vector<thx::uint8> b = makeRandBytes(64);
+  for (std::size_t offset = 0; offset < 8; ++offset) {
+    for (std::size_t len = 0; offset + len <= b.size(); ++len) {
+      const U seed = static_cast<U>(len);
+      ASSERT_EQ(murmurBytes(&b[offset], len, seed), 
+                thx::murmur<U>(&b[offset], len, seed));
+      ASSERT_EQ(BytesHasher(seed).update(&b[offset], len).digest(),
+                thx::murmur3<U>(&b[offset], len, seed));
+    }
+  }
+
+  ASSERT_EQ(0x78563412u, thx::detail::byte_swap32(0x12345678u));
+  ASSERT_EQ(0xefcdab8967452301ULL, 
+            thx::detail::byte_swap64(0x0123456789abcdefULL));
+}
+
+// Test that murmur_inverse recovers word-sized keys.
+TYPED_TEST(HashTest, murmur_inverse) {
+  typedef TypeParam U;
+
+  for (int i = 0; i < 1000; ++i) {
+    const U seed = static_cast<U>(rand());
+    U k = 0;
+    for (std::size_t j = 0; j < sizeof(U); ++j) {
+      k = static_cast<U>((k << 8) | (rand() & 0xff));
+    }
+    const U h = thx::murmur<U>(&k, sizeof(U), seed);
+    ASSERT_EQ(k, thx::murmur_inverse<U>(h, seed));
+    const U r = thx::murmur_inverse<U>(k, seed);
+    ASSERT_EQ(k, thx::murmur<U>(&r, sizeof(U), seed));
+  }
+}
+
+// Test that streaming in arbitrary chunks matches hashing in one go, and 
+// that taking a digest does not end the stream.
+TYPED_TEST(HashTest, murmur3_hasher) {
+  typedef TypeParam U;
+
+  const std::vector<thx::uint8> b = makeRandBytes(1000);
+  for (int i = 0; i < 100; ++i) {
+    const U seed = static_cast<U>(rand());
+    thx::murmur3_hasher<U> hasher(seed);
+    std::size_t n = 0;
+    while (n < b.size()) {
+      const std::size_t m = 
+        (std::min)(b.size() - n, static_cast<std::size_t>(rand() % 40));
+      hasher.update(&b[n], m);
+      n += m;
+      ASSERT_EQ(n, hasher.size());
+      ASSERT_EQ(thx::murmur3<U>(&b[0], n, seed), hasher.digest());
+    }
+    hasher.reset(seed);
+    ASSERT_EQ(thx::murmur3<U>(&b[0], 0, seed), hasher.digest());
+  }
+}
+
+//! Check the std::hash specializations for scalar type S.
+template<typename S>
+void
+checkStdHash()
+{
+  typedef std::numeric_limits<S> limits;
+  const S nan1 = limits::quiet_NaN();
+  const S nan2 = -limits::quiet_NaN();
+
+  // Values that compare equal hash equal, NaNs go to the same bucket.
+  const std::hash<thx::vec<3,S>> vh;
+  EXPECT_EQ(vh(thx::vec<3,S>(0, 1, 2)), vh(thx::vec<3,S>(-S(0), 1, 2)));
+  EXPECT_EQ(vh(thx::vec<3,S>(nan1, 1, 2)), vh(thx::vec<3,S>(nan2, 1, 2)));
+  EXPECT_NE(vh(thx::vec<3,S>(0, 1, 2)), vh(thx::vec<3,S>(0, 2, 1)));
+  EXPECT_NE(thx::hash_value(thx::vec<3,S>(0, 1, 2), 1), 
+            thx::hash_value(thx::vec<3,S>(0, 1, 2), 2));
+
+  thx::mat<4,S> a(1, 2, 3, 4,
+                  0, 1, 0, 0,
+                  0, 0, 2, 0,
+                  0, 0, 0, 1);
+  const std::hash<thx::mat<4,S>> mh;
+  const std::size_t ha = mh(a);
+  a(1,0) = -S(0);
+  EXPECT_EQ(ha, mh(a));
+  a(1,0) = 1;
+  EXPECT_NE(ha, mh(a));
+
+  const std::hash<thx::quat<S>> qh;
+  EXPECT_EQ(qh(thx::quat<S>(1, 0, 0, 0)), qh(thx::quat<S>(1, -S(0), 0, -S(0))));
+  EXPECT_NE(qh(thx::quat<S>(1, 0, 0, 0)), qh(thx::quat<S>(0, 1, 0, 0)));
+
+  // Vertex deduplication.
+  std::unordered_map<thx::vec<3,S>, int> index;
+  std::vector<thx::vec<3,S>> verts;
+  for (int i = 0; i < 1000; ++i) {
+    const thx::vec<3,S> v(S(i % 10), S(i % 7), (i % 3 == 0) ? -S(0) : S(0));
+    auto r = index.insert(std::make_pair(v, static_cast<int>(verts.size())));
+    if (r.second) {
+      verts.push_back(v);
+    }
+    ASSERT_TRUE(thx::vec_equal(verts[r.first->second], v));
+  }
+  EXPECT_EQ(70u, verts.size());
+
+  // Matrix and quaternion keys, -0 and +0 are the same key.
+  std::unordered_map<thx::mat<4,S>, int> mats;
+  std::unordered_map<thx::quat<S>, int> quats;
+  for (int i = 0; i < 20; ++i) {
+    thx::mat<4,S> m(a);
+    m(0,3) = S(i % 5);
+    m(2,1) = (i % 2 == 0) ? -S(0) : S(0);
+    mats[m] += 1;
+    const thx::quat<S> q(S(i % 4), (i % 2 == 0) ? -S(0) : S(0), 0, 1);
+    quats[q] += 1;
+  }
+  ASSERT_EQ(5u, mats.size());
+  ASSERT_EQ(4u, quats.size());
+  a(0,3) = 2;
+  ASSERT_EQ(1u, mats.count(a));
+  EXPECT_EQ(4, mats[a]);
+  EXPECT_EQ(5, quats[thx::quat<S>(1, 0, 0, 1)]);
+  thx::mat<4,S> b(a);
+  EXPECT_TRUE(a == b);
+  b(2,1) = 1;
+  EXPECT_TRUE(a != b);
+  EXPECT_EQ(0u, mats.count(b));
+
+  std::size_t seed = 0;
+  seed = thx::hash_combine(seed, thx::hash_value(thx::vec<3,S>(1, 2, 3)));
+  seed = thx::hash_combine(seed, thx::hash_value(thx::vec<2,S>(4, 5)));
+  std::size_t swapped = 0;
+  swapped = thx::hash_combine(swapped, thx::hash_value(thx::vec<2,S>(4, 5)));
+  swapped = thx::hash_combine(swapped, thx::hash_value(thx::vec<3,S>(1, 2, 3)));
+  EXPECT_NE(seed, swapped);
+}
+
+// Test that vec, mat and quat keys hash consistently with operator==.
+TEST(HashTest, std_hash) {
+  checkStdHash<thx::float32>();
+  checkStdHash<thx::float64>();
+}
+
+//------------------------------------------------------------------------------
+
+// The list of types we want to test.
+typedef ::testing::Types<thx::float32, thx::float64> GridTestTypes;
+
+// Define a test fixture class template.
+template <class T>
+class GridTest : public ::testing::Test {
+protected:
+  GridTest() {
+    srand(1981);
+  }
+
+  virtual 
+  ~GridTest() {
+  }
+};
+
+TYPED_TEST_CASE(GridTest, GridTestTypes);
+
+//! Brute force radius query, ids in increasing order.
+template<typename S>
+std::vector<thx::uint32>
+bruteRadius(const std::vector<thx::vec<3,S>> &p, 
+            const std::vector<bool> &live,
+            const thx::vec<3,S> &c, 
+            const S r)
+{
+  std::vector<thx::uint32> ids;
+  for (std::size_t i = 0; i < p.size(); ++i) {
+    if (live[i] && thx::dist_squared(p[i], c) <= r*r) {
+      ids.push_back(static_cast<thx::uint32>(i));
+    }
+  }
+  return ids;
+}
+
+//! Brute force k nearest, closest first and ties broken by id.
+template<typename S>
+std::vector<thx::uint32>
+bruteKnn(const std::vector<thx::vec<3,S>> &p, 
+         const std::vector<bool> &live,
+         const thx::vec<3,S> &c, 
+         const std::size_t k)
+{
+  std::vector<std::pair<S, thx::uint32>> d;
+  for (std::size_t i = 0; i < p.size(); ++i) {
+    if (live[i]) {
+      d.push_back(std::make_pair(thx::dist_squared(p[i], c), 
+                                 static_cast<thx::uint32>(i)));
+    }
+  }
+  std::sort(d.begin(), d.end());
+  std::vector<thx::uint32> ids;
+  for (std::size_t i = 0; i < (std::min)(k, d.size()); ++i) {
+    ids.push_back(d[i].second);
+  }
+  return ids;
+}
+
+//! Radius and k-NN queries of grid agree with brute force.
+template<typename S>
+void
+checkGrid(const thx::spatial_hash_grid<S> &grid,
+          const std::vector<thx::vec<3,S>> &p, 
+          const std::vector<bool> &live)
+{
+  std::vector<thx::uint32> ids;
+  for (int i = 0; i < 50; ++i) {
+    // Some queries lie outside the points.
+    const thx::vec<3,S> c(S(rand() % 300 - 150)/10, 
+                          S(rand() % 300 - 150)/10, 
+                          S(rand() % 300 - 150)/10);
+    const S r = S(rand() % 40)/10;
+    grid.radius_query(c, r, ids);
+    std::sort(ids.begin(), ids.end());
+    ASSERT_EQ(bruteRadius(p, live, c, r), ids);
+
+    const std::size_t k = static_cast<std::size_t>(rand() % 20);
+    grid.knn_query(c, k, ids);
+    ASSERT_EQ(bruteKnn(p, live, c, k), ids);
+  }
+  // Large regions are scanned.
+  grid.radius_query(thx::vec<3,S>(S(0)), S(100), ids);
+  std::sort(ids.begin(), ids.end());
+  ASSERT_EQ(bruteRadius(p, live, thx::vec<3,S>(S(0)), S(100)), ids);
+  grid.knn_query(thx::vec<3,S>(S(1000)), p.size() + 1, ids);
+  ASSERT_EQ(bruteKnn(p, live, thx::vec<3,S>(S(1000)), p.size() + 1), ids);
+}
+
+TYPED_TEST(GridTest, spatial_hash_grid) {
+  typedef TypeParam S;
+
+  // Points on a coarse lattice to get exact ties and shared cells.
+  const std::size_t n = 3000;
+  std::vector<thx::vec<3,S>> p(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    p[i] = thx::vec<3,S>(S(rand() % 200 - 100)/10, 
+                         S(rand() % 200 - 100)/10, 
+                         S(rand() % 200 - 100)/10);
+  }
+  std::vector<bool> live(n, true);
+
+  thx::spatial_hash_grid<S> grid(S(1));
+  EXPECT_TRUE(grid.empty());
+  std::vector<thx::uint32> ids;
+  grid.radius_query(thx::vec<3,S>(S(0)), S(1), ids);
+  grid.knn_query(thx::vec<3,S>(S(0)), 3, ids);
+  EXPECT_TRUE(ids.empty());
+
+  grid.build(&p[0], n);
+  EXPECT_EQ(n, grid.size());
+  checkGrid(grid, p, live);
+
+  // The layout does not depend on the number of threads.
+  thx::thread_pool pool(3);
+  thx::spatial_hash_grid<S> serial(S(1));
+  thx::thread_pool none(0);
+  serial.build(&p[0], n, none);
+  thx::spatial_hash_grid<S> parallel(S(1));
+  parallel.build(&p[0], n, pool);
+  std::vector<thx::uint32> ids2;
+  serial.radius_query(thx::vec<3,S>(S(0)), S(3), ids);
+  parallel.radius_query(thx::vec<3,S>(S(0)), S(3), ids2);
+  EXPECT_EQ(ids, ids2);
+
+  // Incremental insert and remove, with the rebuilds they trigger.
+  thx::spatial_hash_grid<S> incremental(S(1));
+  thx::spatial_hash_grid<S> incremental_serial(S(1));
+  for (std::size_t i = 0; i < n; ++i) {
+    incremental.insert(static_cast<thx::uint32>(i), p[i]);
+    incremental_serial.insert(static_cast<thx::uint32>(i), p[i], none);
+  }
+  incremental.radius_query(thx::vec<3,S>(S(0)), S(3), ids);
+  incremental_serial.radius_query(thx::vec<3,S>(S(0)), S(3), ids2);
+  EXPECT_EQ(ids, ids2);
+  EXPECT_EQ(n, incremental.size());
+  checkGrid(incremental, p, live);
+  for (std::size_t i = 0; i < n; i += 2) {
+    EXPECT_TRUE(incremental.remove(static_cast<thx::uint32>(i), p[i]));
+    EXPECT_TRUE(grid.remove(static_cast<thx::uint32>(i), p[i]));
+    live[i] = false;
+  }
+  EXPECT_FALSE(grid.remove(0, p[0]));
+  EXPECT_EQ(n/2, grid.size());
+  checkGrid(incremental, p, live);
+  checkGrid(grid, p, live);
+  grid.rebuild();
+  checkGrid(grid, p, live);
+
+  grid.clear();
+  EXPECT_TRUE(grid.empty());
+  grid.knn_query(thx::vec<3,S>(S(0)), 3, ids);
+  EXPECT_TRUE(ids.empty());
+}
+
+//------------------------------------------------------------------------------
+
+// The list of types we want to test.
+typedef ::testing::Types<thx::uint32, thx::uint64> RadixSortTestTypes;
+
+// Define a test fixture class template.
+template <class T>
+class RadixSortTest : public ::testing::Test {
+protected:
+  RadixSortTest() {
+    srand(1981);
+  }
+
+  virtual 
+  ~RadixSortTest() {
+  }
+};
+
+TYPED_TEST_CASE(RadixSortTest, RadixSortTestTypes);
+
+//! Random 64-bit value.
+inline thx::uint64
+rand64()
+{
+  thx::uint64 r = 0;
+  for (int i = 0; i < 4; ++i) {
+    r = (r << 16) | static_cast<thx::uint64>(rand() & 0xffff);
+  }
+  return r;
+}
+
+// Test against std::stable_sort, for key ranges that need an even and an odd 
+// number of passes, and that the result does not depend on the threads.
+TYPED_TEST(RadixSortTest, radix_sort) {
+  typedef TypeParam U;
+
+  thx::thread_pool pool(3);
+  thx::thread_pool none(0);
+  const std::size_t n = 200000;
+  const U masks[] = { U(0xff), U(0xfff0), static_cast<U>(0xff00ff00ff00ff00ULL),
+                      static_cast<U>(~0ULL) };
+  for (U mask : masks) {
+    std::vector<U> keys(n);
+    std::vector<std::pair<U, thx::uint32>> ref(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      keys[i] = static_cast<U>(rand64()) & mask;
+      ref[i] = std::make_pair(keys[i], static_cast<thx::uint32>(i));
+    }
+    std::stable_sort(ref.begin(), ref.end(), 
+      [](const std::pair<U, thx::uint32> &a, 
+         const std::pair<U, thx::uint32> &b) { return a.first < b.first; });
+
+    std::vector<U> k1(keys);
+    std::vector<thx::uint32> v1(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      v1[i] = static_cast<thx::uint32>(i);
+    }
+    thx::radix_sort(&k1[0], &v1[0], n, pool);
+    for (std::size_t i = 0; i < n; ++i) {
+      ASSERT_EQ(ref[i].first, k1[i]);
+      ASSERT_EQ(ref[i].second, v1[i]);
+    }
+
+    std::vector<U> k2(keys);
+    thx::radix_sort(&k2[0], n, none);
+    ASSERT_EQ(k1, k2);
+  }
+
+  U one = 7;
+  thx::radix_sort(&one, 1);
+  EXPECT_EQ(U(7), one);
+  thx::radix_sort(static_cast<U*>(0), 0);
+}
+
+//------------------------------------------------------------------------------
+
+TEST(MortonTest, encode) {
+  EXPECT_EQ(1u, thx::morton_encode(1u, 0u));
+  EXPECT_EQ(2u, thx::morton_encode(0u, 1u));
+  EXPECT_EQ(15u, thx::morton_encode(3u, 3u));
+  EXPECT_EQ(0xffffffffffffffffULL, 
+            thx::morton_encode(0xffffffffu, 0xffffffffu));
+  EXPECT_EQ(7u, thx::morton_encode(1u, 1u, 1u));
+  EXPECT_EQ(8u, thx::morton_encode(2u, 0u, 0u));
+  EXPECT_EQ(0x7fffffffffffffffULL, 
+            thx::morton_encode(0xffffffffu, 0xffffffffu, 0xffffffffu));
+
+  // Round trip, and the batched codes agree with and without pdep.
+  const std::size_t n = 50000;
+  std::vector<thx::vec<2,thx::uint32>> p2(n);
+  std::vector<thx::vec<3,thx::uint32>> p3(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    const thx::uint64 r = rand64();
+    p2[i] = thx::vec<2,thx::uint32>(static_cast<thx::uint32>(r), 
+                                    static_cast<thx::uint32>(r >> 32));
+    p3[i] = thx::vec<3,thx::uint32>(static_cast<thx::uint32>(r) & 0x1fffff, 
+                                    static_cast<thx::uint32>(r >> 21) & 0x1fffff, 
+                                    static_cast<thx::uint32>(r >> 42) & 0x1fffff);
+    EXPECT_TRUE(thx::morton_decode2(thx::morton_encode(p2[i])) == p2[i]);
+    EXPECT_TRUE(thx::morton_decode3(thx::morton_encode(p3[i])) == p3[i]);
+  }
+  ASSERT_TRUE(thx::cpu().bmi2 || !thx::cpu().fast_pdep);
+  const thx::isa active = thx::active_isa();
+  const thx::isa tiers[] = { thx::isa_scalar, thx::max_isa() };
+  for (thx::isa t : tiers) {
+    thx::set_active_isa(t);
+    std::vector<thx::uint64> c2(n);
+    std::vector<thx::uint64> c3(n);
+    thx::morton_encode(&p2[0], n, &c2[0]);
+    thx::morton_encode(&p3[0], n, &c3[0]);
+    for (std::size_t i = 0; i < n; ++i) {
+      ASSERT_EQ(thx::morton_encode(p2[i]), c2[i]);
+      ASSERT_EQ(thx::morton_encode(p3[i]), c3[i]);
+    }
+  }
+  thx::set_active_isa(active);
+}
+
+TEST(MortonTest, quantizer) {
+  typedef thx::morton_quantizer<3,thx::float32> quantizer;
+  typedef thx::vec<3,thx::float32> vec3f;
+  typedef thx::vec<3,thx::uint32> vec3u;
+  const quantizer q(vec3f(-1.f, 0.f, 0.f), vec3f(1.f, 1.f, 0.5f));
+  const thx::uint32 top = static_cast<thx::uint32>(quantizer::max_level);
+  EXPECT_TRUE(q(vec3f(-1.f, 0.f, 0.f)) == vec3u(0u, 0u, 0u));
+  EXPECT_TRUE(q(vec3f(1.f, 2.f, -5.f)) == vec3u(top, top, 0u));
+  // Same scale on all axes, from the longest side.
+  EXPECT_EQ(top/4, q(vec3f(0.f, 0.5f, 0.f))[1]);
+  EXPECT_EQ(0u, q(vec3f(std::numeric_limits<thx::float32>::quiet_NaN(), 
+                        0.f, 0.f))[0]);
+}
+
+TEST(MortonTest, sort) {
+  // Morton order of a 2x2 grid of 2x2 grids.
+  std::vector<thx::vec<2,thx::float64>> g;
+  for (int y = 3; y >= 0; --y) {
+    for (int x = 3; x >= 0; --x) {
+      g.push_back(thx::vec<2,thx::float64>(x, y));
+    }
+  }
+  thx::morton_sort(&g[0], g.size());
+  const int zx[] = { 0, 1, 0, 1, 2, 3, 2, 3, 0, 1, 0, 1, 2, 3, 2, 3 };
+  const int zy[] = { 0, 0, 1, 1, 0, 0, 1, 1, 2, 2, 3, 3, 2, 2, 3, 3 };
+  for (std::size_t i = 0; i < g.size(); ++i) {
+    EXPECT_EQ(zx[i], g[i][0]);
+    EXPECT_EQ(zy[i], g[i][1]);
+  }
+
+  // Random points come out as a permutation in code order.
+  const std::size_t n = 100000;
+  std::vector<thx::vec<3,thx::float32>> p(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    p[i] = thx::vec<3,thx::float32>(static_cast<thx::float32>(rand()), 
+                                    static_cast<thx::float32>(rand()), 
+                                    static_cast<thx::float32>(rand()));
+  }
+  std::vector<thx::uint64> codes(n);
+  thx::morton_encode(&p[0], n, &codes[0]);
+  std::vector<thx::uint32> order(n);
+  thx::morton_order(&p[0], n, &order[0]);
+  std::vector<thx::vec<3,thx::float32>> sorted(p);
+  thx::morton_sort(&sorted[0], n);
+  std::vector<bool> seen(n, false);
+  for (std::size_t i = 0; i < n; ++i) {
+    ASSERT_FALSE(seen[order[i]]);
+    seen[order[i]] = true;
+    ASSERT_TRUE(sorted[i] == p[order[i]]);
+    if (i > 0) {
+      ASSERT_LE(codes[order[i - 1]], codes[order[i]]);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+// The list of types we want to test.
+typedef ::testing::Types<thx::float32, thx::float64> ColorTestTypes;
+
+// Define a test fixture class template.
+template <class T>
+class ColorTest : public ::testing::Test {
+protected:
+  ColorTest() {
+    srand(1981);
+  }
+
+  virtual 
+  ~ColorTest() {
+  }
+};
+
+TYPED_TEST_CASE(ColorTest, ColorTestTypes);
+
+//! Random color with components in [0, 1].
+template<typename S>
+thx::vec<3,S>
+randomColor() {
+  return thx::vec<3,S>(static_cast<S>(rand())/RAND_MAX, 
+                       static_cast<S>(rand())/RAND_MAX, 
+                       static_cast<S>(rand())/RAND_MAX);
+}
+
+//! True if all components of u and v differ by at most tol.
+template<typename S>
+bool
+colorNear(const thx::vec<3,S> &u, const thx::vec<3,S> &v, const S tol) {
+  return std::abs(u[0] - v[0]) <= tol && 
+         std::abs(u[1] - v[1]) <= tol && 
+         std::abs(u[2] - v[2]) <= tol;
+}
+
+TYPED_TEST(ColorTest, single) {
+  typedef TypeParam S;
+  typedef thx::vec<3,S> vec3;
+  const S tol = static_cast<S>(1e-5);
+
+  // D65 white and the primaries.
+  EXPECT_TRUE(colorNear(vec3(S(0.95047), S(1), S(1.08883)), 
+                        thx::RGB_to_XYZ(vec3(1, 1, 1)), S(1e-4)));
+  EXPECT_TRUE(thx::RGB_to_HSV(vec3(1, 0, 0)) == vec3(0, 1, 1));
+  EXPECT_TRUE(colorNear(vec3(S(1)/3, 1, 1), 
+                        thx::RGB_to_HSV(vec3(0, 1, 0)), tol));
+  EXPECT_TRUE(colorNear(vec3(S(2)/3, 1, S(0.5)), 
+                        thx::RGB_to_HSV(vec3(0, 0, S(0.5))), tol));
+  EXPECT_TRUE(colorNear(vec3(S(5)/6, 1, 1), 
+                        thx::RGB_to_HSV(vec3(1, 0, 1)), tol));
+  EXPECT_TRUE(thx::RGB_to_HSV(vec3(S(0.5), S(0.5), S(0.5))) == 
+              vec3(0, 0, S(0.5)));
+  EXPECT_TRUE(thx::RGB_to_HSV(vec3(0, 0, 0)) == vec3(0, 0, 0));
+  EXPECT_TRUE(thx::HSV_to_RGB(vec3(0, 1, 1)) == vec3(1, 0, 0));
+  EXPECT_TRUE(thx::HSV_to_RGB(vec3(S(0.5), 0, S(0.25))) == 
+              vec3(S(0.25), S(0.25), S(0.25)));
+
+  // sRGB, clamped to [0, 1].
+  EXPECT_NEAR(S(0.735357), thx::sRGB_encode(S(0.5)), S(1e-5));
+  EXPECT_NEAR(S(0.214041), thx::sRGB_decode(S(0.5)), S(1e-5));
+  EXPECT_EQ(S(0), thx::sRGB_encode(S(-1)));
+  EXPECT_EQ(S(1), thx::sRGB_decode(S(2)));
+  EXPECT_EQ(S(0), thx::sRGB_encode(std::numeric_limits<S>::quiet_NaN()));
+
+  // xyY, including black and degenerate chromaticities.
+  EXPECT_TRUE(thx::XYZ_to_xyY(vec3(0, 0, 0)) == 
+              vec3(S(0.3127), S(0.3290), 0));
+  EXPECT_TRUE(thx::xyY_to_XYZ(vec3(S(0.3), 0, 1)) == vec3(0, 0, 0));
+
+  // Round trips.
+  for (int i = 0; i < 1000; ++i) {
+    const vec3 c = randomColor<S>();
+    EXPECT_TRUE(colorNear(c, thx::XYZ_to_RGB(thx::RGB_to_XYZ(c)), tol));
+    EXPECT_TRUE(colorNear(c, thx::sRGB_to_RGB(thx::RGB_to_sRGB(c)), tol));
+    EXPECT_TRUE(colorNear(c, thx::HSV_to_RGB(thx::RGB_to_HSV(c)), tol));
+    const vec3 xyz = thx::RGB_to_XYZ(c);
+    EXPECT_TRUE(colorNear(xyz, thx::xyY_to_XYZ(thx::XYZ_to_xyY(xyz)), tol));
+  }
+}
+
+TYPED_TEST(ColorTest, batched) {
+  typedef TypeParam S;
+  typedef thx::vec<3,S> vec3;
+
+  // Pixel counts that leave partial packets and blocks.
+  const std::size_t n = 3*thx::detail::color_block + 7;
+  std::vector<vec3> in(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    in[i] = randomColor<S>();
+  }
+  in[0] = vec3(0, 0, 0);
+  in[1] = vec3(S(0.5), S(0.5), S(0.5));
+
+  const thx::color_stages stages[] = {
+    thx::color_xyY_to_XYZ, 
+    thx::color_XYZ_to_xyY, 
+    thx::color_RGB_to_XYZ, 
+    thx::color_XYZ_to_RGB, 
+    thx::color_RGB_to_sRGB, 
+    thx::color_sRGB_to_RGB, 
+    thx::color_RGB_to_HSV, 
+    thx::color_HSV_to_RGB, 
+    { thx::color_sRGB_to_RGB, thx::color_RGB_to_HSV, thx::color_HSV_to_RGB, 
+      thx::color_RGB_to_XYZ, thx::color_XYZ_to_xyY } 
+  };
+
+  thx::thread_pool pool(3);
+  const thx::isa active = thx::active_isa();
+  const thx::isa tiers[] = { thx::isa_scalar, thx::max_isa() };
+  for (thx::isa t : tiers) {
+    thx::set_active_isa(t);
+    for (const thx::color_stages &s : stages) {
+      // Same as the single-pixel conversion.
+      std::vector<vec3> out(n);
+      thx::convert_colors(s, &in[0], &out[0], n, pool);
+      for (std::size_t i = 0; i < n; ++i) {
+        ASSERT_TRUE(samePath(thx::convert_color(s, in[i]), out[i]));
+      }
+
+      // In-place image with padded rows, padding untouched.
+      const std::size_t width = 37;
+      const std::size_t height = 11;
+      const std::size_t stride = 40;
+      std::vector<vec3> img(in.begin(), in.begin() + stride*height);
+      thx::convert_colors(s, &img[0], stride, &img[0], stride, 
+                          width, height, pool);
+      for (std::size_t i = 0; i < stride*height; ++i) {
+        const vec3 expected = 
+          (i%stride < width ? thx::convert_color(s, in[i]) : in[i]);
+        ASSERT_TRUE(samePath(expected, img[i]));
+      }
+
+      // Planes.
+      std::vector<S> planes(3*stride*height);
+      for (std::size_t i = 0; i < stride*height; ++i) {
+        for (std::size_t c = 0; c < 3; ++c) {
+          planes[c*stride*height + i] = in[i][c];
+        }
+      }
+      std::vector<S> out_planes(planes);
+      const S *p = &planes[0];
+      S *q = &out_planes[0];
+      const std::size_t size = stride*height;
+      thx::convert_colors(s, 
+        thx::make_color_planes(p, p + size, p + 2*size, stride), 
+        thx::make_color_planes(q, q + size, q + 2*size, stride), 
+        width, height, pool);
+      for (std::size_t i = 0; i < size; ++i) {
+        const vec3 expected = 
+          (i%stride < width ? thx::convert_color(s, in[i]) : in[i]);
+        ASSERT_TRUE(
+          samePath(expected, vec3(q[i], q[size + i], q[2*size + i])));
+      }
+    }
+  }
+  thx::set_active_isa(active);
+}
+
+//! Table-driven 8- or 16-bit sRGB against the exact path. C is the channel 
+//! type.
+template<typename S, typename C>
+void
+checkSrgbChannels(C (*encode)(S, thx::color_transfer), 
+                  S (*decode)(C, thx::color_transfer)) {
+  const thx::uint32 top = std::numeric_limits<C>::max();
+  const thx::color_transfer exact = thx::color_transfer_exact;
+  const thx::color_transfer table = thx::color_transfer_table;
+
+  // Decoding tables hold the exact values, and every code survives a round 
+  // trip through the encoding fit.
+  std::vector<C> codes(top + 1);
+  std::vector<S> values(top + 1);
+  for (thx::uint32 c = 0; c <= top; ++c) {
+    codes[c] = static_cast<C>(c);
+    values[c] = decode(codes[c], exact);
+    ASSERT_EQ(values[c], decode(codes[c], table));
+    ASSERT_EQ(codes[c], encode(values[c], table));
+  }
+
+  // Encoding is at most one off, and rarely.
+  const std::size_t n = 1 << 20;
+  std::vector<S> x(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    x[i] = static_cast<S>(i)/(n - 1);
+  }
+  x[0] = S(-1);
+  x[1] = S(2);
+  x[2] = std::numeric_limits<S>::quiet_NaN();
+  x[3] = S(0.0031308);
+  std::size_t mismatches = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    const int d = static_cast<int>(encode(x[i], table)) - 
+                  static_cast<int>(encode(x[i], exact));
+    ASSERT_LE(std::abs(d), 1);
+    mismatches += (d != 0 ? 1 : 0);
+  }
+  EXPECT_LT(mismatches, n/200);
+  EXPECT_EQ(C(0), encode(x[0], table));
+  EXPECT_EQ(C(top), encode(x[1], table));
+  EXPECT_EQ(C(0), encode(x[2], table));
+
+  // Batched versions match.
+  thx::thread_pool pool(3);
+  const thx::color_transfer transfers[] = { exact, table };
+  for (thx::color_transfer t : transfers) {
+    std::vector<C> out(n);
+    thx::sRGB_encode(&x[0], &out[0], n, t, pool);
+    for (std::size_t i = 0; i < n; ++i) {
+      ASSERT_EQ(encode(x[i], t), out[i]);
+    }
+    std::vector<S> back(top + 1);
+    thx::sRGB_decode(&codes[0], &back[0], codes.size(), t, pool);
+    for (thx::uint32 c = 0; c <= top; ++c) {
+      ASSERT_EQ(values[c], back[c]);
+    }
+  }
+}
+
+TYPED_TEST(ColorTest, srgb_channels) {
+  typedef TypeParam S;
+  checkSrgbChannels<S,thx::uint8>(&thx::sRGB_encode8<S>, 
+                                  &thx::sRGB_decode8<S>);
+  checkSrgbChannels<S,thx::uint16>(&thx::sRGB_encode16<S>, 
+                                   &thx::sRGB_decode16<S>);
+}
+
+TYPED_TEST(ColorTest, images) {
+  typedef TypeParam S;
+  typedef thx::vec<3,S> vec3;
+  typedef typename thx::image<3,S>::pixel_type pixel3;
+
+  const std::size_t width = 3*thx::detail::color_block + 5;
+  const std::size_t height = 9;
+  thx::image<3,S> in(width, height);
+  for (std::size_t y = 0; y < height; ++y) {
+    for (std::size_t x = 0; x < width; ++x) {
+      in.set(x, y, pixel3(randomColor<S>()));
+    }
+  }
+
+  // All combinations of layouts give the single-pixel results.
+  const thx::color_stages s = { thx::color_sRGB_to_RGB, thx::color_RGB_to_HSV };
+  thx::thread_pool pool(3);
+  const thx::image_layout layouts[] = { 
+    thx::image_interleaved, thx::image_planar 
+  };
+  for (thx::image_layout li : layouts) {
+    thx::image<3,S> src(width, height, li);
+    thx::copy_image(in, src, pool);
+    for (thx::image_layout lo : layouts) {
+      thx::image<3,S> out(width, height, lo);
+      thx::convert_colors(s, src, out, pool);
+      for (std::size_t y = 0; y < height; ++y) {
+        for (std::size_t x = 0; x < width; ++x) {
+          const vec3 expected = 
+            thx::convert_color(s, in.get(x, y).channels());
+          ASSERT_TRUE(samePath(expected, out.get(x, y).channels()));
+        }
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+TEST(ParallelTest, nested) {
+  thx::thread_pool pool(3);
+
+  // Inner loops queue their helpers on the worker running the outer chunk,
+  // where other workers steal them.
+  const std::size_t n = 64;
+  std::vector<std::size_t> sums(n);
+  thx::parallel_for(0, n, 1, [&](std::size_t const i0, std::size_t const i1) {
+    for (std::size_t i = i0; i < i1; ++i) {
+      std::vector<std::size_t> v(1000);
+      thx::parallel_for(0, v.size(), 10, 
+        [&](std::size_t const j0, std::size_t const j1) {
+          for (std::size_t j = j0; j < j1; ++j) {
+            v[j] = i*j;
+          }
+        }, pool);
+      for (std::size_t j = 0; j < v.size(); ++j) {
+        sums[i] += v[j];
+      }
+    }
+  }, pool);
+  for (std::size_t i = 0; i < n; ++i) {
+    EXPECT_EQ(i*999*1000/2, sums[i]);
+  }
+
+  // Exceptions are rethrown on the calling thread.
+  EXPECT_THROW(thx::parallel_for(0, 100, 1, [](std::size_t i0, std::size_t) {
+    if (i0 == 42) {
+      throw std::runtime_error("42");
+    }
+  }, pool), std::runtime_error);
+
+  // Tasks queued on a pool without threads run immediately.
+  thx::thread_pool none(0);
+  bool ran = false;
+  none.run([&]() { ran = true; });
+  EXPECT_TRUE(ran);
+}
+
+//------------------------------------------------------------------------------
+
+typedef ::testing::Types<thx::uint8, thx::float32> ImageTestTypes;
+
+template<typename S>
+class ImageTest : public ::testing::Test {
+protected:
+  ImageTest() {}
+  virtual ~ImageTest() {}
+};
+
+TYPED_TEST_CASE(ImageTest, ImageTestTypes);
+
+//! Distinct value for channel c of pixel (x, y).
+template<typename S>
+S
+imageValue(std::size_t const x, std::size_t const y, std::size_t const c) {
+  return static_cast<S>((7*x + 13*y + 3*c) % 101);
+}
+
+TYPED_TEST(ImageTest, storage) {
+  typedef TypeParam S;
+  typedef thx::image<3,S> image3;
+  typedef typename image3::pixel_type pixel3;
+
+  const std::size_t width = 37;
+  const std::size_t height = 5;
+  const thx::image_layout layouts[] = { 
+    thx::image_interleaved, thx::image_planar 
+  };
+  for (thx::image_layout layout : layouts) {
+    image3 img(width, height, layout);
+    EXPECT_EQ(width, img.width());
+    EXPECT_EQ(height, img.height());
+    EXPECT_EQ(layout, img.layout());
+    EXPECT_TRUE(img.rows_aligned());
+    EXPECT_EQ(layout == thx::image_interleaved ? 3u : 1u, img.pixel_stride());
+    EXPECT_LE(width*img.pixel_stride(), img.row_stride());
+    EXPECT_EQ(0u, img.row_stride()*sizeof(S) % thx::simd_alignment);
+
+    // Zeroed, including the row padding.
+    for (std::size_t y = 0; y < height; ++y) {
+      for (std::size_t c = 0; c < 3; ++c) {
+        for (std::size_t i = 0; i < img.row_stride(); ++i) {
+          if (layout == thx::image_planar || c == 0) {
+            ASSERT_EQ(S(0), img.row(y, c)[i]);
+          }
+        }
+      }
+    }
+
+    // Pixel access through get/set and pointers agree.
+    for (std::size_t y = 0; y < height; ++y) {
+      for (std::size_t x = 0; x < width; ++x) {
+        pixel3 p;
+        for (std::size_t c = 0; c < 3; ++c) {
+          p[c] = imageValue<S>(x, y, c);
+        }
+        img.set(x, y, p);
+      }
+    }
+    for (std::size_t y = 0; y < height; ++y) {
+      for (std::size_t x = 0; x < width; ++x) {
+        for (std::size_t c = 0; c < 3; ++c) {
+          ASSERT_EQ(imageValue<S>(x, y, c), img.get(x, y)[c]);
+          ASSERT_EQ(imageValue<S>(x, y, c), *img.at(x, y, c));
+          ASSERT_EQ(imageValue<S>(x, y, c), 
+                    img.row(y, c)[x*img.pixel_stride()]);
+        }
+      }
+    }
+
+    // Deep copies.
+    image3 copy(img);
+    img.set(0, 0, pixel3(S(1)));
+    EXPECT_TRUE(pixel3(S(1)) == img.get(0, 0));
+    EXPECT_TRUE(pixel3(S(0)) != copy.get(0, 0));
+    EXPECT_EQ(imageValue<S>(1, 2, 1), copy.get(1, 2)[1]);
+    image3 moved(std::move(copy));
+    EXPECT_TRUE(copy.empty());
+    EXPECT_EQ(imageValue<S>(1, 2, 1), moved.get(1, 2)[1]);
+    copy = moved;
+    EXPECT_EQ(imageValue<S>(1, 2, 1), copy.get(1, 2)[1]);
+
+    // Custom stride.
+    image3 strided(width, height, layout, 3*width + 1);
+    EXPECT_EQ(3*width + 1, strided.row_stride());
+    thx::copy_image(img, strided);
+    EXPECT_TRUE(img.get(width - 1, height - 1) == 
+                strided.get(width - 1, height - 1));
+    EXPECT_THROW(image3(width, height, thx::image_interleaved, 3*width - 1), 
+                 std::invalid_argument);
+  }
+}
+
+TYPED_TEST(ImageTest, views) {
+  typedef TypeParam S;
+  typedef thx::image<3,S> image3;
+  typedef typename image3::pixel_type pixel3;
+
+  const std::size_t width = 37;
+  const std::size_t height = 23;
+  image3 img(width, height);
+  for (std::size_t y = 0; y < height; ++y) {
+    for (std::size_t x = 0; x < width; ++x) {
+      pixel3 p;
+      for (std::size_t c = 0; c < 3; ++c) {
+        p[c] = imageValue<S>(x, y, c);
+      }
+      img.set(x, y, p);
+    }
+  }
+
+  // Sub-images and channels share the pixels.
+  const thx::image_view<3,S> sub = img.sub_image(5, 3, 10, 4);
+  EXPECT_EQ(10u, sub.width());
+  EXPECT_EQ(4u, sub.height());
+  EXPECT_TRUE(img.get(7, 5) == sub.get(2, 2));
+  sub.set(2, 2, pixel3(S(100)));
+  EXPECT_TRUE(pixel3(S(100)) == img.get(7, 5));
+  const thx::image_view<3,S const> csub = sub;
+  EXPECT_TRUE(pixel3(S(100)) == csub.get(2, 2));
+  const thx::image_view<1,S> green = img.channel(1);
+  EXPECT_EQ(imageValue<S>(4, 9, 1), green.get(4, 9)[0]);
+  EXPECT_EQ(img.at(4, 9, 1), green.at(4, 9));
+
+  // Layout conversion, both ways.
+  image3 planar(width, height, thx::image_planar);
+  thx::copy_image(img, planar);
+  image3 back(width, height);
+  thx::copy_image(planar, back);
+  for (std::size_t y = 0; y < height; ++y) {
+    for (std::size_t x = 0; x < width; ++x) {
+      ASSERT_TRUE(img.get(x, y) == planar.get(x, y));
+      ASSERT_TRUE(img.get(x, y) == back.get(x, y));
+    }
+  }
+  EXPECT_EQ(planar.at(4, 9, 2), planar.channel(2).row(9) + 4);
+  EXPECT_TRUE(planar.channel(2).rows_aligned());
+}
+
+TEST(ImageTest, iteration) {
+  thx::thread_pool pool(3);
+  thx::image<1,thx::uint32> visits(203, 131);
+
+  // Every pixel in exactly one tile, tiles at their position.
+  thx::parallel_for_tiles(visits, 32, 16, 
+    [&](thx::image_view<1,thx::uint32> const& tile, 
+        std::size_t const x, std::size_t const y) {
+      EXPECT_EQ(visits.at(x, y), tile.data());
+      EXPECT_LE(tile.width(), 32u);
+      EXPECT_LE(tile.height(), 16u);
+      for (std::size_t ty = 0; ty < tile.height(); ++ty) {
+        for (std::size_t tx = 0; tx < tile.width(); ++tx) {
+          ++tile.row(ty)[tx];
+        }
+      }
+    }, pool);
+
+  // Every row in exactly one group.
+  thx::parallel_for_rows(visits, 
+    [&](std::size_t const y0, std::size_t const y1) {
+      for (std::size_t y = y0; y < y1; ++y) {
+        for (std::size_t x = 0; x < visits.width(); ++x) {
+          ++visits.row(y)[x];
+        }
+      }
+    }, pool);
+
+  for (std::size_t y = 0; y < visits.height(); ++y) {
+    for (std::size_t x = 0; x < visits.width(); ++x) {
+      ASSERT_EQ(2u, visits.get(x, y)[0]);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+typedef ::testing::Types<thx::float32, thx::float64> FilterTestTypes;
+
+template<typename S>
+class FilterTest : public ::testing::Test {
+protected:
+  FilterTest() {}
+  virtual ~FilterTest() {}
+};
+
+TYPED_TEST_CASE(FilterTest, FilterTestTypes);
+
+//! Separable filter of channel c straight from the taps, clamping at edges.
+template<std::size_t N, typename S>
+std::vector<S>
+filterReference(thx::image<N,S> const& in,
+                thx::filter_taps<S> const& xt,
+                thx::filter_taps<S> const& yt,
+                std::size_t const c) {
+  std::vector<S> mid(in.height()*xt.out_size());
+  for (std::size_t y = 0; y < in.height(); ++y) {
+    for (std::size_t x = 0; x < xt.out_size(); ++x) {
+      S a = S(0);
+      for (std::size_t k = 0; k < xt.size(); ++k) {
+        const std::ptrdiff_t i = xt.start(x) + static_cast<std::ptrdiff_t>(k);
+        const std::size_t ic = static_cast<std::size_t>((std::min)(
+          (std::max)(i, std::ptrdiff_t(0)), 
+          static_cast<std::ptrdiff_t>(in.width()) - 1));
+        a += xt.weights(x)[k]*in.get(ic, y)[c];
+      }
+      mid[y*xt.out_size() + x] = a;
+    }
+  }
+  std::vector<S> out(yt.out_size()*xt.out_size());
+  for (std::size_t y = 0; y < yt.out_size(); ++y) {
+    for (std::size_t x = 0; x < xt.out_size(); ++x) {
+      S a = S(0);
+      for (std::size_t k = 0; k < yt.size(); ++k) {
+        const std::ptrdiff_t i = yt.start(y) + static_cast<std::ptrdiff_t>(k);
+        const std::size_t ic = static_cast<std::size_t>((std::min)(
+          (std::max)(i, std::ptrdiff_t(0)), 
+          static_cast<std::ptrdiff_t>(in.height()) - 1));
+        a += yt.weights(y)[k]*mid[ic*xt.out_size() + x];
+      }
+      out[y*xt.out_size() + x] = a;
+    }
+  }
+  return out;
+}
+
+TYPED_TEST(FilterTest, taps) {
+  typedef TypeParam S;
+
+  // Blurs share symmetric weights that sum to one.
+  const thx::filter_taps<S> blur = thx::compact_gaussian_taps(100, 100, S(2));
+  EXPECT_TRUE(blur.uniform());
+  EXPECT_EQ(9u, blur.size()); // Support is 2.5*sigma.
+  EXPECT_EQ(-4, blur.start(0));
+  S sum = S(0);
+  for (std::size_t k = 0; k < blur.size(); ++k) {
+    sum += blur.weights(0)[k];
+    EXPECT_NEAR(blur.weights(0)[k], blur.weights(0)[blur.size() - 1 - k], 
+                S(1e-6));
+  }
+  EXPECT_NEAR(S(1), sum, S(1e-6));
+  EXPECT_GT(blur.weights(0)[4], blur.weights(0)[3]);
+
+  // Downsampling widens the filter.
+  const thx::filter_taps<S> down = thx::compact_gaussian_taps(100, 25, S(0.5));
+  EXPECT_FALSE(down.uniform());
+  EXPECT_LE(5u, down.size());
+  for (std::size_t o = 0; o < down.out_size(); ++o) {
+    sum = S(0);
+    for (std::size_t k = 0; k < down.size(); ++k) {
+      sum += down.weights(o)[k];
+    }
+    ASSERT_NEAR(S(1), sum, S(1e-6));
+  }
+
+  // Very narrow filters pick the nearest pixel.
+  const thx::filter_taps<S> nearest = 
+    thx::compact_gaussian_taps(10, 10, S(0.1));
+  EXPECT_EQ(1u, nearest.size());
+  EXPECT_EQ(S(1), nearest.weights(3)[0]);
+  EXPECT_EQ(3, nearest.start(3));
+
+  EXPECT_THROW(thx::compact_gaussian_taps(10, 10, S(0)), 
+               std::invalid_argument);
+}
+
+TYPED_TEST(FilterTest, convolve) {
+  typedef TypeParam S;
+  typedef thx::image<3,S> image3;
+  typedef typename image3::pixel_type pixel3;
+
+  // Several tiles in both directions, partial at the edges.
+  const std::size_t width = 600;
+  const std::size_t height = 157;
+  image3 in(width, height);
+  for (std::size_t y = 0; y < height; ++y) {
+    for (std::size_t x = 0; x < width; ++x) {
+      pixel3 p;
+      for (std::size_t c = 0; c < 3; ++c) {
+        p[c] = static_cast<S>(rand())/RAND_MAX;
+      }
+      in.set(x, y, p);
+    }
+  }
+
+  thx::thread_pool pool(3);
+  const std::size_t sizes[][2] = { 
+    { width, height }, { width/3, height/2 }, { 2*width/3 + 1, 2*height } 
+  };
+  const S sigmas[] = { S(0.7), S(3) };
+  const thx::image_layout layouts[] = { 
+    thx::image_interleaved, thx::image_planar 
+  };
+  const thx::isa active = thx::active_isa();
+  const thx::isa tiers[] = { thx::isa_scalar, thx::max_isa() };
+  for (thx::isa t : tiers) {
+    thx::set_active_isa(t);
+    for (auto const& size : sizes) {
+      for (S sigma : sigmas) {
+        const thx::filter_taps<S> xt = 
+          thx::compact_gaussian_taps(width, size[0], sigma);
+        const thx::filter_taps<S> yt = 
+          thx::compact_gaussian_taps(height, size[1], sigma);
+        std::vector<S> expected[3];
+        for (std::size_t c = 0; c < 3; ++c) {
+          expected[c] = filterReference(in, xt, yt, c);
+        }
+        for (thx::image_layout layout : layouts) {
+          image3 src(width, height, layout);
+          thx::copy_image(in, src);
+          image3 out(size[0], size[1], thx::image_planar);
+          thx::convolve_separable(src, out, xt, yt, pool);
+          for (std::size_t y = 0; y < size[1]; ++y) {
+            for (std::size_t x = 0; x < size[0]; ++x) {
+              for (std::size_t c = 0; c < 3; ++c) {
+                ASSERT_NEAR(expected[c][y*size[0] + x], out.get(x, y)[c], 
+                            S(1e-5));
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+  thx::set_active_isa(active);
+
+  // Constant images stay constant.
+  image3 flat(width, height);
+  for (std::size_t y = 0; y < height; ++y) {
+    for (std::size_t x = 0; x < width; ++x) {
+      flat.set(x, y, pixel3(S(0.25)));
+    }
+  }
+  image3 blurred(width, height);
+  thx::gaussian_blur(flat, blurred, S(2), pool);
+  image3 small(37, 23);
+  thx::resample(flat, small, S(0.5), pool);
+  for (std::size_t y = 0; y < height; ++y) {
+    for (std::size_t x = 0; x < width; ++x) {
+      ASSERT_NEAR(S(0.25), blurred.get(x, y)[1], S(1e-6));
+    }
+  }
+  EXPECT_NEAR(S(0.25), small.get(36, 22)[2], S(1e-6));
+
+  image3 wrong(width + 1, height);
+  EXPECT_THROW(thx::convolve_separable(in, wrong, 
+                 thx::compact_gaussian_taps(width, width, S(1)), 
+                 thx::compact_gaussian_taps(height, height, S(1)), pool), 
+               std::invalid_argument);
+}
+
+//------------------------------------------------------------------------------
+
+typedef ::testing::Types<thx::float32, thx::float64> FastMathTestTypes;
+
+template<typename S>
+class FastMathTest : public ::testing::Test {
+protected:
+  FastMathTest() {}
+  virtual ~FastMathTest() {}
+};
+
+TYPED_TEST_CASE(FastMathTest, FastMathTestTypes);
+
+// Errors against libm over dense ranges, within the documented errors: the 
+// float32 table in thx_fast_scalar_traits.hpp, or 1e-8 for float64.
+TYPED_TEST(FastMathTest, traits) {
+  typedef TypeParam S;
+  typedef thx::fast_scalar_traits<S> fast;
+  const bool f32 = sizeof(S) == 4;
+  const int n = 100000;
+  for (int i = 0; i < n; ++i) {
+    const double t = (i + 0.5)/n;
+    const S xs = static_cast<S>(-100 + 200*t);
+    EXPECT_NEAR(std::sin(double(xs)), fast::sin(xs), f32 ? 1e-7 : 1e-8);
+    EXPECT_NEAR(std::cos(double(xs)), fast::cos(xs), f32 ? 1e-7 : 1e-8);
+    const S xe = static_cast<S>(-87 + 175*t);
+    EXPECT_NEAR(1., fast::exp(xe)/std::exp(double(xe)), f32 ? 1e-7 : 1e-8);
+    const S xl = static_cast<S>(std::exp(-80 + 160*t));
+    EXPECT_NEAR(std::log(double(xl)), fast::log(xl), (f32 ? 1e-7 : 1e-8)*
+                (std::max)(1., std::fabs(std::log(double(xl)))));
+    const S xr = static_cast<S>(std::exp(-40 + 80*t));
+    EXPECT_NEAR(1., fast::rsqrt(xr)*std::sqrt(double(xr)), 
+                f32 ? 2.9e-7 : 1e-8);
+    EXPECT_NEAR(1., fast::rcp(xr)*double(xr), f32 ? 2e-7 : 1e-8);
+    const S xa = static_cast<S>(-1 + 2*t);
+    EXPECT_NEAR(std::asin(double(xa)), fast::asin(xa), f32 ? 1.7e-7 : 1e-8);
+    EXPECT_NEAR(std::acos(double(xa)), fast::acos(xa), f32 ? 3e-7 : 1e-8);
+    const S xt = static_cast<S>(1000*std::tan(-1.57 + 3.14*t));
+    EXPECT_NEAR(std::atan(double(xt)), fast::atan(xt), f32 ? 1.5e-7 : 1e-8);
+    const S xu = static_cast<S>(-50 + 100*t);
+    EXPECT_NEAR(std::atan(double(xu)), fast::atan(xu), f32 ? 1.5e-7 : 1e-8);
+    const double a = -3.14159 + 6.28318*t;
+    const S y = static_cast<S>((1 + t)*std::sin(a));
+    const S x = static_cast<S>((1 + t)*std::cos(a));
+    EXPECT_NEAR(std::atan2(double(y), double(x)), fast::atan2(y, x), 
+                f32 ? 2.7e-7 : 1e-8);
+    const S xn = static_cast<S>(-1.5707 + 3.1414*t);
+    EXPECT_NEAR(1., fast::tan(xn)/std::tan(double(xn)), f32 ? 2.4e-7 : 1e-8);
+  }
+  EXPECT_EQ(S(3), fast::abs(S(-3)));
+  EXPECT_EQ(S(0), fast::sin(S(0)));
+  EXPECT_EQ(S(1), fast::cos(S(0)));
+  EXPECT_EQ(S(0), fast::atan2(S(0), S(0)));
+  EXPECT_NEAR(S(-3.14159265358979), fast::atan2(S(-1e-30), S(-1)), 1e-6);
+  EXPECT_TRUE((std::is_same<thx::scalar_traits<S>, 
+    typename thx::math_traits<S, thx::precise_math_tag>::type>::value));
+  EXPECT_TRUE((std::is_same<fast, 
+    typename thx::math_traits<S, thx::fast_math_tag>::type>::value));
+}
+
+// Opting in to the fast tier stays close to the precise results.
+TYPED_TEST(FastMathTest, policies) {
+  typedef TypeParam S;
+  typedef thx::vec<3,S> vec3;
+  srand(1981);
+  for (int i = 0; i < 1000; ++i) {
+    const vec3 v(makeRandScalar<S>(-100, 200), makeRandScalar<S>(-100, 200),
+                 makeRandScalar<S>(1, 100));
+    vec3 u = v;
+    vec3 w = v;
+    thx::normalize(u, thx::fast_math_tag());
+    thx::normalize(w, thx::precise_math_tag());
+    const vec3 r = thx::normalized(v, thx::fast_math_tag());
+    for (std::size_t k = 0; k < 3; ++k) {
+      EXPECT_NEAR(w[k], u[k], 1e-6);
+      EXPECT_NEAR(w[k], r[k], 1e-6);
+      EXPECT_EQ(thx::normalized(v)[k], 
+                thx::normalized(v, thx::precise_math_tag())[k]);
+    }
+
+    const S rad = S(0.01)*makeRandScalar<S>(-1000, 2000);
+    const thx::mat<3,S> fx = thx::rotation_x(rad, thx::fast_math_tag());
+    const thx::mat<3,S> fy = thx::rotation_y(rad, thx::fast_math_tag());
+    const thx::mat<3,S> fz = thx::rotation_z(rad, thx::fast_math_tag());
+    const thx::mat<3,S> px = thx::rotation_x(rad, thx::precise_math_tag());
+    const thx::mat<3,S> py = thx::rotation_y(rad, thx::precise_math_tag());
+    const thx::mat<3,S> pz = thx::rotation_z(rad, thx::precise_math_tag());
+    for (thx::int64 r = 0; r < 3; ++r) {
+      for (thx::int64 c = 0; c < 3; ++c) {
+        EXPECT_NEAR(px(r,c), fx(r,c), 1e-6);
+        EXPECT_NEAR(py(r,c), fy(r,c), 1e-6);
+        EXPECT_NEAR(pz(r,c), fz(r,c), 1e-6);
+        EXPECT_EQ(thx::rotation_z(rad)(r,c), pz(r,c));
+      }
+    }
+
+    thx::quat<S> fq;
+    thx::quat<S> pq;
+    thx::set_axis_angle(fq, w, rad, thx::fast_math_tag());
+    thx::set_axis_angle(pq, w, rad, thx::precise_math_tag());
+    for (std::size_t k = 0; k < 4; ++k) {
+      EXPECT_NEAR(pq[k], fq[k], 1e-6);
+    }
+  }
+}
+
+// Simultaneous sine and cosine, single and batched.
+TYPED_TEST(FastMathTest, sincos) {
+  typedef TypeParam S;
+  const double tol = sizeof(S) == 4 ? 1e-7 : 3e-16;
+  const std::size_t n = 10007;
+  std::vector<S> x(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    x[i] = static_cast<S>(-100 + 200*(i + 0.5)/n);
+  }
+  x[0] = S(0);
+  x[1] = S(-3.14159265358979323846);
+
+  for (std::size_t i = 0; i < n; i += 7) {
+    S s, c;
+    thx::scalar_traits<S>::sincos(x[i], s, c);
+    EXPECT_NEAR(std::sin(double(x[i])), s, tol);
+    EXPECT_NEAR(std::cos(double(x[i])), c, tol);
+    thx::fast_scalar_traits<S>::sincos(x[i], s, c);
+    EXPECT_EQ(thx::fast_scalar_traits<S>::sin(x[i]), s);
+    EXPECT_EQ(thx::fast_scalar_traits<S>::cos(x[i]), c);
+  }
+
+  // Results do not depend on the instruction set or position in the range.
+  const thx::isa max = thx::max_isa();
+  std::vector<S> s0, c0;
+  for (int t = thx::isa_scalar; t <= thx::isa_avx512; ++t) {
+    thx::set_active_isa(static_cast<thx::isa>(t));
+    std::vector<S> s(n), c(n);
+    thx::sincos(&x[0], &s[0], &c[0], n);
+    if (t == thx::isa_scalar) {
+      s0 = s;
+      c0 = c;
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+      ASSERT_NEAR(std::sin(double(x[i])), s[i], tol);
+      ASSERT_NEAR(std::cos(double(x[i])), c[i], tol);
+      ASSERT_TRUE(samePath(s0[i], s[i]));
+      ASSERT_TRUE(samePath(c0[i], c[i]));
+    }
+    S s3, c3;
+    thx::sincos(&x[3], &s3, &c3, 1);
+    ASSERT_TRUE(samePath(s[3], s3));
+    ASSERT_TRUE(samePath(c[3], c3));
+  }
+  thx::set_active_isa(max);
+
+  // In place.
+  std::vector<S> y(x);
+  std::vector<S> c(n);
+  thx::sincos(&y[0], &y[0], &c[0], n);
+  EXPECT_TRUE(samePath(s0[n - 1], y[n - 1]));
+}
+
+//------------------------------------------------------------------------------
+
+//! float16 bits of x, with F16C if the compiler enables it.
+thx::uint16
+float16Bits(const float x) {
+  return thx::float16(x).bits();
+}
+
+TEST(Float16Test, conversion) {
+  typedef thx::float16 half;
+  EXPECT_EQ(0x0000, float16Bits(0.f));
+  EXPECT_EQ(0x8000, float16Bits(-0.f));
+  EXPECT_EQ(0x3c00, float16Bits(1.f));
+  EXPECT_EQ(0xc000, float16Bits(-2.f));
+  EXPECT_EQ(0x7bff, float16Bits(65504.f));
+  EXPECT_EQ(0x7bff, float16Bits(65519.f));
+  EXPECT_EQ(0x7c00, float16Bits(65520.f));
+  EXPECT_EQ(0xfc00, float16Bits(-std::numeric_limits<float>::infinity()));
+  EXPECT_EQ(0x0001, float16Bits(std::ldexp(1.f, -24)));
+  EXPECT_EQ(0x0000, float16Bits(std::ldexp(1.f, -25)));
+  EXPECT_EQ(0x0002, float16Bits(std::ldexp(3.f, -25)));
+  EXPECT_EQ(0x3c00, float16Bits(1.f + std::ldexp(1.f, -11))); // Tie, even.
+  EXPECT_EQ(0x3c02, float16Bits(1.f + std::ldexp(3.f, -11)));
+  EXPECT_EQ(0x3555, float16Bits(1.f/3));
+  EXPECT_EQ(0x7e00, float16Bits(std::numeric_limits<float>::quiet_NaN()));
+  EXPECT_EQ(0x3555, half(1./3).bits());
+
+  // Every float16 survives the round trip, software and F16C agree.
+  for (thx::uint32 h = 0; h < 0x10000; ++h) {
+    const half x = half::from_bits(static_cast<thx::uint16>(h));
+    const float f = x;
+    const bool nan = (h & 0x7c00) == 0x7c00 && (h & 0x3ff) != 0;
+    ASSERT_EQ(nan, f != f);
+    const float s = thx::detail::float16_decode_soft(x.bits());
+    ASSERT_EQ(0, std::memcmp(&s, &f, sizeof(f))) << h;
+    const thx::uint16 r = thx::detail::float16_encode_soft(f);
+    ASSERT_EQ(nan ? (h | 0x200) : h, r) << h;
+    ASSERT_EQ(r, half(f).bits());
+  }
+
+  // Batched conversion matches the scalar path on every tier.
+  srand(1981);
+  const std::size_t n = 1003;
+  std::vector<float> f(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    f[i] = std::ldexp(static_cast<float>(rand())/RAND_MAX - 0.5f, 
+                      rand()%40 - 26);
+  }
+  const thx::isa max = thx::max_isa();
+  for (int t = thx::isa_scalar; t <= thx::isa_avx512; ++t) {
+    thx::set_active_isa(static_cast<thx::isa>(t));
+    std::vector<half> h(n);
+    std::vector<float> g(n);
+    thx::convert(&f[0], &h[0], n);
+    thx::convert(&h[0], &g[0], n);
+    for (std::size_t i = 0; i < n; ++i) {
+      ASSERT_EQ(half(f[i]).bits(), h[i].bits());
+      ASSERT_EQ(float(h[i]), g[i]);
+      ASSERT_NEAR(f[i], g[i], std::ldexp(std::fabs(f[i]), -11) + 3e-8);
+    }
+  }
+  thx::set_active_isa(max);
+
+  std::vector<thx::vec<3,float>> v(5, thx::vec<3,float>(0.1f));
+  std::vector<thx::vec<3,half>> vh(v.size());
+  thx::convert(&v[0], &vh[0], v.size());
+  std::vector<thx::vec<3,float>> w(v.size());
+  thx::convert(&vh[0], &w[0], v.size());
+  EXPECT_EQ(0x2e66, vh[4][2].bits());
+  EXPECT_EQ(float(half(0.1f)), w[4][2]);
+}
+
+TEST(Float16Test, arithmetic) {
+  typedef thx::float16 half;
+  typedef thx::vec<3,half> VecType;
+  EXPECT_EQ(6u, sizeof(VecType));
+  EXPECT_EQ(18u, sizeof(thx::mat<3,half>));
+  EXPECT_EQ(8u, sizeof(thx::quat<half>));
+  EXPECT_TRUE((std::is_same<float, 
+    thx::arithmetic_type<half>::compute>::value));
+  EXPECT_TRUE(thx::is_real_scalar<half>::value);
+  EXPECT_EQ(65504.f, float((std::numeric_limits<half>::max)()));
+  EXPECT_EQ(std::ldexp(1.f, -10), 
+            float(std::numeric_limits<half>::epsilon()));
+
+  // Each operation rounds once.
+  half a(1);
+  a += half(std::ldexp(1.f, -11));
+  EXPECT_EQ(1.f, float(a));
+  a *= half(3);
+  a /= half(2);
+  a -= half(0.5f);
+  EXPECT_EQ(1.f, float(a));
+
+  const VecType u(half(1), half(2), half(2));
+  const VecType v = u + u;
+  EXPECT_EQ(4.f, float(v[1]));
+  EXPECT_EQ(18.f, float(thx::dot(u, v)));
+  EXPECT_EQ(3.f, float(thx::mag(u)));
+  const VecType n = thx::normalized(u);
+  EXPECT_NEAR(2.f/3, float(n[2]), 1e-3f);
+  EXPECT_EQ(half(2.f/3).bits(), n[2].bits());
+
+  const thx::mat<3,half> r = thx::rotation_z(half(0.5f));
+  EXPECT_NEAR(std::cos(0.5f), float(r(0,0)), 1e-3f);
+  EXPECT_NEAR(std::sin(0.5f), float(r(0,1)), 1e-3f);
+  thx::quat<half> q;
+  thx::set_axis_angle(q, VecType(half(0), half(0), half(1)), half(1));
+  EXPECT_NEAR(std::cos(0.5f), float(q[0]), 1e-3f);
+  EXPECT_NEAR(std::sin(0.5f), float(q[3]), 1e-3f);
+  EXPECT_NEAR(1.f, float(thx::dot(thx::normalized(q), thx::normalized(q))), 
+              2e-3f);
+  EXPECT_EQ(0x3c00, thx::scalar_traits<half>::abs(half(-1)).bits());
+}
+
+//------------------------------------------------------------------------------
+
+#if defined(THX_HAS_CONST_EXPR)
+
+// Test that construction and arithmetic can be evaluated at compile-time.
+TYPED_TEST(MatAlgoTest, const_expr) {
+  typedef TypeParam S;
+  constexpr thx::vec<3,S> u(1, 2, 3);
+  constexpr thx::vec<3,S> v(4, 5, 6);
+  static_assert(thx::dot(u, v) == 32, "dot");
+  constexpr thx::vec<3,S> w = thx::cross(u, v) + S(2)*u - v;
+  static_assert(w[0] == -5 && w[1] == 5 && w[2] == -3, "cross");
+
+  constexpr thx::mat<4,S> a(1, 2, 3, 4,
+                            0, 1, 0, 0,
+                            0, 0, 2, 0,
+                            0, 0, 0, 1);
+  static_assert(thx::determinant(a) == 2, "determinant");
+  constexpr thx::vec<4,S> p = a*thx::vec<4,S>(1);
+  static_assert(p[0] == 10 && p[1] == 1 && p[2] == 2 && p[3] == 1, "mat*vec");
+  constexpr thx::mat<4,S> b = thx::mult<S>(thx::transposed(a), a);
+  static_assert(b(0,0) == 1 && b(0,1) == 2 && b(1,1) == 5, "mult");
+#if defined(THX_HAS_CONSTANT_EVALUATED) || !defined(THX_SSE2)
+  constexpr thx::mat<4,S> c = thx::transposed(a)*a; // SIMD at run-time.
+  static_assert(c(3,3) == 17 && c(3,0) == 4, "mult");
+#endif
+
+  constexpr thx::quat<S> q(1, 2, 3, 4);
+  constexpr thx::quat<S> r = q*q - S(2)*q;
+  static_assert(r[0] == -30 && r[1] == 0 && r[2] == 0 && r[3] == 0, "quat");
+
+#if defined(THX_HAS_CONSTANT_EVALUATED)
+  constexpr thx::mat<3,S> rz = thx::rotation_z(thx::deg_to_rad(S(90)));
+  static_assert(rz(2,2) == 1 && rz(0,1) > S(0.999) && rz(1,0) < S(-0.999),
+                "rotation_z");
+  const thx::mat<3,S> rt = thx::rotation_z(thx::deg_to_rad(S(90)));
+  for (int i = 0; i < 9; ++i) {
+    ASSERT_NEAR(rt[i], rz[i], 4*std::numeric_limits<S>::epsilon());
+  }
+#endif
+}
+
+#endif // THX_HAS_CONST_EXPR
+
 } // Namespace: anonymous
 
 int